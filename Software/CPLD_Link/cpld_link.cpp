@@ -0,0 +1,477 @@
+/*
+ ============================================================================
+ * @file    cpld_link.cpp
+ * @brief   Host program for framed commands to the CPLD tester
+ *
+ *  Usage:
+ *    cpld_link                                 Loopback test over a pseudo-terminal
+ *    cpld_link <device> [baud] <command>...    Send commands as a single batch
+ *
+ *  Commands:
+ *    power <0|1>    Power target off/on
+ *    clock <Hz>     Set CPLD clock frequency
+ *    vdd            Read target Vdd
+ ============================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include "../CPLD_Tester_MKL03/Sources/commandFrame.h"
+
+using namespace USBDM;
+
+/**
+ * Framed link to a tester over a file descriptor
+ */
+class FrameLink {
+   int                  fd;
+   uint8_t              sequence = 0;
+   FrameReceiver_T<4>   receiver;
+
+public:
+   FrameLink(int fd) : fd(fd) {
+   }
+
+   /**
+    * Send a request.
+    * Sets the sequence number of the request.
+    *
+    * @param[inout] request  Request to send
+    *
+    * @return Sequence number used
+    */
+   uint8_t send(Frame &request) {
+      uint8_t buffer[FRAME_MAX_PAYLOAD+5];
+      unsigned length = 0;
+
+      request.sequence = sequence++;
+      sendFrame(request, [&](uint8_t data) {
+         buffer[length++] = data;
+      });
+      if (write(fd, buffer, length) != (ssize_t)length) {
+         perror("write");
+         exit(1);
+      }
+      return request.sequence;
+   }
+
+   /**
+    * Receive the next response.
+    * Log frames (see CPLD_Log) are skipped.
+    *
+    * @param[out] response   Response received
+    * @param[in]  timeoutMs  How long to wait
+    *
+    * @return false on timeout
+    */
+   bool receive(Frame &response, int timeoutMs=1000) {
+      for(;;) {
+         Frame *frame = receiver.getFrame();
+         if (frame != nullptr) {
+            response = *frame;
+            receiver.releaseFrame();
+            if ((response.status == FrameStatus_Ok) && (response.length > 0) && (response.payload[0] == FRAME_LOG)) {
+               continue;
+            }
+            return true;
+         }
+         pollfd pfd = {fd, POLLIN, 0};
+         if (poll(&pfd, 1, timeoutMs) <= 0) {
+            return false;
+         }
+         uint8_t buffer[256];
+         ssize_t count = read(fd, buffer, sizeof(buffer));
+         if (count <= 0) {
+            return false;
+         }
+         for (ssize_t index=0; index<count; index++) {
+            receiver.receive(buffer[index]);
+         }
+      }
+   }
+};
+
+/**
+ * Put a terminal into raw mode
+ *
+ * @param[in] fd    Terminal
+ * @param[in] baud  Baud rate (0 => unchanged)
+ */
+static void setRaw(int fd, speed_t baud=0) {
+   termios settings;
+   tcgetattr(fd, &settings);
+   cfmakeraw(&settings);
+   if (baud != 0) {
+      cfsetspeed(&settings, baud);
+   }
+   tcsetattr(fd, TCSANOW, &settings);
+}
+
+/**
+ * Print the results in a response
+ *
+ * @param[in] response Response frame
+ */
+static void printResponse(const Frame &response) {
+   FrameReader reader(response.payload, response.length);
+   uint32_t frameStatus;
+   if (!reader.read(frameStatus, 1)) {
+      printf("Empty response\n");
+      return;
+   }
+   printf("Frame %u status %u\n", response.sequence, (unsigned)frameStatus);
+   uint32_t command, status, value;
+   while (reader.read(command, 1) && reader.read(status, 1)) {
+      printf("  Command %u status %u", (unsigned)command, (unsigned)status);
+      if ((status == FrameStatus_UnknownCommand) || (status == FrameStatus_BadLength)) {
+         printf("\n");
+         break;
+      }
+      switch(command) {
+         case FrameCommand_Power:
+            reader.read(value, 1);
+            printf(" power=%u", (unsigned)value);
+            break;
+         case FrameCommand_Clock:
+            reader.read(value, 4);
+            printf(" frequency=%u Hz", (unsigned)value);
+            break;
+         case FrameCommand_Vectors:
+            reader.read(value, 2);
+            printf(" failures=%u", (unsigned)value);
+            reader.read(value, 2);
+            printf(" first=%u", (unsigned)value);
+            reader.read(value, 2);
+            printf(" response=0x%X", (unsigned)value);
+            break;
+         case FrameCommand_ReadVdd:
+            reader.read(value, 2);
+            printf(" vdd=%u", (unsigned)value);
+            reader.read(value, 1);
+            printf(" flags=0x%X", (unsigned)value);
+            break;
+      }
+      printf("\n");
+   }
+}
+
+/**
+ * Tester simulated on the host.
+ * The simulated CPLD returns bit 0 of the stimulus as the response.
+ */
+class SimulatedTester {
+public:
+   uint8_t  powerStatus = 0;
+   uint32_t vectorsApplied = 0;
+
+   FrameStatus power(bool on, uint8_t &status) {
+      powerStatus = on?1:0;
+      status      = powerStatus;
+      return FrameStatus_Ok;
+   }
+   FrameStatus clock(uint32_t &frequency) {
+      if (powerStatus != 1) {
+         frequency = 0;
+         return FrameStatus_NotPowered;
+      }
+      // 48 MHz timer toggling the clock output
+      frequency = 24000000/(24000000/frequency);
+      return FrameStatus_Ok;
+   }
+   FrameStatus vectors(const uint8_t vectors[], unsigned count, FrameVectorResult &result) {
+      if (powerStatus != 1) {
+         return FrameStatus_NotPowered;
+      }
+      result = {0, 0, 0};
+      for (unsigned index=0; index<count; index++) {
+         const uint8_t *vector = vectors+index*FRAME_VECTOR_SIZE;
+         unsigned stimulus = vector[0]|(vector[1]<<8);
+         unsigned expected = vector[2]|(vector[3]<<8);
+         unsigned mask     = vector[4]|(vector[5]<<8);
+         unsigned response = stimulus&1;
+         if (((response^expected)&mask) != 0) {
+            if (result.failCount == 0) {
+               result.firstFailIndex    = vectorsApplied+index;
+               result.firstFailResponse = response;
+            }
+            result.failCount++;
+         }
+      }
+      vectorsApplied += count;
+      return FrameStatus_Ok;
+   }
+   FrameStatus readVdd(uint16_t &value, uint8_t &flags) {
+      value = (powerStatus == 1)?230:10;
+      flags = (powerStatus == 1)?FRAME_VDD_PROTECTED:0;
+      return FrameStatus_Ok;
+   }
+};
+
+/**
+ * Run a simulated tester on a file descriptor until stopped.
+ * Holds only FRAME_RX_BUFFERS frames like the firmware.
+ */
+static void runSimulatedTester(int fd, std::atomic<bool> &stop) {
+   SimulatedTester           tester;
+   FrameReceiver_T<>         receiver;
+   Frame                     response;
+
+   while (!stop) {
+      pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 10) <= 0) {
+         continue;
+      }
+      uint8_t buffer[256];
+      ssize_t count = read(fd, buffer, sizeof(buffer));
+      for (ssize_t index=0; index<count; index++) {
+         receiver.receive(buffer[index]);
+      }
+      Frame *request;
+      while ((request = receiver.getFrame()) != nullptr) {
+         executeFrame(*request, response, tester);
+         receiver.releaseFrame();
+         uint8_t  out[FRAME_MAX_PAYLOAD+5];
+         unsigned length = 0;
+         sendFrame(response, [&](uint8_t data) {
+            out[length++] = data;
+         });
+         if (write(fd, out, length) != (ssize_t)length) {
+            perror("write");
+         }
+      }
+   }
+}
+
+/**
+ * Add a vector block command to a request
+ *
+ * @param[inout] writer  Request being built
+ * @param[in]    count   Number of vectors
+ * @param[in]    failAt  Vector index to make fail (count => none)
+ */
+static void addVectors(FrameWriter &writer, unsigned count, unsigned failAt) {
+   writer.write(FrameCommand_Vectors, 1);
+   writer.write(count, 1);
+   for (unsigned index=0; index<count; index++) {
+      unsigned stimulus = index;
+      unsigned expected = (index == failAt)?((index&1)^1):(index&1);
+      writer.write(stimulus, 2);
+      writer.write(expected, 2);
+      writer.write(0x0001, 2);
+   }
+}
+
+/**
+ * Loopback test against the simulated tester over a pseudo-terminal
+ *
+ * @return true on success
+ */
+static bool loopbackTest() {
+   int master = posix_openpt(O_RDWR|O_NOCTTY);
+   if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)) {
+      perror("posix_openpt");
+      return false;
+   }
+   int slave = open(ptsname(master), O_RDWR|O_NOCTTY);
+   if (slave < 0) {
+      perror("open");
+      return false;
+   }
+   setRaw(master);
+   setRaw(slave);
+
+   std::atomic<bool> stop{false};
+   std::thread tester(runSimulatedTester, slave, std::ref(stop));
+
+   FrameLink link(master);
+   Frame     request, response;
+   bool      success = true;
+
+   auto check = [&](bool condition, const char *message) {
+      if (!condition) {
+         printf("Failed: %s\n", message);
+         success = false;
+      }
+   };
+
+   // Batch of commands in one frame
+   {
+      FrameWriter writer(request);
+      writer.write(FrameCommand_Clock, 1);
+      writer.write(1000000, 4);
+      writer.write(FrameCommand_ReadVdd, 1);
+      link.send(request);
+      check(link.receive(response), "No response");
+      printResponse(response);
+      check((response.length == 1+6) && (response.payload[2] == FrameStatus_NotPowered), "Batch stops at clock while unpowered");
+   }
+   {
+      FrameWriter writer(request);
+      writer.write(FrameCommand_Power, 1);
+      writer.write(1, 1);
+      writer.write(FrameCommand_Clock, 1);
+      writer.write(7000000, 4);
+      writer.write(FrameCommand_ReadVdd, 1);
+      addVectors(writer, 3, 2);
+      uint8_t sequence = link.send(request);
+      check(link.receive(response), "No response");
+      printResponse(response);
+      check(response.sequence == sequence, "Sequence");
+      check(response.length == 1+3+6+5+8, "Batch response length");
+      FrameReader reader(response.payload, response.length);
+      uint32_t value;
+      reader.readBlock(1+3+2);
+      reader.read(value, 4);
+      check(value == 8000000, "Clock quantised");
+      reader.readBlock(5+2);
+      reader.read(value, 2);
+      check(value == 1, "Vector failures");
+      reader.read(value, 2);
+      check(value == 2, "First failing vector");
+   }
+   // Corrupted frame
+   {
+      FrameWriter writer(request);
+      writer.write(FrameCommand_ReadVdd, 1);
+      request.sequence = 0x55;
+      uint8_t buffer[FRAME_MAX_PAYLOAD+5];
+      unsigned length = 0;
+      sendFrame(request, [&](uint8_t data) {
+         buffer[length++] = data;
+      });
+      buffer[3] ^= 0x10;
+      check(write(master, buffer, length) == (ssize_t)length, "Write");
+      check(link.receive(response), "No response");
+      check((response.sequence == 0x55) && (response.length == 1) && (response.payload[0] == FrameStatus_CrcError), "CRC error");
+   }
+   // Unknown command stops batch
+   {
+      FrameWriter writer(request);
+      writer.write(FrameCommand_ReadVdd, 1);
+      writer.write(0x7F, 1);
+      writer.write(FrameCommand_ReadVdd, 1);
+      link.send(request);
+      check(link.receive(response), "No response");
+      check((response.length == 1+5+2) && (response.payload[7] == FrameStatus_UnknownCommand), "Unknown command");
+   }
+   // Pipelined vector blocks
+   {
+      constexpr unsigned FRAMES = 20000;
+      unsigned sent        = 0;
+      unsigned received    = 0;
+      unsigned outstanding = 0;
+      uint8_t  expected    = 0;
+      auto start = std::chrono::steady_clock::now();
+      while (received < FRAMES) {
+         while ((sent < FRAMES) && (outstanding < FRAME_RX_BUFFERS)) {
+            FrameWriter writer(request);
+            addVectors(writer, FRAME_MAX_VECTORS, FRAME_MAX_VECTORS);
+            uint8_t sequence = link.send(request);
+            if (sent == 0) {
+               expected = sequence;
+            }
+            sent++;
+            outstanding++;
+         }
+         if (!link.receive(response)) {
+            check(false, "Pipelined response");
+            break;
+         }
+         check(response.sequence == expected++, "Pipelined sequence");
+         check((response.payload[0] == FrameStatus_Ok) && (response.payload[3] == 0), "Pipelined result");
+         received++;
+         outstanding--;
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+      printf("%u pipelined frames of %u vectors in %.3f s (%.0f vectors/s)\n",
+            received, FRAME_MAX_VECTORS, seconds, received*FRAME_MAX_VECTORS/seconds);
+   }
+   stop = true;
+   tester.join();
+   close(slave);
+   close(master);
+   return success;
+}
+
+/**
+ * Convert baud rate to termios speed
+ */
+static speed_t getSpeed(unsigned long baud) {
+   switch(baud) {
+      case 9600   : return B9600;
+      case 19200  : return B19200;
+      case 38400  : return B38400;
+      case 57600  : return B57600;
+      case 115200 : return B115200;
+      case 230400 : return B230400;
+      default     : return 0;
+   }
+}
+
+int main(int argc, char *argv[]) {
+   if (argc < 2) {
+      bool success = loopbackTest();
+      printf("Loopback test %s\n", success?"passed":"failed");
+      return success?0:1;
+   }
+   int fd = open(argv[1], O_RDWR|O_NOCTTY);
+   if (fd < 0) {
+      perror(argv[1]);
+      return 1;
+   }
+   int     arg  = 2;
+   speed_t baud = B115200;
+   if ((arg < argc) && (getSpeed(strtoul(argv[arg], nullptr, 0)) != 0)) {
+      baud = getSpeed(strtoul(argv[arg++], nullptr, 0));
+   }
+   setRaw(fd, baud);
+
+   Frame request, response;
+   FrameWriter writer(request);
+   while (arg < argc) {
+      if ((strcmp(argv[arg], "power") == 0) && (arg+1 < argc)) {
+         writer.write(FrameCommand_Power, 1);
+         writer.write(strtoul(argv[arg+1], nullptr, 0), 1);
+         arg += 2;
+      }
+      else if ((strcmp(argv[arg], "clock") == 0) && (arg+1 < argc)) {
+         writer.write(FrameCommand_Clock, 1);
+         writer.write(strtoul(argv[arg+1], nullptr, 0), 4);
+         arg += 2;
+      }
+      else if (strcmp(argv[arg], "vdd") == 0) {
+         writer.write(FrameCommand_ReadVdd, 1);
+         arg += 1;
+      }
+      else {
+         fprintf(stderr, "Unknown command '%s'\n", argv[arg]);
+         return 1;
+      }
+      if (writer.space() < 5) {
+         fprintf(stderr, "Too many commands\n");
+         return 1;
+      }
+   }
+   // Tester may be in VLPS where the first character is lost
+   if (write(fd, "\n", 1) != 1) {
+      perror(argv[1]);
+      return 1;
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+   FrameLink link(fd);
+   link.send(request);
+   if (!link.receive(response)) {
+      fprintf(stderr, "No response\n");
+      return 1;
+   }
+   printResponse(response);
+   return 0;
+}
@@ -0,0 +1,579 @@
+/*
+ ============================================================================
+ * @file    cpld_log.cpp
+ * @brief   Host decoder for tokenized log records from the CPLD tester
+ *
+ *  Usage:
+ *    cpld_log                            Self test of logging, decoding and table extraction
+ *    cpld_log <elf> <device> [baud]      Enable logging on a tester and print the messages
+ *    cpld_log <elf> -                    Decode a captured stream from stdin
+ *
+ *  The format strings are read from the TOKEN_LOG_SECTION section of the ELF file
+ *  built for the tester. Log records arrive in log frames (see commandFrame.h).
+ *  Bytes that are not part of a frame are printed unchanged.
+ ============================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <elf.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include "../CPLD_Tester_MKL03/Sources/tokenLog.h"
+#include "../CPLD_Tester_MKL03/Sources/commandFrame.h"
+
+using namespace USBDM;
+
+/// Format strings indexed by ID
+using LogTable = std::map<uint16_t, std::string>;
+
+/**
+ * Read the format strings from an ELF file (32 or 64-bit little-endian)
+ *
+ * @param[in]  filename  ELF file
+ * @param[out] table     Format strings indexed by ID
+ *
+ * @return false on error
+ */
+static bool readLogTable(const char *filename, LogTable &table) {
+   FILE *fp = fopen(filename, "rb");
+   if (fp == nullptr) {
+      perror(filename);
+      return false;
+   }
+   std::vector<uint8_t> image;
+   uint8_t buffer[4096];
+   size_t  length;
+   while ((length = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+      image.insert(image.end(), buffer, buffer+length);
+   }
+   fclose(fp);
+
+   if ((image.size() < EI_NIDENT) || (memcmp(image.data(), ELFMAG, SELFMAG) != 0) || (image[EI_DATA] != ELFDATA2LSB)) {
+      fprintf(stderr, "%s: Not a little-endian ELF file\n", filename);
+      return false;
+   }
+   // Section headers as (name, offset, size)
+   struct Section {
+      uint32_t name;
+      uint64_t offset;
+      uint64_t size;
+   };
+   std::vector<Section> sections;
+   unsigned stringIndex;
+   auto fits = [&](uint64_t offset, uint64_t size) {
+      return (offset <= image.size()) && (size <= image.size()-offset);
+   };
+   if (image[EI_CLASS] == ELFCLASS32) {
+      Elf32_Ehdr header;
+      memcpy(&header, image.data(), sizeof(header));
+      for (unsigned index=0; index<header.e_shnum; index++) {
+         Elf32_Shdr section;
+         uint64_t offset = header.e_shoff+index*header.e_shentsize;
+         if (!fits(offset, sizeof(section))) {
+            break;
+         }
+         memcpy(&section, image.data()+offset, sizeof(section));
+         sections.push_back({section.sh_name, section.sh_offset, section.sh_size});
+      }
+      stringIndex = header.e_shstrndx;
+   }
+   else {
+      Elf64_Ehdr header;
+      memcpy(&header, image.data(), sizeof(header));
+      for (unsigned index=0; index<header.e_shnum; index++) {
+         Elf64_Shdr section;
+         uint64_t offset = header.e_shoff+index*header.e_shentsize;
+         if (!fits(offset, sizeof(section))) {
+            break;
+         }
+         memcpy(&section, image.data()+offset, sizeof(section));
+         sections.push_back({section.sh_name, section.sh_offset, section.sh_size});
+      }
+      stringIndex = header.e_shstrndx;
+   }
+   if ((stringIndex >= sections.size()) || !fits(sections[stringIndex].offset, sections[stringIndex].size)) {
+      fprintf(stderr, "%s: No section names\n", filename);
+      return false;
+   }
+   const Section &names = sections[stringIndex];
+   for (const Section &section:sections) {
+      if ((section.name >= names.size) ||
+          (strncmp((const char *)image.data()+names.offset+section.name, TOKEN_LOG_SECTION, names.size-section.name) != 0)) {
+         continue;
+      }
+      if (!fits(section.offset, section.size)) {
+         break;
+      }
+      // Strings are packed one after another (padding is '\0')
+      const char *strings = (const char *)image.data()+section.offset;
+      for (uint64_t offset=0; offset<section.size;) {
+         size_t length = strnlen(strings+offset, section.size-offset);
+         if (length > 0) {
+            table[offset] = std::string(strings+offset, length);
+         }
+         offset += length+1;
+      }
+      return true;
+   }
+   fprintf(stderr, "%s: No " TOKEN_LOG_SECTION " section\n", filename);
+   return false;
+}
+
+/**
+ * Rebuild the text of a record
+ *
+ * @param[in] table   Format strings indexed by ID
+ * @param[in] record  Record
+ *
+ * @return Text of message
+ */
+static std::string formatRecord(const LogTable &table, const TokenLogRecord &record) {
+   char buffer[80];
+   if (record.id == TOKEN_LOG_ID_DROPPED) {
+      snprintf(buffer, sizeof(buffer), "<%u log records dropped>", (unsigned)record.args[0]);
+      return buffer;
+   }
+   auto entry = table.find(record.id);
+   if (entry == table.end()) {
+      snprintf(buffer, sizeof(buffer), "<unknown log ID 0x%04X>", record.id);
+      return buffer;
+   }
+   const char  *format = entry->second.c_str();
+   std::string  text;
+   unsigned     arg = 0;
+   while (*format != '\0') {
+      if (((format[0] == '{') || (format[0] == '}')) && (format[1] == format[0])) {
+         text += *format;
+         format += 2;
+         continue;
+      }
+      if (*format != '{') {
+         text += *format++;
+         continue;
+      }
+      // Field {:[0|<][width][b|o|d|x|X]}
+      const char *end = strchr(format, '}');
+      if ((end == nullptr) || (arg >= record.count)) {
+         text += format;
+         break;
+      }
+      std::string spec(format+1, end);
+      format = end+1;
+      char padding = ' ';
+      bool left    = false;
+      int  width   = 0;
+      char radix   = 'd';
+      size_t pos = 0;
+      if ((pos < spec.size()) && (spec[pos] == ':')) {
+         pos++;
+         if ((pos < spec.size()) && (spec[pos] == '0')) {
+            padding = '0';
+            pos++;
+         }
+         else if ((pos < spec.size()) && (spec[pos] == '<')) {
+            left = true;
+            pos++;
+         }
+         while ((pos < spec.size()) && isdigit(spec[pos])) {
+            width = 10*width+(spec[pos++]-'0');
+         }
+         if (pos < spec.size()) {
+            radix = spec[pos];
+         }
+      }
+      uint32_t value      = record.args[arg];
+      bool     isNegative = (record.signedArgs&(1<<arg)) && ((int32_t)value < 0);
+      arg++;
+      if (isNegative) {
+         value = -value;
+      }
+      std::string digits;
+      switch(radix) {
+         case 'b':
+            do {
+               digits.insert(digits.begin(), '0'+(value&1));
+               value >>= 1;
+            } while (value != 0);
+            break;
+         case 'o': snprintf(buffer, sizeof(buffer), "%o", value); digits = buffer; break;
+         case 'x':
+         case 'X': snprintf(buffer, sizeof(buffer), "%X", value); digits = buffer; break;
+         default:  snprintf(buffer, sizeof(buffer), "%u", value); digits = buffer; break;
+      }
+      // As FormattedIO - zero padding goes before the sign
+      if (padding == '0') {
+         while ((int)digits.size()+isNegative < width) {
+            digits.insert(digits.begin(), '0');
+         }
+      }
+      if (isNegative) {
+         digits.insert(digits.begin(), '-');
+      }
+      while ((int)digits.size() < width) {
+         if (left) {
+            digits += ' ';
+         }
+         else {
+            digits.insert(digits.begin(), ' ');
+         }
+      }
+      text += digits;
+   }
+   return text;
+}
+
+/**
+ * Separates log frames from other output of the tester and decodes their records.
+ * Other frames (responses) are ignored.
+ */
+class LogStream {
+   FrameReceiver_T<1> receiver;
+   TokenLogDecoder    decoder;
+
+public:
+   /**
+    * Process a byte
+    *
+    * @tparam Other   Callable as void other(uint8_t data)
+    * @tparam Record  Callable as void record(const TokenLogRecord *record)
+    *
+    * @param[in] data    Byte received
+    * @param[in] other   Receives bytes that are not part of a frame
+    * @param[in] record  Receives each record (nullptr for a malformed record or log frame)
+    */
+   template<typename Other, typename Record>
+   void receive(uint8_t data, Other other, Record record) {
+      if (!receiver.isReceiving() && (data != FRAME_SYNC)) {
+         other(data);
+         return;
+      }
+      receiver.receive(data);
+      Frame *frame = receiver.getFrame();
+      if (frame == nullptr) {
+         return;
+      }
+      if ((frame->length > 0) && (frame->payload[0] == FRAME_LOG)) {
+         if (frame->status != FrameStatus_Ok) {
+            record(nullptr);
+         }
+         else {
+            decoder.reset();
+            for (unsigned index=1; index<frame->length; index++) {
+               switch(decoder.receive(frame->payload[index])) {
+                  case TokenLogDecoder::Result_Record: record(&decoder.getRecord()); break;
+                  case TokenLogDecoder::Result_Error:  record(nullptr);              break;
+                  case TokenLogDecoder::Result_Busy:                                break;
+               }
+            }
+            if (decoder.isBusy()) {
+               // Truncated record
+               record(nullptr);
+            }
+         }
+      }
+      receiver.releaseFrame();
+   }
+};
+
+/**
+ * Pack log records into a log frame
+ *
+ * @tparam Log     TokenLog_T to drain
+ * @tparam Output  Callable as void output(uint8_t byte)
+ *
+ * @param[in] log     Log to drain
+ * @param[in] output  Receives each byte of the frame
+ *
+ * @return Number of records in frame (no frame is sent if 0)
+ */
+template<class Log, typename Output>
+static unsigned sendLogFrame(Log &log, Output output) {
+   Frame    frame;
+   unsigned records = 0;
+   unsigned size;
+   frame.sequence = 0;
+   frame.length   = 0;
+   frame.payload[frame.length++] = FRAME_LOG;
+   while (((frame.length+TOKEN_LOG_MAX_RECORD) <= FRAME_MAX_PAYLOAD) && ((size = log.drain(frame.payload+frame.length)) > 0)) {
+      frame.length += size;
+      records++;
+   }
+   if (records > 0) {
+      sendFrame(frame, output);
+   }
+   return records;
+}
+
+/**
+ * Lock for the host ring (spin lock)
+ */
+class HostLock {
+   static std::atomic_flag flag;
+public:
+   HostLock() {
+      while (flag.test_and_set(std::memory_order_acquire)) {
+      }
+   }
+   ~HostLock() {
+      flag.clear(std::memory_order_release);
+   }
+};
+std::atomic_flag HostLock::flag = ATOMIC_FLAG_INIT;
+
+/**
+ * Self test.
+ * Messages are logged from a producer thread and drained by this thread with text interleaved.
+ * The stream is decoded using the table read from this program's own ELF file.
+ *
+ * @return true on success
+ */
+static bool selfTest() {
+   LogTable table;
+   if (!readLogTable("/proc/self/exe", table)) {
+      return false;
+   }
+   bool success = true;
+   auto check = [&](bool condition, const char *message) {
+      if (!condition) {
+         printf("Failed: %s\n", message);
+         success = false;
+      }
+   };
+
+   // Formatting of fields
+   {
+      static TokenLog_T<HostLock, 16> log;
+      std::vector<uint8_t> stream;
+      TOKEN_LOG(log, "Plain text {{}}");
+      TOKEN_LOG(log, "{} {} {} {}", 0, -1, 2147483647, (int32_t)-2147483647-1);
+      TOKEN_LOG(log, "[{:08x}] [{:4}] [{:<4d}] [{:b}]", 0xBEEFu, -12, 7, (uint8_t)5);
+      TOKEN_LOG(log, "[{:05}] [{:o}]", (int16_t)-42, 8u);
+      TOKEN_LOG(log, "Ring now full {}", 1);
+      TOKEN_LOG(log, "Dropped {}", 2);
+      check(log.getDropped() == 1, "Record dropped when ring full");
+      while (sendLogFrame(log, [&](uint8_t data) { stream.push_back(data); }) > 0) {
+      }
+      const char *expected[] = {
+            "<1 log records dropped>",
+            "Plain text {}",
+            "0 -1 2147483647 -2147483648",
+            "[0000BEEF] [ -12] [7   ] [101]",
+            "[-0042] [10]",
+            "Ring now full 1",
+      };
+      LogStream logStream;
+      unsigned  index = 0;
+      bool      clean = true;
+      for (uint8_t data:stream) {
+         logStream.receive(data, [&](uint8_t) { clean = false; }, [&](const TokenLogRecord *record) {
+            if (record == nullptr) {
+               clean = false;
+               return;
+            }
+            std::string text = formatRecord(table, *record);
+            printf("  %s\n", text.c_str());
+            check((index < sizeof(expected)/sizeof(expected[0])) && (text == expected[index]), "Formatted text");
+            index++;
+         });
+      }
+      check(clean, "Frames decoded");
+      check(index == sizeof(expected)/sizeof(expected[0]), "Number of records");
+   }
+   // Concurrent producer with interleaved text and response frames
+   // Records dropped when the ring is full must be accounted for by the drop reports
+   {
+      static TokenLog_T<HostLock, 64> log;
+      constexpr unsigned MESSAGES = 1000000;
+      std::atomic<bool> done{false};
+      std::thread producer([&]() {
+         for (unsigned count=0; count<MESSAGES; count++) {
+            TOKEN_LOG(log, "Sequence {} {}", count, -(int)count-1);
+            if ((count%16) == 15) {
+               std::this_thread::yield();
+            }
+         }
+         done = true;
+      });
+      std::vector<uint8_t> stream;
+      unsigned frames = 0;
+      while (!done || log.isPending()) {
+         if (sendLogFrame(log, [&](uint8_t data) { stream.push_back(data); }) == 0) {
+            std::this_thread::yield();
+            continue;
+         }
+         if ((frames%100) == 0) {
+            const char *line = "OK 10 0\n";
+            stream.insert(stream.end(), line, line+strlen(line));
+            // Response frame containing a byte that was the old record sync
+            Frame response = {2, 7, FrameStatus_Ok, {FrameStatus_Ok, 0xA6}};
+            sendFrame(response, [&](uint8_t data) { stream.push_back(data); });
+         }
+         frames++;
+      }
+      producer.join();
+      LogStream logStream;
+      uint32_t  received = 0;
+      uint32_t  dropped  = 0;
+      uint32_t  next     = 0;
+      unsigned  other    = 0;
+      bool      inOrder  = true;
+      for (uint8_t data:stream) {
+         logStream.receive(data, [&](uint8_t) { other++; }, [&](const TokenLogRecord *record) {
+            if (record == nullptr) {
+               inOrder = false;
+               return;
+            }
+            if (record->id == TOKEN_LOG_ID_DROPPED) {
+               dropped = record->args[0];
+               return;
+            }
+            inOrder = inOrder && (record->count == 2) && (record->args[0] >= next) &&
+                      (formatRecord(table, *record) == "Sequence "+std::to_string(record->args[0])+" -"+std::to_string(record->args[0]+1));
+            next = record->args[0]+1;
+            received++;
+         });
+      }
+      printf("  %u records received, %u dropped\n", (unsigned)received, (unsigned)dropped);
+      check(inOrder, "Records in order and intact");
+      check(received+dropped == MESSAGES, "Dropped records reported");
+      check(other == 8*((frames+99)/100), "Text passed through");
+   }
+   // Cost and wire size against text
+   {
+      static TokenLog_T<HostLock, 1024> log;
+      constexpr unsigned REPEATS = 1000;
+      constexpr unsigned RECORDS = 256;
+      char     text[80];
+      double   logNs = 0, drainNs = 0, textNs = 0;
+      unsigned wireBytes = 0, textBytes = 0;
+
+      for (unsigned repeat=0; repeat<REPEATS; repeat++) {
+         auto start = std::chrono::steady_clock::now();
+         for (unsigned count=0; count<RECORDS; count++) {
+            TOKEN_LOG(log, "Target Vdd fault, sample={} threshold={}", count, 200);
+         }
+         auto logged = std::chrono::steady_clock::now();
+         // Includes the framing
+         while (sendLogFrame(log, [&](uint8_t) { wireBytes++; }) > 0) {
+         }
+         auto drained = std::chrono::steady_clock::now();
+         for (unsigned count=0; count<RECORDS; count++) {
+            textBytes += snprintf(text, sizeof(text), "Target Vdd fault, sample=%u threshold=%u\r\n", count, 200);
+         }
+         auto printed = std::chrono::steady_clock::now();
+         logNs   += std::chrono::duration<double, std::nano>(logged-start).count();
+         drainNs += std::chrono::duration<double, std::nano>(drained-logged).count();
+         textNs  += std::chrono::duration<double, std::nano>(printed-drained).count();
+      }
+      constexpr double messages = REPEATS*RECORDS;
+      printf("Per message: log %.1f ns, drain %.1f ns, snprintf %.1f ns\n", logNs/messages, drainNs/messages, textNs/messages);
+      printf("Wire bytes per message: %.1f framed record, %.1f text (%.1fx)\n",
+            wireBytes/messages, textBytes/messages, textBytes/(double)wireBytes);
+      check(log.getDropped() == 0, "No records dropped");
+   }
+   return success;
+}
+
+/**
+ * Put a terminal into raw mode
+ *
+ * @param[in] fd    Terminal
+ * @param[in] baud  Baud rate (0 => unchanged)
+ */
+static void setRaw(int fd, speed_t baud=0) {
+   termios settings;
+   tcgetattr(fd, &settings);
+   cfmakeraw(&settings);
+   if (baud != 0) {
+      cfsetspeed(&settings, baud);
+   }
+   tcsetattr(fd, TCSANOW, &settings);
+}
+
+/**
+ * Convert baud rate to termios speed
+ */
+static speed_t getSpeed(unsigned long baud) {
+   switch(baud) {
+      case 9600   : return B9600;
+      case 19200  : return B19200;
+      case 38400  : return B38400;
+      case 57600  : return B57600;
+      case 115200 : return B115200;
+      case 230400 : return B230400;
+      default     : return 0;
+   }
+}
+
+int main(int argc, char *argv[]) {
+   if (argc < 2) {
+      bool success = selfTest();
+      printf("Self test %s\n", success?"passed":"failed");
+      return success?0:1;
+   }
+   if (argc < 3) {
+      fprintf(stderr, "Usage: cpld_log <elf> <device|-> [baud]\n");
+      return 1;
+   }
+   LogTable table;
+   if (!readLogTable(argv[1], table)) {
+      return 1;
+   }
+   int fd = STDIN_FILENO;
+   if (strcmp(argv[2], "-") != 0) {
+      fd = open(argv[2], O_RDWR|O_NOCTTY);
+      if (fd < 0) {
+         perror(argv[2]);
+         return 1;
+      }
+      speed_t baud = B115200;
+      if ((argc > 3) && (getSpeed(strtoul(argv[3], nullptr, 0)) != 0)) {
+         baud = getSpeed(strtoul(argv[3], nullptr, 0));
+      }
+      setRaw(fd, baud);
+      // Tester may be in VLPS where the first character is lost
+      if (write(fd, "\n", 1) != 1) {
+         perror(argv[2]);
+         return 1;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      if (write(fd, "L", 1) != 1) {
+         perror(argv[2]);
+         return 1;
+      }
+   }
+   LogStream logStream;
+   bool      atLineStart = true;
+   uint8_t   buffer[256];
+   ssize_t   length;
+   while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+      for (ssize_t index=0; index<length; index++) {
+         logStream.receive(buffer[index],
+            [&](uint8_t data) {
+               if (data != '\r') {
+                  putchar(data);
+                  atLineStart = (data == '\n');
+               }
+            },
+            [&](const TokenLogRecord *record) {
+               if (record == nullptr) {
+                  printf("%s[log] <malformed record>\n", atLineStart?"":"\n");
+               }
+               else {
+                  printf("%s[log] %s\n", atLineStart?"":"\n", formatRecord(table, *record).c_str());
+               }
+               atLineStart = true;
+            });
+      }
+      fflush(stdout);
+   }
+   return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ ============================================================================
+ * @file    cpld_model.cpp
+ * @brief   Host program for the cpld_tester golden model
+ *
+ *  Usage:
+ *    cpld_model                              Check bit-sliced model and benchmark
+ *    cpld_model trace <cycles> [phaseStep]   Print expected leds[31:0] for all lanes
+ ============================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "cpld_model.h"
+
+using namespace CpldModel;
+
+/**
+ * Check the bit-sliced model against the reference model for every lane
+ *
+ * @param[in] cycles    Number of clocks to check
+ * @param[in] phaseStep Clocks between lane phases
+ *
+ * @return true on success
+ */
+static bool checkModel(unsigned long cycles, unsigned long phaseStep) {
+   CpldTesterModel64 model;
+   CpldTesterModel   reference[CpldTesterModel64::LANES];
+
+   model.resetPhased(phaseStep);
+   for (unsigned lane=0; lane<CpldTesterModel64::LANES; lane++) {
+      reference[lane] = CpldTesterModel(model.getLane(lane));
+   }
+   for (unsigned long cycle=0; cycle<cycles; cycle++) {
+      model.clock();
+      for (unsigned lane=0; lane<CpldTesterModel64::LANES; lane++) {
+         reference[lane].clock();
+         if (model.getLeds(lane) != reference[lane].getLeds()) {
+            printf("Mismatch: cycle %lu, lane %u, leds = %08lX, expected %08lX\n",
+                  cycle, lane,
+                  (unsigned long)model.getLeds(lane),
+                  (unsigned long)reference[lane].getLeds());
+            return false;
+         }
+      }
+   }
+   for (unsigned lane=0; lane<CpldTesterModel64::LANES; lane++) {
+      CpldState s = model.getLane(lane);
+      const CpldState &r = reference[lane].getState();
+      if ((s.prescaler != r.prescaler) || (s.count != r.count) ||
+          (s.flash != r.flash) || (s.selectOut != r.selectOut) || (s.chaser != r.chaser)) {
+         printf("State mismatch: lane %u\n", lane);
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Time the bit-sliced model
+ *
+ * @param[in] cycles Number of clocks to simulate
+ */
+static void benchmark(unsigned long cycles) {
+   CpldTesterModel64 model;
+   model.resetPhased(1);
+
+   auto start = std::chrono::steady_clock::now();
+   model.clock(cycles);
+   auto finish = std::chrono::steady_clock::now();
+
+   // Keep result live
+   volatile uint64_t sink = model.chaserPlane(0);
+   (void)sink;
+
+   double seconds = std::chrono::duration<double>(finish-start).count();
+   printf("%lu clocks x %u lanes in %.3f s\n", cycles, CpldTesterModel64::LANES, seconds);
+   printf("  %.1f M clocks/s per lane-group, %.1f M device clocks/s\n",
+         cycles/seconds/1e6, cycles*CpldTesterModel64::LANES/seconds/1e6);
+}
+
+/**
+ * Print expected LED trace.
+ * One line per clock, 64 lanes per line.
+ *
+ * @param[in] cycles    Number of clocks to print
+ * @param[in] phaseStep Clocks between lane phases
+ */
+static void trace(unsigned long cycles, unsigned long phaseStep) {
+   CpldTesterModel64 model;
+   model.resetPhased(phaseStep);
+
+   for (unsigned long cycle=0; cycle<cycles; cycle++) {
+      model.clock();
+      printf("%lu", cycle);
+      for (unsigned lane=0; lane<CpldTesterModel64::LANES; lane++) {
+         printf(" %08lX", (unsigned long)model.getLeds(lane));
+      }
+      printf("\n");
+   }
+}
+
+int main(int argc, char *argv[]) {
+   if ((argc >= 3) && (strcmp(argv[1], "trace") == 0)) {
+      unsigned long cycles    = strtoul(argv[2], nullptr, 0);
+      unsigned long phaseStep = (argc >= 4)?strtoul(argv[3], nullptr, 0):0;
+      trace(cycles, phaseStep);
+      return 0;
+   }
+   // Full period is 2 x 32 x 256 clocks - check several periods at a range of phases
+   static const unsigned long phaseSteps[] = {0, 1, 255, 256, 257, 8191};
+   for (unsigned long phaseStep:phaseSteps) {
+      if (!checkModel(5*2*32*256, phaseStep)) {
+         printf("Model check failed (phaseStep = %lu)\n", phaseStep);
+         return 1;
+      }
+   }
+   printf("Model check passed\n");
+   benchmark(100000000UL);
+   return 0;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file cpld_model.h
+ *
+ * Cycle model of the cpld_tester entity (VHDL_TestHardware/CPLD_Tester.vhd)
+ *
+ * Two models are provided:
+ * - CpldTesterModel      Straightforward model of a single device
+ * - CpldTesterModel64    Bit-sliced model of 64 independent devices
+ *
+ * The bit-sliced model holds each register bit as a 64-bit word where
+ * bit n of the word belongs to device (lane) n. One clock edge of all 64
+ * devices is then a handful of word-wide logic operations.
+ */
+
+#ifndef CPLD_MODEL_H_
+#define CPLD_MODEL_H_
+
+#include <stdint.h>
+
+namespace CpldModel {
+
+/// Value at which the prescaler wraps (prescaler_max)
+static constexpr unsigned PRESCALER_MAX = 255;
+
+/// Value at which count wraps (count_max)
+static constexpr unsigned COUNT_MAX     = 31;
+
+/// Value loaded into chaser when count wraps (0=>'0', others => '1')
+static constexpr uint8_t  CHASER_RESET  = 0xFE;
+
+/**
+ * Registers of a single cpld_tester instance
+ */
+struct CpldState {
+   uint8_t prescaler;   //!< prescaler [0..255]
+   uint8_t count;       //!< count [0..31]
+   bool    flash;       //!< flash
+   bool    selectOut;   //!< selectOut
+   uint8_t chaser;      //!< chaser[7:0]
+};
+
+/**
+ * Expand chaser to LED outputs
+ *
+ * @param[in] chaser Chaser register value
+ *
+ * @return leds[31:0] (chaser&chaser&chaser&chaser)
+ */
+static constexpr uint32_t chaserToLeds(uint8_t chaser) {
+   return chaser*0x01010101UL;
+}
+
+/**
+ * Model of a single cpld_tester instance
+ *
+ * This follows the VHDL process directly and is used as the reference
+ * for the bit-sliced model.
+ */
+class CpldTesterModel {
+
+private:
+   CpldState state;
+
+public:
+   /**
+    * Create model in power-on state (all registers zero)
+    */
+   constexpr CpldTesterModel() : state{0, 0, false, false, 0} {
+   }
+
+   /**
+    * Create model with given register state
+    *
+    * @param[in] initialState Initial register values
+    */
+   constexpr CpldTesterModel(const CpldState &initialState) : state(initialState) {
+   }
+
+   /**
+    * Apply one rising edge of clock
+    */
+   void clock() {
+      // All right-hand sides use the register values before the edge
+      CpldState next = state;
+
+      next.prescaler = (state.prescaler+1)&0xFF;
+      if (state.prescaler == PRESCALER_MAX) {
+         next.prescaler = 0;
+         next.count     = (state.count+1)&0x1F;
+         next.flash     = !state.flash;
+         if (!state.selectOut) {
+            next.chaser = state.flash?0xFF:0x00;
+         }
+         else {
+            next.chaser = (state.chaser>>1)|(state.chaser<<7);
+         }
+      }
+      if (state.count == COUNT_MAX) {
+         next.count     = 0;
+         next.selectOut = !state.selectOut;
+         next.chaser    = CHASER_RESET;
+      }
+      state = next;
+   }
+
+   /**
+    * Apply a number of rising edges of clock
+    *
+    * @param[in] cycles Number of edges
+    */
+   void clock(unsigned long cycles) {
+      while (cycles-->0) {
+         clock();
+      }
+   }
+
+   /**
+    * Get current register values
+    *
+    * @return Register state
+    */
+   const CpldState &getState() const {
+      return state;
+   }
+
+   /**
+    * Get current LED outputs
+    *
+    * @return leds[31:0]
+    */
+   uint32_t getLeds() const {
+      return chaserToLeds(state.chaser);
+   }
+};
+
+/**
+ * Bit-sliced model of 64 cpld_tester instances
+ *
+ * Each register bit is stored as a word with one bit per instance (lane).
+ * The lanes are independent so each may be started from a different
+ * phase e.g. to model uncertainty in when the device came out of reset.
+ */
+class CpldTesterModel64 {
+
+public:
+   /// Number of instances simulated in parallel
+   static constexpr unsigned LANES = 64;
+
+   /// Word holding one register bit for all lanes
+   using Word = uint64_t;
+
+private:
+   static constexpr Word ALL_LANES = ~Word(0);
+
+   Word prescaler[8];   // prescaler bit-planes, [0] = LSB
+   Word count[5];       // count bit-planes, [0] = LSB
+   Word flash;
+   Word selectOut;
+   Word chaser[8];      // chaser bit-planes, [0] = chaser(0)
+
+   /**
+    * Set or clear a lane in a bit-plane
+    */
+   static void setLaneBit(Word &plane, unsigned lane, bool value) {
+      plane = (plane & ~(Word(1)<<lane)) | (Word(value)<<lane);
+   }
+
+   /**
+    * Get a lane from a bit-plane
+    */
+   static unsigned getLaneBit(Word plane, unsigned lane) {
+      return (plane>>lane)&1;
+   }
+
+public:
+   /**
+    * Create model with all lanes in power-on state (all registers zero)
+    */
+   CpldTesterModel64() {
+      reset();
+   }
+
+   /**
+    * Set all lanes to power-on state (all registers zero)
+    */
+   void reset() {
+      for (Word &w:prescaler) {
+         w = 0;
+      }
+      for (Word &w:count) {
+         w = 0;
+      }
+      for (Word &w:chaser) {
+         w = 0;
+      }
+      flash     = 0;
+      selectOut = 0;
+   }
+
+   /**
+    * Set all lanes to evenly spaced phases.
+    * Lane n is placed in the state reached after (n*phaseStep) clocks from power-on.
+    *
+    * @param[in] phaseStep Number of clocks between adjacent lanes
+    */
+   void resetPhased(unsigned long phaseStep) {
+      CpldTesterModel reference;
+      for (unsigned lane=0; lane<LANES; lane++) {
+         setLane(lane, reference.getState());
+         reference.clock(phaseStep);
+      }
+   }
+
+   /**
+    * Load register state into a lane
+    *
+    * @param[in] lane   Lane to modify [0..63]
+    * @param[in] state  Register values
+    */
+   void setLane(unsigned lane, const CpldState &state) {
+      for (unsigned bit=0; bit<8; bit++) {
+         setLaneBit(prescaler[bit], lane, (state.prescaler>>bit)&1);
+         setLaneBit(chaser[bit],    lane, (state.chaser>>bit)&1);
+      }
+      for (unsigned bit=0; bit<5; bit++) {
+         setLaneBit(count[bit], lane, (state.count>>bit)&1);
+      }
+      setLaneBit(flash,     lane, state.flash);
+      setLaneBit(selectOut, lane, state.selectOut);
+   }
+
+   /**
+    * Extract register state of a lane
+    *
+    * @param[in] lane   Lane to examine [0..63]
+    *
+    * @return Register values
+    */
+   CpldState getLane(unsigned lane) const {
+      CpldState state{0, 0, false, false, 0};
+      for (unsigned bit=0; bit<8; bit++) {
+         state.prescaler |= getLaneBit(prescaler[bit], lane)<<bit;
+         state.chaser    |= getLaneBit(chaser[bit],    lane)<<bit;
+      }
+      for (unsigned bit=0; bit<5; bit++) {
+         state.count |= getLaneBit(count[bit], lane)<<bit;
+      }
+      state.flash     = getLaneBit(flash,     lane);
+      state.selectOut = getLaneBit(selectOut, lane);
+      return state;
+   }
+
+   /**
+    * Get LED outputs of a lane
+    *
+    * @param[in] lane   Lane to examine [0..63]
+    *
+    * @return leds[31:0]
+    */
+   uint32_t getLeds(unsigned lane) const {
+      uint8_t value = 0;
+      for (unsigned bit=0; bit<8; bit++) {
+         value |= getLaneBit(chaser[bit], lane)<<bit;
+      }
+      return chaserToLeds(value);
+   }
+
+   /**
+    * Get chaser bit-plane.
+    * leds(n) of all lanes is chaserPlane(n%8).
+    *
+    * @param[in] bit Chaser bit [0..7]
+    *
+    * @return Word with one bit per lane
+    */
+   Word chaserPlane(unsigned bit) const {
+      return chaser[bit];
+   }
+
+   /**
+    * Apply one rising edge of clock to all lanes
+    */
+   inline void clock() {
+      // Decode conditions from register values before the edge
+      Word prescalerMax = ALL_LANES;
+      for (Word w:prescaler) {
+         prescalerMax &= w;
+      }
+      Word countMax = ALL_LANES;
+      for (Word w:count) {
+         countMax &= w;
+      }
+
+      // prescaler <= prescaler + 1 (wraps to 0 after prescaler_max)
+      Word carry = ALL_LANES;
+      for (Word &w:prescaler) {
+         Word t = w & carry;
+         w     ^= carry;
+         carry  = t;
+      }
+
+      // count <= count + 1 on prescaler wrap, 0 on count_max
+      carry = prescalerMax;
+      for (Word &w:count) {
+         Word t = w & carry;
+         w     ^= carry;
+         carry  = t;
+      }
+      for (Word &w:count) {
+         w &= ~countMax;
+      }
+
+      // chaser update on prescaler wrap
+      //   selectOut='0' => chaser <= (others => flash)
+      //   selectOut='1' => chaser <= chaser(0) & chaser(7 downto 1)
+      // chaser reset on count_max
+      Word fill   = ~selectOut & flash;
+      Word rotate =  selectOut;
+      Word bit0   = chaser[0];
+      for (unsigned bit=0; bit<8; bit++) {
+         Word shifted = (bit<7)?chaser[bit+1]:bit0;
+         Word updated = (fill | (rotate & shifted));
+         Word value   = (prescalerMax & updated) | (~prescalerMax & chaser[bit]);
+         Word resetTo = (bit==0)?0:ALL_LANES;
+         chaser[bit]  = (countMax & resetTo) | (~countMax & value);
+      }
+
+      flash     ^= prescalerMax;
+      selectOut ^= countMax;
+   }
+
+   /**
+    * Apply a number of rising edges of clock to all lanes
+    *
+    * @param[in] cycles Number of edges
+    */
+   void clock(unsigned long cycles) {
+      while (cycles-->0) {
+         clock();
+      }
+   }
+};
+
+} // End namespace CpldModel
+
+#endif /* CPLD_MODEL_H_ */
@@ -1,2248 +1,3383 @@
-/****************************************************************************************************//**
- * @file     formatted_io.h (180.ARM_Peripherals/Project_Headers/formatted_io.h)
- * @brief    Formatted I/O
- *
- * @version  V0.0
- * @date     2015/06
- *
- *******************************************************************************************************/
-
-#ifndef HEADER_FORMATTED_IO_H
-#define HEADER_FORMATTED_IO_H
-/*
- * *****************************
- * *** DO NOT EDIT THIS FILE ***
- * *****************************
- *
- * This file is generated automatically.
- * Any manual changes will be lost.
- */
-#include <stdint.h>
-#include <math.h>
-#include <ctype.h>      // isspace() etc
-#include "pin_mapping.h"
-
-#if defined(__FREE_RTOS)
-#include "FreeRTOS.h"
-#include "semphr.h"
-#elif defined(__CMSIS_RTOS)
-#include "cmsis.h"
-#endif
-
-namespace USBDM {
-
-/**
- * @addtogroup FORMATTED_IO_Group Formatted Input/Output
- * @brief C++ Class allowing input and output of basic types as character streams
- * @{
- */
-
-/**
- * Enumeration selecting radix for integer types with << or >> operators
- */
-enum class Radix : uint8_t {
-   Radix_2       = 2,         //!< Convert as binary number
-   Radix_8       = 8,         //!< Convert as octal number
-   Radix_10      = 10,        //!< Convert as decimal number
-   Radix_16      = 16,        //!< Convert as hexadecimal number
-   Radix_Default = Radix_10,  //!< Default radix (10)
-};
-
-// Radix 2 format
-constexpr Radix Radix_2  = Radix::Radix_2;
-
-// Radix 8 format
-constexpr Radix Radix_8  = Radix::Radix_8;
-
-// Radix 10 format
-constexpr Radix Radix_10 = Radix::Radix_10;
-
-// Radix 16 format
-constexpr Radix Radix_16 = Radix::Radix_16;
-
-enum WhiteSpaceType {
-   /**
-    * With operator<< Discard input white-space characters
-    */
-   WhiteSpace
-};
-
-enum EndOfLineType {
-   /**
-    * With operator<< Discard input until end-of-line \n
-    * With operator>> Write end-of-line
-    */
-   EndOfLine
-};
-
-/**
- * Padding for integers
- */
-enum Padding : uint8_t {
-   Padding_None ,         //!< No padding
-   Padding_LeadingSpaces, //!< Pad with leading spaces
-   Padding_LeadingZeroes, //!< Pad with leading zeroes
-   Padding_TrailingSpaces,//!< Pad with trailing spaces
-};
-
-/**
- * Width for integers
- */
-enum Width : uint8_t {
-   Width_auto = 0,//!< Width_auto
-};
-
-enum EchoMode : bool {
-   /*
-    * For use with operator<< and operator>>
-    */
-   EchoMode_Off = false, //!< Turn echo off
-   EchoMode_On  = true,  //!< Turn echo on
-};
-
-enum FlushType {
-   /**
-    * With operator<< Discard queued input \n
-    * With operator>> Wait until queued data is transmitted.
-    */
-   Flush
-};
-
-struct IoFormat {
-   /**
-    * Precision multiplier used for floating point numbers (10^fFloatPrecision)
-    */
-   unsigned fFloatPrecisionMultiplier;
-
-   /** Current radix */
-   Radix fRadix;
-
-   /** Control echo of input characters */
-   EchoMode fEcho;
-
-   /** Padding for integers  */
-   Padding fPadding;
-
-   /** Width used for integers numbers  */
-   uint8_t fWidth;
-
-   /** How to pad the digits on left of floating point number */
-   Padding fFloatPadding;
-
-   /** Precision used for floating point numbers */
-   uint8_t fFloatWidth;
-
-   /** Precision used for floating point numbers */
-   uint8_t fFloatPrecision;
-
-   /**
-    * Constructor.
-    *
-    * This also determines the default settings
-    */
-   constexpr IoFormat() :
-      fFloatPrecisionMultiplier(1000),    // 3 decimal places
-      fRadix(Radix_10),                   // Base 10
-      fEcho(EchoMode_On),                 // Echo on
-      fPadding(Padding_None),             // No padding in integers
-      fWidth(0),                          // Minimum width on integers
-      fFloatPadding(Padding_None),        // No padding on floats
-      fFloatWidth(0),                     // Minimum width on floats
-      fFloatPrecision(3) {                // 3 decimal places on floats
-   }
-
-   /**
-    * Set format for floating point numbers
-    *
-    * @param precision Number of digits to the right of decimal point
-    * @param padding   How to pad on the left of the number (Padding_LeadingSpaces, Padding_None, Padding_LeadingZeroes)
-    * @param width     Number of characters to the left of decimal point (ignored for padding_None)
-    *
-    * @return Reference to self
-    */
-   IoFormat &setFloatFormat(
-         unsigned  precision,
-         Padding   padding  = Padding_None,
-         unsigned  width    = 0) {
-
-      usbdm_assert(padding != Padding_TrailingSpaces, "Not supported format");
-
-      fFloatPrecision           = precision;
-      fFloatPrecisionMultiplier = 1;
-      while (precision-->0) {
-         fFloatPrecisionMultiplier *= 10;
-      }
-      fFloatPadding = padding;
-      fFloatWidth   = width;
-      return *this;
-   }
-
-   /**
-    * Set format for integers
-    *
-    * @param width      Width of number
-    * @param padding    How to pad on the left of the number (Padding_LeadingSpaces, Padding_None, Padding_LeadingZeroes)
-    * @param radix      Radix for number
-    *
-    * @return Reference to self
-    */
-   IoFormat &setIntegerFormat(
-         unsigned width,
-         Padding padding   = Padding_LeadingSpaces,
-         Radix radix       = Radix_10) {
-
-      fWidth   = width;
-      fPadding = padding;
-      fRadix   = radix;
-      return *this;
-   }
-
-   IoFormat &setEcho(EchoMode echo) {
-      fEcho = echo;
-      return *this;
-   }
-};
-
-/**
- * Virtual Base class for formatted IO
- */
-class FormattedIO {
-
-protected:
-   /**
-    * Construct formatter interface
-    */
-   FormattedIO() {
-#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
-      mutex = xSemaphoreCreateRecursiveMutex();
-#elif defined(__CMSIS_RTOS)
-      mutex = new CMSIS::Mutex();
-#endif
-   }
-
-   /**
-    * Destructor
-    */
-   virtual ~FormattedIO() {
-#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
-      vSemaphoreDelete(mutex);
-#elif defined(__CMSIS_RTOS)
-      delete mutex;
-#endif
-   }
-
-   /**
-    * Current settings
-    */
-   IoFormat fFormat;
-
-   /**
-    * One character look-ahead
-    */
-   int16_t lookAhead = -1;
-
-   /**
-    * Indicate in error state
-    */
-   bool inErrorState = false;
-
-#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
-   SemaphoreHandle_t mutex;
-#elif defined(__CMSIS_RTOS)
-   CMSIS::Mutex* mutex;
-#endif
-
-   /**
-    * Convert character to digit in given radix
-    *
-    * @param[in] ch    The character to convert
-    * @param[in] radix The radix to use
-    *
-    * @return >=0 Digit in range 0 - (radix-1)
-    * @return <0  Invalid character for radix
-    */
-   static int convertDigit(int ch, Radix radix) {
-      unsigned digit = ch - '0';
-      if (digit<10) {
-         return (digit<static_cast<unsigned>(radix))?digit:-1;
-      }
-      digit = ch-'a'+10;
-      if (digit<static_cast<unsigned>(radix)) {
-         return digit;
-      }
-      digit = ch-'A'+10;
-      if (digit<static_cast<unsigned>(radix)) {
-         return digit;
-      }
-      return -1;
-   }
-
-   /**
-    * Check if character is available
-    *
-    * @return true  Character available i.e. _readChar() will not block
-    * @return false No character available
-    */
-   virtual bool _isCharAvailable() {
-      return false;
-   }
-
-   /**
-    * Receives a character (blocking)
-    *
-    * @return Character received
-    */
-   virtual int _readChar() {
-      return -1;
-   }
-
-   /**
-    * Writes a character (blocking)
-    *
-    * @param[in]  ch - character to send
-    */
-   virtual void _writeChar(char ch) {
-      (void)ch;
-   }
-
-public:
-   /**
-    * Get current settings e.g width, precision etc
-    *
-    * @param[out] settings Setting object
-    */
-   FormattedIO &getFormat(IoFormat &settings) {
-      settings = fFormat;
-      return *this;
-   }
-
-   /**
-    * Set current settings e.g width, precision etc
-    *
-    * @param[in] settings Setting object
-    */
-   FormattedIO &setFormat(IoFormat &settings) {
-      fFormat = settings;
-      return *this;
-   }
-
-   /**
-    * Reset to default formatting.
-    * Radix = radix_10, width=0, Padding_None
-    *
-    * @return Reference to self
-    */
-   FormattedIO &resetFormat() {
-      // Default settings
-      static const IoFormat defaultSettings;
-
-      fFormat = defaultSettings;
-      return *this;
-   }
-
-   /**
-    *  Flush output data
-    */
-   virtual FormattedIO &flushOutput() {
-      return *this;
-   }
-
-   /**
-    *  Flush input data
-    */
-   virtual FormattedIO &flushInput() {
-      lookAhead = -1;
-      return *this;
-   }
-
-   /**
-    * Lock the object
-    *
-    * @note Requires use of RTOS + Mutexes
-    */
-   FormattedIO &lock() {
-#if defined (__FREE_RTOS) && (configSUPPORT_DYNAMIC_ALLOCATION == 1) && (configUSE_RECURSIVE_MUTEXES == 1)
-      xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-#elif defined(__CMSIS_RTOS)
-      mutex->wait(osWaitForever);
-#endif
-      return *this;
-   }
-
-   /**
-    * Unlock the object
-    *
-    * @note Requires use of RTOS + Mutexes
-    */
-   void unlock() {
-#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
-      xSemaphoreGiveRecursive(mutex);
-#elif defined(__CMSIS_RTOS)
-      mutex->release();
-#endif
-   }
-
-   /**
-    * Peek at lookahead (non-blocking).
-    *
-    * @return <0   No character available
-    * @return >=0  The available character
-    */
-   int __attribute__((noinline)) peek() {
-      if (lookAhead>0) {
-         return lookAhead;
-      }
-      if (!_isCharAvailable()) {
-         return -1;
-      }
-      lookAhead = _readChar();
-      if (lookAhead == static_cast<uint8_t>('\r')) {
-         lookAhead = '\n';
-      }
-      if (fFormat.fEcho) {
-         _writeChar(lookAhead);
-      }
-      return lookAhead;
-   }
-
-   /**
-    * Push a value to the look-ahead buffer
-    *
-    * @param[in] ch Character to push
-    */
-   void NOINLINE_DEBUG pushBack(char ch) {
-      lookAhead = static_cast<uint8_t>(ch);
-   }
-
-   /**
-    * Writes a character
-    *
-    * @param[in]  ch - character to send
-    */
-   void NOINLINE_DEBUG writeChar(char ch) {
-      _writeChar(ch);
-   }
-
-   /**
-    * Receives a single character
-    *
-    * @return >0 Character received
-    * @return <0 No character available
-    */
-   int NOINLINE_DEBUG readChar() {
-      int ch;
-      do {
-         ch = peek();
-      } while (ch < 0);
-      lookAhead = -1;
-      return ch;
-   }
-
-   /**
-    * Set padding for integers
-    *
-    * @param padding Padding mode
-    *
-    * @return Reference to self
-    */
-   FormattedIO &setPadding(Padding padding) {
-      fFormat.fPadding = padding;
-      return *this;
-   }
-
-   /**
-    * Set width for integers
-    *
-    * @param width Width to use
-    *
-    * @return Reference to self
-    */
-   FormattedIO &setWidth(unsigned width) {
-      fFormat.fWidth = width;
-      return *this;
-   }
-
-   /**
-    * Set precision for floating point numbers
-    *
-    * @param precision Number of digits to the right of decimal point
-    * @param padding   How to pad on the left of the number (Padding_LeadingSpaces, Padding_None, Padding_LeadingZeroes)
-    * @param width     Number of characters to the left of decimal point (ignored for padding_None)
-    *
-    * @return Reference to self
-    */
-   FormattedIO &setFloatFormat( unsigned  precision,
-                                Padding   padding  = Padding_None,
-                                unsigned  width    = 0) {
-
-      usbdm_assert(padding != Padding_TrailingSpaces, "Not supported format");
-
-      fFormat.fFloatPrecision           = precision;
-      fFormat.fFloatPrecisionMultiplier = 1;
-      while (precision-->0) {
-         fFormat.fFloatPrecisionMultiplier *= 10;
-      }
-      fFormat.fFloatPadding = padding;
-      fFormat.fFloatWidth   = width;
-      return *this;
-   }
-
-   /**
-    * Converts an unsigned long to a string
-    *
-    * @param[in] ptr        Buffer to write result (at least 32 characters for binary)
-    * @param[in] value      Unsigned long to convert
-    * @param[in] radix      Radix for conversion [2..16]
-    * @param[in] padding    How to pad the number if smaller than field width
-    * @param[in] width      Field width of printed number
-    * @param[in] isNegative Write leading '-'
-    *
-    * @return Pointer to '\0' null character at end of converted number\n
-    *         May be used for incrementally writing to a buffer.
-    */
-   static __attribute__((noinline)) char *ultoa(
-         char          *ptr,
-         unsigned long  value,
-         Radix          radix,
-         Padding        padding,
-         int            width,
-         bool           isNegative
-         ) {
-
-#ifdef DEBUG_BUILD
-      if (ptr == nullptr) {
-         __BKPT();
-      }
-      if ((static_cast<unsigned>(radix)<2)||(static_cast<unsigned>(radix)>16)) {
-         __BKPT();
-      }
-#endif
-      // Save beginning for reversal
-      char *beginPtr = ptr;
-      // Convert backwards
-      do {
-         *ptr++ = "0123456789ABCDEF"[value % static_cast<unsigned>(radix)];
-         value /= static_cast<unsigned>(radix);
-      } while (value != 0);
-
-      // Add leading padding
-      switch (padding) {
-         case Padding_TrailingSpaces:
-         case Padding_None:
-            if (isNegative) {
-                width--;
-                *ptr++ = '-';
-             }
-             break;
-         case Padding_LeadingSpaces:
-            if (isNegative) {
-               *ptr++ = '-';
-            }
-            while ((ptr-beginPtr) < width) {
-               *ptr++ = ' ';
-            }
-            break;
-         case Padding_LeadingZeroes:
-            while ((ptr-beginPtr) < (width-1)) {
-               *ptr++ = '0';
-            }
-            if (isNegative) {
-               *ptr++ = '-';
-            }
-            if ((ptr-beginPtr) < width) {
-               *ptr++ = '0';
-            }
-            break;
-      }
-      // Reverse digits
-      char *endPtr = ptr-1;
-      char *tPtr   = beginPtr;
-      while (tPtr < endPtr) {
-         char t = *tPtr;
-         *tPtr++ = *endPtr;
-         *endPtr-- = t;
-      }
-      // Add trailing padding
-      if (padding==Padding_TrailingSpaces) {
-         while ((ptr-beginPtr) < width) {
-            *ptr++ = ' ';
-         }
-      }
-      // Terminate and leave ptr at last digit
-      *ptr = '\0';
-      return ptr;
-   }
-
-   /**
-    * Converts an unsigned long to a string
-    *
-    * @param[in] ptr      Buffer to write result (at least 32 characters for binary)
-    * @param[in] value    Unsigned long to convert
-    * @param[in] radix    Radix for conversion [2..16] (default 10)
-    * @param[in] padding  How to pad the number if smaller than field width
-    * @param[in] width    Field width of printed number
-    *
-    * @return Pointer to '\0' null character at end of converted number\n
-    *         May be used for incrementally writing to a buffer.
-    */
-   static NOINLINE_DEBUG char *ultoa(
-         char *ptr,
-         unsigned long value,
-         Radix radix=Radix_10,
-         Padding padding=Padding_None,
-         int width=0
-         ) {
-      return ultoa(ptr, value, radix, padding, width, false);
-}
-
-   /**
-    * Converts a long to a string
-    *
-    * @param[in] ptr      Buffer to write result (at least 32 characters for binary)
-    * @param[in] value    Long to convert
-    * @param[in] radix    Radix for conversion [2..16] (default 10)
-    * @param[in] padding  How to pad the number if smaller than field width
-    * @param[in] width    Field width of printed number
-    *
-    * @return Pointer to '\0' null character at end of converted number\n
-    *         May be used for incrementally writing to a buffer.
-    */
-   static NOINLINE_DEBUG char *ltoa(
-         char *ptr,
-         long value,
-         Radix radix=Radix_10,
-         Padding padding=Padding_None,
-         int width=0
-         ) {
-      bool isNegative = value<0;
-      if (isNegative) {
-         value = -value;
-      }
-      return ultoa(ptr, value, radix, padding, width, isNegative);
-   }
-
-   /**
-    * Copies a C string including terminating '\0' character
-    *
-    * @param[out] dst  Where to copy string
-    * @param[in]  src  Source to copy from
-    *
-    * @return Pointer to '\0' null character at end of concatenated string.\n
-    *         May be used for incrementally writing to a buffer.
-    */
-   static NOINLINE_DEBUG char *strcpy(char *dst, const char *src) {
-#ifdef DEBUG_BUILD
-      if (dst == nullptr) {
-         __BKPT();
-      }
-#endif
-      do {
-         *dst++ = *src;
-      } while (*src++ != '\0');
-      return dst-1;
-   }
-
-   /**
-    * Write data
-    *
-    * @param[in]  data     Data to transmit
-    * @param[in]  size     Size of transmission data
-    */
-   void NOINLINE_DEBUG transmit(const uint8_t data[], uint16_t size) {
-      while (size-->0) {
-         writeChar(*data++);
-      }
-   }
-
-   /**
-    * Receive data
-    *
-    * @param[out] data     Data buffer for reception
-    * @param[in]  size     Size of data to receive
-    */
-   void NOINLINE_DEBUG receive(uint8_t data[], uint16_t size) {
-      while (size-->0) {
-         *data++ = readChar();
-      }
-   }
-
-   /**
-    * Receive string until terminator character or buffer full.\n
-    * The terminating character is discarded and the string always '\0' terminated
-    *
-    * @param[out] data       Data buffer for reception
-    * @param[in]  size       Size of data buffer (including space for '\0')
-    * @param[in]  terminator Terminating character
-    *
-    * @return number of characters read (excluding terminator)
-    *
-    * @note Excess characters are discarded once the buffer is full.
-    *
-    * Usage
-    * @code
-    *    char buff[100];
-    *    int numChars = gets(buff, sizeof(buff));
-    * @endcode
-    */
-   int __attribute__((noinline)) gets(char data[], uint16_t size, char terminator='\n') {
-      char *ptr = data;
-
-      char ch;
-      do {
-         ch = readChar();
-         if (ptr<(data+size)) {
-            *ptr++ = ch;
-         }
-      } while(ch != terminator);
-      *--ptr = '\0';
-      return ptr-data;
-   }
-
-   /**
-    * Receive string until terminator character or buffer full.\n
-    * The terminating character is discarded and the string always '\0' terminated
-    *
-    * @param[out] data       Data buffer for reception (size is inferred from this parameter)
-    * @param[in]  terminator Terminating character
-    *
-    * @return number of characters read (excluding terminator)
-    *
-    * @note Excess characters are discarded once the buffer is full.
-    *
-    * Usage
-    * @code
-    *    char buff[100];
-    *    int numChars = gets(buff);
-    * @endcode
-    */
-   template<size_t N>
-   int __attribute__((noinline)) gets(char (&data)[N], char terminator='\n') {
-      return gets(data, N, terminator);
-   }
-
-protected:
-    /**
-    * Write a character
-    *
-    * @param[in]  ch - character to send
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(char ch) {
-      writeChar(ch);
-      return *this;
-   }
-
-   /**
-    * Write an end-of-line
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln() {
-      return private_write('\n');
-   }
-
-   /**
-    * Write a character with newline
-    *
-    * @param[in]  ch - character to send
-    *
-    * @return Reference to self
-    */
-   FormattedIO  NOINLINE_DEBUG &private_writeln(char ch) {
-      private_write(ch);
-      return private_writeln();
-   }
-
-   /**
-    * Write a C string
-    *
-    * @param[in]  str   String to print
-    * @param[in]  width Width of string (either truncated or padded to this width)
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(const char *str, unsigned width) {
-      while ((*str != '\0') && (width-->0)) {
-         private_write(*str++);
-      }
-      while (width-->0) {
-         private_write(' ');
-      }
-      return *this;
-   }
-
-   /**
-    * Write a C string
-    *
-    * @param[in]  str   String to print
-    * @param[in]  width Width of string (either truncated or padded to this width)
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_writeln(const char *str, unsigned width) {
-      private_write(str, width);
-      return private_writeln();
-   }
-
-   /**
-    * Write a C string
-    *
-    * @param[in]  str String to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(const char *str) {
-      while (*str != '\0') {
-         private_write(*str++);
-      }
-      return *this;
-   }
-
-   /**
-    * Write a C string with new line
-    *
-    * @param[in]  str String to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_writeln(const char *str) {
-      private_write(str);
-      return private_writeln();
-   }
-
-   /**
-    * Write a boolean value
-    *
-    * @param[in]  b Boolean to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(bool b) {
-      return private_write(b?"true":"false");
-   }
-
-   /**
-    * Write a boolean value with new line
-    *
-    * @param[in]  b Boolean to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_writeln(bool b) {
-      private_write(b);
-      return private_writeln();
-   }
-
-   /**
-    * Write an unsigned long integer
-    *
-    * @param[in]  value Unsigned long to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(unsigned long value, Radix radix) {
-      char buff[35];
-      ultoa(buff, value, radix, fFormat.fPadding, fFormat.fWidth, false);
-      return private_write(buff);
-   }
-
-   /**
-    * Write an unsigned long integer
-    *
-    * @param[in]  value Unsigned long to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO &private_write(unsigned long value) {
-      return private_write(value, Radix_10);
-   }
-
-   /**
-    * Write a long integer
-    *
-    * @param[in]  value Long to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(long value, Radix radix) {
-      char buff[35];
-      bool isNegative = value < 0;
-      if (isNegative) {
-         value = -value;
-      }
-      ultoa(buff, static_cast<unsigned long>(value), radix, fFormat.fPadding, fFormat.fWidth, isNegative);
-      return private_write(buff);
-   }
-
-   /**
-    * Write a long integer
-    *
-    * @param[in]  value Long to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO &private_write(long value) {
-      return private_write(value, Radix_10);
-   }
-
-   /**
-    * Write an unsigned long integer with newline
-    *
-    * @param[in]  value Unsigned long to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_writeln(unsigned long value, Radix radix) {
-      private_write(value, radix);
-      return private_writeln();
-   }
-
-   /**
-    * Write an unsigned long integer with newline
-    *
-    * @param[in]  value Unsigned long to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO &private_writeln(unsigned long value) {
-      return private_writeln(value, Radix_10);
-   }
-
-   /**
-    * Write an pointer value
-    *
-    * @param[in]  value Pointer value to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(const void *value, Radix radix) {
-      return private_write(reinterpret_cast<unsigned long>(value), radix);
-   }
-
-   /**
-    * Write an pointer value
-    *
-    * @param[in]  value Pointer value to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO &private_write(const void *value) {
-      return private_write(value, Radix_16);
-   }
-
-   /**
-    * Write an pointer value with newline
-    *
-    * @param[in]  value Pointer value to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_writeln(const void *value, Radix radix) {
-      private_write(reinterpret_cast<unsigned long>(value), radix);
-      return private_writeln();
-   }
-
-   /**
-    * Write an pointer value with newline
-    *
-    * @param[in]  value Pointer value to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO &private_writeln(const void *value) {
-      return private_writeln(value, Radix_16);
-   }
-
-   /**
-    * Write a long integer with newline
-    *
-    * @param[in]  value Long to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(long value, Radix radix) {
-      private_write(value, radix);
-      return private_writeln();
-   }
-
-   /**
-    * Write a long integer with newline
-    *
-    * @param[in]  value Long to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO &private_writeln(long value) {
-      return private_writeln(value, Radix_10);
-   }
-
-   /**
-    * Write an unsigned integer
-    *
-    * @param[in]  value Unsigned to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(unsigned value, Radix radix) {
-      return private_write(static_cast<unsigned long>(value), radix);
-   }
-
-   /**
-    * Write an unsigned integer
-    *
-    * @param[in]  value Unsigned to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(unsigned value) {
-      return private_write(static_cast<unsigned long>(value), Radix_10);
-   }
-
-   /**
-    * Write an unsigned integer with newline
-    *
-    * @param[in]  value Unsigned to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(unsigned value, Radix radix) {
-      return private_writeln(static_cast<unsigned long>(value), radix);
-   }
-
-   /**
-    * Write an unsigned integer with newline
-    *
-    * @param[in]  value Unsigned to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(unsigned value) {
-      return private_writeln(static_cast<unsigned long>(value), Radix_10);
-   }
-
-   /**
-    * Write an integer
-    *
-    * @param[in]  value Integer to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(int value, Radix radix) {
-      return private_write(static_cast<long>(value), radix);
-   }
-
-   /**
-    * Write an integer
-    *
-    * @param[in]  value Integer to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(int value) {
-      return private_write(static_cast<long>(value), Radix_10);
-   }
-
-   /**
-    * Write an integer with newline
-    *
-    * @param[in]  value Integer to print
-    * @param[in]  radix Radix for conversion [2..16]
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG  &private_writeln(int value, Radix radix) {
-      return private_writeln(static_cast<long>(value), radix);
-   }
-
-   /**
-    * Write an integer with newline
-    *
-    * @param[in]  value Integer to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG  &private_writeln(int value) {
-      return private_writeln(static_cast<long>(value), Radix_10);
-   }
-
-   void convertToEngineeringNotation(double value, bool &isNegative, unsigned &mantissa, int &exponent) {
-      isNegative = value<0;
-      if (isNegative) {
-         value = -value;
-      }
-      exponent = 0;
-      mantissa = 0;
-      if (value == 0) {
-         return;
-      }
-      // Scale [1..999]
-      while (value>=1000) {
-         exponent += 3;
-         value /= 1000;
-      }
-      while (value<1) {
-         exponent -= 3;
-         value *= 1000;
-      }
-      // Round - may push number out of [1..999]
-      // Note: number is also scaled by precision
-      mantissa = round(value*fFormat.fFloatPrecisionMultiplier);
-
-      // Check if nudged out of range
-      if (mantissa>=(1000*fFormat.fFloatPrecisionMultiplier)) {
-         mantissa = round(mantissa/1000.0);
-         exponent += 3;
-      }
-   }
-#if 0
-   /**
-    * Write a double
-    *
-    * @param[in]  value Double to print
-    *
-    * @return Reference to self
-    *
-    * @note Uses snprintf() which is large.
-    * @note To use this function it is necessary to enable floating point printing\n
-    *       in the linker options (Support %f format in printf -u _print_float)).
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(double value) {
-      char buff[20];
-      snprintf(buff, sizeof(buff), "%f", value);
-      return private_write(buff);
-   }
-#else
-   /**
-    * Write a double - Limited to 3 decimal places
-    *
-    * @param[in]  value Double to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_write(double value) {
-      char buff[20];
-      if (isnan(value)) {
-         return private_write("Nan");
-      }
-      bool isNegative = value<0;
-      if (isNegative) {
-         value = -value;
-      }
-      int exponent=0;
-      auto x = value*fFormat.fFloatPrecisionMultiplier;
-      if (x>4294967295) {
-         // Change to scientific notation
-         // Scale down mantissa within range (otherwise overflows long)
-         while (x>=fFormat.fFloatPrecisionMultiplier*10) {
-            exponent++;
-            x /= 10;
-         }
-      }
-      if ((x!=0) && (x<1)) {
-         // Change to scientific notation
-         while (x<=(fFormat.fFloatPrecisionMultiplier/10.0)) {
-            exponent--;
-            x *= 10;
-         }
-      }
-      auto y = round(x);
-      unsigned long scaledValue = static_cast<unsigned long>(y);
-      if (exponent != 0) {
-
-      }
-
-      ultoa(buff, scaledValue/fFormat.fFloatPrecisionMultiplier, Radix_10, fFormat.fFloatPadding, fFormat.fFloatWidth, isNegative);
-      if (fFormat.fFloatPrecision>0) {
-         private_write(buff).private_write('.');
-         ultoa(buff,
-               (scaledValue)%fFormat.fFloatPrecisionMultiplier,
-               Radix_10, Padding_LeadingZeroes, fFormat.fFloatPrecision);
-      }
-      private_write(buff);
-      if (exponent != 0) {
-         private_write("E").private_write(exponent);
-      }
-      return *this;
-   }
-#endif
-
-   /**
-    * Write a double with newline
-    *
-    * @param[in]  value Double to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &private_writeln(double value) {
-      private_write(value);
-      return private_writeln();
-   }
-
-   /**
-    * Write a float
-    *
-    * @param[in]  value Float to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(float value) {
-      return private_write(static_cast<double>(value));
-   }
-
-   /**
-    * Write a float with newline
-    *
-    * @param[in]  value Float to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(float value) {
-      return private_writeln(static_cast<double>(value));
-   }
-
-   /**
-    * Write a C string
-    *
-    * @param array
-    * @return
-    */
-   template <size_t N>
-   FormattedIO NOINLINE_DEBUG &private_write(const char (&array)[N]) {
-      return private_write((const char*)array);
-   }
-
-   /**
-    * Write a C string with newline
-    *
-    * @param array
-    * @return
-    */
-   template <size_t N>
-   FormattedIO NOINLINE_DEBUG &private_writeln(const char (&array)[N]) {
-      return private_writeln((const char*)array);
-   }
-
-#if (USE_DIMENSION_CHECK)
-   /**
-    * Write a Seconds variable
-    *
-    * @param[in]  value Seconds to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(const Seconds value) {
-      unsigned mantissa;
-      int      exponent;
-      bool     isNegative;
-
-      convertToEngineeringNotation(value.getValue(), isNegative, mantissa, exponent);
-
-      const char *units = " s";
-      if (exponent<-6) {
-         exponent += 9;
-         units =  " ns";
-      }
-      else if (exponent<-3) {
-         exponent += 6;
-         units =  " us";
-      }
-      else if (exponent<0) {
-         exponent += 3;
-         units =  " ms";
-      }
-      private_write(mantissa/fFormat.fFloatPrecisionMultiplier);
-      private_write('.');
-      char buff[10];
-      ultoa(buff, mantissa%fFormat.fFloatPrecisionMultiplier, Radix_10, Padding_LeadingZeroes, fFormat.fFloatPrecision);
-      private_write(buff);
-
-      if (exponent != 0) {
-         private_write('E');
-         private_write(exponent);
-      }
-      private_write(units);
-      return *this;
-   }
-
-   /**
-    * Write a Seconds variable
-    *
-    * @param[in]  value Seconds to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(const Seconds value) {
-      return private_write(value);
-   }
-
-   /**
-    * Write a Seconds variable with newline
-    *
-    * @param[in]  value Seconds to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(const Seconds value) {
-      return private_write(value).private_writeln();
-   }
-
-   /**
-    * Write a Ticks variable
-    *
-    * @param[in]  value Ticks to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(const Ticks value) {
-      return private_write(value.getValue()).private_write(" ticks");
-   }
-
-   /**
-    * Write a Ticks variable
-    *
-    * @param[in]  value Ticks to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(const Ticks value) {
-      return private_write(value);
-   }
-
-   /**
-    * Write a Ticks variable with newline
-    *
-    * @param[in]  value Ticks to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(const Ticks value) {
-      return private_write(value).private_writeln();
-   }
-
-   /**
-    * Write a Hertz variable
-    *
-    * @param[in]  value Hertz to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_write(const Hertz value) {
-      unsigned mantissa;
-      int      exponent;
-      bool     isNegative;
-
-      convertToEngineeringNotation(value.getValue(), isNegative, mantissa, exponent);
-
-      const char *units = " Hz";
-      if (exponent>=6) {
-         exponent -= 6;
-         units =  " MHz";
-      }
-      else if (exponent>=3) {
-         exponent -= 3;
-         units =  " kHz";
-      }
-      private_write(mantissa/fFormat.fFloatPrecisionMultiplier);
-      private_write('.');
-      char buff[10];
-      ultoa(buff, mantissa%fFormat.fFloatPrecisionMultiplier, Radix_10, Padding_LeadingZeroes, fFormat.fFloatPrecision);
-      private_write(buff);
-      if (exponent != 0) {
-         private_write('E');
-         private_write(exponent);
-      }
-      private_write(units);
-      return *this;
-   }
-
-   /**
-    * Write a Hertz variable with newline
-    *
-    * @param[in]  value Hertz to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &private_writeln(const Hertz value) {
-      return private_write(value).private_writeln();
-   }
-
-   /**
-    * Write a Hertz variable
-    *
-    * @param[in]  value Hertz to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(const Hertz value) {
-      return private_write(value);
-   }
-#endif
-
-public:
-   /**
-    * Write a character
-    *
-    * @param[in]  ch Character to print
-    *
-    * @return Reference to self
-     */
-   FormattedIO NOINLINE_DEBUG &operator <<(char ch) {
-      return private_write(ch);
-   }
-
-   /**
-    * Write a boolean value
-    *
-    * @param[in]  b Boolean to print
-    *
-    * @return Reference to self
-     */
-   FormattedIO NOINLINE_DEBUG &operator <<(bool b) {
-      return private_write(b);
-   }
-
-   /**
-    * Write a C string
-    *
-    * @param[in]  str String to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(const char *str) {
-      return private_write(str);
-   }
-
-   /**
-    * Write an unsigned long integer
-    *
-    * @param[in]  value Unsigned long to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(unsigned long value) {
-      return private_write(value, fFormat.fRadix);
-   }
-
-   /**
-    * Write a long integer
-    *
-    * @param[in]  value Long to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(long value) {
-      return private_write(value, fFormat.fRadix);
-   }
-
-   /**
-    * Write an unsigned integer
-    *
-    * @param[in]  value Unsigned to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(unsigned int value) {
-      return private_write(value, fFormat.fRadix);
-   }
-
-   /**
-    * Write an integer
-    *
-    * @param[in]  value Integer to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(int value) {
-      return private_write(value, fFormat.fRadix);
-   }
-
-   /**
-    * Write a pointer value
-    *
-    * @param[in]  value Pointer value to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(const void *value) {
-      return private_write(reinterpret_cast<unsigned long>(value), fFormat.fRadix);
-   }
-
-   /**
-    * Write a float
-    *
-    * @param[in]  value Float to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(float value) {
-      return private_write(static_cast<double>(value));
-   }
-
-   /**
-    * Write a double
-    *
-    * @param[in]  value Double to print
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(double value) {
-      return private_write(value);
-   }
-
-   /**
-    * Sets the conversion radix for integer types
-    *
-    * @param[in] radix Radix to set
-    *
-    * @return Reference to self
-    *
-    * @note Only applies for operator<< methods
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(Radix radix) {
-      fFormat.fRadix = radix;
-      return *this;
-   }
-
-   /**
-    * Write end-of-line
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(EndOfLineType) {
-      return private_writeln();
-   }
-
-   /**
-    * Enable/Disable echoing of input characters
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(EchoMode echoMode) {
-      return setEcho(echoMode);
-   }
-
-   /**
-    * Enable/Disable echoing of input characters
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(EchoMode echoMode) {
-      return setEcho(echoMode);
-   }
-
-   /**
-    * Flush output data
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator <<(FlushType) {
-      flushOutput();
-      return *this;
-   }
-
-   /**
-    * Null function (for debug)
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &null() {
-      return *this;
-   }
-
-   /**
-    * Discard white-space from the input
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &skipWhiteSpace() {
-      int ch;
-      do {
-         ch = readChar();
-      } while (isspace(ch));
-      pushBack(ch);
-      return *this;
-   }
-
-   /**
-    * Discard input until end-of-line (inclusive)
-    *
-    * @return Reference to self
-    */
-   FormattedIO __attribute__((noinline)) &readln() {
-      while (readChar() != '\n') {
-         __asm__("nop");
-      }
-      return *this;
-   }
-
-   /**
-    * Read a character from the input
-    *
-    * @param[out] ch Where to place character read
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &read(char &ch) {
-      ch = readChar();
-      return *this;
-   }
-
-   /**
-    * Get and clear error state
-    *
-    * @return false No error
-    * @return true  Operation failed since last checked e.g. illegal digit at start of number
-    */
-   bool __attribute__((noinline)) isError() {
-      bool t = inErrorState;
-      inErrorState = false;
-      return t;
-   }
-
-   /**
-    * Receives an unsigned long
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO __attribute__((noinline)) &read(unsigned long &value, Radix radix=Radix_10) {
-      // Skip white space
-      int ch;
-      do {
-         ch = readChar();
-      } while (isspace(ch));
-
-      // Check if sign character
-      bool negative = (ch == '-');
-      if (negative) {
-         // Discard  '-'
-         ch = readChar();
-      }
-
-      // Parse number
-      value = 0;
-      int digitCount = 0;
-      do {
-         int digit = convertDigit(ch, radix);
-         if (digit<0) {
-            break;
-         }
-         digitCount++;
-         value *= static_cast<unsigned>(radix);
-         value += digit;
-         ch = readChar();
-      } while (true);
-
-      // Must have at least 1 digit
-      inErrorState = (digitCount<=0);
-
-      // Push back 1st non-digit
-      pushBack(ch);
-      if (negative) {
-         value = -value;
-      }
-      return *this;
-   }
-
-   /**
-    * Controls echoing of input characters
-    *
-    * @param echoMode
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &setEcho(EchoMode echoMode=EchoMode_On) {
-      fFormat.fEcho = echoMode;
-      return *this;
-   }
-   /**
-    * Receives an unsigned long and then discards characters until end of line.
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &readln(unsigned long &value, Radix radix=Radix_10) {
-      read(value, radix);
-      return readln();
-   }
-
-   /**
-    * Receives a long
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &read(long &value, Radix radix=Radix_10) {
-      unsigned long temp;
-      read(temp, radix);
-      value = temp;
-      return *this;
-   }
-
-   /**
-    * Receives a long and then discards characters until end of line.
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &readln(long &value, Radix radix=Radix_10) {
-      read(value, radix);
-      return readln();
-   }
-
-   /**
-    * Receives an unsigned integer
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &read(unsigned int &value, Radix radix=Radix_10) {
-      unsigned long temp;
-      read(temp, radix);
-      value = temp;
-      return *this;
-   }
-
-   /**
-    * Receives an unsigned integer and then discards characters until end of line.
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &readln(unsigned &value, Radix radix=Radix_10) {
-      read(value, radix);
-      return readln();
-   }
-
-   /**
-    * Receives an integer
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &read(int &value, Radix radix=Radix_10) {
-      long temp;
-      read(temp, radix);
-      value = temp;
-      return *this;
-   }
-
-   /**
-    * Receives an integer and then discards characters until end of line.
-    *
-    * @param[out] value Where to place value read
-    * @param[in]  radix The radix to use
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &readln(int &value, Radix radix=Radix_10) {
-      read(value, radix);
-      return readln();
-   }
-
-   /**
-    * Discard white-space from the input
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(WhiteSpaceType) {
-      return skipWhiteSpace();
-   }
-
-   /**
-    * Discard input until end-of-line
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(EndOfLineType) {
-      while (readChar() != '\n') {
-         __asm__("nop");
-      }
-      return *this;
-   }
-
-   /**
-    * Flush input data
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(FlushType) {
-      flushInput();
-      return *this;
-   }
-
-   /**
-    * Sets the conversion radix for integer types
-    *
-    * @param[in]  radix Radix to set
-    *
-    * @return Reference to self
-    *
-    * @note Only applies for operator<< methods
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(Radix radix) {
-      fFormat.fRadix = radix;
-      return *this;
-   }
-
-   /**
-    * Receives a single character
-    *
-    * @param[out] ch Where to place character read
-    *
-    * @return Reference to self
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(char &ch) {
-      ch = readChar();
-      return *this;
-   }
-
-   /**
-    * Receives an unsigned long
-    *
-    * @param[out] value Where to place value read
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(unsigned long &value) {
-      return read(value, fFormat.fRadix);
-   }
-
-   /**
-    * Receives a long
-    *
-    * @param[out] value Where to place value read
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(long &value) {
-      return read(value, fFormat.fRadix);
-   }
-
-   /**
-    * Receives an unsigned long
-    *
-    * @param[out] value Where to place value read
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(unsigned int &value) {
-      return read(value, fFormat.fRadix);
-   }
-
-   /**
-    * Receives an integer
-    *
-    * @param[out] value Where to place value read
-    *
-    * @return Reference to self
-    *
-    * @note Skips leading whitespace
-    */
-   FormattedIO NOINLINE_DEBUG &operator >>(int &value) {
-      return read(value, fFormat.fRadix);
-   }
-
-   /**
-    * Get conversion radix for given base
-    *
-    * @param[in]  radix Base to convert to radix [2..16]
-    *
-    * @return Radix corresponding to base
-    */
-   static constexpr Radix NOINLINE_DEBUG radix(unsigned radix) {
-      return static_cast<Radix>(radix);
-   }
-
-   /**
-    * Create field width object
-    *
-    * @code
-    * Uart0 myUart;
-    * myUart<<Uart0::width(10)<<123;
-    * @endcode
-    *
-    * @param[in]  width Integer to convert to width
-    *
-    * @return Width corresponding to width
-    */
-   static constexpr Width NOINLINE_DEBUG width(int width) {
-      return static_cast<Width>(width);
-   }
-
-   /**
-    * Set printing format
-    *
-    * @param ioSettings    Setting to apply
-    *
-    * @return Reference to self
-    */
-   FormattedIO &operator<<(const IoFormat &ioSettings) {
-      fFormat = ioSettings;
-      return *this;
-   }
-
-   /**
-    * Set width for integers
-    *
-    * @param[in] width
-    *
-    * @return Reference to self
-    */
-   FormattedIO &operator<<(Width width) {
-      setWidth(width);
-      return *this;
-   }
-
-   /**
-    * Set padding for integers
-    *
-    * @param[in] padding
-    *
-    * @return Reference to self
-    */
-   FormattedIO &operator<<(Padding padding) {
-      setPadding(padding);
-      return *this;
-   }
-
-   /**
-    * Write an integral array
-    *
-    * @param[in]  array Pointer to array to print
-    * @param[in]  size  Number of elements in array
-    * @param[in]  radix Radix for conversion
-    *
-    * @return Reference to self
-    */
-   template <typename T>
-   FormattedIO NOINLINE_DEBUG &writeArray(const T array[], size_t size, Radix radix) {
-      unsigned itemCount = 0;
-      const char *prefix="";
-      switch(radix) {
-         case Radix_2:  prefix = "0b"; break;
-         case Radix_8:  prefix = "0";  break;
-         case Radix_16: prefix = "0x"; break;
-         case Radix_10:                break;
-         default:                      break;
-      }
-      private_write("{ ");
-      for(unsigned index=0; index<size; index++) {
-         if (itemCount>=10) {
-            itemCount = 0;
-            private_write("\n  ");
-         }
-         itemCount++;
-         private_write(prefix);
-         private_write(array[index], radix);
-         private_write(", ");
-      }
-      private_write('}');
-      return *this;
-   }
-
-   /**
-    * Write an integral array with newline
-    *
-    * @param[in]  array Pointer to array to print
-    * @param[in]  size  Number of elements in array
-    * @param[in]  radix Radix for conversion
-    *
-    * @return Reference to self
-    */
-   template <typename T>
-   FormattedIO NOINLINE_DEBUG &writelnArray(const T array[], size_t size, Radix radix) {
-      writeArray(array, size, radix);
-      return private_writeln();
-   }
-
-   /**
-    * Write an integral array
-    *
-    * @param[in]  array Reference to array to print
-    * @param[in]  radix Radix for conversion
-    *
-    * @return Reference to self
-    */
-   template <typename T, size_t N>
-   FormattedIO NOINLINE_DEBUG &writeArray(const T (&array)[N], Radix radix) {
-      return writeArray(array, N, radix);
-   }
-
-   /**
-    * Write an integral array with newline
-    *
-    * @param[in]  array Reference to array to print
-    * @param[in]  radix Radix for conversion
-    *
-    * @return Reference to self
-    */
-   template <typename T, size_t N>
-   FormattedIO NOINLINE_DEBUG &writelnArray(const T (&array)[N], Radix radix) {
-      writeArray(array, N, radix);
-      return private_writeln();
-   }
-
-   /**
-    * Write an array
-    *
-    * @param[in]  array Pointer to array to print
-    * @param[in]  size  Number of elements in array
-    *
-    * @return Reference to self
-    */
-   template <typename T>
-   FormattedIO NOINLINE_DEBUG &writeArray(const T array[], size_t size) {
-      unsigned itemCount = 0;
-      private_write("{ ");
-      for(unsigned index=0; index<size; index++) {
-         if (itemCount>=10) {
-            itemCount = 0;
-            private_write("\n  ");
-         }
-         itemCount++;
-         private_write(array[index]);
-         private_write(", ");
-      }
-      private_write('}');
-      return *this;
-   }
-
-   /**
-    * Write an array with newline
-    *
-    * @param[in]  array Pointer to array to print
-    * @param[in]  size  Number of elements in array
-    *
-    * @return Reference to self
-    */
-   template <typename T>
-   FormattedIO NOINLINE_DEBUG &writelnArray(const T array[], size_t size) {
-      writeArray(array, size);
-      return private_writeln();
-   }
-
-   /**
-    * Write an array
-    *
-    * @param[in]  array Reference to array to print
-    *
-    * @return Reference to self
-    */
-   template <typename T, size_t N>
-   FormattedIO NOINLINE_DEBUG &writeArray(const T (&array)[N]) {
-      return writeArray(array, N);
-   }
-
-   /**
-    * Write an array with newline
-    *
-    * @param[in]  array Reference to array to print
-    *
-    * @return Reference to self
-    */
-   template <typename T, size_t N>
-   FormattedIO NOINLINE_DEBUG &writelnArray(const T (&array)[N]) {
-      return writelnArray(array, N);
-   }
-
-   /**
-    * Print an array as a hex table.
-    * The indexes shown are for byte offsets suitable for a memory dump.
-    *
-    * @param data          Array to print
-    * @param size          Size of array in elements
-    * @param visibleIndex The starting index to print for the array. Should be multiple of sizeof(data[]).
-    */
-   template <typename T>
-   void writeArray(T *data, uint32_t size, uint32_t visibleIndex) {
-      usbdm_assert((visibleIndex%sizeof(T))==0, "visibleIndex should be multiple of sizeof(data[])");
-      unsigned rowMask;
-      unsigned offset;
-
-      switch(sizeof(T)) {
-         case 1  :
-            offset = (visibleIndex/sizeof(T))&0xF;
-            visibleIndex &= ~0xF;
-            rowMask = 0xF;  break;
-         case 2  :
-            offset = (visibleIndex/sizeof(T))&0x7;
-            visibleIndex &= ~0xF;
-            rowMask = 0x7; break;
-         default :
-            offset = (visibleIndex/sizeof(T))&0x7;
-            visibleIndex &= ~0x1F;
-            rowMask = 0x7; break;
-      }
-      setPadding(Padding_TrailingSpaces).setWidth(2*sizeof(T));
-      private_write("          ");
-      for (unsigned index=0; index<=(rowMask*sizeof(T)); index+=sizeof(T)) {
-         private_write(index, Radix_16).private_write(" ");
-      }
-      private_writeln();
-      setPadding(Padding_LeadingZeroes);
-      bool needNewline = true;
-      size += offset;
-      for (unsigned index=0; index<size; index++) {
-         if (needNewline) {
-            setWidth(8);
-            private_write(visibleIndex+index*sizeof(T), Radix_16).private_write(": ");
-         }
-         if (index<offset) {
-            switch(sizeof(T)) {
-               case 1  : private_write("   ");       break;
-               case 2  : private_write("     ");     break;
-               default : private_write("         "); break;
-            }
-         }
-         else {
-            setWidth(2*sizeof(T));
-            private_write(data[index-offset], Radix_16).private_write(" ");
-         }
-         needNewline = (((index+1)&rowMask)==0);
-         if (needNewline) {
-            private_writeln();
-         }
-      }
-      private_writeln().resetFormat();
-   }
-
-   /**
-    * Function to write a newline
-    *
-    * @tparam T      Type of value (inferred)
-    * @param arg     Argument to write
-    *
-    * @return Reference to self
-    */
-   FormattedIO &writeln() {
-      return private_writeln();
-   }
-
-   /**
-    * Recursive template function to write a value in given radix with following args and newline
-    *
-    * @tparam T      Type of value (inferred)
-    * @tparam Args   Type of remaining args (inferred)
-    * @param  arg    Argument to write
-    * @param  radix  Radix to use
-    * @param  args   Remaining args to write
-    *
-    * @return Reference to self
-    */
-   template<typename T, typename... Args>
-   FormattedIO &writeln(T arg, Radix radix, Args... args ) {
-      private_write(arg, radix);
-      return writeln(args...);
-   }
-
-   /**
-    * Recursive template function to write a value with following args and newline
-    *
-    * @tparam T      Type of value (inferred)
-    * @tparam Args   Type of remaining args (inferred)
-    * @param  arg    Argument to write
-    * @param  args   Remaining args to write
-    *
-    * @return Reference to self
-    */
-   template<typename T, typename... Args>
-   FormattedIO &writeln(T arg, Args... args) {
-      private_write(arg);
-      return writeln(args...);
-   }
-
-   /**
-    * Template function to write a value in given radix with following args
-    *
-    * @tparam T      Type of value (inferred)
-    * @tparam Args   Type of remaining args (inferred)
-    * @param  arg    Argument to write
-    * @param  radix  Radix to use
-    * @param  args   Remaining args to write
-    *
-    * @return Reference to self
-    */
-   template<typename T, typename... Args>
-   FormattedIO &write(T arg, Radix radix, Args... args ) {
-      private_write(arg, radix);
-      if constexpr(sizeof...(args) > 0) {
-         return write(args...);
-      }
-      return *this;
-   }
-
-   /**
-    * Recursive template function to write a value with following args
-    *
-    * @tparam T      Type of value (inferred)
-    * @tparam Args   Type of remaining args (inferred)
-    * @param  arg    Argument to write
-    * @param  args   Remaining args to write
-    *
-    * @return Reference to self
-    */
-   template<typename T, typename... Args>
-   FormattedIO &write(T arg, Args... args) {
-      private_write(arg);
-      if constexpr(sizeof...(args) > 0) {
-         return write(args...);
-      }
-      return *this;
-   }
-};
-
-/**
- * End FORMATTED_IO_Group
- * @}
- */
-
-} // End namespace USBDM
-
-#endif /* HEADER_FORMATTED_IO_H */
+/****************************************************************************************************//**
+ * @file     formatted_io.h (180.ARM_Peripherals/Project_Headers/formatted_io.h)
+ * @brief    Formatted I/O
+ *
+ * @version  V0.0
+ * @date     2015/06
+ *
+ *******************************************************************************************************/
+
+#ifndef HEADER_FORMATTED_IO_H
+#define HEADER_FORMATTED_IO_H
+/*
+ * *****************************
+ * *** DO NOT EDIT THIS FILE ***
+ * *****************************
+ *
+ * This file is generated automatically.
+ * Any manual changes will be lost.
+ */
+#include <stdint.h>
+#include <math.h>
+#include <ctype.h>      // isspace() etc
+#include <string.h>     // strlen()
+#include <type_traits>
+#include "pin_mapping.h"
+
+#if defined(__FREE_RTOS)
+#include "FreeRTOS.h"
+#include "semphr.h"
+#elif defined(__CMSIS_RTOS)
+#include "cmsis.h"
+#endif
+
+namespace USBDM {
+
+/**
+ * @addtogroup FORMATTED_IO_Group Formatted Input/Output
+ * @brief C++ Class allowing input and output of basic types as character streams
+ * @{
+ */
+
+/**
+ * Enumeration selecting radix for integer types with << or >> operators
+ */
+enum class Radix : uint8_t {
+   Radix_2       = 2,         //!< Convert as binary number
+   Radix_8       = 8,         //!< Convert as octal number
+   Radix_10      = 10,        //!< Convert as decimal number
+   Radix_16      = 16,        //!< Convert as hexadecimal number
+   Radix_Default = Radix_10,  //!< Default radix (10)
+};
+
+// Radix 2 format
+constexpr Radix Radix_2  = Radix::Radix_2;
+
+// Radix 8 format
+constexpr Radix Radix_8  = Radix::Radix_8;
+
+// Radix 10 format
+constexpr Radix Radix_10 = Radix::Radix_10;
+
+// Radix 16 format
+constexpr Radix Radix_16 = Radix::Radix_16;
+
+enum WhiteSpaceType {
+   /**
+    * With operator<< Discard input white-space characters
+    */
+   WhiteSpace
+};
+
+enum EndOfLineType {
+   /**
+    * With operator<< Discard input until end-of-line \n
+    * With operator>> Write end-of-line
+    */
+   EndOfLine
+};
+
+/**
+ * Padding for integers
+ */
+enum Padding : uint8_t {
+   Padding_None ,         //!< No padding
+   Padding_LeadingSpaces, //!< Pad with leading spaces
+   Padding_LeadingZeroes, //!< Pad with leading zeroes
+   Padding_TrailingSpaces,//!< Pad with trailing spaces
+};
+
+/**
+ * Width for integers
+ */
+enum Width : uint8_t {
+   Width_auto = 0,//!< Width_auto
+};
+
+enum EchoMode : bool {
+   /*
+    * For use with operator<< and operator>>
+    */
+   EchoMode_Off = false, //!< Turn echo off
+   EchoMode_On  = true,  //!< Turn echo on
+};
+
+enum FlushType {
+   /**
+    * With operator<< Discard queued input \n
+    * With operator>> Wait until queued data is transmitted.
+    */
+   Flush
+};
+
+struct IoFormat {
+   /**
+    * Precision multiplier used for floating point numbers (10^fFloatPrecision)
+    */
+   unsigned fFloatPrecisionMultiplier;
+
+   /** Current radix */
+   Radix fRadix;
+
+   /** Control echo of input characters */
+   EchoMode fEcho;
+
+   /** Padding for integers  */
+   Padding fPadding;
+
+   /** Width used for integers numbers  */
+   uint8_t fWidth;
+
+   /** How to pad the digits on left of floating point number */
+   Padding fFloatPadding;
+
+   /** Precision used for floating point numbers */
+   uint8_t fFloatWidth;
+
+   /** Precision used for floating point numbers */
+   uint8_t fFloatPrecision;
+
+   /**
+    * Constructor.
+    *
+    * This also determines the default settings
+    */
+   constexpr IoFormat() :
+      fFloatPrecisionMultiplier(1000),    // 3 decimal places
+      fRadix(Radix_10),                   // Base 10
+      fEcho(EchoMode_On),                 // Echo on
+      fPadding(Padding_None),             // No padding in integers
+      fWidth(0),                          // Minimum width on integers
+      fFloatPadding(Padding_None),        // No padding on floats
+      fFloatWidth(0),                     // Minimum width on floats
+      fFloatPrecision(3) {                // 3 decimal places on floats
+   }
+
+   /**
+    * Set format for floating point numbers
+    *
+    * @param precision Number of digits to the right of decimal point
+    * @param padding   How to pad on the left of the number (Padding_LeadingSpaces, Padding_None, Padding_LeadingZeroes)
+    * @param width     Number of characters to the left of decimal point (ignored for padding_None)
+    *
+    * @return Reference to self
+    */
+   IoFormat &setFloatFormat(
+         unsigned  precision,
+         Padding   padding  = Padding_None,
+         unsigned  width    = 0) {
+
+      usbdm_assert(padding != Padding_TrailingSpaces, "Not supported format");
+
+      fFloatPrecision           = precision;
+      fFloatPrecisionMultiplier = 1;
+      while (precision-->0) {
+         fFloatPrecisionMultiplier *= 10;
+      }
+      fFloatPadding = padding;
+      fFloatWidth   = width;
+      return *this;
+   }
+
+   /**
+    * Set format for integers
+    *
+    * @param width      Width of number
+    * @param padding    How to pad on the left of the number (Padding_LeadingSpaces, Padding_None, Padding_LeadingZeroes)
+    * @param radix      Radix for number
+    *
+    * @return Reference to self
+    */
+   IoFormat &setIntegerFormat(
+         unsigned width,
+         Padding padding   = Padding_LeadingSpaces,
+         Radix radix       = Radix_10) {
+
+      fWidth   = width;
+      fPadding = padding;
+      fRadix   = radix;
+      return *this;
+   }
+
+   IoFormat &setEcho(EchoMode echo) {
+      fEcho = echo;
+      return *this;
+   }
+};
+
+/**
+ * Format string for FormattedIO::format() held in a character array with static storage
+ *
+ * @tparam fmt Format string
+ */
+template<const char *fmt>
+struct FormatArray {
+   /// Format string
+   static constexpr const char *string = fmt;
+};
+
+#if __cplusplus >= 202002L
+/**
+ * String literal usable as a template argument e.g. format<"Vdd={} mV">(vdd)
+ *
+ * @tparam N Size of string including terminator
+ */
+template<size_t N>
+struct FormatString {
+   /// Characters of string including terminator
+   char value[N];
+
+   /**
+    * Create from string literal
+    *
+    * @param[in] str String literal
+    */
+   constexpr FormatString(const char (&str)[N]) : value{} {
+      for (size_t index=0; index<N; index++) {
+         value[index] = str[index];
+      }
+   }
+};
+
+/**
+ * Format string for FormattedIO::format() given as a string literal
+ *
+ * @tparam fmt Format string
+ */
+template<FormatString fmt>
+struct FormatLiteral {
+   /// Format string
+   static constexpr const char *string = fmt.value;
+};
+#endif
+
+/**
+ * Virtual Base class for formatted IO
+ */
+class FormattedIO {
+
+protected:
+   /**
+    * Construct formatter interface
+    */
+   FormattedIO() {
+#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
+      mutex = xSemaphoreCreateRecursiveMutex();
+#elif defined(__CMSIS_RTOS)
+      mutex = new CMSIS::Mutex();
+#endif
+   }
+
+   /**
+    * Destructor
+    */
+   virtual ~FormattedIO() {
+#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
+      vSemaphoreDelete(mutex);
+#elif defined(__CMSIS_RTOS)
+      delete mutex;
+#endif
+   }
+
+   /**
+    * Current settings
+    */
+   IoFormat fFormat;
+
+   /**
+    * One character look-ahead
+    */
+   int16_t lookAhead = -1;
+
+   /**
+    * Indicate in error state
+    */
+   bool inErrorState = false;
+
+#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
+   SemaphoreHandle_t mutex;
+#elif defined(__CMSIS_RTOS)
+   CMSIS::Mutex* mutex;
+#endif
+
+   /**
+    * Convert character to digit in given radix
+    *
+    * @param[in] ch    The character to convert
+    * @param[in] radix The radix to use
+    *
+    * @return >=0 Digit in range 0 - (radix-1)
+    * @return <0  Invalid character for radix
+    */
+   static int convertDigit(int ch, Radix radix) {
+      unsigned digit = ch - '0';
+      if (digit<10) {
+         return (digit<static_cast<unsigned>(radix))?digit:-1;
+      }
+      digit = ch-'a'+10;
+      if (digit<static_cast<unsigned>(radix)) {
+         return digit;
+      }
+      digit = ch-'A'+10;
+      if (digit<static_cast<unsigned>(radix)) {
+         return digit;
+      }
+      return -1;
+   }
+
+   /**
+    * Check if character is available
+    *
+    * @return true  Character available i.e. _readChar() will not block
+    * @return false No character available
+    */
+   virtual bool _isCharAvailable() {
+      return false;
+   }
+
+   /**
+    * Receives a character (blocking)
+    *
+    * @return Character received
+    */
+   virtual int _readChar() {
+      return -1;
+   }
+
+   /**
+    * Writes a character (blocking)
+    *
+    * @param[in]  ch - character to send
+    */
+   virtual void _writeChar(char ch) {
+      (void)ch;
+   }
+
+   /**
+    * Writes a block of characters (blocking)
+    * The default writes each character using _writeChar().
+    *
+    * @param[in]  data - characters to send
+    * @param[in]  size - number of characters
+    */
+   virtual void _writeChars(const char *data, size_t size) {
+      while (size-->0) {
+         _writeChar(*data++);
+      }
+   }
+
+public:
+   /**
+    * Get current settings e.g width, precision etc
+    *
+    * @param[out] settings Setting object
+    */
+   FormattedIO &getFormat(IoFormat &settings) {
+      settings = fFormat;
+      return *this;
+   }
+
+   /**
+    * Set current settings e.g width, precision etc
+    *
+    * @param[in] settings Setting object
+    */
+   FormattedIO &setFormat(IoFormat &settings) {
+      fFormat = settings;
+      return *this;
+   }
+
+   /**
+    * Reset to default formatting.
+    * Radix = radix_10, width=0, Padding_None
+    *
+    * @return Reference to self
+    */
+   FormattedIO &resetFormat() {
+      // Default settings
+      static const IoFormat defaultSettings;
+
+      fFormat = defaultSettings;
+      return *this;
+   }
+
+   /**
+    *  Flush output data
+    */
+   virtual FormattedIO &flushOutput() {
+      return *this;
+   }
+
+   /**
+    *  Flush input data
+    */
+   virtual FormattedIO &flushInput() {
+      lookAhead = -1;
+      return *this;
+   }
+
+   /**
+    * Lock the object
+    *
+    * @note Requires use of RTOS + Mutexes
+    */
+   FormattedIO &lock() {
+#if defined (__FREE_RTOS) && (configSUPPORT_DYNAMIC_ALLOCATION == 1) && (configUSE_RECURSIVE_MUTEXES == 1)
+      xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+#elif defined(__CMSIS_RTOS)
+      mutex->wait(osWaitForever);
+#endif
+      return *this;
+   }
+
+   /**
+    * Unlock the object
+    *
+    * @note Requires use of RTOS + Mutexes
+    */
+   void unlock() {
+#if defined (__FREE_RTOS) && ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_RECURSIVE_MUTEXES == 1 )
+      xSemaphoreGiveRecursive(mutex);
+#elif defined(__CMSIS_RTOS)
+      mutex->release();
+#endif
+   }
+
+   /**
+    * Peek at lookahead (non-blocking).
+    *
+    * @return <0   No character available
+    * @return >=0  The available character
+    */
+   int __attribute__((noinline)) peek() {
+      if (lookAhead>0) {
+         return lookAhead;
+      }
+      if (!_isCharAvailable()) {
+         return -1;
+      }
+      lookAhead = _readChar();
+      if (lookAhead == static_cast<uint8_t>('\r')) {
+         lookAhead = '\n';
+      }
+      if (fFormat.fEcho) {
+         _writeChar(lookAhead);
+      }
+      return lookAhead;
+   }
+
+   /**
+    * Push a value to the look-ahead buffer
+    *
+    * @param[in] ch Character to push
+    */
+   void NOINLINE_DEBUG pushBack(char ch) {
+      lookAhead = static_cast<uint8_t>(ch);
+   }
+
+   /**
+    * Writes a character
+    *
+    * @param[in]  ch - character to send
+    */
+   void NOINLINE_DEBUG writeChar(char ch) {
+      _writeChar(ch);
+   }
+
+   /**
+    * Receives a single character
+    *
+    * @return >0 Character received
+    * @return <0 No character available
+    */
+   int NOINLINE_DEBUG readChar() {
+      int ch;
+      do {
+         ch = peek();
+      } while (ch < 0);
+      lookAhead = -1;
+      return ch;
+   }
+
+   /**
+    * Set padding for integers
+    *
+    * @param padding Padding mode
+    *
+    * @return Reference to self
+    */
+   FormattedIO &setPadding(Padding padding) {
+      fFormat.fPadding = padding;
+      return *this;
+   }
+
+   /**
+    * Set width for integers
+    *
+    * @param width Width to use
+    *
+    * @return Reference to self
+    */
+   FormattedIO &setWidth(unsigned width) {
+      fFormat.fWidth = width;
+      return *this;
+   }
+
+   /**
+    * Set precision for floating point numbers
+    *
+    * @param precision Number of digits to the right of decimal point
+    * @param padding   How to pad on the left of the number (Padding_LeadingSpaces, Padding_None, Padding_LeadingZeroes)
+    * @param width     Number of characters to the left of decimal point (ignored for padding_None)
+    *
+    * @return Reference to self
+    */
+   FormattedIO &setFloatFormat( unsigned  precision,
+                                Padding   padding  = Padding_None,
+                                unsigned  width    = 0) {
+
+      usbdm_assert(padding != Padding_TrailingSpaces, "Not supported format");
+
+      fFormat.fFloatPrecision           = precision;
+      fFormat.fFloatPrecisionMultiplier = 1;
+      while (precision-->0) {
+         fFormat.fFloatPrecisionMultiplier *= 10;
+      }
+      fFormat.fFloatPadding = padding;
+      fFormat.fFloatWidth   = width;
+      return *this;
+   }
+
+   /**
+    * Digit pairs "00".."99" used for radix 10 conversion
+    */
+   static constexpr char digitPairs[] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+
+   /**
+    * Write a pair of decimal digits in reverse order (least significant first)
+    *
+    * @param[in] ptr   Buffer to write digits
+    * @param[in] pair  Value to write [0..99]
+    *
+    * @return Pointer to character after digits
+    */
+   static inline char *reverseDigitPair(char *ptr, unsigned pair) {
+      *ptr++ = digitPairs[2*pair+1];
+      *ptr++ = digitPairs[2*pair];
+      return ptr;
+   }
+
+   /**
+    * Converts an unsigned long to digits in reverse order (least significant first).
+    * No division is used for radix 2, 8, 16 or 10 (on 32-bit values).
+    *
+    * @tparam radix Radix for conversion
+    *
+    * @param[in] ptr    Buffer to write digits
+    * @param[in] value  Unsigned long to convert
+    *
+    * @return Pointer to character after last (most significant) digit
+    */
+   template<Radix radix>
+   static inline char *reverseDigits(char *ptr, unsigned long value) {
+      if constexpr ((radix == Radix_2) || (radix == Radix_8) || (radix == Radix_16)) {
+         constexpr unsigned shift = (radix == Radix_2)?1:(radix == Radix_8)?3:4;
+         constexpr unsigned mask  = static_cast<unsigned>(radix)-1;
+         do {
+            *ptr++ = "0123456789ABCDEF"[value & mask];
+            value >>= shift;
+         } while (value != 0);
+      }
+      else {
+         static_assert(radix == Radix_10, "Unsupported radix");
+         if constexpr (sizeof(unsigned long) > sizeof(uint32_t)) {
+            // Only needed when long is wider than 32-bits (host builds)
+            while (value > 0xFFFFFFFFUL) {
+               ptr   = reverseDigitPair(ptr, value%100);
+               value = value/100;
+            }
+         }
+         uint32_t remaining = static_cast<uint32_t>(value);
+         // remaining/100 = (remaining*(2^37/100))>>37 - exact for all 32-bit values
+         while (remaining >= 43699) {
+            uint32_t quotient = static_cast<uint32_t>((static_cast<uint64_t>(remaining)*0x51EB851FU)>>37);
+            ptr       = reverseDigitPair(ptr, remaining-(quotient*100));
+            remaining = quotient;
+         }
+         // remaining/100 = (remaining*(2^19/100))>>19 - exact for remaining < 43699
+         while (remaining >= 100) {
+            uint32_t quotient = (remaining*5243)>>19;
+            ptr       = reverseDigitPair(ptr, remaining-(quotient*100));
+            remaining = quotient;
+         }
+         if (remaining >= 10) {
+            ptr = reverseDigitPair(ptr, remaining);
+         }
+         else {
+            *ptr++ = '0'+remaining;
+         }
+      }
+      return ptr;
+   }
+
+   /**
+    * Adds padding to digits in reverse order, reverses and terminates
+    *
+    * @param[in] beginPtr   Start of digits (least significant first)
+    * @param[in] ptr        Pointer to character after last digit
+    * @param[in] padding    How to pad the number if smaller than field width
+    * @param[in] width      Field width of printed number
+    * @param[in] isNegative Write leading '-'
+    *
+    * @return Pointer to '\0' null character at end of converted number
+    */
+   static __attribute__((noinline)) char *padDigits(
+         char          *beginPtr,
+         char          *ptr,
+         Padding        padding,
+         int            width,
+         bool           isNegative
+         ) {
+
+      // Add leading padding
+      switch (padding) {
+         case Padding_TrailingSpaces:
+         case Padding_None:
+            if (isNegative) {
+                width--;
+                *ptr++ = '-';
+             }
+             break;
+         case Padding_LeadingSpaces:
+            if (isNegative) {
+               *ptr++ = '-';
+            }
+            while ((ptr-beginPtr) < width) {
+               *ptr++ = ' ';
+            }
+            break;
+         case Padding_LeadingZeroes:
+            while ((ptr-beginPtr) < (width-1)) {
+               *ptr++ = '0';
+            }
+            if (isNegative) {
+               *ptr++ = '-';
+            }
+            if ((ptr-beginPtr) < width) {
+               *ptr++ = '0';
+            }
+            break;
+      }
+      // Reverse digits
+      char *endPtr = ptr-1;
+      char *tPtr   = beginPtr;
+      while (tPtr < endPtr) {
+         char t = *tPtr;
+         *tPtr++ = *endPtr;
+         *endPtr-- = t;
+      }
+      // Add trailing padding
+      if (padding==Padding_TrailingSpaces) {
+         while ((ptr-beginPtr) < width) {
+            *ptr++ = ' ';
+         }
+      }
+      // Terminate and leave ptr at last digit
+      *ptr = '\0';
+      return ptr;
+   }
+
+   /**
+    * Converts an unsigned long to a string
+    * The radix is fixed at compile time so only the converter for that radix is used.
+    *
+    * @tparam radix Radix for conversion (Radix_2, Radix_8, Radix_10 or Radix_16)
+    *
+    * @param[in] ptr        Buffer to write result (at least 32 characters for binary)
+    * @param[in] value      Unsigned long to convert
+    * @param[in] padding    How to pad the number if smaller than field width
+    * @param[in] width      Field width of printed number
+    * @param[in] isNegative Write leading '-'
+    *
+    * @return Pointer to '\0' null character at end of converted number\n
+    *         May be used for incrementally writing to a buffer.
+    */
+   template<Radix radix>
+   static char *ultoa(
+         char          *ptr,
+         unsigned long  value,
+         Padding        padding=Padding_None,
+         int            width=0,
+         bool           isNegative=false
+         ) {
+      return padDigits(ptr, reverseDigits<radix>(ptr, value), padding, width, isNegative);
+   }
+
+   /**
+    * Converts an unsigned long to a string
+    *
+    * @param[in] ptr        Buffer to write result (at least 32 characters for binary)
+    * @param[in] value      Unsigned long to convert
+    * @param[in] radix      Radix for conversion [2..16]
+    * @param[in] padding    How to pad the number if smaller than field width
+    * @param[in] width      Field width of printed number
+    * @param[in] isNegative Write leading '-'
+    *
+    * @return Pointer to '\0' null character at end of converted number\n
+    *         May be used for incrementally writing to a buffer.
+    */
+   static __attribute__((noinline)) char *ultoa(
+         char          *ptr,
+         unsigned long  value,
+         Radix          radix,
+         Padding        padding,
+         int            width,
+         bool           isNegative
+         ) {
+
+#ifdef DEBUG_BUILD
+      if (ptr == nullptr) {
+         __BKPT();
+      }
+      if ((static_cast<unsigned>(radix)<2)||(static_cast<unsigned>(radix)>16)) {
+         __BKPT();
+      }
+#endif
+      // Convert backwards
+      char *endPtr;
+      switch(radix) {
+         case Radix_2:  endPtr = reverseDigits<Radix_2>(ptr, value);  break;
+         case Radix_8:  endPtr = reverseDigits<Radix_8>(ptr, value);  break;
+         case Radix_10: endPtr = reverseDigits<Radix_10>(ptr, value); break;
+         case Radix_16: endPtr = reverseDigits<Radix_16>(ptr, value); break;
+         default:
+            endPtr = ptr;
+            do {
+               *endPtr++ = "0123456789ABCDEF"[value % static_cast<unsigned>(radix)];
+               value /= static_cast<unsigned>(radix);
+            } while (value != 0);
+            break;
+      }
+      return padDigits(ptr, endPtr, padding, width, isNegative);
+   }
+
+   /**
+    * Converts an unsigned long to a string
+    *
+    * @param[in] ptr      Buffer to write result (at least 32 characters for binary)
+    * @param[in] value    Unsigned long to convert
+    * @param[in] radix    Radix for conversion [2..16] (default 10)
+    * @param[in] padding  How to pad the number if smaller than field width
+    * @param[in] width    Field width of printed number
+    *
+    * @return Pointer to '\0' null character at end of converted number\n
+    *         May be used for incrementally writing to a buffer.
+    */
+   static NOINLINE_DEBUG char *ultoa(
+         char *ptr,
+         unsigned long value,
+         Radix radix=Radix_10,
+         Padding padding=Padding_None,
+         int width=0
+         ) {
+      return ultoa(ptr, value, radix, padding, width, false);
+}
+
+   /**
+    * Converts a long to a string
+    *
+    * @param[in] ptr      Buffer to write result (at least 32 characters for binary)
+    * @param[in] value    Long to convert
+    * @param[in] radix    Radix for conversion [2..16] (default 10)
+    * @param[in] padding  How to pad the number if smaller than field width
+    * @param[in] width    Field width of printed number
+    *
+    * @return Pointer to '\0' null character at end of converted number\n
+    *         May be used for incrementally writing to a buffer.
+    */
+   static NOINLINE_DEBUG char *ltoa(
+         char *ptr,
+         long value,
+         Radix radix=Radix_10,
+         Padding padding=Padding_None,
+         int width=0
+         ) {
+      bool isNegative = value<0;
+      if (isNegative) {
+         value = -value;
+      }
+      return ultoa(ptr, value, radix, padding, width, isNegative);
+   }
+
+   /**
+    * Copies a C string including terminating '\0' character
+    *
+    * @param[out] dst  Where to copy string
+    * @param[in]  src  Source to copy from
+    *
+    * @return Pointer to '\0' null character at end of concatenated string.\n
+    *         May be used for incrementally writing to a buffer.
+    */
+   static NOINLINE_DEBUG char *strcpy(char *dst, const char *src) {
+#ifdef DEBUG_BUILD
+      if (dst == nullptr) {
+         __BKPT();
+      }
+#endif
+      do {
+         *dst++ = *src;
+      } while (*src++ != '\0');
+      return dst-1;
+   }
+
+   /**
+    * Write data
+    *
+    * @param[in]  data     Data to transmit
+    * @param[in]  size     Size of transmission data
+    */
+   void NOINLINE_DEBUG transmit(const uint8_t data[], uint16_t size) {
+      while (size-->0) {
+         writeChar(*data++);
+      }
+   }
+
+   /**
+    * Receive data
+    *
+    * @param[out] data     Data buffer for reception
+    * @param[in]  size     Size of data to receive
+    */
+   void NOINLINE_DEBUG receive(uint8_t data[], uint16_t size) {
+      while (size-->0) {
+         *data++ = readChar();
+      }
+   }
+
+   /**
+    * Receive string until terminator character or buffer full.\n
+    * The terminating character is discarded and the string always '\0' terminated
+    *
+    * @param[out] data       Data buffer for reception
+    * @param[in]  size       Size of data buffer (including space for '\0')
+    * @param[in]  terminator Terminating character
+    *
+    * @return number of characters read (excluding terminator)
+    *
+    * @note Excess characters are discarded once the buffer is full.
+    *
+    * Usage
+    * @code
+    *    char buff[100];
+    *    int numChars = gets(buff, sizeof(buff));
+    * @endcode
+    */
+   int __attribute__((noinline)) gets(char data[], uint16_t size, char terminator='\n') {
+      char *ptr = data;
+
+      char ch;
+      do {
+         ch = readChar();
+         if (ptr<(data+size)) {
+            *ptr++ = ch;
+         }
+      } while(ch != terminator);
+      *--ptr = '\0';
+      return ptr-data;
+   }
+
+   /**
+    * Receive string until terminator character or buffer full.\n
+    * The terminating character is discarded and the string always '\0' terminated
+    *
+    * @param[out] data       Data buffer for reception (size is inferred from this parameter)
+    * @param[in]  terminator Terminating character
+    *
+    * @return number of characters read (excluding terminator)
+    *
+    * @note Excess characters are discarded once the buffer is full.
+    *
+    * Usage
+    * @code
+    *    char buff[100];
+    *    int numChars = gets(buff);
+    * @endcode
+    */
+   template<size_t N>
+   int __attribute__((noinline)) gets(char (&data)[N], char terminator='\n') {
+      return gets(data, N, terminator);
+   }
+
+protected:
+    /**
+    * Write a character
+    *
+    * @param[in]  ch - character to send
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(char ch) {
+      writeChar(ch);
+      return *this;
+   }
+
+   /**
+    * Write an end-of-line
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln() {
+      return private_write('\n');
+   }
+
+   /**
+    * Write a character with newline
+    *
+    * @param[in]  ch - character to send
+    *
+    * @return Reference to self
+    */
+   FormattedIO  NOINLINE_DEBUG &private_writeln(char ch) {
+      private_write(ch);
+      return private_writeln();
+   }
+
+   /**
+    * Write a C string
+    *
+    * @param[in]  str   String to print
+    * @param[in]  width Width of string (either truncated or padded to this width)
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_write(const char *str, unsigned width) {
+      size_t length = strnlen(str, width);
+      _writeChars(str, length);
+      width -= length;
+      while (width-->0) {
+         private_write(' ');
+      }
+      return *this;
+   }
+
+   /**
+    * Write a C string
+    *
+    * @param[in]  str   String to print
+    * @param[in]  width Width of string (either truncated or padded to this width)
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_writeln(const char *str, unsigned width) {
+      private_write(str, width);
+      return private_writeln();
+   }
+
+   /**
+    * Write a C string
+    *
+    * @param[in]  str String to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_write(const char *str) {
+      _writeChars(str, strlen(str));
+      return *this;
+   }
+
+   /**
+    * Write a C string with new line
+    *
+    * @param[in]  str String to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_writeln(const char *str) {
+      private_write(str);
+      return private_writeln();
+   }
+
+   /**
+    * Write a boolean value
+    *
+    * @param[in]  b Boolean to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_write(bool b) {
+      return private_write(b?"true":"false");
+   }
+
+   /**
+    * Write a boolean value with new line
+    *
+    * @param[in]  b Boolean to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_writeln(bool b) {
+      private_write(b);
+      return private_writeln();
+   }
+
+   /**
+    * Convert an unsigned long integer using current padding and width
+    *
+    * @param[in]  ptr   Buffer to write result (at least 35 characters)
+    * @param[in]  value Unsigned long to convert
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Pointer to '\0' null character at end of converted number
+    */
+   char *formatValue(char *ptr, unsigned long value, Radix radix) {
+      return ultoa(ptr, value, radix, fFormat.fPadding, fFormat.fWidth, false);
+   }
+
+   /**
+    * Convert a long integer using current padding and width
+    *
+    * @param[in]  ptr   Buffer to write result (at least 35 characters)
+    * @param[in]  value Long to convert
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Pointer to '\0' null character at end of converted number
+    */
+   char *formatValue(char *ptr, long value, Radix radix) {
+      bool isNegative = value < 0;
+      if (isNegative) {
+         value = -value;
+      }
+      return ultoa(ptr, static_cast<unsigned long>(value), radix, fFormat.fPadding, fFormat.fWidth, isNegative);
+   }
+
+   /// Convert an unsigned integer using current padding and width
+   char *formatValue(char *ptr, unsigned value, Radix radix) {
+      return formatValue(ptr, static_cast<unsigned long>(value), radix);
+   }
+
+   /// Convert an integer using current padding and width
+   char *formatValue(char *ptr, int value, Radix radix) {
+      return formatValue(ptr, static_cast<long>(value), radix);
+   }
+
+   /// Convert a pointer value using current padding and width
+   char *formatValue(char *ptr, const void *value, Radix radix) {
+      return formatValue(ptr, reinterpret_cast<unsigned long>(value), radix);
+   }
+
+   /**
+    * Write an unsigned long integer
+    *
+    * @param[in]  value Unsigned long to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_write(unsigned long value, Radix radix) {
+      char buff[35];
+      char *end = formatValue(buff, value, radix);
+      _writeChars(buff, end-buff);
+      return *this;
+   }
+
+   /**
+    * Write an unsigned long integer
+    *
+    * @param[in]  value Unsigned long to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO &private_write(unsigned long value) {
+      return private_write(value, Radix_10);
+   }
+
+   /**
+    * Write a long integer
+    *
+    * @param[in]  value Long to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_write(long value, Radix radix) {
+      char buff[35];
+      char *end = formatValue(buff, value, radix);
+      _writeChars(buff, end-buff);
+      return *this;
+   }
+
+   /**
+    * Write a long integer
+    *
+    * @param[in]  value Long to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO &private_write(long value) {
+      return private_write(value, Radix_10);
+   }
+
+   /**
+    * Write an unsigned long integer with newline
+    *
+    * @param[in]  value Unsigned long to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_writeln(unsigned long value, Radix radix) {
+      private_write(value, radix);
+      return private_writeln();
+   }
+
+   /**
+    * Write an unsigned long integer with newline
+    *
+    * @param[in]  value Unsigned long to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO &private_writeln(unsigned long value) {
+      return private_writeln(value, Radix_10);
+   }
+
+   /**
+    * Write an pointer value
+    *
+    * @param[in]  value Pointer value to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_write(const void *value, Radix radix) {
+      return private_write(reinterpret_cast<unsigned long>(value), radix);
+   }
+
+   /**
+    * Write an pointer value
+    *
+    * @param[in]  value Pointer value to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO &private_write(const void *value) {
+      return private_write(value, Radix_16);
+   }
+
+   /**
+    * Write an pointer value with newline
+    *
+    * @param[in]  value Pointer value to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_writeln(const void *value, Radix radix) {
+      private_write(reinterpret_cast<unsigned long>(value), radix);
+      return private_writeln();
+   }
+
+   /**
+    * Write an pointer value with newline
+    *
+    * @param[in]  value Pointer value to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO &private_writeln(const void *value) {
+      return private_writeln(value, Radix_16);
+   }
+
+   /**
+    * Write a long integer with newline
+    *
+    * @param[in]  value Long to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(long value, Radix radix) {
+      private_write(value, radix);
+      return private_writeln();
+   }
+
+   /**
+    * Write a long integer with newline
+    *
+    * @param[in]  value Long to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO &private_writeln(long value) {
+      return private_writeln(value, Radix_10);
+   }
+
+   /**
+    * Write an unsigned integer
+    *
+    * @param[in]  value Unsigned to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(unsigned value, Radix radix) {
+      return private_write(static_cast<unsigned long>(value), radix);
+   }
+
+   /**
+    * Write an unsigned integer
+    *
+    * @param[in]  value Unsigned to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(unsigned value) {
+      return private_write(static_cast<unsigned long>(value), Radix_10);
+   }
+
+   /**
+    * Write an unsigned integer with newline
+    *
+    * @param[in]  value Unsigned to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(unsigned value, Radix radix) {
+      return private_writeln(static_cast<unsigned long>(value), radix);
+   }
+
+   /**
+    * Write an unsigned integer with newline
+    *
+    * @param[in]  value Unsigned to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(unsigned value) {
+      return private_writeln(static_cast<unsigned long>(value), Radix_10);
+   }
+
+   /**
+    * Write an integer
+    *
+    * @param[in]  value Integer to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(int value, Radix radix) {
+      return private_write(static_cast<long>(value), radix);
+   }
+
+   /**
+    * Write an integer
+    *
+    * @param[in]  value Integer to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(int value) {
+      return private_write(static_cast<long>(value), Radix_10);
+   }
+
+   /**
+    * Write an integer with newline
+    *
+    * @param[in]  value Integer to print
+    * @param[in]  radix Radix for conversion [2..16]
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG  &private_writeln(int value, Radix radix) {
+      return private_writeln(static_cast<long>(value), radix);
+   }
+
+   /**
+    * Write an integer with newline
+    *
+    * @param[in]  value Integer to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG  &private_writeln(int value) {
+      return private_writeln(static_cast<long>(value), Radix_10);
+   }
+
+   /// BigNumber words for a double - mantissa scaled by up to 5^340 (denormals at full precision)
+   static constexpr unsigned DOUBLE_BIG_WORDS = 28;
+
+   /// BigNumber words for a float - mantissa scaled by up to 5^60
+   static constexpr unsigned FLOAT_BIG_WORDS  = 6;
+
+   /**
+    * Multi-word unsigned integer used for exact binary to decimal conversion.
+    * Two are on the stack during a conversion so the size is chosen by the type being written
+    * (about 230 bytes for a double and 56 bytes for a float).
+    *
+    * @tparam maxWords Maximum number of 32-bit words
+    */
+   template<unsigned maxWords>
+   struct BigNumber {
+      /// Maximum number of 32-bit words
+      static constexpr unsigned MAX_WORDS = maxWords;
+
+      /// Words, least significant first
+      uint32_t word[MAX_WORDS];
+
+      /// Number of words in use
+      unsigned length;
+
+      /**
+       * Create number
+       *
+       * @param[in] value Initial value
+       */
+      BigNumber(uint64_t value) : length(0) {
+         while (value != 0) {
+            word[length++] = static_cast<uint32_t>(value);
+            value >>= 32;
+         }
+      }
+
+      /**
+       * Multiply by a 32-bit factor
+       *
+       * @param[in] factor Factor
+       */
+      void multiply(uint32_t factor) {
+         uint32_t carry = 0;
+         for (unsigned index=0; index<length; index++) {
+            uint64_t product = static_cast<uint64_t>(word[index])*factor + carry;
+            word[index] = static_cast<uint32_t>(product);
+            carry       = static_cast<uint32_t>(product>>32);
+         }
+         if (carry != 0) {
+            usbdm_assert(length<MAX_WORDS, "BigNumber overflow");
+            word[length++] = carry;
+         }
+      }
+
+      /**
+       * Multiply by 5^power
+       *
+       * @param[in] power Power of 5
+       */
+      void multiplyByPowerOf5(unsigned power) {
+         // 5^13 is the largest power of 5 that fits in 32 bits
+         while (power >= 13) {
+            multiply(1220703125);
+            power -= 13;
+         }
+         uint32_t factor = 1;
+         while (power-- > 0) {
+            factor *= 5;
+         }
+         multiply(factor);
+      }
+
+      /**
+       * Shift left
+       *
+       * @param[in] bits Number of bits to shift
+       */
+      void shiftLeft(unsigned bits) {
+         if (length == 0) {
+            return;
+         }
+         unsigned words = bits/32;
+         bits %= 32;
+         usbdm_assert(length+words+1<=MAX_WORDS, "BigNumber overflow");
+         word[length+words] = 0;
+         for (int index=length-1; index>=0; index--) {
+            word[index+words+1] |= (bits==0)?0:(word[index]>>(32-bits));
+            word[index+words]     = word[index]<<bits;
+         }
+         for (unsigned index=0; index<words; index++) {
+            word[index] = 0;
+         }
+         length += words+1;
+         while ((length>0) && (word[length-1] == 0)) {
+            length--;
+         }
+      }
+
+      /**
+       * Shift right by one bit
+       */
+      void shiftRightOne() {
+         for (unsigned index=0; index<length; index++) {
+            word[index] >>= 1;
+            if ((index+1)<length) {
+               word[index] |= word[index+1]<<31;
+            }
+         }
+         if ((length>0) && (word[length-1] == 0)) {
+            length--;
+         }
+      }
+
+      /**
+       * Compare with another number
+       *
+       * @param[in] other Number to compare with
+       *
+       * @return <0, 0 or >0 as this is less than, equal to or greater than other
+       */
+      int compare(const BigNumber &other) const {
+         if (length != other.length) {
+            return (length<other.length)?-1:1;
+         }
+         for (int index=length-1; index>=0; index--) {
+            if (word[index] != other.word[index]) {
+               return (word[index]<other.word[index])?-1:1;
+            }
+         }
+         return 0;
+      }
+
+      /**
+       * Subtract a smaller or equal number
+       *
+       * @param[in] other Number to subtract
+       */
+      void subtract(const BigNumber &other) {
+         uint32_t borrow = 0;
+         for (unsigned index=0; index<length; index++) {
+            uint32_t subtrahend = ((index<other.length)?other.word[index]:0);
+            uint32_t result     = word[index]-subtrahend-borrow;
+            borrow      = (word[index]<subtrahend) || ((word[index]-subtrahend)<borrow);
+            word[index] = result;
+         }
+         while ((length>0) && (word[length-1] == 0)) {
+            length--;
+         }
+      }
+
+      /**
+       * Get number of significant bits
+       *
+       * @return Bit length (0 for zero)
+       */
+      unsigned bitLength() const {
+         if (length == 0) {
+            return 0;
+         }
+         return 32*length-__builtin_clz(word[length-1]);
+      }
+
+      /**
+       * Get a bit
+       *
+       * @param[in] bit Bit number
+       *
+       * @return Value of bit
+       */
+      bool getBit(unsigned bit) const {
+         return ((bit/32)<length) && ((word[bit/32]>>(bit%32))&1);
+      }
+
+      /**
+       * Check for set bits below a bit position
+       *
+       * @param[in] bit Bit number
+       *
+       * @return true if any of bits [0..bit) are set
+       */
+      bool anyBitsBelow(unsigned bit) const {
+         for (unsigned index=0; (index<length) && (32*index<bit); index++) {
+            uint32_t mask = ((bit-32*index)>=32)?0xFFFFFFFF:((1U<<(bit-32*index))-1);
+            if ((word[index]&mask) != 0) {
+               return true;
+            }
+         }
+         return false;
+      }
+
+      /**
+       * Get 64 bits starting at a bit position
+       *
+       * @param[in] bit Bit number of least significant bit to return
+       *
+       * @return Bits [bit..bit+64)
+       */
+      uint64_t getBits(unsigned bit) const {
+         uint64_t result = 0;
+         unsigned words = ((bit%32)==0)?2:3;
+         for (unsigned index=0; index<words; index++) {
+            unsigned wordIndex = bit/32+index;
+            if (wordIndex<length) {
+               uint64_t value = word[wordIndex];
+               value = (index==0)?(value>>(bit%32)):(value<<(32*index-(bit%32)));
+               result |= value;
+            }
+         }
+         return result;
+      }
+   };
+
+   /**
+    * Get number of significant bits in a value
+    *
+    * @param[in] value Value to examine
+    *
+    * @return Bit length (0 for zero)
+    */
+   static unsigned bitLength(uint64_t value) {
+      unsigned length = 0;
+      while (value != 0) {
+         length++;
+         value >>= 1;
+      }
+      return length;
+   }
+
+   /**
+    * Calculates floor(mantissa * 2^exponent * 10^power) using integer arithmetic only
+    *
+    * @tparam words  Size of BigNumber (DOUBLE_BIG_WORDS or FLOAT_BIG_WORDS)
+    *
+    * @param[in]  mantissa Binary mantissa of value
+    * @param[in]  exponent Binary exponent of value
+    * @param[in]  power    Decimal power to scale by
+    * @param[out] roundUp  Indicates the result should be incremented to round to nearest (ties to even)
+    *
+    * @return Scaled value truncated to an integer - this must be less than 2^64
+    */
+   template<unsigned words>
+   static __attribute__((noinline)) uint64_t scaleDecimal(uint64_t mantissa, int exponent, int power, bool &roundUp) {
+      BigNumber<words> number(mantissa);
+      // 10^power = 5^power * 2^power
+      int shift = exponent+power;
+      if (power >= 0) {
+         number.multiplyByPowerOf5(power);
+         if (shift >= 0) {
+            roundUp = false;
+            return number.getBits(0)<<shift;
+         }
+         uint64_t result = number.getBits(-shift);
+         roundUp = number.getBit(-shift-1) && ((result&1) || number.anyBitsBelow(-shift-1));
+         return result;
+      }
+      // Long division by 5^-power
+      BigNumber<words> divisor(1);
+      divisor.multiplyByPowerOf5(-power);
+      if (shift >= 0) {
+         number.shiftLeft(shift);
+      }
+      else {
+         divisor.shiftLeft(-shift);
+      }
+      uint64_t result = 0;
+      int      bits   = number.bitLength()-divisor.bitLength();
+      if (bits < 0) {
+         bits = 0;
+      }
+      divisor.shiftLeft(bits);
+      for (int bit=bits; bit>=0; bit--) {
+         result <<= 1;
+         if (number.compare(divisor) >= 0) {
+            number.subtract(divisor);
+            result |= 1;
+         }
+         divisor.shiftRightOne();
+      }
+      // Remainder is now in number and divisor has become floor(divisor/2).
+      // An odd divisor can't be exactly half way.
+      int comparison = number.compare(divisor);
+      roundUp = (comparison>0) || ((comparison==0) && (shift<0) && (result&1));
+      return result;
+   }
+
+   /**
+    * Calculates round(mantissa * 2^exponent * 10^power) using integer arithmetic only
+    *
+    * @tparam words  Size of BigNumber (DOUBLE_BIG_WORDS or FLOAT_BIG_WORDS)
+    *
+    * @param[in]  mantissa Binary mantissa of value
+    * @param[in]  exponent Binary exponent of value
+    * @param[in]  power    Decimal power to scale by
+    *
+    * @return Scaled value rounded to nearest (ties to even)
+    */
+   template<unsigned words>
+   static uint64_t roundDecimal(uint64_t mantissa, int exponent, int power) {
+      bool roundUp;
+      uint64_t result = scaleDecimal<words>(mantissa, exponent, power, roundUp);
+      return result+roundUp;
+   }
+
+   /**
+    * Calculates the decimal exponent of a value i.e. floor(log10(value))
+    *
+    * @tparam words  Size of BigNumber (DOUBLE_BIG_WORDS or FLOAT_BIG_WORDS)
+    *
+    * @param[in]  mantissa Binary mantissa of value (non-zero)
+    * @param[in]  exponent Binary exponent of value
+    *
+    * @return Decimal exponent
+    */
+   template<unsigned words>
+   static int decimalExponent(uint64_t mantissa, int exponent) {
+      // Estimate from binary exponent: log10(2) ~ 1233/4096
+      int decimal = ((static_cast<int>(bitLength(mantissa))-1+exponent)*1233)>>12;
+      for(;;) {
+         bool roundUp;
+         uint64_t scaled = scaleDecimal<words>(mantissa, exponent, -decimal, roundUp);
+         if (scaled >= 10) {
+            decimal++;
+         }
+         else if (scaled < 1) {
+            decimal--;
+         }
+         else {
+            return decimal;
+         }
+      }
+   }
+
+   /**
+    * Floating point number classification
+    */
+   enum FloatClass : uint8_t {
+      FloatClass_Finite,   //!< Zero, normal or denormal number
+      FloatClass_Infinite, //!< +/- Infinity
+      FloatClass_Nan,      //!< Not a number
+   };
+
+   /**
+    * Splits a double into integer parts without using floating point operations
+    * value = (-1)^isNegative * mantissa * 2^exponent
+    *
+    * @param[in]  value      Value to split
+    * @param[out] isNegative Sign of value (false for -0.0)
+    * @param[out] mantissa   Binary mantissa
+    * @param[out] exponent   Binary exponent
+    *
+    * @return Class of number
+    */
+   static FloatClass splitFloat(double value, bool &isNegative, uint64_t &mantissa, int &exponent) {
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      unsigned biasedExponent = (bits>>52)&0x7FF;
+      mantissa   = bits&((1ULL<<52)-1);
+      exponent   = 0;
+      isNegative = (bits>>63) && ((biasedExponent != 0) || (mantissa != 0));
+      if (biasedExponent == 0x7FF) {
+         return (mantissa==0)?FloatClass_Infinite:FloatClass_Nan;
+      }
+      if (biasedExponent == 0) {
+         // Denormal
+         exponent = 1-1075;
+      }
+      else {
+         mantissa |= 1ULL<<52;
+         exponent  = biasedExponent-1075;
+      }
+      return FloatClass_Finite;
+   }
+
+   /**
+    * Splits a float into integer parts without using floating point operations
+    * value = (-1)^isNegative * mantissa * 2^exponent
+    *
+    * @param[in]  value      Value to split
+    * @param[out] isNegative Sign of value (false for -0.0)
+    * @param[out] mantissa   Binary mantissa
+    * @param[out] exponent   Binary exponent
+    *
+    * @return Class of number
+    */
+   static FloatClass splitFloat(float value, bool &isNegative, uint64_t &mantissa, int &exponent) {
+      uint32_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      unsigned biasedExponent = (bits>>23)&0xFF;
+      mantissa   = bits&((1U<<23)-1);
+      exponent   = 0;
+      isNegative = (bits>>31) && ((biasedExponent != 0) || (mantissa != 0));
+      if (biasedExponent == 0xFF) {
+         return (mantissa==0)?FloatClass_Infinite:FloatClass_Nan;
+      }
+      if (biasedExponent == 0) {
+         // Denormal
+         exponent = 1-150;
+      }
+      else {
+         mantissa |= 1U<<23;
+         exponent  = biasedExponent-150;
+      }
+      return FloatClass_Finite;
+   }
+
+   /**
+    * Converts a value to engineering notation i.e. mantissa in [1..1000) and exponent a multiple of 3.
+    * Only integer operations are used.
+    *
+    * @param[in]  value      Value to convert
+    * @param[out] isNegative Sign of value
+    * @param[out] mantissa   Mantissa scaled by fFloatPrecisionMultiplier and rounded
+    * @param[out] exponent   Decimal exponent
+    */
+   void convertToEngineeringNotation(double value, bool &isNegative, unsigned &mantissa, int &exponent) {
+      uint64_t binaryMantissa;
+      int      binaryExponent;
+      exponent = 0;
+      mantissa = 0;
+      if ((splitFloat(value, isNegative, binaryMantissa, binaryExponent) != FloatClass_Finite) || (binaryMantissa == 0)) {
+         return;
+      }
+      // Scale [1..999]
+      int decimal = decimalExponent<DOUBLE_BIG_WORDS>(binaryMantissa, binaryExponent);
+      exponent = decimal-(((decimal%3)+3)%3);
+
+      // Round - may push number out of [1..999]
+      // Note: number is also scaled by precision
+      mantissa = roundDecimal<DOUBLE_BIG_WORDS>(binaryMantissa, binaryExponent, fFormat.fFloatPrecision-exponent);
+
+      // Check if nudged out of range
+      if (mantissa>=(1000*fFormat.fFloatPrecisionMultiplier)) {
+         exponent += 3;
+         mantissa = roundDecimal<DOUBLE_BIG_WORDS>(binaryMantissa, binaryExponent, fFormat.fFloatPrecision-exponent);
+      }
+   }
+#if 0
+   /**
+    * Write a double
+    *
+    * @param[in]  value Double to print
+    *
+    * @return Reference to self
+    *
+    * @note Uses snprintf() which is large.
+    * @note To use this function it is necessary to enable floating point printing\n
+    *       in the linker options (Support %f format in printf -u _print_float)).
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(double value) {
+      char buff[20];
+      snprintf(buff, sizeof(buff), "%f", value);
+      return private_write(buff);
+   }
+#else
+   /**
+    * Write a floating point value already split into integer parts.
+    *
+    * Values are written with fFloatPrecision digits after the decimal point.
+    * Scientific notation (d.dddEn) is used if the value doesn't fit in an unsigned long
+    * after scaling by the precision or if it would be written as zero.
+    * Digits are correctly rounded (ties to even) and only integer arithmetic is used.
+    *
+    * @tparam words  Size of BigNumber (DOUBLE_BIG_WORDS or FLOAT_BIG_WORDS)
+    *
+    * @param[in]  floatClass Class of number
+    * @param[in]  isNegative Sign of value
+    * @param[in]  mantissa   Binary mantissa
+    * @param[in]  exponent   Binary exponent
+    *
+    * @return Reference to self
+    */
+   template<unsigned words>
+   FormattedIO __attribute__((noinline)) &writeFloat(FloatClass floatClass, bool isNegative, uint64_t mantissa, int exponent) {
+      if (floatClass == FloatClass_Nan) {
+         return private_write("Nan");
+      }
+      if (floatClass == FloatClass_Infinite) {
+         return private_write(isNegative?"-Inf":"Inf");
+      }
+      // Precision is limited by fFloatPrecisionMultiplier
+      int precision = (fFormat.fFloatPrecision>9)?9:fFormat.fFloatPrecision;
+
+      uint64_t scaledValue     = 0;
+      int      decimal         = 0;
+      if (mantissa != 0) {
+         bool roundUp = false;
+         // Values of 2^33 or more can't fit
+         if ((static_cast<int>(bitLength(mantissa))+exponent) <= 33) {
+            scaledValue = scaleDecimal<words>(mantissa, exponent, precision, roundUp);
+         }
+         if ((scaledValue != 0) && ((scaledValue+roundUp) <= 0xFFFFFFFFUL)) {
+            scaledValue += roundUp;
+         }
+         else {
+            // Change to scientific notation with one digit to left of decimal point
+            uint64_t limit = 10;
+            for (int count=0; count<precision; count++) {
+               limit *= 10;
+            }
+            decimal     = decimalExponent<words>(mantissa, exponent);
+            scaledValue = roundDecimal<words>(mantissa, exponent, precision-decimal);
+            if (scaledValue >= limit) {
+               // Nudged out of range
+               decimal++;
+               scaledValue = roundDecimal<words>(mantissa, exponent, precision-decimal);
+            }
+         }
+      }
+      // Digits in reverse order - at least (precision+1) digits
+      char digits[24];
+      char *digitPtr = digits;
+      if (scaledValue > 0xFFFFFFFFUL) {
+         // Only happens in scientific notation where scaledValue < 10^10 < 2^34
+         // scaledValue/100 = (scaledValue/4)/25
+         uint64_t quotient = ((scaledValue>>2)*0x51EB851FU)>>35;
+         digitPtr    = reverseDigitPair(digitPtr, static_cast<unsigned>(scaledValue-(quotient*100)));
+         scaledValue = quotient;
+      }
+      digitPtr = reverseDigits<Radix_10>(digitPtr, static_cast<unsigned long>(scaledValue));
+      while ((digitPtr-digits) <= precision) {
+         *digitPtr++ = '0';
+      }
+      // Integer part with padding (field width limited to buffer)
+      char buff[sizeof(digits)+2+2+5+16];
+      char *ptr = buff;
+      for (char *intPtr=digits+precision; intPtr<digitPtr; intPtr++) {
+         *ptr++ = *intPtr;
+      }
+      int width = (fFormat.fFloatWidth>16)?16:fFormat.fFloatWidth;
+      ptr = padDigits(buff, ptr, fFormat.fFloatPadding, width, isNegative);
+      // Fractional part
+      if (precision>0) {
+         *ptr++ = '.';
+         for (int index=precision-1; index>=0; index--) {
+            *ptr++ = digits[index];
+         }
+      }
+      // Exponent
+      if (decimal != 0) {
+         *ptr++ = 'E';
+         if (decimal<0) {
+            *ptr++ = '-';
+            decimal = -decimal;
+         }
+         ptr = ultoa<Radix_10>(ptr, decimal);
+      }
+      _writeChars(buff, ptr-buff);
+      return *this;
+   }
+
+   /**
+    * Write a double - Limited to 9 decimal places
+    *
+    * @param[in]  value Double to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(double value) {
+      bool     isNegative;
+      uint64_t mantissa;
+      int      exponent;
+      FloatClass floatClass = splitFloat(value, isNegative, mantissa, exponent);
+      return writeFloat<DOUBLE_BIG_WORDS>(floatClass, isNegative, mantissa, exponent);
+   }
+#endif
+
+   /**
+    * Write a double with newline
+    *
+    * @param[in]  value Double to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &private_writeln(double value) {
+      private_write(value);
+      return private_writeln();
+   }
+
+   /**
+    * Write a float
+    *
+    * @param[in]  value Float to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(float value) {
+      bool     isNegative;
+      uint64_t mantissa;
+      int      exponent;
+      FloatClass floatClass = splitFloat(value, isNegative, mantissa, exponent);
+      return writeFloat<FLOAT_BIG_WORDS>(floatClass, isNegative, mantissa, exponent);
+   }
+
+   /**
+    * Write a float with newline
+    *
+    * @param[in]  value Float to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(float value) {
+      private_write(value);
+      return private_writeln();
+   }
+
+   /**
+    * Write a C string
+    *
+    * @param array
+    * @return
+    */
+   template <size_t N>
+   FormattedIO NOINLINE_DEBUG &private_write(const char (&array)[N]) {
+      return private_write((const char*)array);
+   }
+
+   /**
+    * Write a C string with newline
+    *
+    * @param array
+    * @return
+    */
+   template <size_t N>
+   FormattedIO NOINLINE_DEBUG &private_writeln(const char (&array)[N]) {
+      return private_writeln((const char*)array);
+   }
+
+#if (USE_DIMENSION_CHECK)
+   /**
+    * Write a Seconds variable
+    *
+    * @param[in]  value Seconds to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(const Seconds value) {
+      unsigned mantissa;
+      int      exponent;
+      bool     isNegative;
+
+      convertToEngineeringNotation(value.getValue(), isNegative, mantissa, exponent);
+
+      const char *units = " s";
+      if (exponent<-6) {
+         exponent += 9;
+         units =  " ns";
+      }
+      else if (exponent<-3) {
+         exponent += 6;
+         units =  " us";
+      }
+      else if (exponent<0) {
+         exponent += 3;
+         units =  " ms";
+      }
+      private_write(mantissa/fFormat.fFloatPrecisionMultiplier);
+      private_write('.');
+      char buff[10];
+      ultoa<Radix_10>(buff, mantissa%fFormat.fFloatPrecisionMultiplier, Padding_LeadingZeroes, fFormat.fFloatPrecision);
+      private_write(buff);
+
+      if (exponent != 0) {
+         private_write('E');
+         private_write(exponent);
+      }
+      private_write(units);
+      return *this;
+   }
+
+   /**
+    * Write a Seconds variable
+    *
+    * @param[in]  value Seconds to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(const Seconds value) {
+      return private_write(value);
+   }
+
+   /**
+    * Write a Seconds variable with newline
+    *
+    * @param[in]  value Seconds to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(const Seconds value) {
+      return private_write(value).private_writeln();
+   }
+
+   /**
+    * Write a Ticks variable
+    *
+    * @param[in]  value Ticks to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(const Ticks value) {
+      return private_write(value.getValue()).private_write(" ticks");
+   }
+
+   /**
+    * Write a Ticks variable
+    *
+    * @param[in]  value Ticks to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(const Ticks value) {
+      return private_write(value);
+   }
+
+   /**
+    * Write a Ticks variable with newline
+    *
+    * @param[in]  value Ticks to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(const Ticks value) {
+      return private_write(value).private_writeln();
+   }
+
+   /**
+    * Write a Hertz variable
+    *
+    * @param[in]  value Hertz to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_write(const Hertz value) {
+      unsigned mantissa;
+      int      exponent;
+      bool     isNegative;
+
+      convertToEngineeringNotation(value.getValue(), isNegative, mantissa, exponent);
+
+      const char *units = " Hz";
+      if (exponent>=6) {
+         exponent -= 6;
+         units =  " MHz";
+      }
+      else if (exponent>=3) {
+         exponent -= 3;
+         units =  " kHz";
+      }
+      private_write(mantissa/fFormat.fFloatPrecisionMultiplier);
+      private_write('.');
+      char buff[10];
+      ultoa<Radix_10>(buff, mantissa%fFormat.fFloatPrecisionMultiplier, Padding_LeadingZeroes, fFormat.fFloatPrecision);
+      private_write(buff);
+      if (exponent != 0) {
+         private_write('E');
+         private_write(exponent);
+      }
+      private_write(units);
+      return *this;
+   }
+
+   /**
+    * Write a Hertz variable with newline
+    *
+    * @param[in]  value Hertz to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &private_writeln(const Hertz value) {
+      return private_write(value).private_writeln();
+   }
+
+   /**
+    * Write a Hertz variable
+    *
+    * @param[in]  value Hertz to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(const Hertz value) {
+      return private_write(value);
+   }
+#endif
+
+public:
+   /**
+    * Write a character
+    *
+    * @param[in]  ch Character to print
+    *
+    * @return Reference to self
+     */
+   FormattedIO NOINLINE_DEBUG &operator <<(char ch) {
+      return private_write(ch);
+   }
+
+   /**
+    * Write a boolean value
+    *
+    * @param[in]  b Boolean to print
+    *
+    * @return Reference to self
+     */
+   FormattedIO NOINLINE_DEBUG &operator <<(bool b) {
+      return private_write(b);
+   }
+
+   /**
+    * Write a C string
+    *
+    * @param[in]  str String to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(const char *str) {
+      return private_write(str);
+   }
+
+   /**
+    * Write an unsigned long integer
+    *
+    * @param[in]  value Unsigned long to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(unsigned long value) {
+      return private_write(value, fFormat.fRadix);
+   }
+
+   /**
+    * Write a long integer
+    *
+    * @param[in]  value Long to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(long value) {
+      return private_write(value, fFormat.fRadix);
+   }
+
+   /**
+    * Write an unsigned integer
+    *
+    * @param[in]  value Unsigned to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(unsigned int value) {
+      return private_write(value, fFormat.fRadix);
+   }
+
+   /**
+    * Write an integer
+    *
+    * @param[in]  value Integer to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(int value) {
+      return private_write(value, fFormat.fRadix);
+   }
+
+   /**
+    * Write a pointer value
+    *
+    * @param[in]  value Pointer value to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(const void *value) {
+      return private_write(reinterpret_cast<unsigned long>(value), fFormat.fRadix);
+   }
+
+   /**
+    * Write a float
+    *
+    * @param[in]  value Float to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(float value) {
+      return private_write(value);
+   }
+
+   /**
+    * Write a double
+    *
+    * @param[in]  value Double to print
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(double value) {
+      return private_write(value);
+   }
+
+   /**
+    * Sets the conversion radix for integer types
+    *
+    * @param[in] radix Radix to set
+    *
+    * @return Reference to self
+    *
+    * @note Only applies for operator<< methods
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(Radix radix) {
+      fFormat.fRadix = radix;
+      return *this;
+   }
+
+   /**
+    * Write end-of-line
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(EndOfLineType) {
+      return private_writeln();
+   }
+
+   /**
+    * Enable/Disable echoing of input characters
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(EchoMode echoMode) {
+      return setEcho(echoMode);
+   }
+
+   /**
+    * Enable/Disable echoing of input characters
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(EchoMode echoMode) {
+      return setEcho(echoMode);
+   }
+
+   /**
+    * Flush output data
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator <<(FlushType) {
+      flushOutput();
+      return *this;
+   }
+
+   /**
+    * Null function (for debug)
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &null() {
+      return *this;
+   }
+
+   /**
+    * Discard white-space from the input
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &skipWhiteSpace() {
+      int ch;
+      do {
+         ch = readChar();
+      } while (isspace(ch));
+      pushBack(ch);
+      return *this;
+   }
+
+   /**
+    * Discard input until end-of-line (inclusive)
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &readln() {
+      while (readChar() != '\n') {
+         __asm__("nop");
+      }
+      return *this;
+   }
+
+   /**
+    * Read a character from the input
+    *
+    * @param[out] ch Where to place character read
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &read(char &ch) {
+      ch = readChar();
+      return *this;
+   }
+
+   /**
+    * Get and clear error state
+    *
+    * @return false No error
+    * @return true  Operation failed since last checked e.g. illegal digit at start of number
+    */
+   bool __attribute__((noinline)) isError() {
+      bool t = inErrorState;
+      inErrorState = false;
+      return t;
+   }
+
+   /**
+    * Receives an unsigned long
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO __attribute__((noinline)) &read(unsigned long &value, Radix radix=Radix_10) {
+      // Skip white space
+      int ch;
+      do {
+         ch = readChar();
+      } while (isspace(ch));
+
+      // Check if sign character
+      bool negative = (ch == '-');
+      if (negative) {
+         // Discard  '-'
+         ch = readChar();
+      }
+
+      // Parse number
+      value = 0;
+      int digitCount = 0;
+      do {
+         int digit = convertDigit(ch, radix);
+         if (digit<0) {
+            break;
+         }
+         digitCount++;
+         value *= static_cast<unsigned>(radix);
+         value += digit;
+         ch = readChar();
+      } while (true);
+
+      // Must have at least 1 digit
+      inErrorState = (digitCount<=0);
+
+      // Push back 1st non-digit
+      pushBack(ch);
+      if (negative) {
+         value = -value;
+      }
+      return *this;
+   }
+
+   /**
+    * Controls echoing of input characters
+    *
+    * @param echoMode
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &setEcho(EchoMode echoMode=EchoMode_On) {
+      fFormat.fEcho = echoMode;
+      return *this;
+   }
+   /**
+    * Receives an unsigned long and then discards characters until end of line.
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &readln(unsigned long &value, Radix radix=Radix_10) {
+      read(value, radix);
+      return readln();
+   }
+
+   /**
+    * Receives a long
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &read(long &value, Radix radix=Radix_10) {
+      unsigned long temp;
+      read(temp, radix);
+      value = temp;
+      return *this;
+   }
+
+   /**
+    * Receives a long and then discards characters until end of line.
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &readln(long &value, Radix radix=Radix_10) {
+      read(value, radix);
+      return readln();
+   }
+
+   /**
+    * Receives an unsigned integer
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &read(unsigned int &value, Radix radix=Radix_10) {
+      unsigned long temp;
+      read(temp, radix);
+      value = temp;
+      return *this;
+   }
+
+   /**
+    * Receives an unsigned integer and then discards characters until end of line.
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &readln(unsigned &value, Radix radix=Radix_10) {
+      read(value, radix);
+      return readln();
+   }
+
+   /**
+    * Receives an integer
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &read(int &value, Radix radix=Radix_10) {
+      long temp;
+      read(temp, radix);
+      value = temp;
+      return *this;
+   }
+
+   /**
+    * Receives an integer and then discards characters until end of line.
+    *
+    * @param[out] value Where to place value read
+    * @param[in]  radix The radix to use
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &readln(int &value, Radix radix=Radix_10) {
+      read(value, radix);
+      return readln();
+   }
+
+   /**
+    * Discard white-space from the input
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(WhiteSpaceType) {
+      return skipWhiteSpace();
+   }
+
+   /**
+    * Discard input until end-of-line
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(EndOfLineType) {
+      while (readChar() != '\n') {
+         __asm__("nop");
+      }
+      return *this;
+   }
+
+   /**
+    * Flush input data
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(FlushType) {
+      flushInput();
+      return *this;
+   }
+
+   /**
+    * Sets the conversion radix for integer types
+    *
+    * @param[in]  radix Radix to set
+    *
+    * @return Reference to self
+    *
+    * @note Only applies for operator<< methods
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(Radix radix) {
+      fFormat.fRadix = radix;
+      return *this;
+   }
+
+   /**
+    * Receives a single character
+    *
+    * @param[out] ch Where to place character read
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(char &ch) {
+      ch = readChar();
+      return *this;
+   }
+
+   /**
+    * Receives an unsigned long
+    *
+    * @param[out] value Where to place value read
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(unsigned long &value) {
+      return read(value, fFormat.fRadix);
+   }
+
+   /**
+    * Receives a long
+    *
+    * @param[out] value Where to place value read
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(long &value) {
+      return read(value, fFormat.fRadix);
+   }
+
+   /**
+    * Receives an unsigned long
+    *
+    * @param[out] value Where to place value read
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(unsigned int &value) {
+      return read(value, fFormat.fRadix);
+   }
+
+   /**
+    * Receives an integer
+    *
+    * @param[out] value Where to place value read
+    *
+    * @return Reference to self
+    *
+    * @note Skips leading whitespace
+    */
+   FormattedIO NOINLINE_DEBUG &operator >>(int &value) {
+      return read(value, fFormat.fRadix);
+   }
+
+   /**
+    * Get conversion radix for given base
+    *
+    * @param[in]  radix Base to convert to radix [2..16]
+    *
+    * @return Radix corresponding to base
+    */
+   static constexpr Radix NOINLINE_DEBUG radix(unsigned radix) {
+      return static_cast<Radix>(radix);
+   }
+
+   /**
+    * Create field width object
+    *
+    * @code
+    * Uart0 myUart;
+    * myUart<<Uart0::width(10)<<123;
+    * @endcode
+    *
+    * @param[in]  width Integer to convert to width
+    *
+    * @return Width corresponding to width
+    */
+   static constexpr Width NOINLINE_DEBUG width(int width) {
+      return static_cast<Width>(width);
+   }
+
+   /**
+    * Set printing format
+    *
+    * @param ioSettings    Setting to apply
+    *
+    * @return Reference to self
+    */
+   FormattedIO &operator<<(const IoFormat &ioSettings) {
+      fFormat = ioSettings;
+      return *this;
+   }
+
+   /**
+    * Set width for integers
+    *
+    * @param[in] width
+    *
+    * @return Reference to self
+    */
+   FormattedIO &operator<<(Width width) {
+      setWidth(width);
+      return *this;
+   }
+
+   /**
+    * Set padding for integers
+    *
+    * @param[in] padding
+    *
+    * @return Reference to self
+    */
+   FormattedIO &operator<<(Padding padding) {
+      setPadding(padding);
+      return *this;
+   }
+
+   /**
+    * Write an integral array
+    *
+    * @param[in]  array Pointer to array to print
+    * @param[in]  size  Number of elements in array
+    * @param[in]  radix Radix for conversion
+    *
+    * @return Reference to self
+    */
+   template <typename T>
+   FormattedIO NOINLINE_DEBUG &writeArray(const T array[], size_t size, Radix radix) {
+      unsigned itemCount = 0;
+      const char *prefix="";
+      switch(radix) {
+         case Radix_2:  prefix = "0b"; break;
+         case Radix_8:  prefix = "0";  break;
+         case Radix_16: prefix = "0x"; break;
+         case Radix_10:                break;
+         default:                      break;
+      }
+      // Each item is assembled and written as a block
+      char buff[3+2+35+2+1];
+      _writeChars("{ ", 2);
+      for(unsigned index=0; index<size; index++) {
+         char *ptr = buff;
+         if (itemCount>=10) {
+            itemCount = 0;
+            ptr = strcpy(ptr, "\n  ");
+         }
+         itemCount++;
+         ptr = strcpy(ptr, prefix);
+         ptr = formatValue(ptr, array[index], radix);
+         ptr = strcpy(ptr, ", ");
+         _writeChars(buff, ptr-buff);
+      }
+      private_write('}');
+      return *this;
+   }
+
+   /**
+    * Write an integral array with newline
+    *
+    * @param[in]  array Pointer to array to print
+    * @param[in]  size  Number of elements in array
+    * @param[in]  radix Radix for conversion
+    *
+    * @return Reference to self
+    */
+   template <typename T>
+   FormattedIO NOINLINE_DEBUG &writelnArray(const T array[], size_t size, Radix radix) {
+      writeArray(array, size, radix);
+      return private_writeln();
+   }
+
+   /**
+    * Write an integral array
+    *
+    * @param[in]  array Reference to array to print
+    * @param[in]  radix Radix for conversion
+    *
+    * @return Reference to self
+    */
+   template <typename T, size_t N>
+   FormattedIO NOINLINE_DEBUG &writeArray(const T (&array)[N], Radix radix) {
+      return writeArray(array, N, radix);
+   }
+
+   /**
+    * Write an integral array with newline
+    *
+    * @param[in]  array Reference to array to print
+    * @param[in]  radix Radix for conversion
+    *
+    * @return Reference to self
+    */
+   template <typename T, size_t N>
+   FormattedIO NOINLINE_DEBUG &writelnArray(const T (&array)[N], Radix radix) {
+      writeArray(array, N, radix);
+      return private_writeln();
+   }
+
+   /**
+    * Write an array
+    *
+    * @param[in]  array Pointer to array to print
+    * @param[in]  size  Number of elements in array
+    *
+    * @return Reference to self
+    */
+   template <typename T>
+   FormattedIO NOINLINE_DEBUG &writeArray(const T array[], size_t size) {
+      unsigned itemCount = 0;
+      private_write("{ ");
+      for(unsigned index=0; index<size; index++) {
+         if (itemCount>=10) {
+            itemCount = 0;
+            private_write("\n  ");
+         }
+         itemCount++;
+         private_write(array[index]);
+         private_write(", ");
+      }
+      private_write('}');
+      return *this;
+   }
+
+   /**
+    * Write an array with newline
+    *
+    * @param[in]  array Pointer to array to print
+    * @param[in]  size  Number of elements in array
+    *
+    * @return Reference to self
+    */
+   template <typename T>
+   FormattedIO NOINLINE_DEBUG &writelnArray(const T array[], size_t size) {
+      writeArray(array, size);
+      return private_writeln();
+   }
+
+   /**
+    * Write an array
+    *
+    * @param[in]  array Reference to array to print
+    *
+    * @return Reference to self
+    */
+   template <typename T, size_t N>
+   FormattedIO NOINLINE_DEBUG &writeArray(const T (&array)[N]) {
+      return writeArray(array, N);
+   }
+
+   /**
+    * Write an array with newline
+    *
+    * @param[in]  array Reference to array to print
+    *
+    * @return Reference to self
+    */
+   template <typename T, size_t N>
+   FormattedIO NOINLINE_DEBUG &writelnArray(const T (&array)[N]) {
+      return writelnArray(array, N);
+   }
+
+   /**
+    * Print an array as a hex table.
+    * The indexes shown are for byte offsets suitable for a memory dump.
+    *
+    * @param data          Array to print
+    * @param size          Size of array in elements
+    * @param visibleIndex The starting index to print for the array. Should be multiple of sizeof(data[]).
+    */
+   template <typename T>
+   void writeArray(T *data, uint32_t size, uint32_t visibleIndex) {
+      usbdm_assert((visibleIndex%sizeof(T))==0, "visibleIndex should be multiple of sizeof(data[])");
+      unsigned rowMask;
+      unsigned offset;
+
+      switch(sizeof(T)) {
+         case 1  :
+            offset = (visibleIndex/sizeof(T))&0xF;
+            visibleIndex &= ~0xF;
+            rowMask = 0xF;  break;
+         case 2  :
+            offset = (visibleIndex/sizeof(T))&0x7;
+            visibleIndex &= ~0xF;
+            rowMask = 0x7; break;
+         default :
+            offset = (visibleIndex/sizeof(T))&0x7;
+            visibleIndex &= ~0x1F;
+            rowMask = 0x7; break;
+      }
+      setPadding(Padding_TrailingSpaces).setWidth(2*sizeof(T));
+      private_write("          ");
+      for (unsigned index=0; index<=(rowMask*sizeof(T)); index+=sizeof(T)) {
+         private_write(index, Radix_16).private_write(" ");
+      }
+      private_writeln();
+      setPadding(Padding_LeadingZeroes);
+      bool needNewline = true;
+      size += offset;
+      for (unsigned index=0; index<size; index++) {
+         if (needNewline) {
+            setWidth(8);
+            private_write(visibleIndex+index*sizeof(T), Radix_16).private_write(": ");
+         }
+         if (index<offset) {
+            switch(sizeof(T)) {
+               case 1  : private_write("   ");       break;
+               case 2  : private_write("     ");     break;
+               default : private_write("         "); break;
+            }
+         }
+         else {
+            setWidth(2*sizeof(T));
+            private_write(data[index-offset], Radix_16).private_write(" ");
+         }
+         needNewline = (((index+1)&rowMask)==0);
+         if (needNewline) {
+            private_writeln();
+         }
+      }
+      private_writeln().resetFormat();
+   }
+
+   /**
+    * Write a hex dump of memory with address and optional ASCII columns.
+    * Each line is assembled in a buffer using a nibble look-up table and written as a block.
+    * This is much faster than writeArray(data, size, visibleIndex) for large dumps.
+    *
+    * Example (bytesPerLine=16)
+    * @code
+    *           00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F
+    * 00000120:          53 74 61 72 74 69 6E 67 0A 00 FF FF FF     Starting.....
+    * @endcode
+    *
+    * @param data           Memory to dump
+    * @param size           Number of bytes to dump
+    * @param visibleAddress Address shown for the first byte. Lines start at a multiple of bytesPerLine.
+    * @param bytesPerLine   Bytes on each line (16 or 32)
+    * @param showAscii      Show printable characters after the bytes
+    *
+    * @return Reference to self
+    */
+   FormattedIO NOINLINE_DEBUG &writeHexDump(
+         const void *data,
+         size_t      size,
+         uint32_t    visibleAddress,
+         unsigned    bytesPerLine=16,
+         bool        showAscii=true) {
+
+      usbdm_assert((bytesPerLine==16)||(bytesPerLine==32), "bytesPerLine must be 16 or 32");
+
+      static constexpr char nibbles[] = "0123456789ABCDEF";
+
+      // Address, bytes, ASCII and newline
+      char line[8+2+3*32+1+32+1];
+
+      // Header with column offsets
+      memset(line, ' ', 10);
+      char *ptr = line+10;
+      for (unsigned column=0; column<bytesPerLine; column++) {
+         *ptr++ = nibbles[column>>4];
+         *ptr++ = nibbles[column&0xF];
+         *ptr++ = ' ';
+      }
+      ptr[-1] = '\n';
+      _writeChars(line, ptr-line);
+
+      const uint8_t *bytes       = static_cast<const uint8_t *>(data);
+      uint32_t       lineAddress = visibleAddress&~(bytesPerLine-1);
+      unsigned       skip        = visibleAddress-lineAddress;
+      while (size > 0) {
+         ptr = line;
+         for (int shift=28; shift>=0; shift-=4) {
+            *ptr++ = nibbles[(lineAddress>>shift)&0xF];
+         }
+         *ptr++ = ':';
+         *ptr++ = ' ';
+         unsigned count = bytesPerLine-skip;
+         if (count > size) {
+            count = size;
+         }
+         char *ascii = ptr+3*bytesPerLine+1;
+         memset(ptr, ' ', 3*skip);
+         memset(ascii, ' ', skip);
+         ptr   += 3*skip;
+         ascii += skip;
+         for (unsigned index=0; index<count; index++) {
+            uint8_t value = *bytes++;
+            ptr[0]   = nibbles[value>>4];
+            ptr[1]   = nibbles[value&0xF];
+            ptr[2]   = ' ';
+            ptr     += 3;
+            *ascii++ = ((value>=' ')&&(value<0x7F))?value:'.';
+         }
+         unsigned remainder = bytesPerLine-skip-count;
+         memset(ptr, ' ', 3*remainder+1);
+         ptr += 3*remainder;
+         if (showAscii) {
+            // Trailing spaces are not needed after the ASCII column
+            ptr = ascii;
+         }
+         else {
+            // Drop the trailing space after the bytes
+            ptr--;
+         }
+         *ptr++ = '\n';
+         _writeChars(line, ptr-line);
+
+         size        -= count;
+         lineAddress += bytesPerLine;
+         skip         = 0;
+      }
+      return *this;
+   }
+
+   /**
+    * Function to write a newline
+    *
+    * @tparam T      Type of value (inferred)
+    * @param arg     Argument to write
+    *
+    * @return Reference to self
+    */
+   FormattedIO &writeln() {
+      return private_writeln();
+   }
+
+   /**
+    * Recursive template function to write a value in given radix with following args and newline
+    *
+    * @tparam T      Type of value (inferred)
+    * @tparam Args   Type of remaining args (inferred)
+    * @param  arg    Argument to write
+    * @param  radix  Radix to use
+    * @param  args   Remaining args to write
+    *
+    * @return Reference to self
+    */
+   template<typename T, typename... Args>
+   FormattedIO &writeln(T arg, Radix radix, Args... args ) {
+      private_write(arg, radix);
+      return writeln(args...);
+   }
+
+   /**
+    * Recursive template function to write a value with following args and newline
+    *
+    * @tparam T      Type of value (inferred)
+    * @tparam Args   Type of remaining args (inferred)
+    * @param  arg    Argument to write
+    * @param  args   Remaining args to write
+    *
+    * @return Reference to self
+    */
+   template<typename T, typename... Args>
+   FormattedIO &writeln(T arg, Args... args) {
+      private_write(arg);
+      return writeln(args...);
+   }
+
+   /**
+    * Template function to write a value in given radix with following args
+    *
+    * @tparam T      Type of value (inferred)
+    * @tparam Args   Type of remaining args (inferred)
+    * @param  arg    Argument to write
+    * @param  radix  Radix to use
+    * @param  args   Remaining args to write
+    *
+    * @return Reference to self
+    */
+   template<typename T, typename... Args>
+   FormattedIO &write(T arg, Radix radix, Args... args ) {
+      private_write(arg, radix);
+      if constexpr(sizeof...(args) > 0) {
+         return write(args...);
+      }
+      return *this;
+   }
+
+   /**
+    * Recursive template function to write a value with following args
+    *
+    * @tparam T      Type of value (inferred)
+    * @tparam Args   Type of remaining args (inferred)
+    * @param  arg    Argument to write
+    * @param  args   Remaining args to write
+    *
+    * @return Reference to self
+    */
+   template<typename T, typename... Args>
+   FormattedIO &write(T arg, Args... args) {
+      private_write(arg);
+      if constexpr(sizeof...(args) > 0) {
+         return write(args...);
+      }
+      return *this;
+   }
+
+protected:
+   /**
+    * Field of a compile-time format string e.g. {} or {:08x}
+    */
+   struct FormatSpec {
+      Radix    radix;     //!< Radix for integers
+      Padding  padding;   //!< Padding for integers (if hasWidth)
+      uint8_t  width;     //!< Field width for integers (if hasWidth)
+      bool     hasWidth;  //!< Use padding and width rather than current integer format
+      bool     isDefault; //!< Field is {} - Written as by write(value)
+      bool     isValid;   //!< Field was understood
+   };
+
+   /**
+    * Find end of literal text in a format string
+    *
+    * @param[in] fmt Format string
+    * @param[in] pos Start of literal text
+    *
+    * @return Index of first '{', '}' or '\0' at or after pos
+    */
+   static constexpr size_t formatLiteralEnd(const char *fmt, size_t pos) {
+      while ((fmt[pos] != '\0') && (fmt[pos] != '{') && (fmt[pos] != '}')) {
+         pos++;
+      }
+      return pos;
+   }
+
+   /**
+    * Find end of field in a format string
+    *
+    * @param[in] fmt Format string
+    * @param[in] pos Character after opening '{'
+    *
+    * @return Index of closing '}' (or '\0' if missing)
+    */
+   static constexpr size_t formatFieldEnd(const char *fmt, size_t pos) {
+      while ((fmt[pos] != '\0') && (fmt[pos] != '}')) {
+         pos++;
+      }
+      return pos;
+   }
+
+   /**
+    * Parse field of a format string
+    *
+    * Format is [:[0|<][width][b|o|d|x|X]]
+    *  - 0       Pad with leading zeroes (default leading spaces)
+    *  - <       Pad with trailing spaces
+    *  - width   Field width - current integer format is used if omitted
+    *  - b,o,d,x Radix 2, 8, 10 or 16 (default 10)
+    *
+    * @param[in] fmt Format string
+    * @param[in] pos Character after opening '{'
+    * @param[in] end Index of closing '}'
+    *
+    * @return Parsed field
+    */
+   static constexpr FormatSpec parseFormatSpec(const char *fmt, size_t pos, size_t end) {
+      FormatSpec spec{Radix_10, Padding_LeadingSpaces, 0, false, true, true};
+      if (pos == end) {
+         return spec;
+      }
+      spec.isDefault = false;
+      if (fmt[pos++] != ':') {
+         spec.isValid = false;
+         return spec;
+      }
+      if ((pos<end) && (fmt[pos] == '0')) {
+         spec.padding = Padding_LeadingZeroes;
+         pos++;
+      }
+      else if ((pos<end) && (fmt[pos] == '<')) {
+         spec.padding = Padding_TrailingSpaces;
+         pos++;
+      }
+      unsigned width = 0;
+      while ((pos<end) && (fmt[pos] >= '0') && (fmt[pos] <= '9')) {
+         spec.hasWidth = true;
+         width = 10*width + (fmt[pos++]-'0');
+      }
+      // Buffer in writeField() limits width
+      spec.width = width;
+      if ((width > 32) || ((spec.padding != Padding_LeadingSpaces) && !spec.hasWidth)) {
+         spec.isValid = false;
+      }
+      if (pos<end) {
+         switch(fmt[pos++]) {
+            case 'b':            spec.radix = Radix_2;  break;
+            case 'o':            spec.radix = Radix_8;  break;
+            case 'd':            spec.radix = Radix_10; break;
+            case 'x': case 'X':  spec.radix = Radix_16; break;
+            default:             spec.isValid = false;  break;
+         }
+      }
+      if (pos != end) {
+         spec.isValid = false;
+      }
+      return spec;
+   }
+
+   /**
+    * Flags and fields of the format word passed to writeField()
+    *  - [15:0]  Length of literal text before the field
+    *  - [23:16] Field width
+    *  - [26:24] Padding
+    */
+   /// Use current integer format rather than padding and width in format word
+   static constexpr unsigned FieldFormat_Current  = 1U<<27;
+   /// Value is negative
+   static constexpr unsigned FieldFormat_Negative = 1U<<28;
+
+   /**
+    * Create format word for writeField()
+    *
+    * @param[in] spec          Parsed field
+    * @param[in] prefixLength  Length of literal text before the field
+    *
+    * @return Format word
+    */
+   static constexpr unsigned fieldFormat(const FormatSpec &spec, size_t prefixLength) {
+      if (spec.hasWidth) {
+         return prefixLength|(spec.width<<16)|(spec.padding<<24);
+      }
+      return prefixLength|FieldFormat_Current;
+   }
+
+   /**
+    * Write literal text and an integer field of a compile-time format string
+    *
+    * @tparam radix Radix for conversion
+    *
+    * @param[in]  prefix  Literal text before field
+    * @param[in]  format  Format word - see fieldFormat()
+    * @param[in]  value   Magnitude of value to print
+    *
+    * @return Reference to self
+    */
+   template<Radix radix>
+   FormattedIO __attribute__((noinline)) &writeField(const char *prefix, unsigned format, unsigned long value) {
+      Padding padding = static_cast<Padding>((format>>24)&0x7);
+      int     width   = (format>>16)&0xFF;
+      if (format&FieldFormat_Current) {
+         padding = fFormat.fPadding;
+         width   = fFormat.fWidth;
+      }
+      char buff[35];
+      char *end = ultoa<radix>(buff, value, padding, width, (format&FieldFormat_Negative) != 0);
+      if ((format&0xFFFF) != 0) {
+         _writeChars(prefix, format&0xFFFF);
+      }
+      _writeChars(buff, end-buff);
+      return *this;
+   }
+
+   /**
+    * Write literal text and a signed integer field of a compile-time format string
+    *
+    * @tparam radix Radix for conversion
+    *
+    * @param[in]  prefix  Literal text before field
+    * @param[in]  format  Format word - see fieldFormat()
+    * @param[in]  value   Value to print
+    *
+    * @return Reference to self
+    */
+   template<Radix radix>
+   FormattedIO __attribute__((noinline)) &writeField(const char *prefix, unsigned format, long value) {
+      if (value < 0) {
+         return writeField<radix>(prefix, format|FieldFormat_Negative, -static_cast<unsigned long>(value));
+      }
+      return writeField<radix>(prefix, format, static_cast<unsigned long>(value));
+   }
+
+   /**
+    * Write literal text of a compile-time format string
+    *
+    * @param[in]  text    Text to write
+    * @param[in]  length  Number of characters
+    *
+    * @return Reference to self
+    */
+   FormattedIO __attribute__((noinline)) &writeLiteral(const char *text, size_t length) {
+      _writeChars(text, length);
+      return *this;
+   }
+
+   /**
+    * Write a field of a compile-time format string followed by the rest of the string
+    *
+    * @tparam Format Format string holder e.g. FormatArray
+    * @tparam start  Start of literal text before the field
+    * @tparam pos    Character after opening '{'
+    * @tparam T      Type of value (inferred)
+    * @tparam Args   Type of remaining args (inferred)
+    *
+    * @param  arg    Value for this field
+    * @param  args   Values for remaining fields
+    */
+   template<typename Format, size_t start, size_t pos, typename T, typename... Args>
+   void formatField(T arg, Args... args) {
+      constexpr const char *fmt = Format::string;
+      constexpr size_t     end  = formatFieldEnd(fmt, pos);
+      static_assert(fmt[end] == '}', "Missing '}' in format string");
+      constexpr FormatSpec spec = parseFormatSpec(fmt, pos, end);
+      static_assert(spec.isValid, "Illegal field in format string");
+      constexpr unsigned   format = fieldFormat(spec, pos-1-start);
+
+      if constexpr (std::is_integral<T>::value && !std::is_same<T, char>::value && !std::is_same<T, bool>::value) {
+         static_assert(sizeof(T) <= sizeof(unsigned long), "Integer too large for format()");
+         if constexpr (std::is_signed<T>::value) {
+            writeField<spec.radix>(fmt+start, format, static_cast<long>(arg));
+         }
+         else {
+            writeField<spec.radix>(fmt+start, format, static_cast<unsigned long>(arg));
+         }
+      }
+      else if constexpr (std::is_pointer<T>::value &&
+            !std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value &&
+            !spec.isDefault) {
+         writeField<spec.radix>(fmt+start, format, reinterpret_cast<unsigned long>(arg));
+      }
+      else {
+         static_assert(spec.isDefault, "Only integers and non-string pointers may have a field format");
+         if constexpr (pos-1 > start) {
+            writeLiteral(fmt+start, pos-1-start);
+         }
+         private_write(arg);
+      }
+      formatFrom<Format, end+1>(args...);
+   }
+
+   /**
+    * Write a compile-time format string from given position
+    *
+    * @tparam Format Format string holder e.g. FormatArray
+    * @tparam pos    Position in format string
+    * @tparam Args   Type of args (inferred)
+    *
+    * @param  args   Values for remaining fields
+    */
+   template<typename Format, size_t pos, typename... Args>
+   void formatFrom(Args... args) {
+      constexpr const char *fmt = Format::string;
+      constexpr size_t end = formatLiteralEnd(fmt, pos);
+      if constexpr (fmt[end] == '\0') {
+         static_assert(sizeof...(args) == 0, "Too many arguments for format string");
+         if constexpr (end > pos) {
+            writeLiteral(fmt+pos, end-pos);
+         }
+      }
+      else if constexpr (fmt[end] == fmt[end+1]) {
+         // "{{" or "}}" - Write text including one brace
+         writeLiteral(fmt+pos, end+1-pos);
+         formatFrom<Format, end+2>(args...);
+      }
+      else {
+         static_assert(fmt[end] == '{', "Unmatched '}' in format string");
+         static_assert((fmt[end] != '{') || (sizeof...(args) > 0), "Too few arguments for format string");
+         if constexpr ((fmt[end] == '{') && (sizeof...(args) > 0)) {
+            // Literal text is written with the field
+            formatField<Format, pos, end+1>(args...);
+         }
+      }
+   }
+
+public:
+#if __cplusplus >= 202002L
+   /**
+    * Write values using a format string parsed at compile time.
+    *
+    * The string is reduced to direct writes of the literal text and each field.
+    * There is no run-time parsing.
+    *
+    * Fields are {} or {:[0|<][width][b|o|d|x|X]} e.g. {:x}, {:08x}, {:4}
+    *  - {} writes the value as write(value) would
+    *  - Integers use the current integer format unless a width is given
+    *  - Use {{ and }} for literal braces
+    *
+    * @tparam fmt    Format string literal
+    * @tparam Args   Type of args (inferred)
+    *
+    * @param  args   Values for fields
+    *
+    * @return Reference to self
+    *
+    * Example:
+    * @code
+    *    console.format<"Vdd={} mV, state={:x}\n">(vdd, state);
+    * @endcode
+    */
+   template<FormatString fmt, typename... Args>
+   FormattedIO &format(Args... args) {
+      formatFrom<FormatLiteral<fmt>, 0>(args...);
+      return *this;
+   }
+#else
+   /**
+    * Write values using a format string parsed at compile time.
+    *
+    * The string is reduced to direct writes of the literal text and each field.
+    * There is no run-time parsing.
+    *
+    * Fields are {} or {:[0|<][width][b|o|d|x|X]} e.g. {:x}, {:08x}, {:4}
+    *  - {} writes the value as write(value) would
+    *  - Integers use the current integer format unless a width is given
+    *  - Use {{ and }} for literal braces
+    *
+    * Before C++20 the format string must be a constexpr character array with static storage.
+    *
+    * @tparam fmt    Format string
+    * @tparam Args   Type of args (inferred)
+    *
+    * @param  args   Values for fields
+    *
+    * @return Reference to self
+    *
+    * Example:
+    * @code
+    *    static constexpr char vddFormat[] = "Vdd={} mV, state={:x}\n";
+    *    console.format<vddFormat>(vdd, state);
+    * @endcode
+    */
+   template<const char *fmt, typename... Args>
+   FormattedIO &format(Args... args) {
+      formatFrom<FormatArray<fmt>, 0>(args...);
+      return *this;
+   }
+#endif
+};
+
+/**
+ * End FORMATTED_IO_Group
+ * @}
+ */
+
+} // End namespace USBDM
+
+#endif /* HEADER_FORMATTED_IO_H */
@@ -35,6 +35,193 @@ namespace USBDM {
  */
 typedef void (*I2cCallbackFunction)();
 
+/**
+ * Options for a segment of a batched I2C transaction
+ */
+enum I2cSegmentFlags : uint8_t {
+   I2cSegment_Write    = 0,      //!< Transmit data to slave
+   I2cSegment_Read     = 1<<0,   //!< Receive data from slave (segments of a message must not be empty)
+   I2cSegment_Continue = 1<<1,   //!< Data continues the message of the previous segment (no START or address)
+   I2cSegment_Stop     = 1<<2,   //!< Generate STOP rather than REPEATED-START after the message (then waits for bus idle)
+};
+
+/**
+ * Segment of a batched I2C transaction (see I2c::transfer()).
+ *
+ * Each segment starts a new message i.e. a (REPEATED-)START followed by the slave address,
+ * unless it has I2cSegment_Continue. A continued segment transmits or receives data as part of the
+ * message of the previous segment i.e. data is gathered from (or scattered to) several buffers.
+ * Messages are separated by REPEATED-START unless the last segment of the message has I2cSegment_Stop.
+ * The transaction always ends with STOP.
+ *
+ * @code
+ *    // Write two registers and read back a third as one transaction
+ *    const uint8_t config[] = {IODIR_ADDR, 0x0F, IPOL_ADDR, 0x00};
+ *    const uint8_t gpio[]   = {GPIO_ADDR};
+ *    uint8_t       value;
+ *
+ *    const I2cSegment segments[] = {
+ *       I2cSegment::write(address, 2, config),
+ *       I2cSegment::write(address, 2, config+2),
+ *       I2cSegment::write(address, sizeof(gpio), gpio),
+ *       I2cSegment::read(address, 1, &value),
+ *    };
+ *    ErrorCode rc = i2c.transfer(segments);
+ * @endcode
+ */
+struct I2cSegment {
+   uint8_t   address;   //!< Address of slave (LSB = R/W bit is ignored, not used if continued)
+   uint8_t   flags;     //!< I2cSegmentFlags
+   uint16_t  size;      //!< Number of bytes to transmit or receive
+   uint8_t  *data;      //!< Data to transmit or buffer for reception
+
+   /**
+    * Create segment transmitting data
+    *
+    * @param[in]  address  Address of slave (LSB = R/W bit is ignored)
+    * @param[in]  size     Number of bytes to transmit
+    * @param[in]  data     Data to transmit
+    * @param[in]  flags    I2cSegment_Continue and/or I2cSegment_Stop
+    */
+   static constexpr I2cSegment write(uint8_t address, uint16_t size, const uint8_t data[], unsigned flags=0) {
+      return I2cSegment{address, static_cast<uint8_t>(flags&~I2cSegment_Read), size, const_cast<uint8_t *>(data)};
+   }
+
+   /**
+    * Create segment receiving data
+    *
+    * @param[in]  address  Address of slave (LSB = R/W bit is ignored)
+    * @param[in]  size     Number of bytes to receive
+    * @param[out] data     Buffer for reception
+    * @param[in]  flags    I2cSegment_Continue and/or I2cSegment_Stop
+    */
+   static constexpr I2cSegment read(uint8_t address, uint16_t size, uint8_t data[], unsigned flags=0) {
+      return I2cSegment{address, static_cast<uint8_t>(flags|I2cSegment_Read), size, data};
+   }
+};
+
+class I2cTransaction;
+
+/**
+ * Type definition for transaction completion call back
+ * This is executed from the I2C interrupt handler (or poll()) when a queued transaction completes.
+ *
+ * @param transaction Transaction that has completed (see I2cTransaction::getErrorCode())
+ */
+typedef void (*I2cTransactionCallback)(I2cTransaction &transaction);
+
+/**
+ * Descriptor for a queued I2C transaction.
+ * This is a transmission, a reception or a transmission followed by a reception using repeated-start.
+ *
+ * The descriptor and buffers must remain valid until the transaction completes.
+ * The descriptor also acts as a future i.e. isComplete() may be polled instead of using a callback.
+ *
+ * @code
+ *    static const uint8_t txData[] = {GPIO_ADDR};
+ *    static uint8_t       rxData[1];
+ *    static I2cTransaction transaction(0x40, sizeof(txData), txData, sizeof(rxData), rxData);
+ *
+ *    i2c.queueTransaction(transaction);
+ *    // Do other work
+ *    while (!transaction.isComplete()) {
+ *       // Do other work
+ *    }
+ *    if (transaction.getErrorCode() == E_NO_ERROR) {
+ *       // Use rxData[]
+ *    }
+ * @endcode
+ */
+class I2cTransaction {
+
+   friend class I2c;
+
+private:
+   I2cTransaction     *next      = nullptr;      //!< Next transaction in queue
+   volatile bool       complete  = true;         //!< Transaction has completed (or was never queued)
+   volatile ErrorCode  errorCode = E_NO_ERROR;   //!< Error code from transaction
+
+public:
+   uint8_t                address;      //!< Address of slave to communicate with (LSB = R/W bit is ignored)
+   uint16_t               txSize;       //!< Size of transmission data
+   const uint8_t         *txData;       //!< Data for transmission
+   uint16_t               rxSize;       //!< Size of reception data
+   uint8_t               *rxData;       //!< Data buffer for reception
+   I2cTransactionCallback callback;     //!< Executed on completion (may be nullptr)
+   const I2cSegment      *segments;     //!< Segments of batched transaction (nullptr if not batched)
+   uint16_t               segmentCount; //!< Number of segments
+
+   /**
+    * Create transaction descriptor
+    *
+    * @param[in]  address  Address of slave to communicate with (LSB = R/W bit is ignored)
+    * @param[in]  txSize   Size of transmission data (0 for reception only)
+    * @param[in]  txData   Data for transmission
+    * @param[in]  rxSize   Size of reception data (0 for transmission only)
+    * @param[out] rxData   Data buffer for reception
+    * @param[in]  callback Executed on completion (may be nullptr)
+    */
+   constexpr I2cTransaction(
+         uint8_t                address,
+         uint16_t               txSize,
+         const uint8_t          txData[],
+         uint16_t               rxSize   = 0,
+         uint8_t                rxData[] = nullptr,
+         I2cTransactionCallback callback = nullptr) :
+      address(address), txSize(txSize), txData(txData), rxSize(rxSize), rxData(rxData), callback(callback),
+      segments(nullptr), segmentCount(0) {
+   }
+
+   /**
+    * Create batched transaction descriptor
+    *
+    * @param[in]  segments     Segments of transaction (see I2cSegment)
+    * @param[in]  segmentCount Number of segments (at least 1)
+    * @param[in]  callback     Executed on completion (may be nullptr)
+    */
+   constexpr I2cTransaction(
+         const I2cSegment       segments[],
+         uint16_t               segmentCount,
+         I2cTransactionCallback callback = nullptr) :
+      address(0), txSize(0), txData(nullptr), rxSize(0), rxData(nullptr), callback(callback),
+      segments(segments), segmentCount(segmentCount) {
+      usbdm_assert(segmentCount > 0, "Empty I2C batched transaction");
+   }
+
+   /**
+    * Create batched transaction descriptor
+    *
+    * @tparam N Number of segments (inferred)
+    *
+    * @param[in]  segments     Segments of transaction (see I2cSegment)
+    * @param[in]  callback     Executed on completion (may be nullptr)
+    */
+   template<unsigned N>
+   constexpr I2cTransaction(
+         const I2cSegment       (&segments)[N],
+         I2cTransactionCallback callback = nullptr) :
+      I2cTransaction(segments, N, callback) {
+   }
+
+   /**
+    * Check if transaction has completed
+    *
+    * @return true => Complete (or never queued)
+    */
+   bool isComplete() const {
+      return complete;
+   }
+
+   /**
+    * Get result of transaction
+    *
+    * @return E_BUSY if not yet complete, otherwise error code from transaction
+    */
+   ErrorCode getErrorCode() const {
+      return complete?errorCode:E_BUSY;
+   }
+};
+
 /**
  * I2C Operating mode
  */
@@ -70,9 +257,40 @@ protected:
    const uint8_t              *txDataPtr;           //!< Pointer to transmit data for current transaction
    uint8_t                     addressedDevice;     //!< Address of device being communicated with
    ErrorCode                   errorCode;           //!< Error code from last transaction
+   I2cTransaction             *currentTransaction;  //!< Transaction in progress (nullptr if none)
+   I2cTransaction             *queueHead;           //!< First transaction waiting to start
+   I2cTransaction             *queueTail;           //!< Last transaction waiting to start
+   const I2cSegment           *segment;             //!< Current segment of batched transaction (nullptr if not batched)
+   const I2cSegment           *segmentEnd;          //!< End of segments of batched transaction
+   uint16_t                    segmentRemaining;    //!< Number of receive bytes remaining in current segment
+   bool                        startPending;        //!< START deferred until bus idle (address in addressedDevice)
+
+   /** Entry in I2C_SORTED_DIVISORS */
+   struct I2cDivisor {
+      uint16_t divisor;   //!< Divisor (MULT == 0)
+      uint8_t  firstIcr;  //!< Lowest ICR value giving this divisor
+      uint8_t  lastIcr;   //!< Highest ICR value giving this divisor
+   };
 
-   /** I2C baud rate divisor table */
-   static const uint16_t I2C_DIVISORS[4*16];
+   /**
+    * I2C baud rate divisors (MULT == 0) in increasing order.
+    * Several ICR values give the same divisor - the range of ICR values is recorded.
+    */
+   static constexpr I2cDivisor I2C_SORTED_DIVISORS[] = {
+         {  20, 0x00, 0x00}, {  22, 0x01, 0x01}, {  24, 0x02, 0x02}, {  26, 0x03, 0x03},
+         {  28, 0x04, 0x08}, {  30, 0x05, 0x05}, {  32, 0x09, 0x09}, {  34, 0x06, 0x06},
+         {  36, 0x0A, 0x0A}, {  40, 0x07, 0x0B}, {  44, 0x0C, 0x0C}, {  48, 0x0D, 0x10},
+         {  56, 0x0E, 0x11}, {  64, 0x12, 0x12}, {  68, 0x0F, 0x0F}, {  72, 0x13, 0x13},
+         {  80, 0x14, 0x18}, {  88, 0x15, 0x15}, {  96, 0x19, 0x19}, { 104, 0x16, 0x16},
+         { 112, 0x1A, 0x1A}, { 128, 0x17, 0x1B}, { 144, 0x1C, 0x1C}, { 160, 0x1D, 0x20},
+         { 192, 0x1E, 0x21}, { 224, 0x22, 0x22}, { 240, 0x1F, 0x1F}, { 256, 0x23, 0x23},
+         { 288, 0x24, 0x24}, { 320, 0x25, 0x28}, { 384, 0x26, 0x29}, { 448, 0x2A, 0x2A},
+         { 480, 0x27, 0x27}, { 512, 0x2B, 0x2B}, { 576, 0x2C, 0x2C}, { 640, 0x2D, 0x30},
+         { 768, 0x2E, 0x31}, { 896, 0x32, 0x32}, { 960, 0x2F, 0x2F}, {1024, 0x33, 0x33},
+         {1152, 0x34, 0x34}, {1280, 0x35, 0x38}, {1536, 0x36, 0x39}, {1792, 0x3A, 0x3A},
+         {1920, 0x37, 0x37}, {2048, 0x3B, 0x3B}, {2304, 0x3C, 0x3C}, {2560, 0x3D, 0x3D},
+         {3072, 0x3E, 0x3E}, {3840, 0x3F, 0x3F},
+   };
 
    /**
     * Construct I2C interface
@@ -83,7 +301,8 @@ protected:
    I2c(uint32_t i2c, I2cMode i2cMode) :
       state(i2c_idle), i2c(i2c), i2cMode(i2cMode), rxBytesRemaining(0),
       txBytesRemaining(0), rxDataPtr(0), txDataPtr(0), addressedDevice(0),
-      errorCode(E_NO_ERROR) {
+      errorCode(E_NO_ERROR), currentTransaction(nullptr), queueHead(nullptr), queueTail(nullptr),
+      segment(nullptr), segmentEnd(nullptr), segmentRemaining(0), startPending(false) {
    }
 
    /**
@@ -101,15 +320,112 @@ protected:
     *
     * @return I2C_F value representing speed
     */
-   static uint8_t getBPSValue(uint32_t bps, uint32_t clockFrequency);
+   static constexpr uint8_t getBPSValue(uint32_t bps, uint32_t clockFrequency) {
+      uint8_t  best_mul   = 0;
+      uint8_t  best_icr   = (uint8_t)-1u;
+      uint16_t best_error = (uint16_t)-1u;
+
+      for (uint8_t mul=0; mul<=2; mul++) {
+         uint32_t divisor = (clockFrequency>>mul)/bps;
+
+         // Binary search for smallest divisor not less than required
+         unsigned low  = 0;
+         unsigned high = sizeof(I2C_SORTED_DIVISORS)/sizeof(I2C_SORTED_DIVISORS[0]);
+         while (low < high) {
+            unsigned mid = (low+high)/2;
+            if (I2C_SORTED_DIVISORS[mid].divisor < divisor) {
+               low = mid+1;
+            }
+            else {
+               high = mid;
+            }
+         }
+         if (low == sizeof(I2C_SORTED_DIVISORS)/sizeof(I2C_SORTED_DIVISORS[0])) {
+            // Not suitable - try next
+            continue;
+         }
+         const I2cDivisor &entry = I2C_SORTED_DIVISORS[low];
+         uint16_t error=(uint16_t)(entry.divisor-divisor);
+         if ((error<best_error) || (error==0)) {
+            best_error=error;
+            best_icr=(error==0)?entry.lastIcr:entry.firstIcr;
+            best_mul=mul;
+         }
+      }
+      if (best_icr == (uint8_t)-1u) {
+         return I2C_F_MULT(1)|I2C_F_ICR(5);
+      }
+      else {
+         return I2C_F_MULT(best_mul)|I2C_F_ICR(best_icr);
+      }
+   }
+
+   /**
+    * Calculate value for baud rate register of I2C at compile time
+    *
+    * @tparam  bps            Interface speed in bits-per-second
+    * @tparam  clockFrequency Frequency of I2C input clock
+    *
+    * @return I2C_F value representing speed
+    */
+   template<uint32_t bps, uint32_t clockFrequency>
+   static constexpr uint8_t getBPSValue() {
+      static_assert((bps > 0) && (((clockFrequency>>2)/bps) <= 3840), "I2C speed is not achievable from clock frequency");
+      constexpr uint8_t value = getBPSValue(bps, clockFrequency);
+      return value;
+   }
 
    /**
-    * Start Rx/Tx sequence by sending address byte
+    * Start Rx/Tx sequence by sending address byte.
+    * If the bus is busy the START is deferred until poll() is called on the STOP interrupt.
     *
     * @param[in]  address - address of slave to access
     */
    void sendAddress(uint8_t address);
 
+   /**
+    * Generate REPEATED-START.
+    * The caller then writes the address to I2C->D.
+    */
+   void repeatedStart();
+
+   /**
+    * Set up for message starting at the current segment of a batched transaction.
+    * Sets state and transmit or receive data.
+    *
+    * @return Address of slave including R/W bit
+    */
+   uint8_t loadMessage();
+
+   /**
+    * Start next message of a batched transaction after the current message completes
+    *
+    * @param[out] lastByte Location for last byte received by current message (nullptr if transmitting)
+    *
+    * @return false => No more messages (no action taken)
+    */
+   bool startNextMessage(uint8_t *lastByte);
+
+   /**
+    * Advance I2C state machine.
+    * Sets state to i2c_idle when the transaction in progress completes or fails.
+    */
+   void advanceState();
+
+   /**
+    * Mark transaction complete and execute its callback
+    *
+    * @param[in]  transaction Transaction that has completed
+    * @param[in]  error       Error code for transaction
+    */
+   static void finishTransaction(I2cTransaction &transaction, ErrorCode error);
+
+   /**
+    * Start the transaction at the head of the queue if none is in progress.
+    * Must be called with interrupts masked or from the interrupt handler.
+    */
+   void startNextTransaction();
+
    /**
     * Set baud factor value for interface
     *
@@ -167,12 +483,12 @@ public:
    virtual void busHangReset() = 0;
 
    /**
-    * Wait for current sequence to complete
+    * Wait for current sequence and any queued transactions to complete
     */
    void waitWhileBusy(void) {
       I2C_State lastState = state;
       unsigned timeout = TIMEOUT_LIMIT;
-      while ((state != i2c_idle) && (--timeout>0)) {
+      while (((state != i2c_idle) || (queueHead != nullptr)) && (--timeout>0)) {
          if (state != lastState) {
             // Restart timeout
             timeout = TIMEOUT_LIMIT;
@@ -194,9 +510,71 @@ public:
    /**
     * I2C state-machine poll function.
     * May be called by polling loop or interrupt handler.
+    * Completes queued transactions and starts the next.
     */
    virtual void poll(void);
 
+   /**
+    * Queue transaction without waiting.
+    * The transaction is started immediately if the interface is idle, otherwise when the
+    * transactions ahead of it complete. It is advanced by the interrupt handler (I2cMode_Interrupt)
+    * or by calls to poll() (I2cMode_Polled).
+    *
+    * @param[in]  transaction Transaction to queue (must remain valid until complete)
+    *
+    * @note May be called from an interrupt handler or a transaction callback.
+    */
+   void queueTransaction(I2cTransaction &transaction);
+
+   /**
+    * Wait for a queued transaction to complete.
+    * If the interface stops making progress the transaction in progress is cancelled with E_TIMEOUT.
+    * This may be a transaction queued ahead of this one in which case waiting continues.
+    *
+    * @param[in]  transaction Transaction to wait for
+    *
+    * @return E_NO_ERROR on success
+    */
+   ErrorCode waitForTransaction(I2cTransaction &transaction);
+
+   /**
+    * Cancel a queued transaction.
+    * If the transaction is in progress a STOP is generated and the next queued transaction is started.
+    * The callback is executed with the given error code.
+    *
+    * @param[in]  transaction Transaction to cancel (no action if already complete)
+    * @param[in]  error       Error code for transaction
+    */
+   void cancelTransaction(I2cTransaction &transaction, ErrorCode error=E_INTERRUPTED);
+
+   /**
+    * Batched transaction.
+    * Runs the segments as one transaction using REPEATED-START between messages where possible.
+    * Queued behind any asynchronous transactions.
+    *
+    * @param[in]  segments     Segments of transaction (see I2cSegment)
+    * @param[in]  segmentCount Number of segments (at least 1)
+    *
+    * @return E_NO_ERROR on success, otherwise first error (remaining segments are not run)
+    */
+   ErrorCode transfer(const I2cSegment segments[], unsigned segmentCount);
+
+   /**
+    * Batched transaction.
+    * Runs the segments as one transaction using REPEATED-START between messages where possible.
+    * Queued behind any asynchronous transactions.
+    *
+    * @tparam N Number of segments (inferred)
+    *
+    * @param[in]  segments     Segments of transaction (see I2cSegment)
+    *
+    * @return E_NO_ERROR on success, otherwise first error (remaining segments are not run)
+    */
+   template<unsigned N>
+   ErrorCode transfer(const I2cSegment (&segments)[N]) {
+      return transfer(segments, N);
+   }
+
    /**
     * Transmit message
     * Note: 0th byte of Tx is often register address.
@@ -641,6 +1019,17 @@ public:
       I2c::setBPS(bps, Info::getInputClockFrequency());
    }
 
+   /**
+    * Set baud factor value for interface when the I2C input clock is known at compile time
+    *
+    * @tparam  bps            Interface speed in bits-per-second
+    * @tparam  clockFrequency Frequency of I2C input clock
+    */
+   template<uint32_t bps, uint32_t clockFrequency>
+   void setBPS() {
+      i2c->F = getBPSValue<bps, clockFrequency>();
+   }
+
    /**
     * Initialise interface
     *
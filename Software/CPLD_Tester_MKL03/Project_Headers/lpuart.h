@@ -22,6 +22,8 @@
 #include "pin_mapping.h"
 #include "formatted_io.h"
 #include "uart_queue.h"
+#include "stringFormatter.h"
+#include "delay.h"
 #ifdef __CMSIS_RTOS
 #include "cmsis.h"
 #endif
@@ -52,6 +54,24 @@ enum LpuartDma {
    LpuartDma_RxFull          = LPUART_BAUD_RDMAE(1),   //!< DMA request on Receive holding full
 };
 
+/**
+ * Enumeration selecting action when the transmit queue of a buffered UART is full
+ */
+enum LpuartTxOverflow {
+   LpuartTxOverflow_Block,       //!< Wait for space - no output is lost
+   LpuartTxOverflow_DropNewest,  //!< Discard the characters that don't fit
+   LpuartTxOverflow_DropOldest,  //!< Discard the oldest queued characters and mark the gap (or the oldest waiting chain)
+};
+
+/**
+ * Transmit statistics of a buffered UART
+ */
+struct LpuartTxStatistics {
+   uint32_t droppedBytes;   //!< Characters discarded due to the overflow policy (including those overwritten by a marker)
+   uint32_t highWater;      //!< Largest number of characters queued
+   uint32_t blockedTicks;   //!< Time spent waiting for queue space (SysTick ticks, 0 if SysTick is not running)
+};
+
 /**
  * @brief Virtual Base class for UART interface
  */
@@ -592,21 +612,140 @@ protected:
    /** Lock variable for reads */
    static volatile uint32_t fReadLock;
 
+   /** Action when transmit queue is full */
+   static LpuartTxOverflow fTxOverflow;
+
+   /** Character marking where output was discarded (LpuartTxOverflow_DropOldest) */
+   static char fTxOverflowMarker;
+
+   /** Transmit statistics */
+   static LpuartTxStatistics fTxStatistics;
+
+   /** Chain of text blocks waiting to be sent */
+   struct TxChain {
+      TextBlock *chain;      //!< First block of chain
+      uint32_t   position;   //!< Chain is sent once at least this many characters have been removed from txQueue
+   };
+
+   /** Number of chains that may be waiting to be sent */
+   static constexpr int TX_CHAINS = 4;
+
+   /**
+    * Chains waiting to be sent
+    */
+   static UartQueue<TxChain, TX_CHAINS> txChains;
+
+   /** Block being sent (returned to its arena once sent) */
+   static TextBlock *volatile fTxBlock;
+
+   /** Offset of next character in fTxBlock */
+   static uint16_t fTxOffset;
+
+   /** Position of chain being sent (see TxChain) */
+   static uint32_t fTxPosition;
+
+   /**
+    * Start transmission of queued characters and update high-water mark
+    */
+   void txStart() {
+      lpuart->CTRL = lpuart->CTRL | LPUART_CTRL_TIE_MASK;
+      unsigned queued = txQueue.size();
+      if (queued > fTxStatistics.highWater) {
+         fTxStatistics.highWater = queued;
+      }
+   }
+
+   /**
+    * Add characters to the transmit queue.
+    * The overflow policy is applied if the queue is full.
+    *
+    * @param[in]  data   - characters to send
+    * @param[in]  length - number of characters
+    */
+   void txWrite(const char *data, unsigned length) {
+      unsigned added = txQueue.push(data, length);
+      if (added == length) {
+         // Usual case
+         txStart();
+         return;
+      }
+      switch(fTxOverflow) {
+         case LpuartTxOverflow_Block: {
+            uint32_t last = getTicks();
+            do {
+               if (added > 0) {
+                  txStart();
+               }
+               data   += added;
+               length -= added;
+               // Note: This relies on each poll taking less than the roll-over time of SysTick
+               uint32_t now = getTicks();
+               fTxStatistics.blockedTicks += TIMER_MASK&(last-now);
+               last  = now;
+               added = txQueue.push(data, length);
+            } while (added < length);
+         }
+         break;
+         case LpuartTxOverflow_DropNewest:
+            fTxStatistics.droppedBytes += length-added;
+            break;
+         case LpuartTxOverflow_DropOldest:
+            do {
+               data   += added;
+               length -= added;
+               {
+                  // Transmit interrupt is the consumer of the queue
+                  CriticalSection cs;
+                  fTxStatistics.droppedBytes += txQueue.discardOldest(length, fTxOverflowMarker);
+               }
+               added = txQueue.push(data, length);
+            } while (added < length);
+            break;
+      }
+      txStart();
+   }
+
    /**
-    * Writes a character (blocking on queue full)
+    * Writes a character.
+    * The overflow policy is applied if the queue is full.
     *
     * @param[in]  ch - character to send
     */
    virtual void _writeChar(char ch) override {
+      static const char newline[] = "\n\r";
       lock(&fWriteLock);
-      // Add character to buffer
-      while (!txQueue.enQueueDiscardOnFull(ch)) {
+      if (ch=='\n') {
+         // Queued together so the pair is not split by a drop
+         txWrite(newline, 2);
+      }
+      else {
+         txWrite(&ch, 1);
       }
-      lpuart->CTRL = lpuart->CTRL | LPUART_CTRL_TIE_MASK;
       unlock(&fWriteLock);
-      if (ch=='\n') {
-        _writeChar('\r');
+   }
+
+   /**
+    * Writes a block of characters.
+    * Each chunk is added to the queue as a single bulk push.
+    * The overflow policy is applied if the queue is full.
+    *
+    * @param[in]  data - characters to send
+    * @param[in]  size - number of characters
+    */
+   virtual void _writeChars(const char *data, size_t size) override {
+      lock(&fWriteLock);
+      while (size > 0) {
+         // Send up to and including next '\n'
+         const char *newline = static_cast<const char *>(memchr(data, '\n', size));
+         size_t      length  = (newline == nullptr)?size:(newline-data+1);
+         txWrite(data, length);
+         data += length;
+         size -= length;
+         if (newline != nullptr) {
+            txWrite("\r", 1);
+         }
       }
+      unlock(&fWriteLock);
    }
 
    /**
@@ -635,6 +774,101 @@ protected:
    }
 
 public:
+   /**
+    * Set action when the transmit queue is full
+    *
+    * @param[in]  txOverflow Overflow policy
+    * @param[in]  marker     Character marking where output was discarded (LpuartTxOverflow_DropOldest only)
+    */
+   static void setTxOverflow(LpuartTxOverflow txOverflow, char marker='~') {
+      fTxOverflow       = txOverflow;
+      fTxOverflowMarker = marker;
+   }
+
+   /**
+    * Get transmit statistics
+    *
+    * @param[out] statistics Statistics since last cleared
+    */
+   static void getTxStatistics(LpuartTxStatistics &statistics) {
+      statistics = fTxStatistics;
+   }
+
+   /**
+    * Clear transmit statistics
+    */
+   static void clearTxStatistics() {
+      fTxStatistics = {0, 0, 0};
+   }
+
+   /**
+    * Queue a chain of text blocks for transmission without copying.
+    * The chain is sent after the characters already written. Each block is returned to its arena once sent.
+    * The overflow policy is applied if TX_CHAINS chains are already waiting to be sent:
+    *  - LpuartTxOverflow_Block       waits for a chain to be sent
+    *  - LpuartTxOverflow_DropNewest  discards this chain
+    *  - LpuartTxOverflow_DropOldest  discards the oldest waiting chain
+    *
+    * Discarded chains are returned to their arena and counted as dropped characters.
+    * Discarding characters from the transmit queue (LpuartTxOverflow_DropOldest) never discards a chain.
+    *
+    * @param[in]  chain First block of chain (ownership passes to the UART, may be nullptr)
+    */
+   void writeChain(TextBlock *chain) {
+      if (chain == nullptr) {
+         return;
+      }
+      lock(&fWriteLock);
+      TxChain txChain = {chain, txQueue.getAddedCount()};
+      if (!txChains.enQueueDiscardOnFull(txChain)) {
+         switch(fTxOverflow) {
+            case LpuartTxOverflow_Block: {
+               uint32_t last = getTicks();
+               do {
+                  // Note: This relies on each poll taking less than the roll-over time of SysTick
+                  uint32_t now = getTicks();
+                  fTxStatistics.blockedTicks += TIMER_MASK&(last-now);
+                  last = now;
+               } while (!txChains.enQueueDiscardOnFull(txChain));
+            }
+            break;
+            case LpuartTxOverflow_DropNewest:
+               fTxStatistics.droppedBytes += TextArena::releaseChain(chain);
+               break;
+            case LpuartTxOverflow_DropOldest: {
+               // Transmit interrupt is the consumer of the chains
+               CriticalSection cs;
+               if (txChains.isFull()) {
+                  fTxStatistics.droppedBytes += TextArena::releaseChain(txChains.deQueue().chain);
+               }
+               txChains.enQueueDiscardOnFull(txChain);
+            }
+            break;
+         }
+      }
+      lpuart->CTRL = lpuart->CTRL | LPUART_CTRL_TIE_MASK;
+      unlock(&fWriteLock);
+   }
+
+   /**
+    * Queue the text of a ChainFormatter for transmission without copying.
+    * The formatter is left empty.
+    *
+    * @param[in]  formatter Formatter holding text
+    */
+   void writeChain(ChainFormatter &formatter) {
+      writeChain(formatter.detach());
+   }
+
+   /**
+    * Get space in transmit queue
+    *
+    * @return Number of characters that may be written without applying the overflow policy
+    */
+   static unsigned getTxSpace() {
+      return txSize-txQueue.size();
+   }
+
    /**
     * Receive/Transmit/Error IRQ handler
     */
@@ -646,14 +880,48 @@ public:
       }
       if (status & LPUART_STAT_TDRE_MASK) {
          // Transmitter ready
-         if (txQueue.isEmpty()) {
-            // No data available - disable further transmit interrupts
-            Info::lpuart->CTRL = Info::lpuart->CTRL & ~LPUART_CTRL_TIE_MASK;
+         txIrqHandler();
+      }
+   }
+
+   /**
+    * Transmit part of IRQ handler.
+    * Sends the next character from the transmit queue or from a chain of text blocks
+    * in the order they were written.
+    */
+   static void txIrqHandler() {
+      // Find next character in chains (returning finished blocks to their arena)
+      for(;;) {
+         if (fTxBlock == nullptr) {
+            if (txChains.isEmpty()) {
+               break;
+            }
+            TxChain txChain = txChains.deQueue();
+            fTxBlock    = txChain.chain;
+            fTxPosition = txChain.position;
+            fTxOffset   = 0;
          }
-         else {
-            // Transmit next byte
-            Info::lpuart->DATA = txQueue.deQueue();
+         if (fTxOffset < fTxBlock->length) {
+            break;
          }
+         TextBlock *next = fTxBlock->next;
+         fTxBlock->release();
+         fTxBlock  = next;
+         fTxOffset = 0;
+      }
+      // Discarding oldest characters may move the queue past the chain position in one step
+      // or while the chain is being sent so the comparison allows for this (and wrapping)
+      if ((fTxBlock != nullptr) && (static_cast<int32_t>(txQueue.getRemovedCount()-fTxPosition) >= 0)) {
+         // Characters written before the chain have been sent or discarded
+         Info::lpuart->DATA = fTxBlock->data()[fTxOffset++];
+      }
+      else if (txQueue.isEmpty()) {
+         // No data available - disable further transmit interrupts
+         Info::lpuart->CTRL = Info::lpuart->CTRL & ~LPUART_CTRL_TIE_MASK;
+      }
+      else {
+         // Transmit next byte
+         Info::lpuart->DATA = txQueue.deQueue();
       }
    }
 
@@ -662,8 +930,8 @@ public:
     *  This blocks until all pending data has been sent
     */
    virtual LpuartBuffered_T &flushOutput() override {
-      while (!txQueue.isEmpty()) {
-         // Wait until queue empty
+      while (!txQueue.isEmpty() || !txChains.isEmpty() || (fTxBlock != nullptr)) {
+         // Wait until queue and chains empty
       }
       while ((lpuart->STAT & LPUART_STAT_TC_MASK) == 0) {
          // Wait until transmission of last character is complete
@@ -683,6 +951,14 @@ public:
 
 template<class Info, int rxSize, int txSize> UartQueue<char, rxSize> LpuartBuffered_T<Info, rxSize, txSize>::rxQueue;
 template<class Info, int rxSize, int txSize> UartQueue<char, txSize> LpuartBuffered_T<Info, rxSize, txSize>::txQueue;
+template<class Info, int rxSize, int txSize> LpuartTxOverflow   LpuartBuffered_T<Info, rxSize, txSize>::fTxOverflow       = LpuartTxOverflow_Block;
+template<class Info, int rxSize, int txSize> char               LpuartBuffered_T<Info, rxSize, txSize>::fTxOverflowMarker = '~';
+template<class Info, int rxSize, int txSize> LpuartTxStatistics LpuartBuffered_T<Info, rxSize, txSize>::fTxStatistics     = {0, 0, 0};
+template<class Info, int rxSize, int txSize> UartQueue<typename LpuartBuffered_T<Info, rxSize, txSize>::TxChain, LpuartBuffered_T<Info, rxSize, txSize>::TX_CHAINS>
+                                                                LpuartBuffered_T<Info, rxSize, txSize>::txChains;
+template<class Info, int rxSize, int txSize> TextBlock *volatile LpuartBuffered_T<Info, rxSize, txSize>::fTxBlock    = nullptr;
+template<class Info, int rxSize, int txSize> uint16_t           LpuartBuffered_T<Info, rxSize, txSize>::fTxOffset   = 0;
+template<class Info, int rxSize, int txSize> uint32_t           LpuartBuffered_T<Info, rxSize, txSize>::fTxPosition = 0;
 template<class Info, int rxSize, int txSize> volatile uint32_t   LpuartBuffered_T<Info, rxSize, txSize>::fReadLock  = 0;
 template<class Info, int rxSize, int txSize> volatile uint32_t   LpuartBuffered_T<Info, rxSize, txSize>::fWriteLock = 0;
 
@@ -144,8 +144,46 @@ protected:
     * @return BR register value
     *
     * Note: Chooses the highest speed that is not greater than frequency.
+    *       If no setting is slow enough the slowest setting is returned.
     */
-   static uint8_t calculateBr(uint32_t clockFrequency, uint32_t frequency);
+   static constexpr uint8_t calculateBr(uint32_t clockFrequency, uint32_t frequency) {
+
+      // Divisors greater than this give a speed not greater than frequency
+      uint32_t limit = (frequency>=clockFrequency)?0:clockFrequency/(frequency+1);
+
+      // Divisor is (SPPR+1)<<(SPR+1) - find the smallest SPPR for each SPR
+      uint8_t  bestBr      = (uint8_t)(SPI_BR_SPPR(7)|SPI_BR_SPR(8));
+      uint32_t bestDivisor = UINT32_MAX;
+      for (unsigned spr=0; spr<=8; spr++) {
+         uint32_t sppr = limit>>(spr+1);
+         if (sppr > 7) {
+            continue;
+         }
+         uint32_t divisor = (sppr+1)<<(spr+1);
+         if (divisor < bestDivisor) {
+            bestDivisor = divisor;
+            bestBr      = (uint8_t)(SPI_BR_SPPR(sppr)|SPI_BR_SPR(spr));
+         }
+      }
+      return bestBr;
+   }
+
+   /**
+    * Calculate communication BR value for SPI at compile time
+    *
+    * @tparam  clockFrequency => Clock frequency of SPI in Hz
+    * @tparam  frequency      => Communication frequency in Hz
+    *
+    * @return BR register value
+    *
+    * Note: Chooses the highest speed that is not greater than frequency.
+    */
+   template<uint32_t clockFrequency, uint32_t frequency>
+   static constexpr uint8_t calculateBr() {
+      static_assert((frequency > 0) && ((clockFrequency/(8*512)) <= frequency), "SPI frequency is not achievable from clock frequency");
+      constexpr uint8_t br = calculateBr(clockFrequency, frequency);
+      return br;
+   }
 
    /**
     * Calculates speed from SPI clock frequency and SPI clock factors
@@ -155,7 +193,11 @@ protected:
     *
     * @return SPI frequency
     */
-   static uint32_t calculateSpeed(uint32_t clockFrequency, uint32_t clockFactors);
+   static constexpr uint32_t calculateSpeed(uint32_t clockFrequency, uint32_t clockFactors) {
+      uint32_t sppr = (clockFactors&SPI_BR_SPPR_MASK)>>SPI_BR_SPPR_SHIFT;
+      uint32_t spr  = (clockFactors&SPI_BR_SPR_MASK)>>SPI_BR_SPR_SHIFT;
+      return clockFrequency/((sppr+1)<<(spr+1));
+   }
 
 #if defined(__CMSIS_RTOS)
    /**
@@ -333,6 +375,19 @@ public:
       spi->BR = calculateBr(getClockFrequency(), frequency);
    }
 
+   /**
+    * Sets Communication speed for SPI when the SPI clock frequency is known at compile time
+    *
+    * @tparam  clockFrequency => Clock frequency of SPI in Hz
+    * @tparam  frequency      => Communication frequency in Hz
+    *
+    * Note: Chooses the highest speed that is not greater than frequency.
+    */
+   template<uint32_t clockFrequency, uint32_t frequency>
+   void setSpeed() {
+      spi->BR = calculateBr<clockFrequency, frequency>();
+   }
+
    /**
     * Get communication speed of SPI
     *
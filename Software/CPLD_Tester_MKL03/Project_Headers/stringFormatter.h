@@ -143,6 +143,24 @@ protected:
       *ptr = '\0';
    }
 
+   /**
+    * Writes a block of characters.
+    * Characters are discarded if buffer is full.
+    *
+    * @param[in]  data - characters to send
+    * @param[in]  size - number of characters
+    */
+   virtual void _writeChars(const char *data, size_t size) override {
+      size_t space = (buff+sizeMinusOne)-ptr;
+      if (size > space) {
+         size = space;
+      }
+      memcpy(ptr, data, size);
+      ptr += size;
+      // Keep string terminated
+      *ptr = '\0';
+   }
+
 };
 
 /**
@@ -177,6 +195,352 @@ public:
    }
 };
 
+class TextArena;
+
+/**
+ * Block of text in a chain of blocks.
+ * The characters follow the header in memory.
+ */
+struct TextBlock {
+   TextBlock *next;     //!< Next block in chain (or in free list)
+   TextArena *arena;    //!< Arena owning this block
+   uint16_t   length;   //!< Number of characters in block
+   uint16_t   size;     //!< Capacity of block
+
+   /**
+    * Get characters in block
+    */
+   char *data() {
+      return reinterpret_cast<char *>(this+1);
+   }
+
+   /**
+    * Get characters in block
+    */
+   const char *data() const {
+      return reinterpret_cast<const char *>(this+1);
+   }
+
+   /**
+    * Return this block to its arena
+    */
+   inline void release();
+};
+
+/**
+ * Pool of fixed-size text blocks.
+ * Blocks may be allocated and released from any context including interrupt handlers.
+ * The storage is provided by TextArena_T.
+ */
+class TextArena {
+
+private:
+   TextArena(const TextArena&) = delete;
+   TextArena(TextArena&&) = delete;
+
+   /** Free blocks */
+   TextBlock *fFree      = nullptr;
+
+   /** Number of free blocks */
+   unsigned   fFreeCount = 0;
+
+protected:
+   TextArena() {
+   }
+
+   /**
+    * Add a block to the arena
+    *
+    * @param[in] block Block to add
+    * @param[in] size  Capacity of block
+    */
+   void add(TextBlock *block, uint16_t size) {
+      block->arena = this;
+      block->size  = size;
+      release(block);
+   }
+
+public:
+   /**
+    * Allocate an empty block
+    *
+    * @return Block or nullptr if none are free
+    */
+   TextBlock *allocate() {
+      CriticalSection cs;
+      TextBlock *block = fFree;
+      if (block != nullptr) {
+         fFree        = block->next;
+         fFreeCount--;
+         block->next   = nullptr;
+         block->length = 0;
+      }
+      return block;
+   }
+
+   /**
+    * Return a block to the arena
+    *
+    * @param[in] block Block to release
+    */
+   void release(TextBlock *block) {
+      CriticalSection cs;
+      block->next = fFree;
+      fFree       = block;
+      fFreeCount++;
+   }
+
+   /**
+    * Return all blocks in a chain to their arenas
+    *
+    * @param[in] chain First block in chain (may be nullptr)
+    *
+    * @return Number of characters in the chain
+    */
+   static unsigned releaseChain(TextBlock *chain) {
+      unsigned length = 0;
+      while (chain != nullptr) {
+         TextBlock *next = chain->next;
+         length += chain->length;
+         chain->release();
+         chain = next;
+      }
+      return length;
+   }
+
+   /**
+    * Get number of free blocks
+    */
+   unsigned getFreeCount() const {
+      return fFreeCount;
+   }
+};
+
+void TextBlock::release() {
+   arena->release(this);
+}
+
+/**
+ * Pool of fixed-size text blocks with static storage
+ *
+ * @tparam blockSize  Characters in each block
+ * @tparam blockCount Number of blocks
+ */
+template<unsigned blockSize, unsigned blockCount>
+class TextArena_T : public TextArena {
+
+   static_assert(blockSize <= 0xFFFF, "Block too large");
+
+private:
+   /** Block header followed by its characters */
+   struct Block {
+      TextBlock header;
+      char      data[blockSize];
+   };
+
+   Block blocks[blockCount];
+
+public:
+   TextArena_T() {
+      for (Block &block:blocks) {
+         add(&block.header, blockSize);
+      }
+   }
+};
+
+/**
+ * Class for writing formatted information into a chain of blocks from a TextArena.
+ *
+ * The text grows a block at a time without using the heap and is only truncated when the arena is exhausted.
+ * The chain may be handed to a buffered UART which sends it without copying and returns
+ * each block to the arena once it has been sent.
+ *
+ * Example:
+ * @code
+ *    static TextArena_T<32, 8> arena;
+ *
+ *    ChainFormatter report(arena);
+ *    for (unsigned index=0; index<count; index++) {
+ *       report.write(index).write(": ").writeln(results[index]);
+ *    }
+ *    console.writeChain(report);
+ * @endcode
+ */
+class ChainFormatter : public FormattedIO {
+
+private:
+   ChainFormatter(const ChainFormatter&) = delete;
+   ChainFormatter(ChainFormatter&&) = delete;
+
+   /** Arena providing blocks */
+   TextArena   &fArena;
+
+   /** First block in chain */
+   TextBlock   *fFirst     = nullptr;
+
+   /** Last block in chain */
+   TextBlock   *fLast      = nullptr;
+
+   /** Characters in chain */
+   unsigned     fLength    = 0;
+
+   /** Characters were discarded as the arena was exhausted */
+   bool         fTruncated = false;
+
+   /** Add '\r' after each '\n' */
+   const bool   fAddReturn;
+
+   /**
+    * Add characters to the chain growing it as needed
+    *
+    * @param[in]  data - characters to add
+    * @param[in]  size - number of characters
+    */
+   void append(const char *data, size_t size) {
+      while (size > 0) {
+         if ((fLast == nullptr) || (fLast->length == fLast->size)) {
+            TextBlock *block = fArena.allocate();
+            if (block == nullptr) {
+               fTruncated = true;
+               return;
+            }
+            if (fLast == nullptr) {
+               fFirst = block;
+            }
+            else {
+               fLast->next = block;
+            }
+            fLast = block;
+         }
+         size_t length = fLast->size-fLast->length;
+         if (length > size) {
+            length = size;
+         }
+         memcpy(fLast->data()+fLast->length, data, length);
+         fLast->length += length;
+         fLength       += length;
+         data          += length;
+         size          -= length;
+      }
+   }
+
+protected:
+   /**
+    * Writes a character.
+    * Characters are discarded if the arena is exhausted.
+    *
+    * @param[in]  ch - character to send
+    */
+   virtual void _writeChar(char ch) override {
+      append(&ch, 1);
+      if (fAddReturn && (ch=='\n')) {
+         append("\r", 1);
+      }
+   }
+
+   /**
+    * Writes a block of characters.
+    * Characters are discarded if the arena is exhausted.
+    *
+    * @param[in]  data - characters to send
+    * @param[in]  size - number of characters
+    */
+   virtual void _writeChars(const char *data, size_t size) override {
+      if (!fAddReturn) {
+         append(data, size);
+         return;
+      }
+      while (size > 0) {
+         // Up to and including next '\n'
+         const char *newline = static_cast<const char *>(memchr(data, '\n', size));
+         size_t      length  = (newline == nullptr)?size:(newline-data+1);
+         append(data, length);
+         data += length;
+         size -= length;
+         if (newline != nullptr) {
+            append("\r", 1);
+         }
+      }
+   }
+
+public:
+   /**
+    * Create formatter
+    *
+    * @param[in] arena     Arena providing blocks
+    * @param[in] addReturn Add '\r' after each '\n' as done by the buffered UARTs
+    */
+   ChainFormatter(TextArena &arena, bool addReturn=true) : fArena(arena), fAddReturn(addReturn) {
+   }
+
+   /**
+    * Destructor - returns any blocks still held to the arena
+    */
+   virtual ~ChainFormatter() {
+      clear();
+   }
+
+   /**
+    * Clear text
+    * Returns blocks to the arena
+    */
+   ChainFormatter &clear() {
+      TextArena::releaseChain(fFirst);
+      fFirst     = nullptr;
+      fLast      = nullptr;
+      fLength    = 0;
+      fTruncated = false;
+      return *this;
+   }
+
+   /**
+    *  Flush output data
+    *  Clears text
+    */
+   virtual ChainFormatter &flushOutput() override {
+      return clear();
+   }
+
+   /**
+    * Get number of characters held
+    */
+   unsigned length() const {
+      return fLength;
+   }
+
+   /**
+    * Check if characters were discarded as the arena was exhausted
+    */
+   bool isTruncated() const {
+      return fTruncated;
+   }
+
+   /**
+    * Get chain of blocks holding the text (remains owned by the formatter)
+    *
+    * @return First block (nullptr if empty)
+    */
+   const TextBlock *getChain() const {
+      return fFirst;
+   }
+
+   /**
+    * Take ownership of the chain of blocks holding the text.
+    * The formatter is left empty. The chain must be released with TextArena::releaseChain()
+    * or passed to a buffered UART (see LpuartBuffered_T::writeChain()).
+    *
+    * @return First block (nullptr if empty)
+    */
+   TextBlock *detach() {
+      TextBlock *chain = fFirst;
+      fFirst     = nullptr;
+      fLast      = nullptr;
+      fLength    = 0;
+      fTruncated = false;
+      return chain;
+   }
+};
+
 /**
  * End FORMATTED_IO_Group
  * @}
@@ -8,53 +8,106 @@
 #ifndef INCLUDE_USBDM_UART_QUEUE_H_
 #define INCLUDE_USBDM_UART_QUEUE_H_
 
+#include <atomic>
 #include "system.h"
 
 namespace USBDM {
 
 /**
- * Simple queue implementation
+ * Lock-free single-producer/single-consumer queue
+ *
+ * One context adds elements (e.g. the UART receive interrupt) and one context
+ * removes them (e.g. the main loop). No critical section is needed as:
+ *  - The producer only writes fTail and the consumer only writes fHead.
+ *  - The indices run freely and are masked into the buffer.
+ *    The number of elements is (fTail-fHead) so there is no shared counter.
+ *  - Elements are written before fTail is advanced (release) and
+ *    read after fTail is observed (acquire). Likewise for fHead and free space.
+ *
+ * Several producers (or consumers) must be serialised by the caller.
  *
  * @tparam T          Type of queue items
- * @tparam QUEUE_SIZE Size of queue
+ * @tparam QUEUE_SIZE Size of queue (storage is rounded up to a power of two)
  */
 template<class T, int QUEUE_SIZE>
 class UartQueue {
-   volatile T        fBuff[QUEUE_SIZE];
-   volatile T        *fHead, *fTail;
-   volatile int      fNumberOfElements;
+   static_assert(QUEUE_SIZE > 0, "Queue size must be positive");
+
+   /**
+    * Size of storage - QUEUE_SIZE rounded up to a power of two
+    */
+   static constexpr uint32_t storageSize() {
+      uint32_t size = 1;
+      while (size < QUEUE_SIZE) {
+         size <<= 1;
+      }
+      return size;
+   }
+
+   /// Mask to convert an index to a buffer offset
+   static constexpr uint32_t INDEX_MASK = storageSize()-1;
+
+   T                     fBuff[storageSize()];
+   std::atomic<uint32_t> fHead;   //!< Index of next element to remove - written by consumer only
+   std::atomic<uint32_t> fTail;   //!< Index of next element to add    - written by producer only
+   uint32_t              fMarker; //!< Index of marker placed by discardOldest() - used by consumer only
 
 public:
    /*
     * Create empty Queue
     */
-   constexpr UartQueue() : fHead(fBuff), fTail(fBuff), fNumberOfElements(0) {
+   constexpr UartQueue() : fBuff{}, fHead(0), fTail(0), fMarker(-1u) {
    }
 
    /**
     * Clear queue i.e. make empty
+    * Must be used by the consumer.
     */
    void clear() {
-      USBDM::CriticalSection cs;
-      fHead             = fBuff;
-      fTail             = fBuff;
-      fNumberOfElements = 0;
+      uint32_t tail = fTail.load(std::memory_order_acquire);
+      fMarker = tail-1;
+      fHead.store(tail, std::memory_order_release);
+   }
+   /*
+    * Get number of elements in queue
+    *
+    * @return Number of elements
+    */
+   unsigned size() const {
+      return fTail.load(std::memory_order_acquire)-fHead.load(std::memory_order_acquire);
+   }
+   /*
+    * Get number of elements ever added (free-running).
+    * May be compared with getRemovedCount() to tell when a given element has been removed.
+    *
+    * @return Count of elements added
+    */
+   uint32_t getAddedCount() const {
+      return fTail.load(std::memory_order_acquire);
+   }
+   /*
+    * Get number of elements ever removed (free-running)
+    *
+    * @return Count of elements removed
+    */
+   uint32_t getRemovedCount() const {
+      return fHead.load(std::memory_order_acquire);
    }
    /*
     * Check if empty
     *
     * @return true => empty
     */
-   bool isEmpty() {
-      return fNumberOfElements == 0;
+   bool isEmpty() const {
+      return size() == 0;
    }
    /*
     * Check if full
     *
     * @return true => full
     */
-   bool isFull() {
-      return fNumberOfElements == QUEUE_SIZE;
+   bool isFull() const {
+      return size() == QUEUE_SIZE;
    }
    /*
     * Add element to queue
@@ -75,34 +128,147 @@ public:
     * @return false => Queue full, element not added
     */
    bool enQueueDiscardOnFull(T element) {
-      USBDM::CriticalSection cs;
-      bool hasSpace = !isFull();
-      if (hasSpace) {
-         *fTail = element;
-         fTail = fTail + 1;
-         fNumberOfElements = fNumberOfElements + 1;
-         if (fTail>=(fBuff+QUEUE_SIZE)) {
-            fTail = fBuff;
-         }
+      uint32_t tail = fTail.load(std::memory_order_relaxed);
+      if ((tail-fHead.load(std::memory_order_acquire)) >= QUEUE_SIZE) {
+         return false;
       }
-      return hasSpace;
+      fBuff[tail&INDEX_MASK] = element;
+      fTail.store(tail+1, std::memory_order_release);
+      return true;
+   }
+   /*
+    * Add elements to queue. Adds as many as will fit.
+    * The elements become visible to the consumer together.
+    *
+    * @param[in]  elements Elements to add
+    * @param[in]  count    Number of elements
+    *
+    * @return Number of elements added
+    */
+   unsigned push(const T elements[], unsigned count) {
+      uint32_t tail  = fTail.load(std::memory_order_relaxed);
+      unsigned space = QUEUE_SIZE-(tail-fHead.load(std::memory_order_acquire));
+      if (count > space) {
+         count = space;
+      }
+      // Copy as (up to) two contiguous runs
+      unsigned offset = tail&INDEX_MASK;
+      unsigned first  = storageSize()-offset;
+      if (first > count) {
+         first = count;
+      }
+      for (unsigned index=0; index<first; index++) {
+         fBuff[offset+index] = elements[index];
+      }
+      for (unsigned index=first; index<count; index++) {
+         fBuff[index-first] = elements[index];
+      }
+      fTail.store(tail+count, std::memory_order_release);
+      return count;
+   }
+   /*
+    * Add elements to queue. Adds as many as will fit.
+    *
+    * @param[in]  elements Elements to add
+    * @param[in]  count    Number of elements
+    *
+    * @return Number of elements added
+    */
+   unsigned enQueueDiscardOnFull(const T elements[], unsigned count) {
+      return push(elements, count);
+   }
+   /*
+    * Add elements to queue. Adds all or none.
+    *
+    * @param[in]  elements Elements to add
+    * @param[in]  count    Number of elements
+    *
+    * @return true  => Elements enqueued
+    * @return false => Insufficient space, no elements added
+    */
+   bool enQueueAllOrNothing(const T elements[], unsigned count) {
+      // Free space can only grow while checking as this is the only producer
+      if ((QUEUE_SIZE-size()) < count) {
+         return false;
+      }
+      return push(elements, count) == count;
    }
    /*
     * Remove & return element from queue
     *
-    * @param[in]  element Element to add
+    * @return Element removed
     */
    T deQueue() {
-      USBDM::CriticalSection cs;
-      usbdm_assert(!isEmpty(), "Queue empty");
-      T t = *fHead;
-      fHead = fHead + 1;
-      fNumberOfElements = fNumberOfElements -1;
-      if (fHead>=(fBuff+QUEUE_SIZE)) {
-         fHead = fBuff;
-      }
+      uint32_t head = fHead.load(std::memory_order_relaxed);
+      usbdm_assert(head != fTail.load(std::memory_order_acquire), "Queue empty");
+      T t = fBuff[head&INDEX_MASK];
+      fHead.store(head+1, std::memory_order_release);
       return t;
    }
+   /*
+    * Discard oldest elements and mark the gap.
+    * At least one element is kept to hold the marker.
+    * The position of the marker is remembered so an element that happens to equal
+    * the marker is still counted as lost.
+    * Must only be used by the consumer or while the consumer is excluded e.g. its interrupt masked.
+    *
+    * @param[in]  count  Number of elements to discard
+    * @param[in]  marker Replaces the new oldest element to show where elements were lost
+    *
+    * @return Number of elements lost (including any replaced by the marker)
+    */
+   unsigned discardOldest(unsigned count, T marker) {
+      uint32_t head      = fHead.load(std::memory_order_relaxed);
+      unsigned available = fTail.load(std::memory_order_acquire)-head;
+      if (available == 0) {
+         return 0;
+      }
+      if (count >= available) {
+         count = available-1;
+      }
+      unsigned lost = count;
+      if ((count > 0) && (head == fMarker)) {
+         // Marker from an earlier discard is not an element lost
+         lost--;
+      }
+      head += count;
+      if (head != fMarker) {
+         fBuff[head&INDEX_MASK] = marker;
+         fMarker = head;
+         lost++;
+      }
+      fHead.store(head, std::memory_order_release);
+      return lost;
+   }
+   /*
+    * Remove elements from queue. Removes as many as are available.
+    *
+    * @param[out] elements Buffer for elements removed
+    * @param[in]  count    Size of buffer
+    *
+    * @return Number of elements removed
+    */
+   unsigned pop(T elements[], unsigned count) {
+      uint32_t head      = fHead.load(std::memory_order_relaxed);
+      unsigned available = fTail.load(std::memory_order_acquire)-head;
+      if (count > available) {
+         count = available;
+      }
+      // Copy as (up to) two contiguous runs
+      unsigned offset = head&INDEX_MASK;
+      unsigned first  = storageSize()-offset;
+      if (first > count) {
+         first = count;
+      }
+      for (unsigned index=0; index<first; index++) {
+         elements[index] = fBuff[offset+index];
+      }
+      for (unsigned index=first; index<count; index++) {
+         elements[index] = fBuff[index-first];
+      }
+      fHead.store(head+count, std::memory_order_release);
+      return count;
+   }
 };
 
 } // End namespace USBDM
@@ -0,0 +1,84 @@
+/**
+ * @file adcControl.h
+ *
+ * ADC control used by the target Vdd monitoring that the generated adc.h lacks or gets wrong
+ *
+ * Kept here rather than in adc.h so regenerating the project code does not lose it:
+ *  - adc.h enableComparison() ORs the previous SC2 value back in so the compare
+ *    function can't be changed or disabled once enabled
+ *  - adc.h has no way to return to software triggered conversions
+ */
+
+#ifndef SOURCES_ADCCONTROL_H_
+#define SOURCES_ADCCONTROL_H_
+
+#include "adc.h"
+
+namespace USBDM {
+
+/**
+ * ADC control
+ *
+ * @tparam Adc  ADC class e.g. Adc0
+ */
+template<class Adc>
+class AdcControl_T {
+
+private:
+   /**
+    * This class is not intended to be instantiated
+    */
+   AdcControl_T() = delete;
+   AdcControl_T(const AdcControl_T&) = delete;
+   AdcControl_T(AdcControl_T&&) = delete;
+
+   /** SC2 fields of the compare function */
+   static constexpr uint32_t COMPARE_MASK = ADC_SC2_ACFE(1)|ADC_SC2_ACFGT(1)|ADC_SC2_ACREN(1);
+
+public:
+   /**
+    * Configure comparison mode replacing any previous comparison.
+    *
+    * @param[in] adcCompare   Comparison operation to enable
+    * @param[in] low          Lower threshold
+    * @param[in] high         Higher threshold (if needed)
+    */
+   static void enableComparison(AdcCompare adcCompare, int low=INT_MIN, int high=INT_MAX) {
+#ifdef DEBUG_BUILD
+      usbdm_assert (low<=high, "ADC Low level > high level");
+#endif
+      // Juggle CV1, CV2 values to satisfy comparison rules
+      switch (adcCompare) {
+         case AdcCompare_Disabled:
+            break;
+         case AdcCompare_LessThan:
+         case AdcCompare_GreaterThanOrEqual:
+            Adc::adc->CV1 = low;
+            break;
+         case AdcCompare_OutsideRangeExclusive:
+         case AdcCompare_InsideRangeInclusive:
+            Adc::adc->CV1 = low;
+            Adc::adc->CV2 = high;
+            break;
+         case AdcCompare_InsideRangeExclusive:
+         case AdcCompare_OutsideRangeInclusive:
+            Adc::adc->CV1 = high;
+            Adc::adc->CV2 = low;
+            break;
+      }
+      // Replace comparison fields
+      Adc::adc->SC2 = (Adc::adc->SC2&~COMPARE_MASK)|(adcCompare&COMPARE_MASK);
+   }
+
+   /**
+    * Disables hardware trigger mode of operation.
+    * Conversions are then started by software e.g. Channel::startConversion().
+    */
+   static void disableHardwareConversion() {
+      Adc::adc->SC2 = Adc::adc->SC2 & ~ADC_SC2_ADTRG_MASK;
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* SOURCES_ADCCONTROL_H_ */
@@ -0,0 +1,94 @@
+/**
+ * @file buttonDebouncer.h
+ *
+ * Power button debouncing with an edge interrupt and a one-shot timer
+ *
+ * Each edge on the button pin (re)starts the one-shot timer. The timer only expires
+ * once the button has been stable for the debounce interval. A change to pressed
+ * is then acted on. Bounces and glitches shorter than the interval are ignored.
+ *
+ * The debouncer does not access hardware. The pin, timer and action are provided by
+ * the Platform class supplied by the caller so the debouncing may be exercised
+ * against a simulated button and timer.
+ *
+ * Platform requirements:
+ *  - Platform::Lock              Masks interrupts for the lifetime of the object (e.g. CriticalSection)
+ *  - bool readButton()           Current button level (true => pressed)
+ *  - void clearButtonFlags()     Clear the button pin interrupt flags
+ *  - void startDebounceTimer()   (Re)start the one-shot timer from zero
+ *  - void stopDebounceTimer()    Stop the timer and clear its flag
+ *  - void pressed()              Act on a press. Called with Platform::Lock held.
+ */
+
+#ifndef SOURCES_BUTTONDEBOUNCER_H_
+#define SOURCES_BUTTONDEBOUNCER_H_
+
+namespace USBDM {
+
+/**
+ * Button debouncer
+ *
+ * @tparam Platform  Button pin, one-shot timer and action (see file description)
+ */
+template<class Platform>
+class ButtonDebouncer_T {
+
+private:
+   /**
+    * This class is not intended to be instantiated
+    */
+   ButtonDebouncer_T() = delete;
+   ButtonDebouncer_T(const ButtonDebouncer_T&) = delete;
+   ButtonDebouncer_T(ButtonDebouncer_T&&) = delete;
+
+   /** Last stable button level */
+   static bool lastLevel;
+
+public:
+   /**
+    * Button pin interrupt handler
+    *
+    * Each edge (re)starts the debounce timer
+    */
+   static void edgeIrqHandler() {
+      Platform::clearButtonFlags();
+      Platform::startDebounceTimer();
+   }
+
+   /**
+    * Debounce timer interrupt handler
+    *
+    * Button has been stable for the debounce interval
+    */
+   static void timerIrqHandler() {
+      Platform::stopDebounceTimer();
+      checkButton();
+   }
+
+   /**
+    * Check button once it has been stable for the debounce interval.
+    * A press is acted on with interrupts masked as the action may also be
+    * requested from the main loop.
+    */
+   static void checkButton() {
+      bool currentLevel = Platform::readButton();
+      if (currentLevel == lastLevel) {
+         // Bounce or glitch
+         return;
+      }
+      lastLevel = currentLevel;
+
+      // Act on press only
+      if (currentLevel) {
+         typename Platform::Lock lock;
+         Platform::pressed();
+      }
+   }
+};
+
+template<class Platform>
+bool ButtonDebouncer_T<Platform>::lastLevel = false;
+
+} // End namespace USBDM
+
+#endif /* SOURCES_BUTTONDEBOUNCER_H_ */
@@ -0,0 +1,495 @@
+/**
+ * @file commandFrame.h
+ *
+ * Binary framed commands between host and tester
+ *
+ * Does not access hardware. It is shared with the host program (CPLD_Link).
+ *
+ * Frame format:
+ *  - uint8_t  FRAME_SYNC
+ *  - uint8_t  Payload length (0..FRAME_MAX_PAYLOAD)
+ *  - uint8_t  Sequence number (echoed in the response)
+ *  - uint8_t  Payload[length]
+ *  - uint16_t CRC-16/CCITT (0x1021, initial 0xFFFF) of length, sequence and payload
+ *
+ * A request payload is a batch of commands, each an opcode followed by its arguments.
+ * A response payload is a frame status followed, for each command executed, by the
+ * opcode, a command status and the results.
+ * Execution of a batch stops at the first command that does not succeed.
+ *
+ * Commands:
+ *  - FrameCommand_Power    u8 on                       -> u8 power status (0=Off, 1=On, 2=Error)
+ *  - FrameCommand_Clock    u32 frequency (Hz)          -> u32 frequency obtained (Hz)
+ *  - FrameCommand_Vectors  u8 count, vector[count]     -> u16 failures, u16 first fail index, u16 first fail response
+ *  - FrameCommand_ReadVdd  -                           -> u16 target Vdd (ADC counts), u8 flags (FRAME_VDD_*)
+ *
+ * Multi-byte values are little-endian. Vectors are 6 bytes (stimulus, expected, mask).
+ *
+ * The host may send further frames without waiting for the responses to earlier frames
+ * as long as no more than FRAME_RX_BUFFERS are outstanding.
+ *
+ * While logging is enabled the tester also sends log frames that are not responses.
+ * The payload of a log frame is FRAME_LOG followed by log records (see tokenLog.h)
+ * and the sequence number is 0.
+ */
+
+#ifndef SOURCES_COMMANDFRAME_H_
+#define SOURCES_COMMANDFRAME_H_
+
+#include <stdint.h>
+
+namespace USBDM {
+
+/// Byte starting each frame (not a command character)
+constexpr uint8_t  FRAME_SYNC         = 0xA5;
+
+/// Largest payload in a frame (kept small as the tester holds FRAME_RX_BUFFERS+1 frames in RAM)
+constexpr unsigned FRAME_MAX_PAYLOAD  = 32;
+
+/// Number of request frames the tester can hold
+constexpr unsigned FRAME_RX_BUFFERS   = 2;
+
+/// Size of a vector in FrameCommand_Vectors
+constexpr unsigned FRAME_VECTOR_SIZE  = 6;
+
+/// Largest number of vectors in a single FrameCommand_Vectors
+constexpr unsigned FRAME_MAX_VECTORS  = (FRAME_MAX_PAYLOAD-2)/FRAME_VECTOR_SIZE;
+
+/// Largest response to a single command (opcode, status and results)
+constexpr unsigned FRAME_MAX_RESULT   = 8;
+
+/// First payload byte of a log frame (in place of the frame status of a response)
+constexpr uint8_t  FRAME_LOG          = 0x80;
+
+/// Bytes in a frame in addition to the payload (sync, length, sequence number and CRC)
+constexpr unsigned FRAME_OVERHEAD     = 5;
+
+/// FrameCommand_ReadVdd flag - Vdd is checked by the ADC compare function and the value is the last sample before that
+constexpr uint8_t  FRAME_VDD_PROTECTED = (1<<0);
+
+/**
+ * Command opcodes
+ */
+enum FrameCommand : uint8_t {
+   FrameCommand_Power    = 1,  //!< Power target on/off
+   FrameCommand_Clock    = 2,  //!< Set CPLD clock frequency
+   FrameCommand_Vectors  = 3,  //!< Apply a block of test vectors
+   FrameCommand_ReadVdd  = 4,  //!< Read target Vdd
+};
+
+/**
+ * Frame and command status
+ */
+enum FrameStatus : uint8_t {
+   FrameStatus_Ok             = 0,  //!< Success
+   FrameStatus_CrcError       = 1,  //!< Frame - CRC failed, nothing executed
+   FrameStatus_ResponseFull   = 2,  //!< Frame - Batch stopped as response frame is full
+   FrameStatus_UnknownCommand = 3,  //!< Command - Opcode not recognised
+   FrameStatus_BadLength      = 4,  //!< Command - Arguments truncated or out of range
+   FrameStatus_NotPowered     = 5,  //!< Command - Target must be powered
+   FrameStatus_Failed         = 6,  //!< Command - Could not be done
+};
+
+/**
+ * A frame without sync and CRC
+ */
+struct Frame {
+   uint8_t length;                       //!< Payload length
+   uint8_t sequence;                     //!< Sequence number
+   uint8_t status;                       //!< Receive status (FrameStatus_Ok or FrameStatus_CrcError)
+   uint8_t payload[FRAME_MAX_PAYLOAD];   //!< Payload
+};
+
+/**
+ * Result of FrameCommand_Vectors
+ */
+struct FrameVectorResult {
+   uint16_t failCount;           //!< Number of vectors that failed
+   uint16_t firstFailIndex;      //!< Index of first failing vector (if failCount>0)
+   uint16_t firstFailResponse;   //!< Response for first failing vector (if failCount>0)
+};
+
+/**
+ * Update CRC-16/CCITT
+ *
+ * @param[in] crc   Current CRC
+ * @param[in] data  Byte to add
+ *
+ * @return Updated CRC
+ */
+static inline uint16_t frameCrc(uint16_t crc, uint8_t data) {
+   crc ^= data<<8;
+   for (unsigned bit=0; bit<8; bit++) {
+      crc = (crc&0x8000)?((crc<<1)^0x1021):(crc<<1);
+   }
+   return crc;
+}
+
+/**
+ * Send a frame
+ *
+ * @tparam Output  Callable as void output(uint8_t byte)
+ *
+ * @param[in] frame   Frame to send (status is not sent)
+ * @param[in] output  Receives each byte of the frame
+ */
+template<typename Output>
+void sendFrame(const Frame &frame, Output output) {
+   uint16_t crc = 0xFFFF;
+   crc = frameCrc(crc, frame.length);
+   crc = frameCrc(crc, frame.sequence);
+   output(FRAME_SYNC);
+   output(frame.length);
+   output(frame.sequence);
+   for (unsigned index=0; index<frame.length; index++) {
+      output(frame.payload[index]);
+      crc = frameCrc(crc, frame.payload[index]);
+   }
+   output(crc&0xFF);
+   output(crc>>8);
+}
+
+/**
+ * Receiver assembling frames a byte at a time
+ *
+ * receive() is usually called from the UART ISR.
+ * Completed frames are taken in order by getFrame()/releaseFrame() in the main loop.
+ * Frames failing the CRC are passed on with FrameStatus_CrcError so the sequence number can be reported.
+ *
+ * @tparam bufferCount  Number of frames that may be held
+ */
+template<unsigned bufferCount=FRAME_RX_BUFFERS>
+class FrameReceiver_T {
+
+   static_assert((bufferCount&(bufferCount-1)) == 0, "Buffer count must be a power of 2");
+
+private:
+   /**
+    * State of frame receiver
+    */
+   enum RxState : uint8_t {
+      RxState_Sync,        //!< Waiting for FRAME_SYNC
+      RxState_Length,      //!< Receiving length
+      RxState_Sequence,    //!< Receiving sequence number
+      RxState_Payload,     //!< Receiving payload
+      RxState_CrcLow,      //!< Receiving CRC
+      RxState_CrcHigh,     //!< Receiving CRC
+      RxState_Discard,     //!< Discarding rest of frame
+   };
+
+   /** Frame buffers */
+   Frame frames[bufferCount];
+
+   /** Number of frames completed - written by receiver only */
+   volatile uint8_t filled  = 0;
+
+   /** Number of frames released - written by main loop only */
+   volatile uint8_t emptied = 0;
+
+   /** Receiver state */
+   volatile RxState rxState = RxState_Sync;
+
+   /** Offset within payload or bytes remaining to discard */
+   uint8_t  rxOffset = 0;
+
+   /** CRC of frame being received */
+   uint16_t crc = 0;
+
+   /** Frames discarded as all buffers were in use */
+   uint32_t overruns = 0;
+
+   /**
+    * Frame being filled by receiver
+    */
+   Frame &rxFrame() {
+      return frames[filled%bufferCount];
+   }
+
+public:
+   /**
+    * Check if the receiver is part way through a frame
+    *
+    * @return true if received bytes should be passed to receive()
+    */
+   bool isReceiving() const {
+      return rxState != RxState_Sync;
+   }
+
+   /**
+    * Process a received byte.
+    * Usually called from the UART ISR.
+    *
+    * @param[in] data Byte received
+    */
+   void receive(uint8_t data) {
+      switch(rxState) {
+         case RxState_Sync:
+            if (data == FRAME_SYNC) {
+               crc     = 0xFFFF;
+               rxState = RxState_Length;
+            }
+            break;
+         case RxState_Length:
+            if (data > FRAME_MAX_PAYLOAD) {
+               // Can't be a frame - resynchronise
+               rxState = RxState_Sync;
+               break;
+            }
+            if ((uint8_t)(filled-emptied) >= bufferCount) {
+               // No buffer - frame is discarded (sequence number and CRC follow payload)
+               overruns++;
+               rxOffset = data+3;
+               rxState  = RxState_Discard;
+               break;
+            }
+            crc                = frameCrc(crc, data);
+            rxFrame().length   = data;
+            rxState            = RxState_Sequence;
+            break;
+         case RxState_Sequence:
+            crc                = frameCrc(crc, data);
+            rxFrame().sequence = data;
+            rxOffset           = 0;
+            rxState            = (rxFrame().length == 0)?RxState_CrcLow:RxState_Payload;
+            break;
+         case RxState_Payload:
+            crc = frameCrc(crc, data);
+            rxFrame().payload[rxOffset++] = data;
+            if (rxOffset == rxFrame().length) {
+               rxState = RxState_CrcLow;
+            }
+            break;
+         case RxState_CrcLow:
+            crc     ^= data;
+            rxState  = RxState_CrcHigh;
+            break;
+         case RxState_CrcHigh:
+            crc ^= data<<8;
+            rxFrame().status = (crc == 0)?FrameStatus_Ok:FrameStatus_CrcError;
+            filled  = filled+1;
+            rxState = RxState_Sync;
+            break;
+         case RxState_Discard:
+            if (--rxOffset == 0) {
+               rxState = RxState_Sync;
+            }
+            break;
+      }
+   }
+
+   /**
+    * Get the oldest completed frame
+    *
+    * @return Frame or nullptr if none
+    */
+   Frame *getFrame() {
+      if (filled == emptied) {
+         return nullptr;
+      }
+      return &frames[emptied%bufferCount];
+   }
+
+   /**
+    * Release the frame obtained by getFrame() for reuse by the receiver
+    */
+   void releaseFrame() {
+      emptied = emptied+1;
+   }
+
+   /**
+    * Get number of frames discarded as all buffers were in use
+    */
+   uint32_t getOverruns() const {
+      return overruns;
+   }
+};
+
+/**
+ * Reads little-endian values from a payload
+ */
+class FrameReader {
+   const uint8_t *data;
+   unsigned       remaining;
+
+public:
+   FrameReader(const uint8_t data[], unsigned length) : data(data), remaining(length) {
+   }
+
+   /**
+    * Check if all data has been read
+    */
+   bool isEmpty() const {
+      return remaining == 0;
+   }
+
+   /**
+    * Read value
+    *
+    * @param[out] value  Value read
+    * @param[in]  size   Size of value in bytes (1..4)
+    *
+    * @return false if insufficient data
+    */
+   bool read(uint32_t &value, unsigned size) {
+      if (size > remaining) {
+         return false;
+      }
+      value = 0;
+      for (unsigned index=0; index<size; index++) {
+         value |= static_cast<uint32_t>(*data++)<<(8*index);
+      }
+      remaining -= size;
+      return true;
+   }
+
+   /**
+    * Obtain a block of bytes without copying
+    *
+    * @param[in] size Number of bytes
+    *
+    * @return Pointer to data or nullptr if insufficient data
+    */
+   const uint8_t *readBlock(unsigned size) {
+      if (size > remaining) {
+         return nullptr;
+      }
+      const uint8_t *block = data;
+      data      += size;
+      remaining -= size;
+      return block;
+   }
+};
+
+/**
+ * Writes little-endian values to a frame payload
+ */
+class FrameWriter {
+   Frame &frame;
+
+public:
+   FrameWriter(Frame &frame) : frame(frame) {
+      frame.length = 0;
+   }
+
+   /**
+    * Number of bytes that may still be written
+    */
+   unsigned space() const {
+      return FRAME_MAX_PAYLOAD-frame.length;
+   }
+
+   /**
+    * Write value. Caller must check space().
+    *
+    * @param[in] value  Value to write
+    * @param[in] size   Size of value in bytes (1..4)
+    */
+   void write(uint32_t value, unsigned size) {
+      for (unsigned index=0; index<size; index++) {
+         frame.payload[frame.length++] = value;
+         value >>= 8;
+      }
+   }
+};
+
+/**
+ * Execute a batch of commands and construct the response
+ *
+ * @tparam Handler  Class providing:
+ *  - FrameStatus power(bool on, uint8_t &powerStatus)
+ *  - FrameStatus clock(uint32_t &frequency)  (frequency requested, updated to frequency obtained)
+ *  - FrameStatus vectors(const uint8_t vectors[], unsigned count, FrameVectorResult &result)
+ *  - FrameStatus readVdd(uint16_t &value, uint8_t &flags)
+ *
+ * @param[in]  request   Request frame
+ * @param[out] response  Response frame (same sequence number)
+ * @param[in]  handler   Executes commands
+ */
+template<class Handler>
+void executeFrame(const Frame &request, Frame &response, Handler &handler) {
+   FrameWriter writer(response);
+   response.sequence = request.sequence;
+
+   if (request.status != FrameStatus_Ok) {
+      writer.write(request.status, 1);
+      return;
+   }
+   // Frame status is filled in at end
+   writer.write(FrameStatus_Ok, 1);
+
+   FrameReader reader(request.payload, request.length);
+   while (!reader.isEmpty()) {
+      if (writer.space() < FRAME_MAX_RESULT) {
+         response.payload[0] = FrameStatus_ResponseFull;
+         return;
+      }
+      uint32_t    command;
+      uint32_t    argument;
+      FrameStatus status = FrameStatus_Ok;
+      reader.read(command, 1);
+      writer.write(command, 1);
+
+      switch(command) {
+         case FrameCommand_Power: {
+            uint8_t powerStatus = 0;
+            if (!reader.read(argument, 1)) {
+               status = FrameStatus_BadLength;
+               break;
+            }
+            status = handler.power(argument != 0, powerStatus);
+            writer.write(status, 1);
+            writer.write(powerStatus, 1);
+            break;
+         }
+         case FrameCommand_Clock:
+            if (!reader.read(argument, 4)) {
+               status = FrameStatus_BadLength;
+               break;
+            }
+            status = handler.clock(argument);
+            writer.write(status, 1);
+            writer.write(argument, 4);
+            break;
+         case FrameCommand_Vectors: {
+            FrameVectorResult result = {0, 0, 0};
+            const uint8_t *vectors = nullptr;
+            if (reader.read(argument, 1)) {
+               vectors = reader.readBlock(argument*FRAME_VECTOR_SIZE);
+            }
+            if (vectors == nullptr) {
+               status = FrameStatus_BadLength;
+               break;
+            }
+            status = handler.vectors(vectors, argument, result);
+            writer.write(status, 1);
+            writer.write(result.failCount, 2);
+            writer.write(result.firstFailIndex, 2);
+            writer.write(result.firstFailResponse, 2);
+            break;
+         }
+         case FrameCommand_ReadVdd: {
+            uint16_t value = 0;
+            uint8_t  flags = 0;
+            status = handler.readVdd(value, flags);
+            writer.write(status, 1);
+            writer.write(value, 2);
+            writer.write(flags, 1);
+            break;
+         }
+         default:
+            status = FrameStatus_UnknownCommand;
+            break;
+      }
+      if (status != FrameStatus_Ok) {
+         if ((status == FrameStatus_BadLength) || (status == FrameStatus_UnknownCommand)) {
+            // No results
+            writer.write(status, 1);
+         }
+         return;
+      }
+   }
+}
+
+} // End namespace USBDM
+
+#endif /* SOURCES_COMMANDFRAME_H_ */
@@ -0,0 +1,81 @@
+/**
+ * @file fmaxSearch.h
+ *
+ * Search for the highest clock frequency at which a device passes
+ *
+ * The search does not access hardware. Setting the clock and deciding
+ * pass/fail is done by the check supplied by the caller so the search
+ * may be exercised against a simulated device.
+ */
+
+#ifndef SOURCES_FMAXSEARCH_H_
+#define SOURCES_FMAXSEARCH_H_
+
+#include <stdint.h>
+
+namespace USBDM {
+
+/**
+ * Result of a Fmax search
+ */
+struct FmaxResult {
+   uint32_t fmax;       //!< Highest passing frequency (0 => failed at minimum frequency)
+   uint32_t firstFail;  //!< Lowest failing frequency seen (0 => passed at maximum frequency)
+   uint16_t steps;      //!< Number of checks made
+};
+
+/**
+ * Binary search for the highest passing frequency.
+ *
+ * Assumes a device that passes at a frequency passes at all lower frequencies.
+ *
+ * @tparam Check  Callable as bool check(uint32_t frequency).
+ *                Sets the clock to frequency and returns true if the device passes.
+ *
+ * @param[in] minimum     Lowest frequency to check (Hz)
+ * @param[in] maximum     Highest frequency to check (Hz)
+ * @param[in] resolution  Search stops when pass and fail frequencies are within this (Hz)
+ * @param[in] check       Pass/fail check
+ *
+ * @return Search result
+ */
+template<typename Check>
+FmaxResult searchFmax(uint32_t minimum, uint32_t maximum, uint32_t resolution, Check check) {
+   FmaxResult result = {0, 0, 0};
+
+   if (resolution == 0) {
+      resolution = 1;
+   }
+   result.steps++;
+   if (!check(minimum)) {
+      result.firstFail = minimum;
+      return result;
+   }
+   result.fmax = minimum;
+   if (maximum <= minimum) {
+      return result;
+   }
+   result.steps++;
+   if (check(maximum)) {
+      result.fmax = maximum;
+      return result;
+   }
+   result.firstFail = maximum;
+
+   // Invariant: check(fmax) passed, check(firstFail) failed
+   while ((result.firstFail-result.fmax) > resolution) {
+      uint32_t frequency = result.fmax + ((result.firstFail-result.fmax)>>1);
+      result.steps++;
+      if (check(frequency)) {
+         result.fmax = frequency;
+      }
+      else {
+         result.firstFail = frequency;
+      }
+   }
+   return result;
+}
+
+} // End namespace USBDM
+
+#endif /* SOURCES_FMAXSEARCH_H_ */
@@ -16,71 +16,39 @@
  */
 namespace USBDM {
 
-// I2C baud rate divisor table
-const uint16_t I2c::I2C_DIVISORS[] = {
-      // Divider assuming MULT == 0
-      20,   22,  24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
-      48,   56,  64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
-      160, 192, 224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
-      640, 768, 896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840,
-};
+// Storage for divisor table (odr-used by getBPSValue() when not evaluated at compile time)
+constexpr I2c::I2cDivisor I2c::I2C_SORTED_DIVISORS[];
 
 /**
- * Calculate value for baud rate register of I2C
- *
- * This is calculated from processor bus frequency and given bps
- *
- * @param[in]  bps            Interface speed in bits-per-second
- * @param[in]  clockFrequency Frequency of I2C input clock
- *
- * @return I2C_F value representing speed
- */
-uint8_t I2c::getBPSValue(uint32_t bps, uint32_t clockFrequency) {
-   uint8_t  best_mul   = 0;
-   uint8_t  best_icr   = (uint8_t)-1u;
-   uint16_t best_error = (uint16_t)-1u;
-
-   for (uint8_t mul=0; mul<=2; mul++) {
-      uint32_t divisor = (clockFrequency>>mul)/bps;
-      for(uint8_t icr=0; icr<(sizeof(I2C_DIVISORS)/sizeof(I2C_DIVISORS[0])); icr++) {
-         if (divisor>I2C_DIVISORS[icr]) {
-            // Not suitable - try next
-            continue;
-         }
-         uint16_t error=(uint16_t)(I2C_DIVISORS[icr]-divisor);
-         if ((error<best_error) || (error==0)) {
-            best_error=error;
-            best_icr=icr;
-            best_mul=mul;
-         }
-      }
-   }
-   if (best_icr == (uint8_t)-1u) {
-      return I2C_F_MULT(1)|I2C_F_ICR(5);
-   }
-   else {
-      return I2C_F_MULT(best_mul)|I2C_F_ICR(best_icr);
-   }
-}
-
-/**
- * Start Rx/Tx sequence by sending address byte
+ * Start Rx/Tx sequence by sending address byte.
+ * If the bus is busy (e.g. the previous STOP is still in progress) the START is deferred
+ * until poll() is called on the STOP interrupt rather than waiting here.
  *
  * @param[in]  address - address of slave to access
  */
 void I2c::sendAddress(uint8_t address) {
 
-   unsigned timeout = TIMEOUT_LIMIT;
+   addressedDevice = address;
 
-   // Wait for bus idle
-   while (((i2c->S & I2C_S_BUSY_MASK) != 0) && (--timeout>0)) {
-      __asm("nop");
-   }
-   if (timeout == 0) {
-      errorCode = E_TIMEOUT;
-      return;
+   // Filter settings without the START/STOP flags or interrupt enable
+   uint8_t flt = i2c->FLT & ~(I2C_FLT_STOPF_MASK|I2C_FLT_STARTF_MASK|I2C_FLT_SSIE_MASK);
+
+   if ((i2c->S & I2C_S_BUSY_MASK) != 0) {
+      // Clear START/STOP flags and interrupt when STOP detected
+      i2c->FLT = flt|I2C_FLT_SSIE_MASK|I2C_FLT_STOPF_MASK|I2C_FLT_STARTF_MASK;
+      i2c->S   = I2C_S_IICIF_MASK;
+
+      // Check again in case the STOP occurred before the interrupt was enabled
+      if ((i2c->S & I2C_S_BUSY_MASK) != 0) {
+         startPending = true;
+         return;
+      }
    }
-   addressedDevice = address;
+   startPending = false;
+
+   // Clear START/STOP flags and interrupt from them
+   i2c->FLT = flt|I2C_FLT_STOPF_MASK|I2C_FLT_STARTF_MASK;
+   i2c->S   = I2C_S_IICIF_MASK;
 
    // Configure for Tx of address
    i2c->C1 = i2cMode|I2C_C1_IICEN_MASK|I2C_C1_TX_MASK;
@@ -93,10 +61,16 @@ void I2c::sendAddress(uint8_t address) {
 }
 
 /**
- * I2C state-machine based interrupt handler
+ * Advance I2C state machine.
+ * Sets state to i2c_idle when the transaction in progress completes or fails.
  */
-void I2c::poll(void) {
+void I2c::advanceState() {
 
+   if (startPending) {
+      // Waiting for bus idle to send START
+      sendAddress(addressedDevice);
+      return;
+   }
    if ((i2c->S & I2C_S_ARBL_MASK) != 0) {
       i2c->S = I2C_S_ARBL_MASK|I2C_S_IICIF_MASK;
       errorCode = E_LOST_ARBITRATION;
@@ -131,35 +105,24 @@ void I2c::poll(void) {
          i2c->C1 = i2cMode|I2C_C1_IICEN_MASK;
          return;
       }
+      if (txBytesRemaining == 0) {
+         // Gather data from following segments of the same message
+         while ((segment != nullptr) && (txBytesRemaining == 0) &&
+                ((segment+1) < segmentEnd) && ((segment[1].flags&I2cSegment_Continue) != 0)) {
+            segment++;
+            txDataPtr        = segment->data;
+            txBytesRemaining = segment->size;
+         }
+      }
       if (txBytesRemaining-- == 0) {
          if (rxBytesRemaining > 0) {
             // Reception after transmission
             state = i2c_rxAddress;
-
-#if defined(MCU_MKL25Z4)
-            {
-               // Temporarily clear MULT - see KL25 errata e6070
-               uint8_t temp = i2c->F;
-               i2c->F&=~I2C_F_MULT(3);
-#endif
-               // Generate REPEATED-START
-               i2c->C1 = i2cMode|I2C_C1_IICEN_MASK|I2C_C1_MST_MASK|I2C_C1_TX_MASK|I2C_C1_RSTA_MASK;
-#if defined(MCU_MKL25Z4)
-               // Restore MULT
-               i2c->F = temp;
-            }
-#endif
-#if defined(MCU_MKL27Z4) || defined(MCU_MKL27Z644) || defined(MCU_MKL43Z4)
-            // This is a nasty hack
-            // It seems these chips need a delay after asserting repeated start
-            for (int i=0; i<20; i++) {
-               __asm__ volatile("nop");
-            }
-#endif
+            repeatedStart();
             // Send device address again with READ bit set
             i2c->D = addressedDevice|1;
          }
-         else {
+         else if (!startNextMessage(nullptr)) {
             // Complete
             state = i2c_idle;
             // Generate stop signal
@@ -201,12 +164,18 @@ void I2c::poll(void) {
    case i2c_rxData:
       // Just receive data bytes until complete
       if (--rxBytesRemaining == 0) {
-         // Received last byte - complete
-         state = i2c_idle;
-         // Generate STOP
-         i2c->C1 = i2cMode|I2C_C1_IICEN_MASK;
+         // Received last byte of message
+         if (!startNextMessage(rxDataPtr)) {
+            // Complete
+            state = i2c_idle;
+            // Generate STOP
+            i2c->C1 = i2cMode|I2C_C1_IICEN_MASK;
+            // Save receive data
+            *rxDataPtr++ = i2c->D;
+         }
+         break;
       }
-      else if (rxBytesRemaining == 1) {
+      if (rxBytesRemaining == 1) {
          // Received 2nd last byte (don't acknowledge the last byte to follow)
          i2c->C1 = i2cMode|I2C_C1_IICEN_MASK|I2C_C1_MST_MASK|I2C_C1_TXAK_MASK;
       }
@@ -215,82 +184,336 @@ void I2c::poll(void) {
       }
       // Save receive data
       *rxDataPtr++ = i2c->D;
+      if (--segmentRemaining == 0) {
+         // Scatter data to following segments of the same message
+         do {
+            segment++;
+         } while (segment->size == 0);
+         rxDataPtr        = segment->data;
+         segmentRemaining = segment->size;
+      }
       break;
    }
 }
 
 /**
- * Transmit message
- * Note: 0th byte of Tx is often register address.
- *
- * @param[in]  address  Address of slave to communicate with (should include LSB = R/W bit = 0)
- * @param[in]  size     Size of transmission data
- * @param[in]  data     Data to transmit
- *
- * @return E_NO_ERROR on success
+ * Generate REPEATED-START.
+ * The caller then writes the address to I2C->D.
  */
-ErrorCode I2c::transmit(uint8_t address, uint16_t size, const uint8_t data[]) {
-#ifdef __CMSIS_RTOS
-   startTransaction();
+void I2c::repeatedStart() {
+#if defined(MCU_MKL25Z4)
+   // Temporarily clear MULT - see KL25 errata e6070
+   uint8_t temp = i2c->F;
+   i2c->F&=~I2C_F_MULT(3);
 #endif
+   // Generate REPEATED-START
+   i2c->C1 = i2cMode|I2C_C1_IICEN_MASK|I2C_C1_MST_MASK|I2C_C1_TX_MASK|I2C_C1_RSTA_MASK;
+#if defined(MCU_MKL25Z4)
+   // Restore MULT
+   i2c->F = temp;
+#endif
+#if defined(MCU_MKL27Z4) || defined(MCU_MKL27Z644) || defined(MCU_MKL43Z4)
+   // This is a nasty hack
+   // It seems these chips need a delay after asserting repeated start
+   for (int i=0; i<20; i++) {
+      __asm__ volatile("nop");
+   }
+#endif
+}
 
-   errorCode = E_NO_ERROR;
+/**
+ * Set up for message starting at the current segment of a batched transaction.
+ * Sets state and transmit or receive data.
+ *
+ * @return Address of slave including R/W bit
+ */
+uint8_t I2c::loadMessage() {
+   if ((segment->flags&I2cSegment_Read) == 0) {
+      state            = i2c_txData;
+      txDataPtr        = segment->data;
+      txBytesRemaining = segment->size;
+      rxBytesRemaining = 0;
+      return segment->address&~1;
+   }
+   state            = i2c_rxAddress;
+   txBytesRemaining = 0;
+   rxDataPtr        = segment->data;
+   segmentRemaining = segment->size;
 
-   rxBytesRemaining = 0;
+   // Reception continues over following segments
+   rxBytesRemaining = segment->size;
+   for (const I2cSegment *next=segment+1; (next<segmentEnd) && ((next->flags&I2cSegment_Continue) != 0); next++) {
+      rxBytesRemaining += next->size;
+   }
+   usbdm_assert(rxBytesRemaining > 0, "Empty I2C read");
+   if (segmentRemaining == 0) {
+      // Skip empty segments
+      do {
+         segment++;
+      } while (segment->size == 0);
+      rxDataPtr        = segment->data;
+      segmentRemaining = segment->size;
+   }
+   return segment->address|1;
+}
 
-   // Send address byte at start and move to data transmission
-   state = i2c_txData;
+/**
+ * Start next message of a batched transaction after the current message completes
+ *
+ * @param[out] lastByte Location for last byte received by current message (nullptr if transmitting)
+ *
+ * @return false => No more messages (no action taken)
+ */
+bool I2c::startNextMessage(uint8_t *lastByte) {
+   if (segment == nullptr) {
+      return false;
+   }
+   // Skip any empty segments at end of current message
+   while (((segment+1) < segmentEnd) && ((segment[1].flags&I2cSegment_Continue) != 0)) {
+      segment++;
+   }
+   if ((segment+1) >= segmentEnd) {
+      return false;
+   }
+   bool stop = (segment->flags&I2cSegment_Stop) != 0;
+   if (stop) {
+      // Generate STOP
+      i2c->C1 = i2cMode|I2C_C1_IICEN_MASK;
+   }
+   else {
+      repeatedStart();
+   }
+   if (lastByte != nullptr) {
+      // Save receive data (no further reception as now transmitting or stopped)
+      *lastByte = i2c->D;
+   }
+   segment++;
+   uint8_t address = loadMessage();
+   if (stop) {
+      // START once bus is idle
+      sendAddress(address);
+   }
+   else {
+      addressedDevice = address;
+      i2c->D = address;
+   }
+   return true;
+}
 
-   // Set up transmit data
-   txDataPtr        = data;
-   txBytesRemaining = size;
+/**
+ * I2C state-machine based interrupt handler
+ */
+void I2c::poll(void) {
+   advanceState();
+   if ((state == i2c_idle) && (currentTransaction != nullptr)) {
+      // Transaction completed or failed
+      I2cTransaction *transaction = currentTransaction;
+      currentTransaction = nullptr;
+      finishTransaction(*transaction, errorCode);
+      startNextTransaction();
+   }
+}
 
-   sendAddress(address);
-   waitWhileBusy();
+/**
+ * Mark transaction complete and execute its callback
+ *
+ * @param[in]  transaction Transaction that has completed
+ * @param[in]  error       Error code for transaction
+ */
+void I2c::finishTransaction(I2cTransaction &transaction, ErrorCode error) {
+   transaction.errorCode = error;
+   transaction.complete  = true;
+   if (transaction.callback != nullptr) {
+      transaction.callback(transaction);
+   }
+}
 
-   ErrorCode tErrorCode = errorCode;
+/**
+ * Start the transaction at the head of the queue if none is in progress.
+ * Must be called with interrupts masked or from the interrupt handler.
+ */
+void I2c::startNextTransaction() {
+   if ((currentTransaction == nullptr) && (queueHead != nullptr)) {
+      I2cTransaction *transaction = queueHead;
+      queueHead = transaction->next;
+      if (queueHead == nullptr) {
+         queueTail = nullptr;
+      }
+      currentTransaction = transaction;
 
-#ifdef __CMSIS_RTOS
-   endTransaction();
-#endif
+      errorCode = E_NO_ERROR;
 
-   return tErrorCode;
+      if (transaction->segments != nullptr) {
+         // Batched transaction
+         segment    = transaction->segments;
+         segmentEnd = transaction->segments+transaction->segmentCount;
+         sendAddress(loadMessage());
+      }
+      else {
+         segment = nullptr;
+
+         // Set up transmit and receive data
+         txDataPtr        = transaction->txData;
+         txBytesRemaining = transaction->txSize;
+         rxDataPtr        = transaction->rxData;
+         rxBytesRemaining = transaction->rxSize;
+         segmentRemaining = transaction->rxSize;
+
+         if ((txBytesRemaining == 0) && (rxBytesRemaining > 0)) {
+            // Send address byte at start and move to data reception
+            state = i2c_rxAddress;
+            sendAddress(transaction->address|1);
+         }
+         else {
+            // Send address byte at start and move to data transmission
+            state = i2c_txData;
+            sendAddress(transaction->address&~1);
+         }
+      }
+      // In progress - completed by poll()
+   }
 }
 
 /**
- * Receive message
+ * Queue transaction without waiting.
+ * The transaction is started immediately if the interface is idle, otherwise when the
+ * transactions ahead of it complete. It is advanced by the interrupt handler (I2cMode_Interrupt)
+ * or by calls to poll() (I2cMode_Polled).
  *
- * @param[in]  address  Address of slave to communicate with (should include LSB = R/W bit = 0)
- * @param[in]  size     Size of reception data
- * @param[out] data     Data buffer for reception
+ * @param[in]  transaction Transaction to queue (must remain valid until complete)
  *
- * @return E_NO_ERROR on success
+ * @note May be called from an interrupt handler or a transaction callback.
  */
-ErrorCode I2c::receive(uint8_t address, uint16_t size,  uint8_t data[]) {
-#ifdef __CMSIS_RTOS
-   startTransaction();
-#endif
-   errorCode = E_NO_ERROR;
+void I2c::queueTransaction(I2cTransaction &transaction) {
+   usbdm_assert(transaction.complete, "Transaction already queued");
 
-   txBytesRemaining = 0;
+   transaction.next      = nullptr;
+   transaction.errorCode = E_NO_ERROR;
+   transaction.complete  = false;
 
-   // Send address byte at start and move to data reception
-   state = i2c_rxAddress;
+   CriticalSection cs;
+   if (queueTail == nullptr) {
+      queueHead = &transaction;
+   }
+   else {
+      queueTail->next = &transaction;
+   }
+   queueTail = &transaction;
+   startNextTransaction();
+}
 
-   // Set up receive data
-   rxDataPtr        = data;
-   rxBytesRemaining = size;
+/**
+ * Wait for a queued transaction to complete.
+ * If the interface stops making progress the transaction in progress is cancelled with E_TIMEOUT.
+ * This may be a transaction queued ahead of this one in which case waiting continues.
+ *
+ * @param[in]  transaction Transaction to wait for
+ *
+ * @return E_NO_ERROR on success
+ */
+ErrorCode I2c::waitForTransaction(I2cTransaction &transaction) {
+   I2C_State       lastState       = state;
+   I2cTransaction *lastTransaction = currentTransaction;
+   unsigned        timeout         = TIMEOUT_LIMIT;
+   while (!transaction.complete) {
+      if ((state != lastState) || (currentTransaction != lastTransaction)) {
+         // Restart timeout
+         timeout         = TIMEOUT_LIMIT;
+         lastState       = state;
+         lastTransaction = currentTransaction;
+      }
+      else if (--timeout == 0) {
+         CriticalSection cs;
+         I2cTransaction *stuck = (currentTransaction != nullptr)?currentTransaction:&transaction;
+         // Bus is reset before the cancel starts the next transaction
+         busHangReset();
+         cancelTransaction(*stuck, E_TIMEOUT);
+         timeout = TIMEOUT_LIMIT;
+      }
+      if ((i2c->C1&I2C_C1_IICIE_MASK) == 0) {
+         poll();
+      }
+      else {
+         __asm__("wfi");
+      }
+   }
+   return transaction.errorCode;
+}
 
-   sendAddress(address|1);
-   waitWhileBusy();
+/**
+ * Cancel a queued transaction.
+ * If the transaction is in progress a STOP is generated and the next queued transaction is started.
+ * The callback is executed with the given error code.
+ *
+ * @param[in]  transaction Transaction to cancel (no action if already complete)
+ * @param[in]  error       Error code for transaction
+ */
+void I2c::cancelTransaction(I2cTransaction &transaction, ErrorCode error) {
+   CriticalSection cs;
+   if (transaction.complete) {
+      return;
+   }
+   if (&transaction == currentTransaction) {
+      state              = i2c_idle;
+      currentTransaction = nullptr;
+      errorCode          = error;
+      if (startPending) {
+         // START not sent - stop waiting for bus idle
+         startPending = false;
+         i2c->FLT     = i2c->FLT & ~(I2C_FLT_STOPF_MASK|I2C_FLT_STARTF_MASK|I2C_FLT_SSIE_MASK);
+      }
+      // Generate STOP
+      i2c->C1 = i2cMode|I2C_C1_IICEN_MASK;
+   }
+   else {
+      // Remove from queue
+      I2cTransaction *previous = nullptr;
+      I2cTransaction *current  = queueHead;
+      while (current != &transaction) {
+         previous = current;
+         current  = current->next;
+      }
+      if (previous == nullptr) {
+         queueHead = transaction.next;
+      }
+      else {
+         previous->next = transaction.next;
+      }
+      if (queueTail == &transaction) {
+         queueTail = previous;
+      }
+   }
+   finishTransaction(transaction, error);
 
-   ErrorCode tErrorCode = errorCode;
+   // Queue may have been held up by the cancelled transaction
+   startNextTransaction();
+}
 
-#ifdef __CMSIS_RTOS
-   endTransaction();
-#endif
+/**
+ * Transmit message
+ * Note: 0th byte of Tx is often register address.
+ *
+ * @param[in]  address  Address of slave to communicate with (should include LSB = R/W bit = 0)
+ * @param[in]  size     Size of transmission data
+ * @param[in]  data     Data to transmit
+ *
+ * @return E_NO_ERROR on success
+ */
+ErrorCode I2c::transmit(uint8_t address, uint16_t size, const uint8_t data[]) {
+   return txRx(address, size, data, 0, nullptr);
+}
 
-   return tErrorCode;
+/**
+ * Receive message
+ *
+ * @param[in]  address  Address of slave to communicate with (should include LSB = R/W bit = 0)
+ * @param[in]  size     Size of reception data
+ * @param[out] data     Data buffer for reception
+ *
+ * @return E_NO_ERROR on success
+ */
+ErrorCode I2c::receive(uint8_t address, uint16_t size,  uint8_t data[]) {
+   return txRx(address, 0, nullptr, size, data);
 }
 
 /**
@@ -311,21 +534,39 @@ ErrorCode I2c::txRx(uint8_t address, uint16_t txSize, const uint8_t txData[], ui
 #ifdef __CMSIS_RTOS
    startTransaction();
 #endif
-   errorCode = E_NO_ERROR;
 
-   // Send address byte at start and move to data transmission
-   state = i2c_txData;
+   // Queued behind any asynchronous transactions
+   I2cTransaction transaction(address, txSize, txData, rxSize, rxData);
+   queueTransaction(transaction);
+   ErrorCode tErrorCode = waitForTransaction(transaction);
+
+#ifdef __CMSIS_RTOS
+   endTransaction();
+#endif
+
+   return tErrorCode;
+}
 
-   // Set up transmit and receive data
-   rxDataPtr        = rxData;
-   rxBytesRemaining = rxSize;
-   txDataPtr        = txData;
-   txBytesRemaining = txSize;
+/**
+ * Batched transaction.
+ * Runs the segments as one transaction using REPEATED-START between messages where possible.
+ * Queued behind any asynchronous transactions.
+ *
+ * @param[in]  segments     Segments of transaction (see I2cSegment)
+ * @param[in]  segmentCount Number of segments (at least 1)
+ *
+ * @return E_NO_ERROR on success, otherwise first error (remaining segments are not run)
+ */
+ErrorCode I2c::transfer(const I2cSegment segments[], unsigned segmentCount) {
+   usbdm_assert(segmentCount > 0, "Empty I2C batched transaction");
 
-   sendAddress(address);
-   waitWhileBusy();
+#ifdef __CMSIS_RTOS
+   startTransaction();
+#endif
 
-   ErrorCode tErrorCode = errorCode;
+   I2cTransaction transaction(segments, segmentCount);
+   queueTransaction(transaction);
+   ErrorCode tErrorCode = waitForTransaction(transaction);
 
 #ifdef __CMSIS_RTOS
    endTransaction();
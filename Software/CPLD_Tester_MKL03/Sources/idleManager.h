@@ -0,0 +1,205 @@
+/**
+ * @file idleManager.h
+ *
+ * Low-power idle with residency and entry/exit overhead accounting
+ *
+ * The idle manager does not access hardware. Entering low-power modes and reading
+ * timebases is done by the Platform class supplied by the caller so the idle
+ * policy may be exercised against a simulated SMC.
+ *
+ * Platform requirements:
+ *  - Platform::Lock              Masks interrupts for the lifetime of the object (e.g. CriticalSection).
+ *                                A pending interrupt must still wake the low-power modes.
+ *  - Platform::CYCLE_MASK        Wrap mask for getCycles()
+ *  - uint32_t getTime()          Time in ms from a timebase that runs in all idle modes
+ *  - uint32_t getCycles()        Up-counter of core clock cycles (usually stops while the core is not clocked)
+ *  - void enterWait()            Enter WAIT. Returns when an interrupt is pending.
+ *  - bool enterDeepSleep()       Enter VLPS. Returns false if entry was aborted by a pending interrupt.
+ */
+
+#ifndef SOURCES_IDLEMANAGER_H_
+#define SOURCES_IDLEMANAGER_H_
+
+#include <stdint.h>
+
+namespace USBDM {
+
+/**
+ * Modes accounted by the idle manager
+ */
+enum IdleMode : uint8_t {
+   IdleMode_Run,          //!< Executing code
+   IdleMode_Wait,         //!< WAIT - core clock stopped, bus clocks running
+   IdleMode_DeepSleep,    //!< VLPS - core and bus clocks stopped
+};
+
+/// Number of modes in IdleMode
+constexpr unsigned IDLE_MODE_COUNT = 3;
+
+/**
+ * Statistics for a single mode
+ */
+struct IdleModeStatistics {
+   uint32_t residency;    //!< Total time spent in mode (ms, wraps after ~49 days)
+   uint32_t entries;      //!< Number of times mode was entered
+   uint32_t overheadMinimum;  //!< Fewest core cycles counted from requesting the mode until execution resumes
+   uint32_t overheadMaximum;  //!< Most core cycles counted from requesting the mode until execution resumes
+   uint32_t overheadTotal;    //!< Sum of core cycles counted, for averaging over entries
+};
+
+/**
+ * Idle manager
+ *
+ * idle() is called from the main loop when it has nothing to do.
+ * The check for work and entry to the low-power mode are done with interrupts masked
+ * so an interrupt that creates work can't be lost between the check and the WFI.
+ * The interrupt is taken on return from idle().
+ *
+ * The overhead of each entry is the core cycles counted from requesting the mode until
+ * execution resumes (before the waking interrupt is taken). The cycle counter (SysTick on
+ * the tester) stops while the core is not clocked, so this is the software cost of entry
+ * and exit. It does not include the time spent in the mode or the hardware wake-up time.
+ *
+ * @tparam Platform  Low-power modes and timebases (see file description)
+ */
+template<class Platform>
+class IdleManager_T {
+
+private:
+   /**
+    * This class is not intended to be instantiated
+    */
+   IdleManager_T() = delete;
+   IdleManager_T(const IdleManager_T&) = delete;
+   IdleManager_T(IdleManager_T&&) = delete;
+
+   /** Statistics for each mode */
+   static IdleModeStatistics modeStatistics[IDLE_MODE_COUNT];
+
+   /** Number of times deep sleep was aborted by an interrupt */
+   static uint32_t deepSleepAborted;
+
+   /** Time of last change between running and idle (ms) */
+   static uint32_t lastChangeTime;
+
+   /**
+    * Account for a period spent in a mode
+    *
+    * @param[in] mode       Mode
+    * @param[in] startTime  Time mode was entered (ms)
+    * @param[in] endTime    Time mode was left (ms)
+    * @param[in] overhead   Core cycles counted from entry until execution resumed
+    */
+   static void account(IdleMode mode, uint32_t startTime, uint32_t endTime, uint32_t overhead) {
+      IdleModeStatistics &statistics = modeStatistics[mode];
+      statistics.residency += endTime-startTime;
+      statistics.entries++;
+      if ((statistics.entries == 1) || (overhead < statistics.overheadMinimum)) {
+         statistics.overheadMinimum = overhead;
+      }
+      if (overhead > statistics.overheadMaximum) {
+         statistics.overheadMaximum = overhead;
+      }
+      statistics.overheadTotal += overhead;
+   }
+
+public:
+   /**
+    * Start accounting.
+    * Time until the first call to idle() is accounted as running.
+    */
+   static void initialise() {
+      resetStatistics();
+   }
+
+   /**
+    * Clear all statistics
+    */
+   static void resetStatistics() {
+      typename Platform::Lock lock;
+
+      for (IdleModeStatistics &statistics:modeStatistics) {
+         statistics = {0, 0, 0, 0, 0};
+      }
+      deepSleepAborted = 0;
+      lastChangeTime   = Platform::getTime();
+   }
+
+   /**
+    * Idle until the next interrupt.
+    *
+    * Does nothing if workPending() returns true.
+    * Otherwise enters VLPS if deepSleepAllowed() returns true or WAIT if not.
+    * Both checks are made with interrupts masked.
+    *
+    * @tparam WorkPending      Callable as bool workPending()
+    * @tparam DeepSleepAllowed Callable as bool deepSleepAllowed()
+    *
+    * @param[in] workPending      Returns true if the main loop has work to do
+    * @param[in] deepSleepAllowed Returns true if nothing needs bus clocks
+    *
+    * @return Mode that was entered (IdleMode_Run if none)
+    */
+   template<typename WorkPending, typename DeepSleepAllowed>
+   static IdleMode idle(WorkPending workPending, DeepSleepAllowed deepSleepAllowed) {
+      typename Platform::Lock lock;
+
+      if (workPending()) {
+         return IdleMode_Run;
+      }
+      IdleMode mode      = deepSleepAllowed()?IdleMode_DeepSleep:IdleMode_Wait;
+      uint32_t idleStart = Platform::getTime();
+      account(IdleMode_Run, lastChangeTime, idleStart, 0);
+
+      uint32_t startCycles = Platform::getCycles();
+      if (mode == IdleMode_DeepSleep) {
+         if (!Platform::enterDeepSleep()) {
+            deepSleepAborted++;
+         }
+      }
+      else {
+         Platform::enterWait();
+      }
+      uint32_t overhead = (Platform::getCycles()-startCycles)&Platform::CYCLE_MASK;
+
+      lastChangeTime = Platform::getTime();
+      account(mode, idleStart, lastChangeTime, overhead);
+      return mode;
+   }
+
+   /**
+    * Get statistics for a mode.
+    * The current running period is not included until the next call to idle().
+    *
+    * @param[in]  mode        Mode
+    * @param[out] statistics  Statistics for mode
+    */
+   static void getStatistics(IdleMode mode, IdleModeStatistics &statistics) {
+      typename Platform::Lock lock;
+
+      statistics = modeStatistics[mode];
+   }
+
+   /**
+    * Get number of times deep sleep was aborted by a pending interrupt.
+    * These are included in the IdleMode_DeepSleep entries.
+    *
+    * @return Number of aborts
+    */
+   static uint32_t getDeepSleepAborted() {
+      return deepSleepAborted;
+   }
+};
+
+template<class Platform>
+IdleModeStatistics IdleManager_T<Platform>::modeStatistics[IDLE_MODE_COUNT];
+
+template<class Platform>
+uint32_t IdleManager_T<Platform>::deepSleepAborted = 0;
+
+template<class Platform>
+uint32_t IdleManager_T<Platform>::lastChangeTime = 0;
+
+} // End namespace USBDM
+
+#endif /* SOURCES_IDLEMANAGER_H_ */
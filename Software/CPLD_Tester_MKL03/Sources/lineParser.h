@@ -0,0 +1,365 @@
+/**
+ * @file lineParser.h
+ *
+ * Single pass parser for command lines e.g. as read by FormattedIO::gets()
+ *
+ * Does not access hardware. It may be shared with host programs.
+ *
+ * A line is a sequence of tokens separated by spaces, tabs, commas or carriage returns.
+ * The expected arguments are described by a pattern with a character per argument:
+ *  - 'u'  Unsigned integer - decimal, or hexadecimal/binary with a 0x/0b prefix
+ *  - 'i'  Signed integer - as 'u' with an optional '+' or '-'
+ *  - 'x'  Hexadecimal word without prefix e.g. A5F0
+ *  - 'k'  Keyword - the value is the index of the keyword in the parser's table
+ * A '*' after the last character repeats it for the rest of the line (zero or more times).
+ * Values are limited to 32 bits.
+ *
+ * Errors are reported with the offset in the line of the offending character or token.
+ *
+ * Usage
+ * @code
+ *    static const char *const keywords[] = {"power", "clock", "vectors"};
+ *    static const LineParser  parser(keywords);
+ *
+ *    char    line[100];
+ *    LineArg args[20];
+ *
+ *    console.gets(line);
+ *    LineParseResult result = parser.parse(line, "kx*", args);
+ *    if (result.error != LineError_None) {
+ *       console.write("Error at ").writeln(result.position);
+ *    }
+ * @endcode
+ */
+
+#ifndef SOURCES_LINEPARSER_H_
+#define SOURCES_LINEPARSER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace USBDM {
+
+/**
+ * Type of parsed argument
+ */
+enum LineArgType : uint8_t {
+   LineArgType_Unsigned = 'u',   //!< Unsigned integer
+   LineArgType_Signed   = 'i',   //!< Signed integer (value is two's complement)
+   LineArgType_Hex      = 'x',   //!< Hexadecimal word
+   LineArgType_Keyword  = 'k',   //!< Keyword (value is index in keyword table)
+};
+
+/**
+ * Errors from parsing a line
+ */
+enum LineError : uint8_t {
+   LineError_None,             //!< Line parsed successfully
+   LineError_BadDigit,         //!< Illegal character in number (or no digits)
+   LineError_Overflow,         //!< Number too large for 32 bits
+   LineError_UnknownKeyword,   //!< Token is not in keyword table
+   LineError_TooFewArgs,       //!< Line ended before pattern
+   LineError_TooManyArgs,      //!< Line has more tokens than the pattern or argument array
+   LineError_BadPattern,       //!< Pattern contains an unknown character
+};
+
+/**
+ * A parsed argument
+ */
+struct LineArg {
+   LineArgType type;    //!< Type of argument
+   uint32_t    value;   //!< Value of argument
+
+   /**
+    * Get value of signed argument
+    */
+   int32_t asSigned() const {
+      return static_cast<int32_t>(value);
+   }
+};
+
+/**
+ * Result of parsing a line
+ */
+struct LineParseResult {
+   LineError error;      //!< Error (LineError_None on success)
+   uint16_t  position;   //!< Offset in line of error (or end of line on success)
+   uint16_t  count;      //!< Number of arguments parsed (before any error)
+};
+
+/**
+ * Parser for command lines
+ */
+class LineParser {
+
+private:
+   /// Keyword table
+   const char *const *const fKeywords;
+
+   /// Number of entries in keyword table
+   const unsigned fKeywordCount;
+
+   /**
+    * Check if character separates tokens
+    */
+   static bool isSeparator(char ch) {
+      return (ch == ' ') || (ch == ',') || (ch == '\t') || (ch == '\r');
+   }
+
+   /**
+    * Check if character ends a token
+    */
+   static bool isTokenEnd(char ch) {
+      return (ch == '\0') || isSeparator(ch);
+   }
+
+   /**
+    * Convert character to hexadecimal digit
+    *
+    * @return Digit in range 0-15 or >=16 if not a hexadecimal digit
+    */
+   static unsigned hexDigit(char ch) {
+      unsigned digit = ch-'0';
+      if (digit < 10) {
+         return digit;
+      }
+      // Fold to lower case
+      digit = (ch|0x20)-'a';
+      return (digit < 6)?digit+10:16;
+   }
+
+   /**
+    * Parse hexadecimal digits
+    *
+    * @param[inout] ptr   Start of digits, updated to first non-digit
+    * @param[out]   value Value parsed
+    */
+   static LineError parseHex(const char *&ptr, uint32_t &value) {
+      unsigned digit = hexDigit(*ptr);
+      if (digit >= 16) {
+         return LineError_BadDigit;
+      }
+      uint32_t result = 0;
+      do {
+         if ((result>>28) != 0) {
+            return LineError_Overflow;
+         }
+         result = (result<<4)|digit;
+         digit  = hexDigit(*++ptr);
+      } while (digit < 16);
+      value = result;
+      return LineError_None;
+   }
+
+   /**
+    * Parse binary digits
+    *
+    * @param[inout] ptr   Start of digits, updated to first non-digit
+    * @param[out]   value Value parsed
+    */
+   static LineError parseBinary(const char *&ptr, uint32_t &value) {
+      unsigned digit = *ptr-'0';
+      if (digit > 1) {
+         return LineError_BadDigit;
+      }
+      uint32_t result = 0;
+      do {
+         if ((result>>31) != 0) {
+            return LineError_Overflow;
+         }
+         result = (result<<1)|digit;
+         digit  = *++ptr-'0';
+      } while (digit <= 1);
+      value = result;
+      return LineError_None;
+   }
+
+   /**
+    * Parse decimal digits (no division is used)
+    *
+    * @param[inout] ptr   Start of digits, updated to first non-digit
+    * @param[out]   value Value parsed
+    */
+   static LineError parseDecimal(const char *&ptr, uint32_t &value) {
+      unsigned digit = *ptr-'0';
+      if (digit > 9) {
+         return LineError_BadDigit;
+      }
+      uint32_t result = 0;
+      do {
+         // 4294967295 = 429496729*10+5
+         if ((result > 429496729U) || ((result == 429496729U) && (digit > 5))) {
+            return LineError_Overflow;
+         }
+         result = result*10+digit;
+         digit  = *++ptr-'0';
+      } while (digit <= 9);
+      value = result;
+      return LineError_None;
+   }
+
+   /**
+    * Parse unsigned integer with optional 0x/0b prefix
+    *
+    * @param[inout] ptr   Start of number, updated to first non-digit
+    * @param[out]   value Value parsed
+    */
+   static LineError parseUnsigned(const char *&ptr, uint32_t &value) {
+      if (ptr[0] == '0') {
+         if ((ptr[1]|0x20) == 'x') {
+            ptr += 2;
+            return parseHex(ptr, value);
+         }
+         if ((ptr[1]|0x20) == 'b') {
+            ptr += 2;
+            return parseBinary(ptr, value);
+         }
+      }
+      return parseDecimal(ptr, value);
+   }
+
+   /**
+    * Parse signed integer with optional sign and 0x/0b prefix
+    *
+    * @param[inout] ptr   Start of number, updated to first non-digit
+    * @param[out]   value Value parsed (two's complement)
+    */
+   static LineError parseSigned(const char *&ptr, uint32_t &value) {
+      bool negative = (*ptr == '-');
+      if (negative || (*ptr == '+')) {
+         ptr++;
+      }
+      uint32_t  magnitude;
+      LineError error = parseUnsigned(ptr, magnitude);
+      if (error != LineError_None) {
+         return error;
+      }
+      if (magnitude > (negative?0x80000000U:0x7FFFFFFFU)) {
+         return LineError_Overflow;
+      }
+      value = negative?-magnitude:magnitude;
+      return LineError_None;
+   }
+
+   /**
+    * Look up keyword
+    *
+    * @param[inout] ptr   Start of token, updated to end of token
+    * @param[out]   value Index of keyword in table
+    */
+   LineError parseKeyword(const char *&ptr, uint32_t &value) const {
+      const char *start = ptr;
+      while (!isTokenEnd(*ptr)) {
+         ptr++;
+      }
+      size_t length = ptr-start;
+      for (unsigned index=0; index<fKeywordCount; index++) {
+         const char *keyword = fKeywords[index];
+         if ((strncmp(keyword, start, length) == 0) && (keyword[length] == '\0')) {
+            value = index;
+            return LineError_None;
+         }
+      }
+      ptr = start;
+      return LineError_UnknownKeyword;
+   }
+
+public:
+   /**
+    * Create parser without keywords
+    */
+   constexpr LineParser() : fKeywords(nullptr), fKeywordCount(0) {
+   }
+
+   /**
+    * Create parser
+    *
+    * @param[in] keywords Keyword table (must remain valid while the parser is used)
+    * @param[in] count    Number of keywords
+    */
+   constexpr LineParser(const char *const keywords[], unsigned count) : fKeywords(keywords), fKeywordCount(count) {
+   }
+
+   /**
+    * Create parser
+    *
+    * @param[in] keywords Keyword table (size is inferred, must remain valid while the parser is used)
+    */
+   template<size_t N>
+   constexpr LineParser(const char *const (&keywords)[N]) : fKeywords(keywords), fKeywordCount(N) {
+   }
+
+   /**
+    * Parse a line in a single pass
+    *
+    * @param[in]  line     Line to parse ('\0' terminated)
+    * @param[in]  pattern  Expected arguments e.g. "kuu" or "kx*"
+    * @param[out] args     Arguments parsed
+    * @param[in]  maxArgs  Size of args
+    *
+    * @return Result of parse - on error the arguments before the error are valid
+    */
+   LineParseResult parse(const char line[], const char pattern[], LineArg args[], unsigned maxArgs) const {
+      const char *ptr   = line;
+      unsigned    count = 0;
+      for(;;) {
+         while (isSeparator(*ptr)) {
+            ptr++;
+         }
+         char type   = *pattern;
+         bool repeat = (type != '\0') && (pattern[1] == '*');
+         if (*ptr == '\0') {
+            LineError error = ((type == '\0') || repeat)?LineError_None:LineError_TooFewArgs;
+            return {error, static_cast<uint16_t>(ptr-line), static_cast<uint16_t>(count)};
+         }
+         if ((type == '\0') || (count >= maxArgs)) {
+            return {LineError_TooManyArgs, static_cast<uint16_t>(ptr-line), static_cast<uint16_t>(count)};
+         }
+         const char *start = ptr;
+         uint32_t    value = 0;
+         LineError   error;
+         switch(type) {
+            case LineArgType_Unsigned: error = parseUnsigned(ptr, value); break;
+            case LineArgType_Signed:   error = parseSigned(ptr, value);   break;
+            case LineArgType_Hex:      error = parseHex(ptr, value);      break;
+            case LineArgType_Keyword:  error = parseKeyword(ptr, value);  break;
+            default:
+               return {LineError_BadPattern, static_cast<uint16_t>(start-line), static_cast<uint16_t>(count)};
+         }
+         if ((error == LineError_None) && !isTokenEnd(*ptr)) {
+            // Number followed by junk
+            error = LineError_BadDigit;
+         }
+         if (error != LineError_None) {
+            // Digit errors are reported at the character, others at the token
+            const char *position = (error == LineError_BadDigit)?ptr:start;
+            return {error, static_cast<uint16_t>(position-line), static_cast<uint16_t>(count)};
+         }
+         args[count].type  = static_cast<LineArgType>(type);
+         args[count].value = value;
+         count++;
+         if (!repeat) {
+            pattern++;
+         }
+      }
+   }
+
+   /**
+    * Parse a line in a single pass
+    *
+    * @param[in]  line     Line to parse ('\0' terminated)
+    * @param[in]  pattern  Expected arguments e.g. "kuu" or "kx*"
+    * @param[out] args     Arguments parsed (size is inferred)
+    *
+    * @return Result of parse - on error the arguments before the error are valid
+    */
+   template<size_t N>
+   LineParseResult parse(const char line[], const char pattern[], LineArg (&args)[N]) const {
+      return parse(line, pattern, args, N);
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* SOURCES_LINEPARSER_H_ */
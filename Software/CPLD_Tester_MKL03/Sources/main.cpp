@@ -4,6 +4,18 @@
  *============================================================================
  */
 #include "hardware.h"
+#include "vectorEngine.h"
+#include "fmaxSearch.h"
+#include "rampProfile.h"
+#include "delay.h"
+#include "lptmr.h"
+#include "rtc.h"
+#include "smc.h"
+#include "idleManager.h"
+#include "commandFrame.h"
+#include "tokenLog.h"
+#include "buttonDebouncer.h"
+#include "adcControl.h"
 
 // Allow access to USBDM methods without USBDM:: prefix
 using namespace USBDM;
@@ -25,9 +37,265 @@ static PowerStatus powerStatus         = Off;
 static unsigned    powerChangeSettling = 0;
 
 /**
- * Number of consistent samples to confirm debouncing
+ * Time the power button must be stable to confirm debouncing (at least 25 ms).
+ * Counted by the LPTMR from the LPO (1 kHz) so it continues in VLPS.
  */
-constexpr unsigned DEBOUNCE_COUNT = 5; // 5 * 5 ms = 25 ms
+static constexpr unsigned debounceTicks = 25;
+
+/// Target Vdd samples in each block (processed every 5 ms)
+constexpr unsigned VDD_BLOCK_SIZE = 10;
+
+/// Interval between hardware triggered target Vdd samples (5 ms/VDD_BLOCK_SIZE)
+static constexpr Seconds vddSampleInterval = 500_us;
+
+/// Compare function and trigger control of the ADC sampling target Vdd (see adcControl.h)
+using VddAdcControl = AdcControl_T<MyAdc>;
+
+/// ADC value above which target Vdd is considered present
+constexpr uint16_t VDD_PRESENT_THRESHOLD = 200;
+
+/**
+ * Number of samples in the current block of target Vdd samples
+ */
+static uint8_t vddSampleCount = 0;
+
+/**
+ * Smallest target Vdd sample in the current block
+ */
+static uint16_t vddBlockMinimum;
+
+/**
+ * Largest target Vdd sample in the current block
+ */
+static uint16_t vddBlockMaximum;
+
+/**
+ * Set while target Vdd is checked by the ADC compare function rather than by sampling
+ */
+static volatile bool vddProtectionActive = false;
+
+/**
+ * Set while hardware triggered target Vdd sampling is running
+ */
+static volatile bool vddSamplingActive = false;
+
+/**
+ * Most recent target Vdd sample
+ */
+static volatile uint16_t lastVddSample = 0;
+
+/// Number of target Vdd samples captured at power-on
+constexpr unsigned RAMP_SAMPLES = 64;
+
+/// Number of ADC conversions averaged for each captured sample
+constexpr unsigned RAMP_DECIMATION = 4;
+
+/// Ramp is considered settled when within this many ADC counts of final value
+constexpr unsigned RAMP_TOLERANCE = 3;
+
+/**
+ * Target Vdd samples captured from power-on.
+ * Each is the average of RAMP_DECIMATION conversions at the maximum ADC rate.
+ */
+static uint8_t rampSamples[RAMP_SAMPLES];
+
+/**
+ * Index of next sample in rampSamples
+ */
+static uint8_t rampSampleIndex = 0;
+
+/**
+ * Number of conversions added to rampSum
+ */
+static uint8_t rampConversionCount = 0;
+
+/**
+ * Sum of conversions for the next sample in rampSamples
+ */
+static uint16_t rampSum = 0;
+
+/**
+ * SysTick value at start of ramp capture
+ */
+static uint32_t rampStartTicks;
+
+/**
+ * Set while the ADC interrupt is capturing the supply ramp
+ */
+static volatile bool rampCaptureActive = false;
+
+/**
+ * Duration of ramp capture in SysTick ticks
+ */
+static uint32_t rampCaptureTicks;
+
+/**
+ * Set when a ramp capture is waiting to be reported
+ */
+static volatile bool rampReportPending = false;
+
+/// Spare pins driving CPLD inputs during vector tests
+using VectorStimulus = GpioBField<3,2>;
+
+/// Spare pin sampling a CPLD output during vector tests
+using VectorResponse = GpioAField<7,7>;
+
+/// Engine applying test vectors streamed over the LPUART
+using VectorEngine   = VectorEngine_T<VectorStimulus, VectorResponse, ClockGpio>;
+
+/**
+ * LPUART link to host
+ *
+ * Received bytes are dispatched by LPUART0_IRQHandler() as they arrive.
+ * Transmission is buffered so responses don't hold up the main loop.
+ *
+ * Binary data (frames) is written through txWrite() like text so it is included in the transmit statistics.
+ * The default LpuartTxOverflow_Block policy is kept so frames are never broken up.
+ */
+class HostLink : public LpuartBuffered_T<Lpuart0Info, 4, 32> {
+public:
+   /**
+    * Encodes a frame straight into the transmit queue (blocking on queue full).
+    * The write lock is held so the frame is not interleaved with other output.
+    *
+    * @param[in] frame Frame to send
+    */
+   void writeFrame(const Frame &frame) {
+      ::lock(&fWriteLock);
+      sendFrame(frame, [this](uint8_t data) {
+         char ch = data;
+         txWrite(&ch, 1);
+      });
+      ::unlock(&fWriteLock);
+   }
+};
+
+/**
+ * LPUART used to receive test vectors and commands and report results
+ */
+static HostLink vectorLink;
+
+/**
+ * Blocks for reports queued on the host link without copying (see HostLink::writeChain())
+ * Holds 48 characters. Blocks are returned as they are sent.
+ */
+static TextArena_T<16, 3> reportArena;
+
+/**
+ * Receives command frames from the host
+ */
+static FrameReceiver_T<> frameReceiver;
+
+/**
+ * Deferred log of events in interrupt handlers (see CPLD_Log)
+ * Holds 8 one-argument records. Records are drained by the main loop soon after they are made.
+ */
+static TokenLog_T<CriticalSection, 16> tokenLog;
+
+/**
+ * Set while log records are being sent to the host
+ */
+static bool tokenLogEnabled = false;
+
+/**
+ * Frame being constructed by the main loop.
+ * The response to a command frame or a log frame.
+ */
+static Frame responseFrame;
+
+/**
+ * Last command byte received from the host (-1 => none)
+ */
+static volatile int hostCommand = -1;
+
+/**
+ * Take the last command byte received from the host.
+ * Done with interrupts masked so a command arriving at the same time is not lost.
+ *
+ * @return Command byte or -1 if none
+ */
+static int takeHostCommand() {
+   CriticalSection cs;
+   int command = hostCommand;
+   hostCommand = -1;
+   return command;
+}
+
+/// LPUART receive pin used to wake from VLPS (the LPUART is not clocked in VLPS)
+using LinkWakePin = PcrTable_T<Lpuart0Info, 1>;   // PTA4 = LPUART0_RX
+
+/**
+ * Low-power modes and timebases used by the idle manager
+ *  - Time is from the RTC prescaler clocked by the LPO (1 kHz) so it continues in VLPS
+ *  - Cycles are from SysTick which stops with the core clock
+ */
+class IdlePlatform {
+public:
+   using Lock = CriticalSection;
+
+   static constexpr uint32_t CYCLE_MASK = TIMER_MASK;
+
+   /**
+    * Start RTC from LPO and allow VLPS.
+    * The RTC pins are not used (PTA5 is the TVdd LED) so only the RTC clock is enabled.
+    */
+   static void initialise() {
+      Smc::defaultConfigure();
+      SimInfo::setErc32kClock(SimErc32kSel_LpoClk);
+      RtcInfo::enableClock();
+      Rtc::setTime(0);
+      enableTimer();
+   }
+
+   /**
+    * Get time.
+    * The prescaler overflows into the seconds register every 32768 counts.
+    *
+    * @return Time in ms
+    */
+   static uint32_t getTime() {
+      uint32_t seconds, prescaler;
+      do {
+         seconds   = Rtc::getTime();
+         prescaler = RtcInfo::rtc->TPR;
+      } while ((seconds != Rtc::getTime()) || (prescaler != RtcInfo::rtc->TPR));
+      return (seconds<<15)+(prescaler&0x7FFF);
+   }
+
+   /**
+    * Get core cycles (SysTick counts down).
+    * SysTick is clocked by the core clock so it stops in WAIT and VLPS.
+    */
+   static uint32_t getCycles() {
+      return -getTicks();
+   }
+
+   static void enterWait() {
+      Smc::enterWaitMode();
+   }
+
+   /**
+    * Enter VLPS.
+    * A falling edge on the LPUART receive pin wakes the processor.
+    * The character being received is lost.
+    */
+   static bool enterDeepSleep() {
+      LinkWakePin::clearPinInterruptFlag();
+      LinkWakePin::setPcrOption(PinAction_IrqFalling);
+      bool entered = Smc::enterStopMode(SmcStopMode_VeryLowPowerStop) == E_NO_ERROR;
+      LinkWakePin::setPcrOption(PinAction_None);
+      return entered;
+   }
+};
+
+/// Idle manager used by the main loop
+using IdleManager = IdleManager_T<IdlePlatform>;
+
+/// Lowest CPLD clock frequency checked by Fmax search
+constexpr uint32_t FMAX_MINIMUM    = 1000;  // 1 kHz
+
+/// Fmax search stops when the pass and fail frequencies are this close
+constexpr uint32_t FMAX_RESOLUTION = 100;   // 100 Hz
 
 /**
  * Enable clock output
@@ -39,6 +307,31 @@ void enableClock() {
    ClockChannel::setOutput(PinDriveStrength_High);
 }
 
+/**
+ * Set CPLD clock frequency.
+ * The clock output toggles once per timer period so the timer period is half the clock period.
+ * The clock must already be enabled.
+ *
+ * @param[in] frequency Frequency in Hz
+ *
+ * @return Frequency obtained in Hz (0 => not possible)
+ */
+uint32_t setClockFrequency(uint32_t frequency) {
+   if (Clock::setPeriod(Seconds(0.5f/frequency)) != E_NO_ERROR) {
+      return 0;
+   }
+   return Clock::getTickFrequencyAsInt()/(2*(Clock::getCounterMaximumValue()+1));
+}
+
+/**
+ * Highest CPLD clock frequency that may be obtained
+ *
+ * @return Frequency in Hz
+ */
+uint32_t getMaximumClockFrequency() {
+   return Tpm1Info::getInputClockFrequency(TpmClockSource_SystemTpmClock)/(2*(Tpm1Info::minimumResolution+1));
+}
+
 /**
  * Disable CPLD clock
  */
@@ -46,128 +339,764 @@ void disableClock() {
    ClockGpio::setInput(PinPull_Up);
 }
 
+/**
+ * Default initialisation value for Tpm0
+ * This value is created from Configure.usbdmProject settings
+ */
+static constexpr PollTimer::Init pollTimerInitValue = {
+   TpmMode_LeftAligned , // Alignment and whether interval or free-running mode - Left-aligned (count up)
+   TpmOverflowAction_None , // Action on Counter overflow - No action
+   NvicPriority_Normal , // IRQ level for this peripheral - Normal
+   TpmClockSource_SystemTpmClock , // Clock Source - System TPM Clock
+   TpmPrescale_DivBy4 , // Clock prescaler - Divide by 4
+   65535_ticks,  // End value for counter
+};
+
+/**
+ * Start hardware triggered target Vdd sampling.
+ * Conversions are triggered by PollTimer overflow.
+ */
+static void startVddSampling() {
+   vddSampleCount    = 0;
+   vddSamplingActive = true;
+   PollTimer::configure(pollTimerInitValue);
+   PollTimer::setPeriod(vddSampleInterval);
+   TargetVddSample::enableHardwareConversion(AdcPretrigger_0, AdcInterrupt_Enabled);
+}
+
+/**
+ * Stop hardware triggered target Vdd sampling
+ */
+static void stopVddSampling() {
+   PollTimer::disable();
+   vddSamplingActive = false;
+}
+
+/**
+ * Apply target power and start capturing the supply ramp.
+ * Target Vdd is sampled at the maximum ADC rate and decimated into rampSamples[] by the ADC interrupt
+ * so other interrupts are not held off for the capture (~1 ms).
+ */
+static void startRampCapture() {
+   CriticalSection cs;
+
+   VddAdcControl::disableHardwareConversion();
+   MyAdc::enableContinuousConversions(AdcContinuous_Enabled);
+
+   rampReportPending   = false;
+   rampSampleIndex     = 0;
+   rampConversionCount = 0;
+   rampSum             = 0;
+   rampCaptureActive   = true;
+   enableTimer();
+   rampStartTicks    = getTicks();
+   TargetVddSample::startConversion(AdcInterrupt_Enabled);
+   TargetVddEnable::on();
+}
+
+/**
+ * Stop capturing the supply ramp and resume hardware triggered sampling
+ */
+static void stopRampCapture() {
+   CriticalSection cs;
+
+   rampCaptureActive = false;
+   MyAdc::enableContinuousConversions(AdcContinuous_Disabled);
+   startVddSampling();
+}
+
 /**
  * Enable CPLD power, clock etc
+ *
+ * The supply ramp is captured in the background and analysed by the main loop (see reportRamp()).
+ * Loss of target Vdd is detected by sampling once the settling time has elapsed.
  */
 void powerOn() {
    TargetVddSample::setInput();
-   TargetVddEnable::on();
+   startRampCapture();
    enableClock();
+   VectorEngine::enableReception();
+}
+
+/**
+ * Start target Vdd protection.
+ *
+ * The ADC converts continuously and only signals a conversion when the compare
+ * function finds target Vdd below the threshold. The ADC interrupt then removes
+ * power immediately without software checking each sample.
+ */
+static void enableVddProtection() {
+   vddProtectionActive = true;
+   stopVddSampling();
+   VddAdcControl::disableHardwareConversion();
+   VddAdcControl::enableComparison(AdcCompare_LessThan, VDD_PRESENT_THRESHOLD+1);
+   MyAdc::enableContinuousConversions(AdcContinuous_Enabled);
+   TargetVddSample::startConversion(AdcInterrupt_Enabled);
+}
+
+/**
+ * Stop target Vdd protection and return to hardware triggered sampling
+ */
+static void disableVddProtection() {
+   MyAdc::enableContinuousConversions(AdcContinuous_Disabled);
+   VddAdcControl::enableComparison(AdcCompare_Disabled);
+   startVddSampling();
+   vddProtectionActive = false;
 }
 
 /**
  * Disable CPLD power, clock etc
  */
 void powerOff() {
+   if (rampCaptureActive) {
+      stopRampCapture();
+   }
+   if (vddProtectionActive) {
+      disableVddProtection();
+   }
+   VectorEngine::enableReception(false);
    disableClock();
    TargetVddEnable::off();
    TargetVddDischarge::setOutput(PinDriveStrength_High, PinSlewRate_Slow);
 }
 
-namespace USBDM {
-
 /**
- * Polling interrupt handler (Executed every 5 ms)
+ * Change power state
  *
- * Polls power enable button and initiates the power check ADC conversion
+ * @param[in] on true to power on, false to power off
  */
-template<>
-void PollTimer::TpmBase_T::irqHandler() {
-   static bool     lastRunButton = false;
-   static unsigned stableCount   = 0;
+static void setPower(bool on) {
+   // 5 * 5ms power settling time
+   powerChangeSettling = 5;
 
-   PollChannel::clearInterruptFlag();
+   if (on) {
+      powerStatus = On;
+      powerOn();
+   }
+   else {
+      powerStatus = Off;
+      powerOff();
+   }
+}
 
-   // Sample voltage
-   TargetVddSample::startConversion(AdcInterrupt_Enabled);
+/**
+ * Power button pin and debounce timer
+ */
+class ButtonPlatform {
+public:
+   using Lock = CriticalSection;
 
-   bool currentRunButton = PowerButton::read();
-   if (currentRunButton != lastRunButton) {
-      stableCount   = 0;
-      lastRunButton = currentRunButton;
-      return;
-   }
-   // Stop counter rolling over
-   if (stableCount < DEBOUNCE_COUNT+1) {
-      stableCount++;
+   static bool readButton() {
+      return PowerButton::read();
    }
-   // Check for debounce time
-   if ((stableCount == DEBOUNCE_COUNT) && currentRunButton) {
 
-      // 5 * 5ms power settling time
-      powerChangeSettling = 5;
+   static void clearButtonFlags() {
+      PowerButton::port->ISFR = PowerButton::port->ISFR;
+   }
 
-      // Change power state due to button press
-      switch (powerStatus) {
-         case Off:
-         case Error:
-            powerStatus = On;
-            powerOn();
-            break;
+   /**
+    * (Re)start one-shot debounce timer.
+    * Disabling the LPTMR clears the counter.
+    */
+   static void startDebounceTimer() {
+      Lptmr0Info::lptmr->CSR = LptmrResetOnCompare_Enabled|LptmrMode_TimeInterval|LPTMR_CSR_TCF_MASK;
+      Lptmr0Info::lptmr->CSR = LptmrResetOnCompare_Enabled|LptmrInterrupt_Enabled|LptmrMode_TimeInterval|LPTMR_CSR_TCF_MASK|LPTMR_CSR_TEN_MASK;
+   }
 
-         case On:
-            powerStatus = Off;
-            powerOff();
-            break;
-      }
+   /**
+    * Stop debounce timer and clear flag
+    */
+   static void stopDebounceTimer() {
+      Lptmr0Info::lptmr->CSR = LptmrResetOnCompare_Enabled|LptmrMode_TimeInterval|LPTMR_CSR_TCF_MASK;
    }
-}
+
+   static void pressed();
+};
 
 /**
- * Target Vdd check ADC conversion complete interrupt
+ * Change power state due to button press.
+ * Interrupts are masked as for FrameHandler::power().
  *
- * Check status of target power.
+ * Defined outside the class so it isn't inline (see TOKEN_LOG()).
  */
-template<>
-void MyAdc::AdcBase_T::irqHandler() {
+void ButtonPlatform::pressed() {
+   TOKEN_LOG(tokenLog, "Power button, status={}", static_cast<unsigned>(powerStatus));
+   setPower(powerStatus != On);
+}
 
-   // Poll TVdd
-   bool targetVddPresent = (getConversionResult()>200);
+/// Debounces the power button
+using PowerButtonDebouncer = ButtonDebouncer_T<ButtonPlatform>;
+
+/**
+ * Process a block of Vdd samples (Executed every 5 ms)
+ *
+ * Checks status of target power.
+ * Any sample below the threshold is treated as loss of target Vdd so
+ * short brown-outs between blocks are not missed.
+ *
+ * @param[in] minimum Smallest of the VDD_BLOCK_SIZE samples
+ * @param[in] maximum Largest of the VDD_BLOCK_SIZE samples
+ * @param[in] last    Last sample of the block
+ */
+static void processVddBlock(uint16_t minimum, uint16_t maximum, uint16_t last) {
+   bool targetVddPresent = (minimum>VDD_PRESENT_THRESHOLD);
 
    if ((powerStatus == On) && (powerChangeSettling == 0) && !targetVddPresent) {
       // Power on + timeout + No target Vdd
+      TOKEN_LOG(tokenLog, "Vdd fault (sampled) min={} max={}", minimum, maximum);
       powerStatus = Error;
+      VectorEngine::enableReception(false);
       TargetVddEnable::off();
    }
    // Update TVdd LED
-   TargetVddStatusLed::write(targetVddPresent);
+   TargetVddStatusLed::write(last>VDD_PRESENT_THRESHOLD);
 
    // Settling timer for power change
    if (powerChangeSettling>0) {
       powerChangeSettling--;
    }
+   if (powerChangeSettling > 0) {
+      return;
+   }
+   if (powerStatus == On) {
+      // Power has settled - hand over to ADC compare function
+      enableVddProtection();
+   }
+   else if (maximum <= VDD_PRESENT_THRESHOLD) {
+      // Target discharged - nothing to monitor until next power on
+      stopVddSampling();
+   }
 }
 
+/**
+ * Power button pin interrupt
+ *
+ * Each edge (re)starts the debounce timer
+ */
+extern "C" void PORTB_IRQHandler() {
+   PowerButtonDebouncer::edgeIrqHandler();
 }
 
 /**
- * Default initialisation value for Tpm0
- * This value is created from Configure.usbdmProject settings
+ * Debounce timer interrupt
+ *
+ * Power button has been stable for the debounce interval
  */
-static constexpr PollTimer::Init pollTimerInitValue = {
-   TpmMode_FreeRunning , // Alignment and whether interval or free-running mode - Free-running (count up)
-   TpmOverflowAction_None , // Action on Counter overflow - No action
-   NvicPriority_Normal , // IRQ level for this peripheral - Normal
-   TpmClockSource_SystemTpmClock , // Clock Source - System TPM Clock
-   TpmPrescale_DivBy4 , // Clock prescaler - Divide by 4
-   65535_ticks,  // End value for counter
+extern "C" void LPTMR0_IRQHandler() {
+   PowerButtonDebouncer::timerIrqHandler();
+}
+
+/**
+ * LPUART receive pin interrupt
+ *
+ * Only enabled while in VLPS. The character that woke the processor is lost so the host
+ * follows it with the command after a short delay (see CPLD_Link). Target Vdd sampling is
+ * started to keep the bus clocks running for the command. It stops itself after a block
+ * that finds target Vdd discharged (see processVddBlock()).
+ */
+extern "C" void PORTA_IRQHandler() {
+   // Clear flags
+   LinkWakePin::port->ISFR = LinkWakePin::port->ISFR;
+
+   startVddSampling();
+}
+
+namespace USBDM {
+
+/**
+ * Target Vdd ADC conversion complete interrupt
+ *
+ * While Vdd protection is active this only occurs when target Vdd has failed.
+ *
+ * While the supply ramp is being captured conversions are continuous and are averaged into rampSamples[].
+ *
+ * Otherwise conversions are triggered by the PollTimer overflow.
+ * The minimum and maximum of each block of samples are tracked as they arrive and the block is
+ * processed once complete.
+ */
+template<>
+void MyAdc::AdcBase_T::irqHandler() {
+
+   if (vddProtectionActive) {
+      // No target Vdd
+      TargetVddEnable::off();
+      TOKEN_LOG(tokenLog, "Vdd fault (compare) adc={}", getConversionResult());
+      powerStatus = Error;
+      VectorEngine::enableReception(false);
+      TargetVddStatusLed::write(false);
+      disableVddProtection();
+      return;
+   }
+
+   if (rampCaptureActive) {
+      rampSum += getConversionResult();
+      if (++rampConversionCount < RAMP_DECIMATION) {
+         return;
+      }
+      rampSamples[rampSampleIndex++] = rampSum/RAMP_DECIMATION;
+      rampConversionCount = 0;
+      rampSum             = 0;
+      if (rampSampleIndex == RAMP_SAMPLES) {
+         // SysTick counts down
+         rampCaptureTicks  = (rampStartTicks-getTicks())&TIMER_MASK;
+         stopRampCapture();
+         rampReportPending = true;
+      }
+      return;
+   }
+
+   uint16_t sample = getConversionResult();
+   lastVddSample = sample;
+   if ((vddSampleCount == 0) || (sample < vddBlockMinimum)) {
+      vddBlockMinimum = sample;
+   }
+   if ((vddSampleCount == 0) || (sample > vddBlockMaximum)) {
+      vddBlockMaximum = sample;
+   }
+   if (++vddSampleCount == VDD_BLOCK_SIZE) {
+      vddSampleCount = 0;
+      processVddBlock(vddBlockMinimum, vddBlockMaximum, sample);
+   }
+}
+
+}
+
+/**
+ * LPUART receive interrupt
+ *
+ * Passes received bytes to the vector engine while a stream is being received
+ * and to the frame receiver while a command frame is being received.
+ * Otherwise FRAME_SYNC starts a command frame, 'V' starts a vector stream and
+ * other bytes are commands for the main loop.
+ *
+ * Also transmits buffered data and ends the transmit complete wake-up.
+ */
+extern "C" void LPUART0_IRQHandler() {
+   uint32_t status = vectorLink.lpuart->STAT;
+
+   // Clear & ignore pending errors
+   if ((status & (LPUART_STAT_FE_MASK|LPUART_STAT_OR_MASK|LPUART_STAT_PF_MASK|LPUART_STAT_NF_MASK)) != 0) {
+      vectorLink.lpuart->STAT = LPUART_STAT_FE_MASK|LPUART_STAT_OR_MASK|LPUART_STAT_PF_MASK|LPUART_STAT_NF_MASK;
+   }
+   if (status & LPUART_STAT_RDRF_MASK) {
+      uint8_t data = vectorLink.lpuart->DATA;
+      if (VectorEngine::isReceiving()) {
+         VectorEngine::receive(data);
+      }
+      else if (frameReceiver.isReceiving() || (data == FRAME_SYNC)) {
+         frameReceiver.receive(data);
+      }
+      else if (data == 'V') {
+         VectorEngine::startStream();
+      }
+      else {
+         hostCommand = data;
+      }
+   }
+   if ((status & LPUART_STAT_TDRE_MASK) && (vectorLink.lpuart->CTRL & LPUART_CTRL_TIE_MASK)) {
+      HostLink::txIrqHandler();
+   }
+   if (status & LPUART_STAT_TC_MASK) {
+      // Transmit complete only wakes the main loop to enter VLPS (see deepSleepAllowed())
+      vectorLink.lpuart->CTRL = vectorLink.lpuart->CTRL & ~LPUART_CTRL_TCIE_MASK;
+   }
+}
+
+/**
+ * Tell sender another window of vectors may be sent
+ */
+static void vectorWindowReleased() {
+   vectorLink.writeChar('+');
+}
+
+/**
+ * Apply a vector stream received over the LPUART and report the result
+ *
+ * Reports "OK|ABORT <vectors> <failures> [<first fail index> <first fail response>]"
+ */
+void runVectors() {
+   VectorResult result;
+
+   VectorEngine::configure();
+   bool complete = VectorEngine::runStream(result);
+
+   // Release CPLD inputs and return clock to the timer without changing its frequency (e.g. during Fmax search)
+   VectorStimulus::setInput();
+   if (powerStatus == On) {
+      ClockChannel::setOutput(PinDriveStrength_High);
+   }
+   else {
+      disableClock();
+   }
+   const char *status = complete?"OK":"ABORT";
+   if (result.failCount > 0) {
+      static constexpr char failFormat[] = "{} {} {} {} 0x{:x}\n";
+      vectorLink.format<failFormat>(status, result.vectorCount, result.failCount, result.firstFailIndex, result.firstFailResponse);
+   }
+   else {
+      static constexpr char passFormat[] = "{} {} {}\n";
+      vectorLink.format<passFormat>(status, result.vectorCount, result.failCount);
+   }
+}
+
+/**
+ * Report the last power-on ramp
+ *
+ * A ramp that settled within the capture shortens the power settling time to one block.
+ *
+ * Reports "RAMP <sample ns> <rise ns> <settle ns> <final> <peak> <trace>"
+ *  - Rise time is 10%-90% of final value
+ *  - Settling time is 0 if the ramp had not settled by the end of the capture
+ *  - Trace is the compressed samples (see rampProfile.h) as hex digits
+ */
+void reportRamp() {
+   rampReportPending = false;
+
+   RampProfile profile;
+   analyseRamp(rampSamples, RAMP_SAMPLES, RAMP_TOLERANCE, profile);
+
+   if (profile.hasSettled) {
+      CriticalSection cs;
+      // Check power hasn't been changed since the capture
+      if ((powerStatus == On) && !rampCaptureActive && (powerChangeSettling > 1)) {
+         powerChangeSettling = 1;
+      }
+   }
+
+   uint32_t sampleNs = (uint32_t)((rampCaptureTicks*1000000000ULL)/SystemCoreClock/RAMP_SAMPLES);
+   uint32_t riseNs   = (profile.riseEnd-profile.riseStart)*sampleNs;
+   uint32_t settleNs = profile.hasSettled?(profile.settled*sampleNs):0;
+
+   vectorLink.write("RAMP ").write(sampleNs).write(' ').write(riseNs).write(' ').write(settleNs);
+   vectorLink.write(' ').write(profile.finalValue).write(' ').write(profile.peakValue).write(' ');
+
+   static const char hexDigits[] = "0123456789ABCDEF";
+   encodeRamp(rampSamples, RAMP_SAMPLES, [](uint8_t byte) {
+      vectorLink.writeChar(hexDigits[byte>>4]);
+      vectorLink.writeChar(hexDigits[byte&0x0F]);
+   });
+   vectorLink.writeln();
+}
+
+/**
+ * Executes framed commands (see commandFrame.h)
+ */
+class FrameHandler {
+public:
+   /**
+    * Power target on/off
+    */
+   FrameStatus power(bool on, uint8_t &status) {
+      CriticalSection cs;
+
+      if (on?(powerStatus != On):(powerStatus != Off)) {
+         setPower(on);
+      }
+      status = powerStatus;
+      return FrameStatus_Ok;
+   }
+
+   /**
+    * Set CPLD clock frequency
+    */
+   FrameStatus clock(uint32_t &frequency) {
+      if (powerStatus != On) {
+         frequency = 0;
+         return FrameStatus_NotPowered;
+      }
+      frequency = setClockFrequency(frequency);
+      return (frequency == 0)?FrameStatus_Failed:FrameStatus_Ok;
+   }
+
+   /**
+    * Apply a block of vectors.
+    * The CPLD clock is returned to the timer afterwards without changing its frequency.
+    */
+   FrameStatus vectors(const uint8_t vectors[], unsigned count, FrameVectorResult &result) {
+      if (powerStatus != On) {
+         return FrameStatus_NotPowered;
+      }
+      if (count > FRAME_MAX_VECTORS) {
+         return FrameStatus_BadLength;
+      }
+      VectorResult vectorResult = {0, 0, 0, 0};
+      VectorEngine::configure();
+      for (unsigned index=0; index<count; index++) {
+         // Vectors in the frame are not aligned
+         TestVector vector;
+         memcpy(&vector, vectors+index*FRAME_VECTOR_SIZE, sizeof(vector));
+         VectorEngine::applyBlock(&vector, 1, vectorResult);
+      }
+      VectorStimulus::setInput();
+      ClockChannel::setOutput(PinDriveStrength_High);
+
+      result.failCount         = vectorResult.failCount;
+      result.firstFailIndex    = vectorResult.firstFailIndex;
+      result.firstFailResponse = vectorResult.firstFailResponse;
+      return FrameStatus_Ok;
+   }
+
+   /**
+    * Read target Vdd
+    */
+   FrameStatus readVdd(uint16_t &value, uint8_t &flags) {
+      value = lastVddSample;
+      flags = vddProtectionActive?FRAME_VDD_PROTECTED:0;
+      return FrameStatus_Ok;
+   }
 };
 
+/**
+ * Execute received command frames and send the responses
+ *
+ * The request buffer is released before the response is sent so the
+ * host may have the next frame arriving meanwhile.
+ */
+void processFrames() {
+   FrameHandler handler;
+   Frame *request;
+
+   while ((request = frameReceiver.getFrame()) != nullptr) {
+      executeFrame(*request, responseFrame, handler);
+      frameReceiver.releaseFrame();
+      vectorLink.writeFrame(responseFrame);
+   }
+}
+
+/**
+ * Report idle statistics
+ *
+ * Reports "IDLE <run ms> <wait ms> <wait entries> <wait overhead min> <max> <mean>
+ *               <vlps ms> <vlps entries> <vlps overhead min> <max> <mean> <vlps aborted>"
+ *  - Overheads are core cycles executed entering and leaving the mode.
+ *    SysTick stops while the core is not clocked so the hardware wake-up time is not included.
+ */
+void reportIdle() {
+   IdleModeStatistics statistics;
+
+   IdleManager::getStatistics(IdleMode_Run, statistics);
+   vectorLink.write("IDLE ").write(statistics.residency);
+   for (IdleMode mode:{IdleMode_Wait, IdleMode_DeepSleep}) {
+      IdleManager::getStatistics(mode, statistics);
+      uint32_t mean = (statistics.entries==0)?0:statistics.overheadTotal/statistics.entries;
+      vectorLink.write(' ').write(statistics.residency).write(' ').write(statistics.entries);
+      vectorLink.write(' ').write(statistics.overheadMinimum).write(' ').write(statistics.overheadMaximum).write(' ').write(mean);
+   }
+   vectorLink.write(' ').writeln(IdleManager::getDeepSleepAborted());
+}
+
+/**
+ * Report transmit statistics of the host link
+ *
+ * Reports "UART <dropped bytes> <high water> <blocked ticks>"
+ *  - Counts include text, frames, vector responses and log frames
+ *  - Blocked ticks is the time spent waiting for transmit queue space in SysTick ticks (SysTick is clocked by the core clock)
+ *
+ * The report is queued as a chain so it doesn't wait for transmit queue space or change the statistics it reports.
+ */
+void reportUart() {
+   LpuartTxStatistics statistics;
+
+   HostLink::getTxStatistics(statistics);
+   ChainFormatter report(reportArena);
+   report.write("UART ").write(statistics.droppedBytes).write(' ').write(statistics.highWater);
+   report.write(' ').writeln(statistics.blockedTicks);
+   vectorLink.writeChain(report);
+}
+
+/**
+ * Check if a log frame holding at least one record can be sent without waiting for the transmit queue
+ */
+static bool logRecordFits() {
+   return HostLink::getTxSpace() >= FRAME_OVERHEAD+1+TOKEN_LOG_MAX_RECORD;
+}
+
+/**
+ * Send pending log records to the host packed in log frames (see commandFrame.h).
+ * Records are left in the log while the transmit queue is too full so logging never holds up the main loop.
+ * The frames are built in responseFrame which is free between command frames.
+ */
+static void sendLog() {
+   Frame &logFrame = responseFrame;
+
+   while (logRecordFits() && tokenLog.isPending()) {
+      // Only the main loop writes to the queue so this space remains available
+      unsigned space = HostLink::getTxSpace()-FRAME_OVERHEAD;
+      if (space > FRAME_MAX_PAYLOAD) {
+         space = FRAME_MAX_PAYLOAD;
+      }
+      logFrame.sequence  = 0;
+      logFrame.length    = 0;
+      logFrame.payload[logFrame.length++] = FRAME_LOG;
+
+      unsigned size;
+      while (((logFrame.length+TOKEN_LOG_MAX_RECORD) <= space) &&
+             ((size = tokenLog.drain(logFrame.payload+logFrame.length)) > 0)) {
+         logFrame.length += size;
+      }
+      vectorLink.writeFrame(logFrame);
+   }
+}
+
+/**
+ * Check if the main loop has work to do
+ */
+static bool workPending() {
+   return VectorEngine::isStreamActive() || rampReportPending || (hostCommand >= 0) ||
+          (frameReceiver.getFrame() != nullptr) || (tokenLogEnabled && tokenLog.isPending() && logRecordFits());
+}
+
+/**
+ * Check if VLPS may be entered.
+ * Bus clocks are needed while the CPLD is powered, target Vdd is being monitored
+ * or a character, command frame or vector stream is being sent or received.
+ */
+static bool deepSleepAllowed() {
+   if ((powerStatus == On) || vddSamplingActive || vddProtectionActive) {
+      return false;
+   }
+   if (frameReceiver.isReceiving() || VectorEngine::isReceiving()) {
+      return false;
+   }
+   uint32_t status = vectorLink.lpuart->STAT;
+   if ((status&LPUART_STAT_TC_MASK) == 0) {
+      // Wake from WAIT when the last character has been sent (see LPUART0_IRQHandler())
+      vectorLink.lpuart->CTRL = vectorLink.lpuart->CTRL | LPUART_CTRL_TCIE_MASK;
+      return false;
+   }
+   return (status&LPUART_STAT_RAF_MASK) == 0;
+}
+
+/**
+ * Apply vector streams, report the power-on ramp, execute command frames and send the log.
+ * Called from the main loop and while waiting for the host during long operations.
+ */
+static void serviceHost() {
+   if (VectorEngine::isStreamActive()) {
+      runVectors();
+   }
+   if (rampReportPending) {
+      reportRamp();
+   }
+   processFrames();
+   if (tokenLogEnabled) {
+      sendLog();
+   }
+}
+
+/**
+ * Wait for a command byte from the host.
+ * Vector streams and command frames are serviced while waiting so the host can
+ * use them to check the CPLD.
+ *
+ * @return Command byte or -1 if the CPLD has been powered off
+ */
+int waitForHostCommand() {
+   int command;
+   for(;;) {
+      if (powerStatus != On) {
+         return -1;
+      }
+      serviceHost();
+      command = takeHostCommand();
+      if (command >= 0) {
+         return command;
+      }
+      IdleManager::idle(workPending, deepSleepAllowed);
+   }
+}
+
+/**
+ * Search for highest CPLD clock frequency that passes and report the result
+ *
+ * At each step the clock is changed, "STEP <frequency>" is reported and the host
+ * replies 'P' (pass) or 'X' (fail) after checking the CPLD at that frequency.
+ * The host may send vector streams and command frames while checking.
+ *
+ * Reports "FMAX <frequency> <first fail frequency> <steps>".
+ * The first fail frequency is 0 if the CPLD passed at the highest frequency available.
+ */
+void runFmaxSearch() {
+   if (powerStatus != On) {
+      vectorLink.writeln("FMAX OFF");
+      return;
+   }
+   // Frequencies actually obtained rather than requested
+   uint32_t lastPass = 0;
+   uint32_t lastFail = 0;
+
+   auto check = [&](uint32_t frequency) {
+      uint32_t actual = setClockFrequency(frequency);
+      static constexpr char stepFormat[] = "STEP {}\n";
+      vectorLink.format<stepFormat>(actual);
+      bool pass = (actual != 0) && (waitForHostCommand() == 'P');
+      if (pass) {
+         lastPass = actual;
+      }
+      else {
+         lastFail = actual;
+      }
+      return pass;
+   };
+   enableClock();
+   FmaxResult result = searchFmax(FMAX_MINIMUM, getMaximumClockFrequency(), FMAX_RESOLUTION, check);
+   if (powerStatus == On) {
+      enableClock();
+   }
+   static constexpr char fmaxFormat[] = "FMAX {} {} {}\n";
+   vectorLink.format<fmaxFormat>((result.fmax==0)?0:lastPass, (result.firstFail==0)?0:lastFail, result.steps);
+}
 
 int main() {
    TargetVddEnable::setOutput(PinDriveStrength_Low, PinSlewRate_Slow);
-   PowerButton::setInput(PinPull_Up, PinAction_None, PinFilter_Passive);
 
-   PollTimer::configure(pollTimerInitValue);
-   PollChannel::configure(TpmChannelMode_OutputCompare, TpmChannelAction_Interrupt);
+   IdlePlatform::initialise();
+   IdleManager::initialise();
 
+   // Power button edges start a one-shot debounce timer.
+   // The interval is set directly as Lptmr0::configureTimeIntervalMode() requires 100 ticks of resolution.
+   // The flag is set after CMR+1 edges of the free-running LPO so the first tick may be short.
+   Lptmr0::enable();
+   Lptmr0Info::lptmr->PSR = LptmrClockSel_Lpoclk|LPTMR_PSR_PBYP_MASK;
+   Lptmr0Info::lptmr->CMR = debounceTicks;
+   ButtonPlatform::stopDebounceTimer();
+   Lptmr0::enableNvicInterrupts(NvicPriority_Normal);
+   PowerButton::setInput(PinPull_Up, PinAction_IrqEither, PinFilter_Passive);
+   PowerButton::enableNvicPinInterrupts(NvicPriority_Normal);
+
+   // Target Vdd conversions are triggered by PollTimer overflow
    MyAdc::defaultConfigure();
    TargetVddSample::setInput();
+   SimInfo::setAdc0Triggers(SimAdc0TriggerMode_Alt_PreTrigger_0, SimAdc0TriggerSrc_Tpm0);
+   startVddSampling();
+
+   // Target Vdd failure takes priority
+   MyAdc::enableNvicInterrupts(NvicPriority_High);
 
    TargetVddStatusLed::setOutput(PinDriveStrength_High, PinSlewRate_Slow);
 
+   vectorLink.setBaudRate(Lpuart0Info::defaultBaudRate);
+   vectorLink.enableInterrupt(LpuartInterrupt_RxFull);
+   Lpuart0::enableNvicInterrupts(NvicPriority_Normal);
+   VectorEngine::setWindowCallback(vectorWindowReleased);
+
+   // Only enabled while in VLPS
+   LinkWakePin::enableNvicPinInterrupts(NvicPriority_Normal);
+
    for(;;) {
-      __asm__("nop");
+      serviceHost();
+      int command = takeHostCommand();
+      if (command >= 0) {
+         switch(command) {
+            case 'F': runFmaxSearch(); break;
+            case 'I': reportIdle();    break;
+            case 'U': reportUart();    break;
+            case 'L': tokenLogEnabled = true;  break;
+            case 'l': tokenLogEnabled = false; break;
+            default:                   break;  // e.g. wake-up character
+         }
+      }
+      IdleManager::idle(workPending, deepSleepAllowed);
    }
    return 0;
 }
@@ -0,0 +1,114 @@
+/**
+ * @file rampProfile.h
+ *
+ * Analysis and compression of a captured supply ramp
+ *
+ * Operates on 8-bit samples taken at a fixed interval and does not access hardware.
+ *
+ * Compressed trace format:
+ *  - First byte is the first sample
+ *  - 0rrrdddd  Sample changes by d (signed, -8..7) and this repeats (r+1) times
+ *  - 10000000  Escape - next byte is the new sample value
+ */
+
+#ifndef SOURCES_RAMPPROFILE_H_
+#define SOURCES_RAMPPROFILE_H_
+
+#include <stdint.h>
+
+namespace USBDM {
+
+/**
+ * Results of ramp analysis
+ * Times are in samples from the start of the capture
+ */
+struct RampProfile {
+   uint16_t riseStart;     //!< First sample at or above 10% of final value
+   uint16_t riseEnd;       //!< First sample at or above 90% of final value
+   uint16_t settled;       //!< First sample after which all samples are within tolerance of final value
+   uint8_t  finalValue;    //!< Final (settled) value
+   uint8_t  peakValue;     //!< Largest sample
+   bool     hasSettled;    //!< Samples were within tolerance for the end of the capture
+};
+
+/**
+ * Analyse a supply ramp
+ *
+ * The final value is taken as the average of the last samples of the capture.
+ *
+ * @param[in]  samples    Samples starting at the time power was applied
+ * @param[in]  count      Number of samples (at least 16)
+ * @param[in]  tolerance  Settling tolerance in ADC counts
+ * @param[out] profile    Results
+ */
+static inline void analyseRamp(const uint8_t samples[], unsigned count, unsigned tolerance, RampProfile &profile) {
+   constexpr unsigned FINAL_SAMPLES = 16;
+
+   unsigned sum = 0;
+   for (unsigned index=count-FINAL_SAMPLES; index<count; index++) {
+      sum += samples[index];
+   }
+   unsigned finalValue = sum/FINAL_SAMPLES;
+   unsigned low        = (finalValue*26)>>8;   // ~10%
+   unsigned high       = (finalValue*230)>>8;  // ~90%
+
+   profile.finalValue = finalValue;
+   profile.peakValue  = 0;
+   profile.riseStart  = count;
+   profile.riseEnd    = count;
+   profile.settled    = 0;
+
+   for (unsigned index=0; index<count; index++) {
+      unsigned sample = samples[index];
+      if (sample > profile.peakValue) {
+         profile.peakValue = sample;
+      }
+      if ((profile.riseStart == count) && (sample >= low)) {
+         profile.riseStart = index;
+      }
+      if ((profile.riseEnd == count) && (sample >= high)) {
+         profile.riseEnd = index;
+      }
+      unsigned difference = (sample>finalValue)?(sample-finalValue):(finalValue-sample);
+      if (difference > tolerance) {
+         profile.settled = index+1;
+      }
+   }
+   // Require the end of the capture to be steady
+   profile.hasSettled = (profile.settled+FINAL_SAMPLES) <= count;
+}
+
+/**
+ * Compress samples to delta/run-length trace
+ *
+ * @tparam Output  Callable as void output(uint8_t byte)
+ *
+ * @param[in] samples Samples to compress
+ * @param[in] count   Number of samples (at least 1)
+ * @param[in] output  Receives each byte of the compressed trace
+ */
+template<typename Output>
+void encodeRamp(const uint8_t samples[], unsigned count, Output output) {
+   output(samples[0]);
+
+   unsigned index = 1;
+   while (index<count) {
+      int delta = samples[index]-samples[index-1];
+      if ((delta < -8) || (delta > 7)) {
+         output(0x80);
+         output(samples[index]);
+         index++;
+         continue;
+      }
+      unsigned run = 1;
+      while ((run<8) && ((index+run)<count) && ((samples[index+run]-samples[index+run-1]) == delta)) {
+         run++;
+      }
+      output(((run-1)<<4)|(delta&0x0F));
+      index += run;
+   }
+}
+
+} // End namespace USBDM
+
+#endif /* SOURCES_RAMPPROFILE_H_ */
@@ -0,0 +1,425 @@
+/**
+ * @file tokenLog.h
+ *
+ * Deferred binary (tokenized) logging
+ *
+ * Does not access hardware. It is shared with the host program (CPLD_Log).
+ *
+ * Each log site has a format string that is placed in the section TOKEN_LOG_SECTION.
+ * On the target this section is not loaded (see Linker-rom.ld) so the strings take no flash.
+ * The offset of the string in the section is the ID of the log site. The host program
+ * reads the strings from the ELF file to rebuild the text.
+ *
+ * Logging a message only stores the ID and the raw argument values in a RAM ring.
+ * The ring is drained at low priority by drain() which encodes each record for sending.
+ *
+ * Format strings use the fields of FormattedIO::format() i.e. {} or {:[0|<][width][b|o|d|x|X]}.
+ * There may be up to TOKEN_LOG_MAX_ARGS integer arguments of up to 32 bits.
+ *
+ * Records are sent to the host packed in log frames (see FRAME_LOG in commandFrame.h) so
+ * they are delimited and checked by the frame CRC like other binary data from the tester.
+ *
+ * Record format:
+ *  - uint16_t ID (little-endian)
+ *  - uint8_t  Descriptor - [2:0] number of arguments, [7:4] argument is signed (bit per argument)
+ *  - Arguments, each as a LEB128 varint. Signed arguments are zigzag encoded first.
+ *
+ * The ID TOKEN_LOG_ID_DROPPED reports the total number of records discarded as the ring was full.
+ *
+ * Usage
+ * @code
+ *    static TokenLog_T<CriticalSection, 64> tokenLog;
+ *
+ *    TOKEN_LOG(tokenLog, "Vdd fault, sample={}", sample);
+ * @endcode
+ */
+
+#ifndef SOURCES_TOKENLOG_H_
+#define SOURCES_TOKENLOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+namespace USBDM {
+
+/// Largest number of arguments to a log site
+constexpr unsigned TOKEN_LOG_MAX_ARGS    = 4;
+
+/// Largest encoded record
+constexpr unsigned TOKEN_LOG_MAX_RECORD  = 3+5*TOKEN_LOG_MAX_ARGS;
+
+/// ID of record reporting the number of records dropped
+constexpr uint16_t TOKEN_LOG_ID_DROPPED  = 0xFFFF;
+
+/// Section holding the format strings
+#define TOKEN_LOG_SECTION "log_strings"
+
+#if !defined(__arm__)
+/// Start of format strings (provided by the host linker)
+extern "C" const char __start_log_strings[];
+#endif
+
+/**
+ * Get ID of a log site
+ *
+ * @param[in] format Format string in TOKEN_LOG_SECTION
+ *
+ * @return Offset of string in TOKEN_LOG_SECTION
+ */
+static inline uint16_t tokenLogId(const char *format) {
+#if defined(__arm__)
+   // Section is located at address 0
+   return static_cast<uint16_t>(reinterpret_cast<uintptr_t>(format));
+#else
+   return static_cast<uint16_t>(format-__start_log_strings);
+#endif
+}
+
+/**
+ * Count the fields in a format string
+ *
+ * @param[in] format Format string
+ *
+ * @return Number of fields ({{ is not a field)
+ */
+static constexpr unsigned tokenLogFieldCount(const char *format) {
+   unsigned count = 0;
+   while (*format != '\0') {
+      if (*format == '{') {
+         if (format[1] == '{') {
+            format++;
+         }
+         else {
+            count++;
+         }
+      }
+      format++;
+   }
+   return count;
+}
+
+/**
+ * Log a message
+ *
+ * @param log     TokenLog_T to write to
+ * @param format  Format string literal
+ * @param ...     Integer arguments (up to TOKEN_LOG_MAX_ARGS)
+ *
+ * @note Not for use in inline functions (including member functions defined in the class body).
+ *       Their format strings are COMDAT and GCC won't place them in the same section as others.
+ */
+#define TOKEN_LOG(log, format, ...) do {                                                  \
+   static constexpr char tokenLogFormat[]                                                 \
+      __attribute__((section(TOKEN_LOG_SECTION), used)) = format;                         \
+   (log).template write<USBDM::tokenLogFieldCount(tokenLogFormat)>(                       \
+         USBDM::tokenLogId(tokenLogFormat), ##__VA_ARGS__);                               \
+} while(false)
+
+/**
+ * Ring of log records
+ *
+ * write() may be used from any interrupt level. The ring space is reserved with
+ * interrupts masked for a few instructions and the arguments are stored afterwards.
+ * The record header is written last so a record interrupted part way through is not drained.
+ *
+ * drain() must only be used from a single context e.g. the main loop.
+ *
+ * @tparam Lock   Masks interrupts for the lifetime of the object (e.g. CriticalSection)
+ * @tparam size   Size of ring in 32-bit words (power of 2)
+ */
+template<class Lock, unsigned size>
+class TokenLog_T {
+
+   static_assert((size&(size-1)) == 0, "Size must be a power of 2");
+   static_assert(size > TOKEN_LOG_MAX_ARGS, "Size too small for a record");
+
+private:
+   /**
+    * Record header word
+    *  - [31:16] ID
+    *  - [11:8]  Argument is signed (bit per argument)
+    *  - [6:4]   Number of arguments
+    *  - [0]     Record is complete (0 => empty or being written)
+    */
+   static constexpr uint32_t HEADER_VALID = 1;
+
+   /** Ring of header and argument words */
+   volatile uint32_t words[size] = {};
+
+   /** Words reserved - written by writers only (with interrupts masked) */
+   volatile uint32_t head = 0;
+
+   /** Words drained - written by drain() only */
+   volatile uint32_t tail = 0;
+
+   /** Records discarded as the ring was full */
+   volatile uint32_t dropped = 0;
+
+   /** Value of dropped last reported by drain() */
+   uint32_t droppedReported = 0;
+
+   /**
+    * Get signed mask for argument types
+    */
+   template<typename... Args>
+   static constexpr uint32_t signedMask() {
+      uint32_t mask = 0;
+      unsigned bit  = 0;
+      ((mask |= (std::is_signed<Args>::value?(1U<<bit):0), bit++), ...);
+      return mask;
+   }
+
+   /**
+    * Encode a record
+    *
+    * @param[out] buffer     Buffer for record (at least TOKEN_LOG_MAX_RECORD bytes)
+    * @param[in]  id         ID of log site
+    * @param[in]  count      Number of arguments
+    * @param[in]  signedArgs Argument is signed (bit per argument)
+    * @param[in]  args       Arguments
+    *
+    * @return Number of bytes in record
+    */
+   static unsigned encode(uint8_t buffer[], uint16_t id, unsigned count, unsigned signedArgs, const uint32_t args[]) {
+      unsigned length = 0;
+      buffer[length++] = id;
+      buffer[length++] = id>>8;
+      buffer[length++] = count|(signedArgs<<4);
+      for (unsigned index=0; index<count; index++) {
+         uint32_t value = args[index];
+         if (signedArgs&(1<<index)) {
+            // Zigzag - small negative numbers are short
+            value = (value<<1)^static_cast<uint32_t>(static_cast<int32_t>(value)>>31);
+         }
+         while (value >= 0x80) {
+            buffer[length++] = (value&0x7F)|0x80;
+            value >>= 7;
+         }
+         buffer[length++] = value;
+      }
+      return length;
+   }
+
+public:
+   /**
+    * Write a record.
+    * Usually done with TOKEN_LOG() which checks the number of arguments against the format string.
+    *
+    * @tparam fieldCount Number of fields in format string
+    * @tparam Args       Types of arguments (inferred)
+    *
+    * @param[in] id    ID of log site
+    * @param[in] args  Integer arguments
+    *
+    * @return false if the ring was full and the record was dropped
+    */
+   template<unsigned fieldCount, typename... Args>
+   bool write(uint16_t id, Args... args) {
+      constexpr unsigned count = sizeof...(args);
+      static_assert(count == fieldCount, "Number of arguments doesn't match format string");
+      static_assert(count <= TOKEN_LOG_MAX_ARGS, "Too many arguments to log");
+      static_assert((std::is_integral<Args>::value && ...), "Log arguments must be integers");
+      static_assert(((sizeof(Args) <= sizeof(uint32_t)) && ...), "Log arguments are limited to 32 bits");
+
+      uint32_t index;
+      {
+         Lock lock;
+         index = head;
+         if ((index-tail) > (size-(count+1))) {
+            dropped = dropped+1;
+            return false;
+         }
+         head = index+count+1;
+      }
+      unsigned offset = 1;
+      ((words[(index+offset++)&(size-1)] = static_cast<uint32_t>(args)), ...);
+      (void)offset;
+      __asm__ volatile("" ::: "memory");
+      words[index&(size-1)] = (static_cast<uint32_t>(id)<<16)|(signedMask<Args...>()<<8)|(count<<4)|HEADER_VALID;
+      return true;
+   }
+
+   /**
+    * Check if there are records to drain
+    *
+    * @return true if drain() has a record to send
+    */
+   bool isPending() const {
+      return ((words[tail&(size-1)]&HEADER_VALID) != 0) || (dropped != droppedReported);
+   }
+
+   /**
+    * Encode and remove the oldest record.
+    * A record reporting dropped records is produced first if more have been dropped since the last report.
+    *
+    * @param[out] buffer Buffer for record (at least TOKEN_LOG_MAX_RECORD bytes)
+    *
+    * @return Number of bytes in record (0 if none)
+    */
+   unsigned drain(uint8_t buffer[]) {
+      uint32_t droppedNow = dropped;
+      if (droppedNow != droppedReported) {
+         droppedReported = droppedNow;
+         return encode(buffer, TOKEN_LOG_ID_DROPPED, 1, 0, &droppedNow);
+      }
+      uint32_t index  = tail;
+      uint32_t header = words[index&(size-1)];
+      if ((header&HEADER_VALID) == 0) {
+         return 0;
+      }
+      unsigned count = (header>>4)&0x7;
+      uint32_t args[TOKEN_LOG_MAX_ARGS];
+      for (unsigned arg=0; arg<count; arg++) {
+         args[arg] = words[(index+1+arg)&(size-1)];
+         // An old argument must not look like a header when the ring wraps
+         words[(index+1+arg)&(size-1)] = 0;
+      }
+      words[index&(size-1)] = 0;
+      __asm__ volatile("" ::: "memory");
+      tail = index+count+1;
+      return encode(buffer, header>>16, count, (header>>8)&0xF, args);
+   }
+
+   /**
+    * Get number of records discarded as the ring was full
+    */
+   uint32_t getDropped() const {
+      return dropped;
+   }
+};
+
+/**
+ * A decoded log record
+ */
+struct TokenLogRecord {
+   uint16_t id;                         //!< ID of log site
+   uint8_t  count;                      //!< Number of arguments
+   uint8_t  signedArgs;                 //!< Argument is signed (bit per argument)
+   uint32_t args[TOKEN_LOG_MAX_ARGS];   //!< Arguments (signed arguments are sign-extended)
+};
+
+/**
+ * Decoder for the log records in the payload of a log frame
+ */
+class TokenLogDecoder {
+
+   /**
+    * State of decoder
+    */
+   enum DecodeState : uint8_t {
+      DecodeState_IdLow,       //!< Receiving ID
+      DecodeState_IdHigh,      //!< Receiving ID
+      DecodeState_Descriptor,  //!< Receiving descriptor
+      DecodeState_Argument,    //!< Receiving arguments
+   };
+
+   DecodeState    state = DecodeState_IdLow;
+   TokenLogRecord record;
+   uint8_t        arg   = 0;
+   uint8_t        shift = 0;
+
+   /**
+    * Complete an argument
+    *
+    * @return true if the record is complete
+    */
+   bool completeArgument() {
+      uint32_t &value = record.args[arg];
+      if (record.signedArgs&(1<<arg)) {
+         value = (value>>1)^(-(value&1));
+      }
+      shift = 0;
+      if (++arg == record.count) {
+         state = DecodeState_IdLow;
+         return true;
+      }
+      record.args[arg] = 0;
+      return false;
+   }
+
+public:
+   /**
+    * Result of decoding a byte
+    */
+   enum Result : uint8_t {
+      Result_Busy,       //!< Byte is part of an incomplete record
+      Result_Record,     //!< Record completed (see getRecord())
+      Result_Error,      //!< Malformed record discarded
+   };
+
+   /**
+    * Discard any incomplete record e.g. at the start of a frame payload
+    */
+   void reset() {
+      state = DecodeState_IdLow;
+   }
+
+   /**
+    * Check if a record has been started but not completed
+    *
+    * @return true if part way through a record
+    */
+   bool isBusy() const {
+      return state != DecodeState_IdLow;
+   }
+
+   /**
+    * Process a byte
+    *
+    * @param[in] data Byte received
+    *
+    * @return Result of decoding
+    */
+   Result receive(uint8_t data) {
+      switch(state) {
+         case DecodeState_IdLow:
+            record.id = data;
+            state     = DecodeState_IdHigh;
+            return Result_Busy;
+         case DecodeState_IdHigh:
+            record.id |= data<<8;
+            state      = DecodeState_Descriptor;
+            return Result_Busy;
+         case DecodeState_Descriptor:
+            record.count      = data&0x7;
+            record.signedArgs = data>>4;
+            if ((record.count > TOKEN_LOG_MAX_ARGS) || ((data&0x08) != 0)) {
+               state = DecodeState_IdLow;
+               return Result_Error;
+            }
+            if (record.count == 0) {
+               state = DecodeState_IdLow;
+               return Result_Record;
+            }
+            arg     = 0;
+            shift   = 0;
+            record.args[0] = 0;
+            state   = DecodeState_Argument;
+            return Result_Busy;
+         case DecodeState_Argument:
+            if (shift > 28) {
+               state = DecodeState_IdLow;
+               return Result_Error;
+            }
+            record.args[arg] |= static_cast<uint32_t>(data&0x7F)<<shift;
+            shift += 7;
+            if ((data&0x80) != 0) {
+               return Result_Busy;
+            }
+            return completeArgument()?Result_Record:Result_Busy;
+      }
+      return Result_Error;
+   }
+
+   /**
+    * Get the record completed by receive()
+    */
+   const TokenLogRecord &getRecord() const {
+      return record;
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* SOURCES_TOKENLOG_H_ */
@@ -0,0 +1,487 @@
+/**
+ * @file vectorEngine.h
+ *
+ * Test vector engine for CPLD functional testing
+ *
+ * Each vector drives a stimulus field, clocks the CPLD and compares a
+ * response field against a masked expected value.
+ *
+ * Vectors are streamed into a pair of RAM windows by the receiver (usually
+ * called from the UART ISR) while the previous window is being applied.
+ * Vectors are packed into the windows using only the bits of the stimulus and
+ * response fields. Bits of a received vector outside the fields are ignored.
+ *
+ * A stream is started by startStream() (e.g. on receiving a command byte).
+ *
+ * Stream format (little-endian):
+ *  - uint32_t  Number of vectors that follow
+ *  - TestVector[] Vectors, 6 bytes each (stimulus, expected, mask)
+ *
+ * The sender must not get more than two windows ahead of the window released callback.
+ * If it does the stream is aborted and the rest of its declared length is discarded.
+ */
+
+#ifndef SOURCES_VECTORENGINE_H_
+#define SOURCES_VECTORENGINE_H_
+
+#include <stdint.h>
+#include <type_traits>
+#include "gpio.h"
+
+namespace USBDM {
+
+/**
+ * A single test vector
+ */
+struct TestVector {
+   uint16_t stimulus;   //!< Value to drive to stimulus field
+   uint16_t expected;   //!< Expected value on response field
+   uint16_t mask;       //!< Response bits to check (0=> don't care, 1=> check)
+};
+
+static_assert(sizeof(TestVector) == 6, "TestVector must be packed as it is received directly from the stream");
+
+/**
+ * Result of applying vectors
+ */
+struct VectorResult {
+   uint32_t vectorCount;         //!< Number of vectors applied
+   uint32_t failCount;           //!< Number of vectors that failed
+   uint32_t firstFailIndex;      //!< Index of first failing vector (if failCount>0)
+   uint16_t firstFailResponse;   //!< Response for first failing vector (if failCount>0)
+};
+
+/**
+ * Smallest unsigned type holding a given number of bits
+ *
+ * @tparam bits Number of bits (at most 64)
+ */
+template<unsigned bits>
+using PackedVector_T =
+   typename std::conditional<(bits<=8),  uint8_t,
+   typename std::conditional<(bits<=16), uint16_t,
+   typename std::conditional<(bits<=32), uint32_t, uint64_t>::type>::type>::type;
+
+/**
+ * Type definition for window released call back.
+ * Used to tell the sender that another window of vectors may be sent.
+ */
+typedef void (*VectorWindowCallbackFunction)();
+
+/**
+ * Test vector engine
+ *
+ * @tparam StimulusField   GpioField_T driving CPLD inputs (at most 16 bits)
+ * @tparam ResponseField   GpioField_T sampling CPLD outputs (at most 16 bits)
+ * @tparam ClockPin        Gpio_T used to clock the CPLD
+ * @tparam windowSize      Number of vectors in each RAM window
+ * @tparam settleCycles    Minimum number of core clock cycles between the clock rising edge and
+ *                         sampling the response field (CPLD clock-to-output and port input synchroniser)
+ */
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize=16, unsigned settleCycles=4>
+class VectorEngine_T {
+
+   static_assert((StimulusField::LEFT-StimulusField::RIGHT)<16, "Stimulus field is too wide for TestVector");
+   static_assert((ResponseField::LEFT-ResponseField::RIGHT)<16, "Response field is too wide for TestVector");
+   static_assert(windowSize<=255, "Window vector count must fit in 8 bits");
+
+private:
+   /**
+    * This class is not intended to be instantiated
+    */
+   VectorEngine_T() = delete;
+   VectorEngine_T(const VectorEngine_T&) = delete;
+   VectorEngine_T(VectorEngine_T&&) = delete;
+
+   /**
+    * State of a RAM window
+    */
+   enum WindowState : uint8_t {
+      WindowState_Free,       //!< Available to receiver
+      WindowState_Ready,      //!< Filled and waiting to be applied
+      WindowState_ReadyLast,  //!< Filled and waiting to be applied - last window of stream
+   };
+
+   /**
+    * State of stream receiver
+    */
+   enum RxState : uint8_t {
+      RxState_Idle,           //!< Waiting for start of stream
+      RxState_Header,         //!< Receiving vector count
+      RxState_Vectors,        //!< Receiving vectors
+      RxState_Discard,        //!< Discarding the rest of an aborted stream
+   };
+
+   /** Width of stimulus field */
+   static constexpr unsigned STIMULUS_BITS = StimulusField::LEFT-StimulusField::RIGHT+1;
+
+   /** Width of response field */
+   static constexpr unsigned RESPONSE_BITS = ResponseField::LEFT-ResponseField::RIGHT+1;
+
+   /** Vector packed as stimulus, expected, mask from least significant bit */
+   using PackedVector = PackedVector_T<STIMULUS_BITS+2*RESPONSE_BITS>;
+
+   /** Mask for stimulus field */
+   static constexpr uint32_t STIMULUS_MASK = (1U<<STIMULUS_BITS)-1;
+
+   /** Mask for response field */
+   static constexpr uint32_t RESPONSE_MASK = (1U<<RESPONSE_BITS)-1;
+
+   /** Vector windows */
+   static PackedVector vectorWindows[2][windowSize];
+
+   /** Number of vectors in each window */
+   static uint8_t  windowCounts[2];
+
+   /** State of each window - shared between receiver and engine */
+   static volatile WindowState windowStates[2];
+
+   /** Receiver state */
+   static volatile RxState rxState;
+
+   /** Set if the stream is aborted or the sender overruns the windows */
+   static volatile bool streamError;
+
+   /** Enables reception of streams */
+   static volatile bool receiveEnabled;
+
+   /** Window being filled by receiver */
+   static uint8_t  rxWindow;
+
+   /** Number of vectors in window being filled by receiver */
+   static uint8_t  rxCount;
+
+   /** Byte offset within vector or header being received */
+   static uint8_t  rxOffset;
+
+   /** Vector being received */
+   static TestVector rxVector;
+
+   /** Vectors remaining in stream (bytes remaining when discarding) */
+   static uint32_t rxRemaining;
+
+   /** Callback when a window has been applied */
+   static VectorWindowCallbackFunction windowCallback;
+
+   /**
+    * Mark current receive window as ready and move to the next one
+    *
+    * @param[in] last Indicates this is the last window of the stream
+    */
+   static void publishWindow(bool last) {
+      windowCounts[rxWindow] = rxCount;
+      windowStates[rxWindow] = last?WindowState_ReadyLast:WindowState_Ready;
+      rxWindow ^= 1;
+      rxCount   = 0;
+   }
+
+   /**
+    * Pack a vector for a RAM window
+    *
+    * @param[in] vector Vector to pack
+    *
+    * @return Packed vector
+    */
+   static PackedVector pack(const TestVector &vector) {
+      return static_cast<PackedVector>(
+            (static_cast<PackedVector>(vector.stimulus&STIMULUS_MASK)) |
+            (static_cast<PackedVector>(vector.expected&RESPONSE_MASK)<<STIMULUS_BITS) |
+            (static_cast<PackedVector>(vector.mask&RESPONSE_MASK)<<(STIMULUS_BITS+RESPONSE_BITS)));
+   }
+
+   /**
+    * Wait for the CPLD outputs to settle after a clock edge
+    */
+   static void __attribute__((always_inline)) settle() {
+      for (unsigned count=0; count<settleCycles; count++) {
+         __asm__("nop");
+      }
+   }
+
+   /**
+    * Apply a single vector
+    *
+    * @param[in] stimulus Value to drive to stimulus field
+    * @param[in] expected Expected value on response field
+    * @param[in] mask     Response bits to check
+    *
+    * @return Mismatched response bits (0 => passed)
+    */
+   static uint32_t __attribute__((always_inline)) apply(uint32_t stimulus, uint32_t expected, uint32_t mask) {
+      StimulusField::write(stimulus);
+      ClockPin::high();
+      settle();
+      uint32_t response = ResponseField::read();
+      ClockPin::low();
+      return (response^expected)&mask;
+   }
+
+   /**
+    * Record the result of applying a vector
+    *
+    * @param[in]    index      Index of vector in block
+    * @param[in]    expected   Expected value on response field
+    * @param[in]    difference Mismatched response bits
+    * @param[inout] result     Result to update
+    */
+   static void __attribute__((always_inline)) record(unsigned index, uint32_t expected, uint32_t difference, VectorResult &result) {
+      if (difference != 0) {
+         if (result.failCount == 0) {
+            result.firstFailIndex    = result.vectorCount+index;
+            result.firstFailResponse = (expected^difference);
+         }
+         result.failCount++;
+      }
+   }
+
+   /**
+    * Apply a window of packed vectors
+    *
+    * @param[in]    vectors  Vectors to apply
+    * @param[in]    count    Number of vectors
+    * @param[inout] result   Result to update. Vector indices continue from result.vectorCount.
+    */
+   static void applyWindow(const PackedVector vectors[], unsigned count, VectorResult &result) {
+      for (unsigned index=0; index<count; index++) {
+         PackedVector vector   = vectors[index];
+         uint32_t     expected = static_cast<uint32_t>(vector>>STIMULUS_BITS)&RESPONSE_MASK;
+         uint32_t     mask     = static_cast<uint32_t>(vector>>(STIMULUS_BITS+RESPONSE_BITS))&RESPONSE_MASK;
+         record(index, expected, apply(static_cast<uint32_t>(vector)&STIMULUS_MASK, expected, mask), result);
+      }
+      result.vectorCount += count;
+   }
+
+public:
+   /**
+    * Configure pins used by the engine.
+    * The clock pin is taken from any other function (e.g. TPM) and driven low.
+    */
+   static void configure() {
+      StimulusField::setOutput(PinDriveStrength_High, PinSlewRate_Fast);
+      ResponseField::setInput();
+      ClockPin::setOutput(PinDriveStrength_High, PinSlewRate_Fast);
+      ClockPin::low();
+   }
+
+   /**
+    * Apply a single vector.
+    * The response is sampled at least settleCycles core clock cycles after the clock rising edge.
+    *
+    * @param[in] vector Vector to apply
+    *
+    * @return Mismatched response bits (0 => passed)
+    */
+   static uint32_t __attribute__((always_inline)) apply(const TestVector &vector) {
+      return apply(vector.stimulus, vector.expected, vector.mask);
+   }
+
+   /**
+    * Apply a block of vectors
+    *
+    * @param[in]    vectors  Vectors to apply
+    * @param[in]    count    Number of vectors
+    * @param[inout] result   Result to update. Vector indices continue from result.vectorCount.
+    */
+   static void applyBlock(const TestVector vectors[], unsigned count, VectorResult &result) {
+      for (unsigned index=0; index<count; index++) {
+         record(index, vectors[index].expected, apply(vectors[index]), result);
+      }
+      result.vectorCount += count;
+   }
+
+   /**
+    * Set callback executed each time a window has been applied and may be refilled
+    *
+    * @param[in] callback Callback function. Use nullptr to remove callback.
+    */
+   static void setWindowCallback(VectorWindowCallbackFunction callback) {
+      windowCallback = callback;
+   }
+
+   /**
+    * Enable/disable reception of vector streams.
+    * Disabling reception aborts any stream in progress.
+    *
+    * @param[in] enable True to enable, false to disable
+    */
+   static void enableReception(bool enable=true) {
+      receiveEnabled = enable;
+      if (!enable) {
+         streamError     = true;
+         rxState         = RxState_Idle;
+         windowStates[0] = WindowState_Free;
+         windowStates[1] = WindowState_Free;
+      }
+   }
+
+   /**
+    * Start reception of a vector stream.
+    * Following bytes passed to receive() are the stream header and vectors.
+    * Ignored if reception is disabled or a stream is already being received.
+    */
+   static void startStream() {
+      if (!receiveEnabled || (rxState != RxState_Idle)) {
+         return;
+      }
+      rxRemaining  = 0;
+      rxOffset     = 0;
+      rxCount      = 0;
+      rxWindow     = 0;
+      streamError  = false;
+      rxState      = RxState_Header;
+   }
+
+   /**
+    * Check if the receiver is part way through a stream
+    *
+    * @return true if received bytes should be passed to receive()
+    */
+   static bool isReceiving() {
+      return (rxState != RxState_Idle);
+   }
+
+   /**
+    * Check if a vector stream has started arriving
+    * A stream being discarded is not active.
+    *
+    * @return true if runStream() should be called
+    */
+   static bool isStreamActive() {
+      return ((rxState != RxState_Idle) && (rxState != RxState_Discard)) || (windowStates[0] != WindowState_Free);
+   }
+
+   /**
+    * Process a received byte.
+    * Usually called from the UART receive ISR.
+    *
+    * @param[in] data Byte received
+    */
+   static void receive(uint8_t data) {
+      if (!receiveEnabled) {
+         return;
+      }
+      switch(rxState) {
+         case RxState_Idle:
+            // Not part of a stream
+            break;
+         case RxState_Header:
+            rxRemaining |= static_cast<uint32_t>(data)<<(8*rxOffset++);
+            if (rxOffset < sizeof(rxRemaining)) {
+               break;
+            }
+            rxOffset = 0;
+            rxState  = RxState_Vectors;
+            if (rxRemaining == 0) {
+               publishWindow(true);
+               rxState = RxState_Idle;
+            }
+            break;
+         case RxState_Vectors:
+            if (windowStates[rxWindow] != WindowState_Free) {
+               // Sender has overrun the windows
+               // Discard the rest of the stream (including this byte) so it isn't taken as commands
+               streamError = true;
+               rxRemaining = (rxRemaining*sizeof(TestVector))-rxOffset-1;
+               rxState     = (rxRemaining == 0)?RxState_Idle:RxState_Discard;
+               break;
+            }
+            reinterpret_cast<uint8_t *>(&rxVector)[rxOffset++] = data;
+            if (rxOffset < sizeof(TestVector)) {
+               break;
+            }
+            rxOffset = 0;
+            vectorWindows[rxWindow][rxCount++] = pack(rxVector);
+            rxRemaining--;
+            if (rxRemaining == 0) {
+               publishWindow(true);
+               rxState = RxState_Idle;
+            }
+            else if (rxCount == windowSize) {
+               publishWindow(false);
+            }
+            break;
+         case RxState_Discard:
+            rxRemaining--;
+            if (rxRemaining == 0) {
+               rxState = RxState_Idle;
+            }
+            break;
+      }
+   }
+
+   /**
+    * Apply a vector stream as it arrives.
+    * Blocks until the entire stream has been applied or an error occurs.
+    *
+    * @param[out] result Result of applying vectors
+    *
+    * @return true  Stream completed
+    * @return false Stream aborted or sender overran the RAM windows
+    */
+   static bool runStream(VectorResult &result) {
+      result = {0, 0, 0, 0};
+      unsigned window = 0;
+      bool     last   = false;
+      do {
+         while (windowStates[window] == WindowState_Free) {
+            if (streamError) {
+               windowStates[0] = WindowState_Free;
+               windowStates[1] = WindowState_Free;
+               return false;
+            }
+            __asm__("nop");
+         }
+         last = (windowStates[window] == WindowState_ReadyLast);
+         applyWindow(vectorWindows[window], windowCounts[window], result);
+         windowStates[window] = WindowState_Free;
+         if (windowCallback != nullptr) {
+            windowCallback();
+         }
+         window ^= 1;
+      } while (!last);
+      return !streamError;
+   }
+};
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+typename VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::PackedVector
+   VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::vectorWindows[2][windowSize];
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+uint8_t VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::windowCounts[2];
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+volatile typename VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::WindowState
+   VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::windowStates[2] = {WindowState_Free, WindowState_Free};
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+volatile typename VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::RxState
+   VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::rxState = RxState_Idle;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+volatile bool VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::streamError = false;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+volatile bool VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::receiveEnabled = false;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+uint8_t VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::rxWindow = 0;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+uint8_t VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::rxCount = 0;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+uint8_t VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::rxOffset = 0;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+TestVector VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::rxVector;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+uint32_t VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::rxRemaining = 0;
+
+template<class StimulusField, class ResponseField, class ClockPin, unsigned windowSize, unsigned settleCycles>
+VectorWindowCallbackFunction VectorEngine_T<StimulusField, ResponseField, ClockPin, windowSize, settleCycles>::windowCallback = nullptr;
+
+} // End namespace USBDM
+
+#endif /* SOURCES_VECTORENGINE_H_ */
@@ -0,0 +1,211 @@
+/**
+ * @file    board.cpp
+ * @brief   Model of the tester board around the MKL03 - target supply, power button and host link
+ */
+#include "board.h"
+#include "peripherals.h"
+
+#include <math.h>
+#include <memory>
+
+namespace Board {
+
+using namespace Sim;
+
+/// Port and pin numbers
+static constexpr unsigned PORT_A = 0, PORT_B = 1;
+static constexpr unsigned PIN_DISCHARGE = 0;  // PTB0
+static constexpr unsigned PIN_ENABLE    = 1;  // PTB1
+static constexpr unsigned PIN_BUTTON    = 4;  // PTB4
+static constexpr unsigned PIN_RX        = 4;  // PTA4
+static constexpr unsigned PIN_LED       = 5;  // PTA5
+
+/// Time constants of target Vdd
+static constexpr double RISE_TAU      = 50e-6;   // Regulator charging the target
+static constexpr double DISCHARGE_TAU = 0.5e-3;  // Discharge transistor
+static constexpr double LOAD_TAU      = 20e-3;   // Target load only
+static constexpr double FAULT_TAU     = 5e-6;    // Short circuit
+
+/** Target Vdd at start of current segment */
+static double startVdd;
+
+/** Start of current segment */
+static Time   startTime;
+
+/** Voltage approached in current segment */
+static double targetVdd;
+
+/** Time constant of current segment (s) */
+static double tau;
+
+/** Supply collapsed by a fault */
+static bool   faultActive;
+
+static unsigned          lost;
+static std::string       received;
+static std::vector<Line> receivedLines;
+static std::vector<Change> enable, discharge, led;
+
+double vdd() {
+   double elapsed = (double)(now()-startTime)/SECOND;
+   return targetVdd+(startVdd-targetVdd)*exp(-elapsed/tau);
+}
+
+/**
+ * Start a new segment of the target Vdd curve after a change of the drive
+ */
+static void supplyChanged() {
+   startVdd  = vdd();
+   startTime = now();
+   int dischargeLevel = Pins::output(PORT_B, PIN_DISCHARGE);
+   if (faultActive) {
+      targetVdd = 0;
+      tau       = FAULT_TAU;
+   }
+   else if (Pins::output(PORT_B, PIN_ENABLE) == 1) {
+      targetVdd = VDD_NOMINAL;
+      tau       = RISE_TAU;
+   }
+   else if (dischargeLevel >= 0) {
+      targetVdd = dischargeLevel*ADC_VREF;
+      tau       = DISCHARGE_TAU;
+   }
+   else {
+      targetVdd = 0;
+      tau       = LOAD_TAU;
+   }
+}
+
+void reset() {
+   startVdd    = 0;
+   startTime   = 0;
+   targetVdd   = 0;
+   tau         = LOAD_TAU;
+   faultActive = false;
+   lost        = 0;
+   received.clear();
+   receivedLines.clear();
+   enable.clear();
+   discharge.clear();
+   led.clear();
+
+   Pins::drive(PORT_B, PIN_BUTTON, 0);
+   Pins::drive(PORT_A, PIN_RX, 1);
+   Pins::setListener([](unsigned port, unsigned pin, int output) {
+      if ((port == PORT_B) && (pin == PIN_ENABLE)) {
+         enable.push_back({now(), output});
+      }
+      else if ((port == PORT_B) && (pin == PIN_DISCHARGE)) {
+         discharge.push_back({now(), output});
+      }
+      else if ((port == PORT_A) && (pin == PIN_LED)) {
+         led.push_back({now(), output});
+         return;
+      }
+      else {
+         return;
+      }
+      supplyChanged();
+   });
+   Models::adc0.setInput([](unsigned channel) {
+      return (channel == 9)?vdd()/ADC_VREF:0.0;
+   });
+   Models::lpuart0.setTransmitter([](uint8_t data) {
+      static size_t lineStart = 0;
+      if (received.empty()) {
+         lineStart = 0;
+      }
+      if (data == '\r') {
+         // Lines end with "\n\r"
+         return;
+      }
+      received += (char)data;
+      if (data == '\n') {
+         receivedLines.push_back({now(), received.substr(lineStart, received.size()-lineStart-1)});
+         lineStart = received.size();
+      }
+   });
+}
+
+Time button(Time when, bool pressed, unsigned bounces, Random &random) {
+   Time time = when;
+   at(time, [pressed]() { Pins::drive(PORT_B, PIN_BUTTON, pressed); });
+   for (unsigned bounce=0; bounce<bounces; bounce++) {
+      time += random.range(100*US, 2*MS);
+      at(time, [pressed]() { Pins::drive(PORT_B, PIN_BUTTON, !pressed); });
+      time += random.range(100*US, 2*MS);
+      at(time, [pressed]() { Pins::drive(PORT_B, PIN_BUTTON, pressed); });
+   }
+   return time;
+}
+
+void fault(Time when, bool fault) {
+   at(when, [fault]() {
+      faultActive = fault;
+      supplyChanged();
+   });
+}
+
+Time characterTime() {
+   return cyclesToTime(10, HOST_BAUD);
+}
+
+Time send(Time when, const std::string &text) {
+   const Time bit = cyclesToTime(1, HOST_BAUD);
+   Time time = when;
+   for (char ch:text) {
+      auto accepted = std::make_shared<bool>(false);
+      at(time, [accepted]() {
+         // Start bit
+         Pins::drive(PORT_A, PIN_RX, 0);
+         *accepted = Models::lpuart0.startReceive();
+         if (*accepted) {
+            Time firmware = Models::lpuart0.characterTime();
+            if ((firmware < characterTime()*97/100) || (firmware > characterTime()*103/100)) {
+               fail("LPUART0 baud rate doesn't match the host (character %.1f us)", (double)firmware/US);
+            }
+         }
+         else {
+            lost++;
+         }
+      });
+      at(time+bit, []() {
+         // Data bits (only the falling edge of the start bit matters to the firmware)
+         Pins::drive(PORT_A, PIN_RX, 1);
+      });
+      at(time+9*bit+bit/2, [accepted, ch]() {
+         // Middle of stop bit
+         if (*accepted) {
+            Models::lpuart0.receive(ch);
+         }
+      });
+      time += characterTime();
+   }
+   return time;
+}
+
+unsigned lostCharacters() {
+   return lost;
+}
+
+const std::vector<Line> &lines() {
+   return receivedLines;
+}
+
+const std::string &output() {
+   return received;
+}
+
+const std::vector<Change> &enableChanges() {
+   return enable;
+}
+
+const std::vector<Change> &dischargeChanges() {
+   return discharge;
+}
+
+const std::vector<Change> &ledChanges() {
+   return led;
+}
+
+} // End namespace Board
@@ -0,0 +1,151 @@
+/**
+ * @file    board.h
+ * @brief   Model of the tester board around the MKL03 - target supply, power button and host link
+ *
+ *  - Target Vdd (read by ADC0_SE9 on PTB0) rises when PTB1 (TargetVddEnable) is high,
+ *    is pulled down when PTB0 (TargetVddDischarge) is a GPIO output and decays slowly
+ *    through the target load otherwise. A fault collapses it whatever the firmware does.
+ *  - The power button drives PTB4 high while pressed, with contact bounce on each change.
+ *  - The host link drives PTA4 (LPUART0_RX) and collects the characters the firmware sends.
+ */
+#ifndef FIRMWARE_SIM_BOARD_H_
+#define FIRMWARE_SIM_BOARD_H_
+
+#include <string>
+#include <vector>
+#include "simulator.h"
+
+namespace Board {
+
+using Sim::Time;
+
+/// Target Vdd when powered (V)
+constexpr double VDD_NOMINAL = 3.2;
+
+/// ADC reference (V)
+constexpr double ADC_VREF = 3.3;
+
+/// Host link baud rate
+constexpr unsigned HOST_BAUD = 115200;
+
+/**
+ * Small random number generator for bounce and scenario times (xorshift)
+ */
+class Random {
+private:
+   uint64_t state;
+
+public:
+   Random(uint64_t seed) : state(seed*0x9E3779B97F4A7C15ULL+1) {}
+
+   /** Get next random number */
+   uint32_t next() {
+      state ^= state<<13;
+      state ^= state>>7;
+      state ^= state<<17;
+      return state>>32;
+   }
+
+   /** Get random number in [minimum, maximum] */
+   uint64_t range(uint64_t minimum, uint64_t maximum) {
+      return minimum+next()%(maximum-minimum+1);
+   }
+};
+
+/**
+ * A change of an MCU output
+ */
+struct Change {
+   Time time;   //!< Time of change
+   int  level;  //!< New level (-1 => not driven)
+};
+
+/**
+ * A line received from the firmware
+ */
+struct Line {
+   Time        time;  //!< Time the newline was sent
+   std::string text;  //!< Text without the newline
+};
+
+/**
+ * Set initial state - supply discharged, button released, host link idle.
+ * Called before the firmware starts.
+ */
+void reset();
+
+/**
+ * Get target Vdd now
+ *
+ * @return Voltage (V)
+ */
+double vdd();
+
+/**
+ * Press or release the power button with contact bounce
+ *
+ * @param[in] when    Time of first contact
+ * @param[in] pressed New state
+ * @param[in] bounces Number of extra open/close pairs before the contact settles
+ * @param[in] random  Source of bounce intervals (0.1-2 ms)
+ *
+ * @return Time the contact settles
+ */
+Time button(Time when, bool pressed, unsigned bounces, Random &random);
+
+/**
+ * Collapse or restore target Vdd independently of the firmware (e.g. target short circuit)
+ *
+ * @param[in] when  Time of fault
+ * @param[in] fault true to collapse the supply
+ */
+void fault(Time when, bool fault);
+
+/**
+ * Send characters to the firmware back to back
+ *
+ * @param[in] when Time of first start bit
+ * @param[in] text Characters
+ *
+ * @return Time the last stop bit ends
+ */
+Time send(Time when, const std::string &text);
+
+/**
+ * Get time of one character on the host link
+ */
+Time characterTime();
+
+/**
+ * Get characters sent by the firmware that were lost as it was in VLPS
+ */
+unsigned lostCharacters();
+
+/**
+ * Get lines sent by the firmware
+ */
+const std::vector<Line> &lines();
+
+/**
+ * Get all characters sent by the firmware (without the carriage returns)
+ */
+const std::string &output();
+
+/**
+ * Get changes of PTB1 (TargetVddEnable)
+ */
+const std::vector<Change> &enableChanges();
+
+/**
+ * Get changes of PTB0 as a GPIO output (TargetVddDischarge)
+ */
+const std::vector<Change> &dischargeChanges();
+
+/**
+ * Get changes of PTA5 (TargetVddStatusLed)
+ */
+const std::vector<Change> &ledChanges();
+
+} // End namespace Board
+
+#endif /* FIRMWARE_SIM_BOARD_H_ */
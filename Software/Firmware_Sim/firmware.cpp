@@ -0,0 +1,8 @@
+/**
+ * @file    firmware.cpp
+ * @brief   The tester firmware (main.cpp) compiled for the simulator
+ *
+ * main() is renamed so the simulator can run it for each scenario.
+ */
+#define main firmwareMain
+#include "main.cpp"
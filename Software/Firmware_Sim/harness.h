@@ -0,0 +1,70 @@
+/**
+ * @file    harness.h
+ * @brief   Runs scenarios against the firmware from a snapshot taken once it has booted
+ *
+ * The firmware is started once. When it first enters VLPS (boot complete and idle) the
+ * process is forked for each run of each scenario. The child starts the scenario by
+ * scheduling board events and returns to the firmware. The scenario ends by calling
+ * pass() or Sim::fail() from a scheduled check.
+ *
+ * A scenario may have a prepare step that brings the firmware to a common state once
+ * (e.g. powered and protected) and calls checkpoint(). The runs are then forked from there.
+ */
+#ifndef FIRMWARE_SIM_HARNESS_H_
+#define FIRMWARE_SIM_HARNESS_H_
+
+#include "simulator.h"
+#include "board.h"
+
+namespace Harness {
+
+using Sim::Time;
+
+/**
+ * Scenario run from the booted firmware
+ */
+struct Scenario {
+   const char *name;                           //!< Name used to select scenario
+   const char *description;                    //!< Description for listing
+   void      (*prepare)();                     //!< Schedules events leading to checkpoint() (may be nullptr)
+   void      (*start)(Board::Random &random);  //!< Schedules the events and checks of a run
+};
+
+/** Scenarios that may be run (see scenarios.cpp) */
+extern const Scenario scenarios[];
+
+/** Number of entries in scenarios[] */
+extern const unsigned scenarioCount;
+
+/**
+ * Get time the current run started
+ */
+Time start();
+
+/**
+ * Get number of times the processor has entered VLPS during the current run
+ */
+unsigned vlpsEntries();
+
+/**
+ * Add a value to a statistic reported for the scenario (minimum, mean and maximum over runs)
+ *
+ * @param[in] name  Name of statistic (a string literal)
+ * @param[in] value Value from this run
+ */
+void record(const char *name, double value);
+
+/**
+ * Fork the runs of the scenario being prepared from the current state.
+ * Called from an event scheduled by Scenario::prepare.
+ */
+void checkpoint();
+
+/**
+ * End the current run successfully
+ */
+[[noreturn]] void pass();
+
+} // End namespace Harness
+
+#endif /* FIRMWARE_SIM_HARNESS_H_ */
@@ -0,0 +1,1014 @@
+/**
+ * @file    peripherals.cpp
+ * @brief   Behavioural models of the MKL03 peripherals used by the firmware
+ */
+#include "peripherals.h"
+
+#include <string.h>
+
+namespace Sim {
+
+namespace Models {
+SimModel    sim     __attribute__((init_priority(101)));
+McgModel    mcg     __attribute__((init_priority(101)));
+SmcModel    smc     __attribute__((init_priority(101)));
+RtcModel    rtc     __attribute__((init_priority(101)));
+LptmrModel  lptmr0  __attribute__((init_priority(101)));
+PortModel   porta   __attribute__((init_priority(101))) {"PORTA", PORTA_BasePtr, 0, PORTA_IRQn};
+PortModel   portb   __attribute__((init_priority(101))) {"PORTB", PORTB_BasePtr, 1, PORTB_IRQn};
+GpioModel   gpio    __attribute__((init_priority(101)));
+TpmModel    tpm0    __attribute__((init_priority(101))) {"TPM0", TPM0_BasePtr, 0, TPM0_IRQn};
+TpmModel    tpm1    __attribute__((init_priority(101))) {"TPM1", TPM1_BasePtr, 1, TPM1_IRQn};
+AdcModel    adc0    __attribute__((init_priority(101)));
+LpuartModel lpuart0 __attribute__((init_priority(101)));
+}
+
+using namespace Models;
+
+/**
+ * Get field of register
+ */
+static constexpr uint32_t field(uint32_t value, uint32_t mask) {
+   return (value&mask)/(mask&-mask);
+}
+
+/*
+ * ============================================================================
+ * Clocks
+ * ============================================================================
+ */
+
+/**
+ * Get LIRC divided by FCRDIV (LIRC_DIV1_CLK)
+ */
+static uint32_t getLircDiv1Clock() {
+   uint32_t lirc = (mcg.regs()->C2 & MCG_C2_IRCS_MASK)?8000000:2000000;
+   return lirc>>field(mcg.regs()->SC, MCG_SC_FCRDIV_MASK);
+}
+
+uint32_t getMcgOutClock() {
+   switch(field(mcg.regs()->C1, MCG_C1_CLKS_MASK)) {
+      case 0:  return HIRC_CLOCK;
+      case 1:  return getLircDiv1Clock();
+      default: fail("MCG external clock is not modelled");
+   }
+}
+
+uint32_t getBusClock() {
+   return getCoreClock()/sim.getBusDivider();
+}
+
+uint32_t getMcgIrClock() {
+   if ((mcg.regs()->C1 & MCG_C1_IRCLKEN_MASK) == 0) {
+      return 0;
+   }
+   return getLircDiv1Clock()>>field(mcg.regs()->MC, MCG_MC_LIRC_DIV2_MASK);
+}
+
+uint32_t getMcgPClock() {
+   if ((mcg.regs()->MC & MCG_MC_HIRCEN_MASK) || (field(mcg.regs()->C1, MCG_C1_CLKS_MASK) == 0)) {
+      return HIRC_CLOCK;
+   }
+   return 0;
+}
+
+uint32_t getErc32kClock() {
+   return (field(sim.regs()->SOPT1, SIM_SOPT1_OSC32KSEL_MASK) == 3)?LPO_CLOCK:0;
+}
+
+uint32_t getPeripheralClock(unsigned select) {
+   switch(select) {
+      case 1:  return getMcgPClock();
+      case 3:  return getMcgIrClock();
+      default: return 0;
+   }
+}
+
+/*
+ * ============================================================================
+ * SIM, MCG, SMC
+ * ============================================================================
+ */
+
+void SimModel::reset() {
+   memset(regs(), 0, sizeof(SIM_Type));
+   regs()->CLKDIV1 = SIM_CLKDIV1_OUTDIV4(1);
+   regs()->COPC    = 0x0C;
+}
+
+void SimModel::written(uint32_t offset, uint32_t previous) {
+   (void)previous;
+   switch(offset) {
+      case offsetof(SIM_Type, CLKDIV1):
+         coreClockChanged();
+         break;
+      case offsetof(SIM_Type, SOPT7):
+         tpm0.schedule();
+         tpm1.schedule();
+         break;
+   }
+}
+
+unsigned SimModel::getCoreDivider() const {
+   return field(regs()->CLKDIV1, SIM_CLKDIV1_OUTDIV1_MASK)+1;
+}
+
+unsigned SimModel::getBusDivider() const {
+   return field(regs()->CLKDIV1, SIM_CLKDIV1_OUTDIV4_MASK)+1;
+}
+
+void McgModel::reset() {
+   memset(regs(), 0, sizeof(MCG_Type));
+   regs()->C1 = MCG_C1_CLKS(1);
+   regs()->C2 = MCG_C2_IRCS(1);
+   regs()->S  = MCG_S_CLKST(1);
+}
+
+void McgModel::written(uint32_t offset, uint32_t previous) {
+   (void)offset;
+   (void)previous;
+   regs()->S = MCG_S_CLKST(field(regs()->C1, MCG_C1_CLKS_MASK));
+   coreClockChanged();
+}
+
+void SmcModel::reset() {
+   memset(regs(), 0, sizeof(SMC_Type));
+   regs()->PMSTAT = 1;  // RUN
+}
+
+void SmcModel::written(uint32_t offset, uint32_t previous) {
+   if (offset == offsetof(SMC_Type, PMCTRL)) {
+      // STOPA is read-only
+      uint8_t stopa = (previous>>8) & SMC_PMCTRL_STOPA_MASK;
+      regs()->PMCTRL = (regs()->PMCTRL & ~SMC_PMCTRL_STOPA_MASK)|stopa;
+   }
+   if (offset == offsetof(SMC_Type, PMSTAT)) {
+      regs()->PMSTAT = previous>>24;
+   }
+}
+
+bool SmcModel::isVlpsSelected() const {
+   return field(regs()->PMCTRL, SMC_PMCTRL_STOPM_MASK) == 2;
+}
+
+void SmcModel::setStopAborted(bool aborted) {
+   if (aborted) {
+      regs()->PMCTRL = regs()->PMCTRL | SMC_PMCTRL_STOPA_MASK;
+   }
+   else {
+      regs()->PMCTRL = regs()->PMCTRL & ~SMC_PMCTRL_STOPA_MASK;
+   }
+}
+
+/*
+ * ============================================================================
+ * RTC
+ * ============================================================================
+ */
+
+void RtcModel::reset() {
+   memset(regs(), 0, sizeof(RTC_Type));
+   regs()->SR  = RTC_SR_TIF_MASK;
+   regs()->LR  = 0xFF;
+   regs()->IER = RTC_IER_TIIE_MASK|RTC_IER_TOIE_MASK|RTC_IER_TAIE_MASK;
+}
+
+uint64_t RtcModel::counts() const {
+   uint32_t clock = getErc32kClock();
+   if (clock == 0) {
+      fail("RTC only modelled with ERCLK32K from the LPO");
+   }
+   return clocks(clock, Domain_Always)-(uint64_t)(((unsigned __int128)startTime*clock)/SECOND);
+}
+
+void RtcModel::update(uint32_t offset) {
+   (void)offset;
+   if ((regs()->SR & RTC_SR_TCE_MASK) == 0) {
+      return;
+   }
+   // TSR increments each time the 15-bit prescaler overflows
+   uint64_t total = startPrescaler+counts();
+   regs()->TPR = total & 0xFFFF;
+   regs()->TSR = startSeconds+(total>>15)-(startPrescaler>>15);
+}
+
+void RtcModel::written(uint32_t offset, uint32_t previous) {
+   bool counting = (previous & RTC_SR_TCE_MASK) != 0;
+   switch(offset) {
+      case offsetof(RTC_Type, TSR):
+      case offsetof(RTC_Type, TPR):
+         if (counting) {
+            // Not writable while counting
+            (offset == offsetof(RTC_Type, TSR)?regs()->TSR:regs()->TPR) = previous;
+         }
+         else if (offset == offsetof(RTC_Type, TSR)) {
+            regs()->SR = regs()->SR & ~(RTC_SR_TIF_MASK|RTC_SR_TOF_MASK);
+         }
+         break;
+      case offsetof(RTC_Type, SR): {
+         // Flags are read-only
+         const uint32_t flags = RTC_SR_TIF_MASK|RTC_SR_TOF_MASK|RTC_SR_TAF_MASK;
+         regs()->SR = (regs()->SR & ~flags)|(previous & flags);
+         bool start = (regs()->SR & RTC_SR_TCE_MASK) != 0;
+         if (start && !counting) {
+            if (regs()->SR & RTC_SR_TIF_MASK) {
+               // Counter doesn't start while time is invalid
+               regs()->SR = regs()->SR & ~RTC_SR_TCE_MASK;
+               break;
+            }
+            startTime      = now();
+            startPrescaler = regs()->TPR & 0xFFFF;
+            startSeconds   = regs()->TSR;
+         }
+         break;
+      }
+   }
+}
+
+bool RtcModel::irqRequest(IRQn_Type irqNum) {
+   (void)irqNum;
+   return (regs()->SR & regs()->IER & (RTC_SR_TIF_MASK|RTC_SR_TOF_MASK|RTC_SR_TAF_MASK)) != 0;
+}
+
+/*
+ * ============================================================================
+ * LPTMR
+ * ============================================================================
+ */
+
+LptmrModel::LptmrModel() :
+      Peripheral("LPTMR0", LPTMR0_BasePtr, sizeof(LPTMR_Type)),
+      compare(Domain_Always, [this]() {
+         regs()->CSR = regs()->CSR | LPTMR_CSR_TCF_MASK;
+         schedule();
+      }) {
+   ownIrq(LPTMR0_IRQn);
+}
+
+void LptmrModel::reset() {
+   memset(regs(), 0, sizeof(LPTMR_Type));
+   compare.cancel();
+}
+
+uint32_t LptmrModel::frequency() const {
+   uint32_t psr = regs()->PSR;
+   uint32_t clock;
+   switch(field(psr, LPTMR_PSR_PCS_MASK)) {
+      case 0:  clock = getMcgIrClock();  break;
+      case 1:  clock = LPO_CLOCK;        break;
+      case 2:  clock = getErc32kClock(); break;
+      default: clock = 0;                break;
+   }
+   if (clock == 0) {
+      fail("LPTMR clock source %u not modelled or disabled", (unsigned)field(psr, LPTMR_PSR_PCS_MASK));
+   }
+   if (psr & LPTMR_PSR_PBYP_MASK) {
+      return clock;
+   }
+   return clock>>(field(psr, LPTMR_PSR_PRESCALE_MASK)+1);
+}
+
+uint64_t LptmrModel::counts() const {
+   return (uint64_t)(((unsigned __int128)(now()-startTime)*frequency())/SECOND);
+}
+
+void LptmrModel::schedule() {
+   // TCF is set when the counter equals the compare value and increments
+   uint32_t period = (regs()->CMR & 0xFFFF)+1;
+   uint64_t count  = counts();
+   uint64_t next;
+   if (regs()->CSR & LPTMR_CSR_TFC_MASK) {
+      // Free running - counter wraps at 16 bits
+      next = (count/0x10000)*0x10000+period;
+      if (next <= count) {
+         next += 0x10000;
+      }
+   }
+   else {
+      // Counter resets on compare
+      next = (count/period+1)*period;
+   }
+   compare.at(startTime+cyclesToTime(next, frequency()));
+}
+
+void LptmrModel::update(uint32_t offset) {
+   if ((offset == offsetof(LPTMR_Type, CNR)) && (regs()->CSR & LPTMR_CSR_TEN_MASK)) {
+      uint64_t count = counts();
+      if ((regs()->CSR & LPTMR_CSR_TFC_MASK) == 0) {
+         count %= (regs()->CMR & 0xFFFF)+1;
+      }
+      regs()->CNR = count & 0xFFFF;
+   }
+}
+
+void LptmrModel::written(uint32_t offset, uint32_t previous) {
+   if (offset != offsetof(LPTMR_Type, CSR)) {
+      if ((offset == offsetof(LPTMR_Type, CMR)) && compare.isScheduled()) {
+         schedule();
+      }
+      return;
+   }
+   uint32_t csr = regs()->CSR;
+   // TCF is write-1-to-clear
+   uint32_t tcf = previous & ~csr & LPTMR_CSR_TCF_MASK;
+   if ((csr & LPTMR_CSR_TEN_MASK) == 0) {
+      // Disabled - counter and flag reset
+      tcf = 0;
+      regs()->CNR = 0;
+      compare.cancel();
+   }
+   regs()->CSR = (csr & ~LPTMR_CSR_TCF_MASK)|tcf;
+   if ((csr & LPTMR_CSR_TEN_MASK) && !(previous & LPTMR_CSR_TEN_MASK)) {
+      if (csr & LPTMR_CSR_TMS_MASK) {
+         fail("LPTMR pulse counter mode is not modelled");
+      }
+      // The prescaler clock runs freely so the first count is at its next edge
+      uint32_t clock = frequency();
+      startTime = (Time)(((unsigned __int128)clocks(clock, Domain_Always)*SECOND)/clock);
+      schedule();
+   }
+}
+
+bool LptmrModel::irqRequest(IRQn_Type irqNum) {
+   (void)irqNum;
+   uint32_t csr = regs()->CSR;
+   return (csr & LPTMR_CSR_TIE_MASK) && (csr & LPTMR_CSR_TCF_MASK);
+}
+
+/*
+ * ============================================================================
+ * Pins, PORT and GPIO
+ * ============================================================================
+ */
+
+/** Levels driven by the board (-1 => not driven) */
+static int8_t boardDrive[Pins::PORTS][32];
+
+/** Last pin levels */
+static bool pinLevels[Pins::PORTS][32];
+
+/** Last MCU outputs */
+static int8_t mcuOutputs[Pins::PORTS][32];
+
+/** Listener for MCU output changes */
+static std::function<void(unsigned port, unsigned pin, int output)> outputListener;
+
+/**
+ * Get PORT model of port
+ */
+static PortModel &portModel(unsigned port) {
+   return (port == 0)?porta:portb;
+}
+
+void Pins::reset() {
+   memset(boardDrive, -1, sizeof(boardDrive));
+   memset(pinLevels,  0,  sizeof(pinLevels));
+   memset(mcuOutputs, -1, sizeof(mcuOutputs));
+}
+
+void Pins::drive(unsigned port, unsigned pin, int level) {
+   boardDrive[port][pin] = level;
+   update();
+}
+
+int Pins::output(unsigned port, unsigned pin) {
+   uint32_t pcr = portModel(port).regs()->PCR[pin];
+   const GPIO_Type *gpioRegs = gpio.regs(port);
+   if ((field(pcr, PORT_PCR_MUX_MASK) != 1) || !(gpioRegs->PDDR & (1U<<pin))) {
+      return -1;
+   }
+   return (gpioRegs->PDOR>>pin)&1;
+}
+
+bool Pins::level(unsigned port, unsigned pin) {
+   int drive = output(port, pin);
+   if (drive >= 0) {
+      return drive;
+   }
+   if (boardDrive[port][pin] >= 0) {
+      return boardDrive[port][pin];
+   }
+   uint32_t pcr = portModel(port).regs()->PCR[pin];
+   return (pcr & PORT_PCR_PE_MASK) && (pcr & PORT_PCR_PS_MASK);
+}
+
+void Pins::update() {
+   for (unsigned port=0; port<PORTS; port++) {
+      for (unsigned pin=0; pin<32; pin++) {
+         int drive = output(port, pin);
+         if (drive != mcuOutputs[port][pin]) {
+            mcuOutputs[port][pin] = drive;
+            if (outputListener) {
+               outputListener(port, pin, drive);
+            }
+         }
+         bool newLevel = level(port, pin);
+         if (newLevel != pinLevels[port][pin]) {
+            pinLevels[port][pin] = newLevel;
+            portModel(port).pinChanged(pin, newLevel);
+         }
+      }
+   }
+}
+
+void Pins::setListener(std::function<void(unsigned port, unsigned pin, int output)> listener) {
+   outputListener = listener;
+}
+
+void PortModel::reset() {
+   memset(regs(), 0, sizeof(PORT_Type));
+   if (fPort == 0) {
+      // SWD and RESET pins
+      regs()->PCR[0] = PORT_PCR_MUX(3)|PORT_PCR_PE_MASK;
+      regs()->PCR[1] = PORT_PCR_MUX(3)|PORT_PCR_PE_MASK|PORT_PCR_PS_MASK;
+      regs()->PCR[2] = PORT_PCR_MUX(3)|PORT_PCR_PE_MASK|PORT_PCR_PS_MASK;
+   }
+}
+
+void PortModel::update(uint32_t offset) {
+   if (offset == offsetof(PORT_Type, ISFR)) {
+      uint32_t isfr = 0;
+      for (unsigned pin=0; pin<32; pin++) {
+         if (regs()->PCR[pin] & PORT_PCR_ISF_MASK) {
+            isfr |= 1U<<pin;
+         }
+      }
+      regs()->ISFR = isfr;
+   }
+}
+
+void PortModel::written(uint32_t offset, uint32_t previous) {
+   PORT_Type *port = regs();
+   if (offset < offsetof(PORT_Type, GPCLR)) {
+      // PCR - ISF is write-1-to-clear
+      unsigned pin = offset/4;
+      uint32_t isf = previous & ~port->PCR[pin] & PORT_PCR_ISF_MASK;
+      port->PCR[pin] = (port->PCR[pin] & ~PORT_PCR_ISF_MASK)|isf;
+   }
+   else if ((offset == offsetof(PORT_Type, GPCLR)) || (offset == offsetof(PORT_Type, GPCHR))) {
+      uint32_t value = (offset == offsetof(PORT_Type, GPCLR))?port->GPCLR:port->GPCHR;
+      unsigned first = (offset == offsetof(PORT_Type, GPCLR))?0:16;
+      for (unsigned pin=0; pin<16; pin++) {
+         if (value & (1U<<(pin+16))) {
+            port->PCR[first+pin] = (port->PCR[first+pin] & 0xFFFF0000)|(value & 0xFFFF);
+         }
+      }
+      port->GPCLR = 0;
+      port->GPCHR = 0;
+   }
+   else if (offset == offsetof(PORT_Type, ISFR)) {
+      uint32_t clear = port->ISFR;
+      for (unsigned pin=0; pin<32; pin++) {
+         if (clear & (1U<<pin)) {
+            port->PCR[pin] = port->PCR[pin] & ~PORT_PCR_ISF_MASK;
+         }
+      }
+      update(offset);
+   }
+   Pins::update();
+}
+
+void PortModel::pinChanged(unsigned pin, bool level) {
+   uint32_t pcr = regs()->PCR[pin];
+   if (field(pcr, PORT_PCR_MUX_MASK) == 0) {
+      // Digital input disabled
+      return;
+   }
+   bool set;
+   switch(field(pcr, PORT_PCR_IRQC_MASK)) {
+      case 0x8:  set = !level; break;  // Logic 0
+      case 0x9:  set = level;  break;  // Rising
+      case 0xA:  set = !level; break;  // Falling
+      case 0xB:  set = true;   break;  // Either
+      case 0xC:  set = level;  break;  // Logic 1
+      default:   set = false;  break;
+   }
+   if (set) {
+      regs()->PCR[pin] = pcr|PORT_PCR_ISF_MASK;
+   }
+}
+
+bool PortModel::irqRequest(IRQn_Type irqNum) {
+   (void)irqNum;
+   const PORT_Type *port = regs();
+   for (unsigned pin=0; pin<32; pin++) {
+      uint32_t pcr = port->PCR[pin];
+      if ((pcr & PORT_PCR_ISF_MASK) && (field(pcr, PORT_PCR_IRQC_MASK) >= 8)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void GpioModel::reset() {
+   memset(regs(0), 0, fSize);
+   Pins::reset();
+}
+
+void GpioModel::update(uint32_t offset) {
+   if ((offset%0x40) == offsetof(GPIO_Type, PDIR)) {
+      unsigned port = offset/0x40;
+      uint32_t pdir = 0;
+      for (unsigned pin=0; pin<32; pin++) {
+         if ((field(portModel(port).regs()->PCR[pin], PORT_PCR_MUX_MASK) != 0) && Pins::level(port, pin)) {
+            pdir |= 1U<<pin;
+         }
+      }
+      regs(port)->PDIR = pdir;
+   }
+}
+
+void GpioModel::written(uint32_t offset, uint32_t previous) {
+   (void)previous;
+   GPIO_Type *gpioRegs = regs(offset/0x40);
+   switch(offset%0x40) {
+      case offsetof(GPIO_Type, PSOR):
+         gpioRegs->PDOR = gpioRegs->PDOR | gpioRegs->PSOR;
+         break;
+      case offsetof(GPIO_Type, PCOR):
+         gpioRegs->PDOR = gpioRegs->PDOR & ~gpioRegs->PCOR;
+         break;
+      case offsetof(GPIO_Type, PTOR):
+         gpioRegs->PDOR = gpioRegs->PDOR ^ gpioRegs->PTOR;
+         break;
+   }
+   // Set, clear and toggle registers read as zero
+   gpioRegs->PSOR = 0;
+   gpioRegs->PCOR = 0;
+   gpioRegs->PTOR = 0;
+   Pins::update();
+}
+
+/*
+ * ============================================================================
+ * TPM
+ * ============================================================================
+ */
+
+TpmModel::TpmModel(const char *name, uint32_t base, unsigned index, IRQn_Type irqNum) :
+      Peripheral(name, base, sizeof(TPM_Type)),
+      fIndex(index),
+      overflow(Domain_Bus, [this]() {
+         adc0.trigger(fIndex);
+         schedule();
+      }) {
+   ownIrq(irqNum);
+}
+
+void TpmModel::reset() {
+   memset(regs(), 0, sizeof(TPM_Type));
+   regs()->MOD = 0xFFFF;
+   overflow.cancel();
+   clearedOverflows = 0;
+}
+
+bool TpmModel::isRunning() const {
+   return (field(regs()->SC, TPM_SC_CMOD_MASK) == 1) && (clock != 0);
+}
+
+uint64_t TpmModel::ticks() const {
+   if (!isRunning()) {
+      return 0;
+   }
+   return clocks(clock, Domain_Bus)-(uint64_t)(((unsigned __int128)startTime*clock)/SECOND);
+}
+
+uint64_t TpmModel::overflows() const {
+   return (startCount+ticks())/((regs()->MOD & 0xFFFF)+1);
+}
+
+void TpmModel::restart() {
+   uint32_t period = (regs()->MOD & 0xFFFF)+1;
+   startCount = (startCount+ticks())%period;
+   startTime  = now(Domain_Bus);
+   clearedOverflows = 0;
+   uint32_t sc = regs()->SC;
+   clock = 0;
+   if (field(sc, TPM_SC_CMOD_MASK) == 1) {
+      clock = getPeripheralClock(field(sim.regs()->SOPT2, SIM_SOPT2_TPMSRC_MASK))>>field(sc, TPM_SC_PS_MASK);
+      if (clock == 0) {
+         fail("%s counter clock not modelled or disabled", fName);
+      }
+   }
+   else if (field(sc, TPM_SC_CMOD_MASK) != 0) {
+      fail("%s external clock is not modelled", fName);
+   }
+   schedule();
+}
+
+void TpmModel::schedule() {
+   overflow.cancel();
+   if (!isRunning() || !adc0.isTriggeredBy(fIndex)) {
+      // Overflow flag is calculated when read
+      return;
+   }
+   uint32_t period = (regs()->MOD & 0xFFFF)+1;
+   uint64_t next   = (overflows()+1)*period-startCount;
+   overflow.at(startTime+cyclesToTime(next, clock));
+}
+
+void TpmModel::update(uint32_t offset) {
+   (void)offset;
+   if (isRunning()) {
+      uint32_t period = (regs()->MOD & 0xFFFF)+1;
+      regs()->CNT = (startCount+ticks())%period;
+   }
+   if (overflows() > clearedOverflows) {
+      regs()->SC     = regs()->SC | TPM_SC_TOF_MASK;
+      regs()->STATUS = regs()->STATUS | TPM_STATUS_TOF_MASK;
+   }
+}
+
+void TpmModel::written(uint32_t offset, uint32_t previous) {
+   TPM_Type *tpm = regs();
+   switch(offset) {
+      case offsetof(TPM_Type, SC): {
+         // TOF is write-1-to-clear
+         bool clear = (tpm->SC & TPM_SC_TOF_MASK) != 0;
+         tpm->SC = (tpm->SC & ~TPM_SC_TOF_MASK)|(clear?0:(previous & TPM_SC_TOF_MASK));
+         if (clear) {
+            clearedOverflows = overflows();
+            tpm->STATUS = tpm->STATUS & ~TPM_STATUS_TOF_MASK;
+         }
+         if ((tpm->SC ^ previous) & (TPM_SC_CMOD_MASK|TPM_SC_PS_MASK)) {
+            restart();
+         }
+         break;
+      }
+      case offsetof(TPM_Type, CNT):
+         // Any write clears the counter
+         tpm->CNT   = 0;
+         startCount = 0;
+         startTime  = now(Domain_Bus);
+         clearedOverflows = 0;
+         schedule();
+         break;
+      case offsetof(TPM_Type, MOD):
+         restart();
+         break;
+      case offsetof(TPM_Type, STATUS): {
+         uint32_t clear = tpm->STATUS;
+         tpm->STATUS = previous & ~clear;
+         if (clear & TPM_STATUS_TOF_MASK) {
+            clearedOverflows = overflows();
+            tpm->SC = tpm->SC & ~TPM_SC_TOF_MASK;
+         }
+         break;
+      }
+   }
+}
+
+bool TpmModel::irqRequest(IRQn_Type irqNum) {
+   (void)irqNum;
+   if ((regs()->SC & TPM_SC_TOIE_MASK) == 0) {
+      return false;
+   }
+   if (!overflow.isScheduled() && isRunning()) {
+      fail("%s overflow interrupt is not modelled", fName);
+   }
+   return overflows() > clearedOverflows;
+}
+
+/*
+ * ============================================================================
+ * ADC
+ * ============================================================================
+ */
+
+/** Voltage of each channel as a fraction of the reference */
+static std::function<double(unsigned channel)> adcInput;
+
+AdcModel::AdcModel() :
+      Peripheral("ADC0", ADC0_BasePtr, sizeof(ADC_Type)),
+      conversion(Domain_Bus, [this]() {
+         complete();
+      }) {
+   ownIrq(ADC0_IRQn);
+}
+
+void AdcModel::setInput(std::function<double(unsigned channel)> input) {
+   adcInput = input;
+}
+
+void AdcModel::reset() {
+   memset(regs(), 0, sizeof(ADC_Type));
+   regs()->SC1[0] = ADC_SC1_ADCH(0x1F);
+   regs()->SC1[1] = ADC_SC1_ADCH(0x1F);
+   regs()->PG     = 0x8200;
+   regs()->CV1    = 0;
+   conversion.cancel();
+   calibrating = false;
+}
+
+uint32_t AdcModel::adck() const {
+   uint32_t clock;
+   switch(field(regs()->CFG1, ADC_CFG1_ADICLK_MASK)) {
+      case 0:  clock = getBusClock();   break;
+      case 1:  clock = getBusClock()/2; break;
+      case 3:  clock = (regs()->CFG2 & ADC_CFG2_ADHSC_MASK)?6100000:3300000; break; // ADACK typical
+      default: fail("ADC ALTCLK is not modelled");
+   }
+   return clock>>field(regs()->CFG1, ADC_CFG1_ADIV_MASK);
+}
+
+void AdcModel::start(unsigned index, bool first) {
+   ADC_Type *adc = regs();
+   converting = index;
+
+   // Conversion time in ADCK cycles (single-ended, see reference manual)
+   static const unsigned baseTimes[]    = {17, 20, 20, 25};  // MODE: 8, 12, 10, 16-bit
+   static const unsigned longSamples[]  = {20, 12, 6, 2};    // ADLSTS
+   unsigned cycles = baseTimes[field(adc->CFG1, ADC_CFG1_MODE_MASK)];
+   if (adc->CFG1 & ADC_CFG1_ADLSMP_MASK) {
+      cycles += longSamples[field(adc->CFG2, ADC_CFG2_ADLSTS_MASK)];
+   }
+   if (adc->CFG2 & ADC_CFG2_ADHSC_MASK) {
+      cycles += 2;
+   }
+   if (adc->SC3 & ADC_SC3_AVGE_MASK) {
+      cycles <<= field(adc->SC3, ADC_SC3_AVGS_MASK)+2;
+   }
+   Time time = cyclesToTime(cycles, adck());
+   if (first) {
+      // Single or first continuous conversion adder
+      time += cyclesToTime(3, adck())+cyclesToTime(5, getBusClock());
+   }
+   adc->SC2 = adc->SC2 | ADC_SC2_ADACT_MASK;
+   conversion.after(time);
+}
+
+void AdcModel::abort() {
+   conversion.cancel();
+   calibrating = false;
+   regs()->SC2 = regs()->SC2 & ~ADC_SC2_ADACT_MASK;
+}
+
+void AdcModel::complete() {
+   ADC_Type *adc = regs();
+   adc->SC2 = adc->SC2 & ~ADC_SC2_ADACT_MASK;
+   if (calibrating) {
+      calibrating = false;
+      adc->SC3    = adc->SC3 & ~(ADC_SC3_CAL_MASK|ADC_SC3_CALF_MASK);
+      // Typical calibration values
+      adc->CLPD = 0x0A; adc->CLPS = 0x20; adc->CLP4 = 0x200;
+      adc->CLP3 = 0x100; adc->CLP2 = 0x80; adc->CLP1 = 0x40; adc->CLP0 = 0x20;
+      adc->SC1[0] = adc->SC1[0] | ADC_SC1_COCO_MASK;
+      return;
+   }
+   conversions++;
+
+   static const unsigned bits[] = {8, 12, 10, 16};
+   unsigned index   = converting;
+   unsigned channel = field(adc->SC1[index], ADC_SC1_ADCH_MASK);
+   double   input   = adcInput?adcInput(channel):0.0;
+   uint32_t maximum = (1U<<bits[field(adc->CFG1, ADC_CFG1_MODE_MASK)])-1;
+   uint32_t result  = (input <= 0.0)?0:(input >= 1.0)?maximum:(uint32_t)(input*maximum+0.5);
+
+   bool store = true;
+   if (adc->SC2 & ADC_SC2_ACFE_MASK) {
+      // Compare function
+      uint32_t cv1 = adc->CV1 & 0xFFFF;
+      uint32_t cv2 = adc->CV2 & 0xFFFF;
+      bool greater = (adc->SC2 & ADC_SC2_ACFGT_MASK) != 0;
+      if (adc->SC2 & ADC_SC2_ACREN_MASK) {
+         // Range: inside (CV1 <= CV2) or outside (CV1 > CV2), inclusive when ACFGT
+         if (cv1 <= cv2) {
+            bool inside = (result >= cv1) && (result <= cv2);
+            store = greater?inside:!inside;
+         }
+         else {
+            bool outside = (result >= cv1) || (result <= cv2);
+            store = greater?outside:!outside;
+         }
+      }
+      else {
+         store = greater?(result >= cv1):(result < cv1);
+      }
+   }
+   if (store) {
+      adc->R[index] = result;
+      adc->SC1[index] = adc->SC1[index] | ADC_SC1_COCO_MASK;
+   }
+   if (adc->SC3 & ADC_SC3_ADCO_MASK) {
+      start(index, false);
+   }
+}
+
+void AdcModel::read(uint32_t offset) {
+   if ((offset == offsetof(ADC_Type, R[0])) || (offset == offsetof(ADC_Type, R[1]))) {
+      unsigned index = (offset-offsetof(ADC_Type, R[0]))/4;
+      regs()->SC1[index] = regs()->SC1[index] & ~ADC_SC1_COCO_MASK;
+   }
+}
+
+void AdcModel::written(uint32_t offset, uint32_t previous) {
+   ADC_Type *adc = regs();
+   switch(offset) {
+      case offsetof(ADC_Type, SC1[0]):
+      case offsetof(ADC_Type, SC1[1]): {
+         // COCO is read-only and cleared by the write
+         unsigned index = offset/4;
+         adc->SC1[index] = adc->SC1[index] & ~ADC_SC1_COCO_MASK;
+         if ((index == 0) || (converting == index)) {
+            abort();
+         }
+         if ((index == 0) && !(adc->SC2 & ADC_SC2_ADTRG_MASK) &&
+             (field(adc->SC1[0], ADC_SC1_ADCH_MASK) != 0x1F)) {
+            start(0, true);
+         }
+         break;
+      }
+      case offsetof(ADC_Type, SC3):
+         // CALF is write-1-to-clear
+         adc->SC3 = (adc->SC3 & ~ADC_SC3_CALF_MASK)|(previous & ~adc->SC3 & ADC_SC3_CALF_MASK);
+         abort();
+         if (adc->SC3 & ADC_SC3_CAL_MASK) {
+            calibrating = true;
+            adc->SC3 = adc->SC3 & ~ADC_SC3_CALF_MASK;
+            adc->SC2 = adc->SC2 | ADC_SC2_ADACT_MASK;
+            conversion.after(cyclesToTime(3500, adck()));
+         }
+         break;
+      case offsetof(ADC_Type, SC2):
+         // ADACT is read-only
+         adc->SC2 = (adc->SC2 & ~ADC_SC2_ADACT_MASK)|(previous & ADC_SC2_ADACT_MASK);
+         abort();
+         tpm0.schedule();
+         tpm1.schedule();
+         break;
+      case offsetof(ADC_Type, CFG1):
+      case offsetof(ADC_Type, CFG2):
+         abort();
+         break;
+      case offsetof(ADC_Type, R[0]):
+      case offsetof(ADC_Type, R[1]):
+         // Read-only
+         *reinterpret_cast<volatile uint32_t *>(registers(fBase+offset)) = previous;
+         break;
+   }
+}
+
+bool AdcModel::isTriggeredBy(unsigned tpm) const {
+   uint32_t sopt7 = sim.regs()->SOPT7;
+   return (regs()->SC2 & ADC_SC2_ADTRG_MASK) &&
+          (sopt7 & SIM_SOPT7_ADC0ALTTRGEN_MASK) &&
+          (field(sopt7, SIM_SOPT7_ADC0TRGSEL_MASK) == 8+tpm);
+}
+
+void AdcModel::trigger(unsigned tpm) {
+   if (!isTriggeredBy(tpm) || conversion.isScheduled()) {
+      // Triggers are ignored while converting
+      return;
+   }
+   unsigned index = field(sim.regs()->SOPT7, SIM_SOPT7_ADC0PRETRGSEL_MASK);
+   if (field(regs()->SC1[index], ADC_SC1_ADCH_MASK) == 0x1F) {
+      return;
+   }
+   start(index, true);
+}
+
+bool AdcModel::irqRequest(IRQn_Type irqNum) {
+   (void)irqNum;
+   for (unsigned index=0; index<2; index++) {
+      uint32_t sc1 = regs()->SC1[index];
+      if ((sc1 & ADC_SC1_AIEN_MASK) && (sc1 & ADC_SC1_COCO_MASK)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+/*
+ * ============================================================================
+ * LPUART
+ * ============================================================================
+ */
+
+/** Status flags that are write-1-to-clear */
+static constexpr uint32_t LPUART_STAT_W1C =
+      LPUART_STAT_LBKDIF_MASK|LPUART_STAT_RXEDGIF_MASK|LPUART_STAT_IDLE_MASK|LPUART_STAT_OR_MASK|
+      LPUART_STAT_NF_MASK|LPUART_STAT_FE_MASK|LPUART_STAT_PF_MASK|LPUART_STAT_MA1F_MASK|LPUART_STAT_MA2F_MASK;
+
+/** Status flags that are read-only */
+static constexpr uint32_t LPUART_STAT_RO =
+      LPUART_STAT_RAF_MASK|LPUART_STAT_TDRE_MASK|LPUART_STAT_TC_MASK|LPUART_STAT_RDRF_MASK;
+
+LpuartModel::LpuartModel() :
+      Peripheral("LPUART0", LPUART0_BasePtr, sizeof(LPUART_Type)),
+      sent(Domain_Bus, [this]() {
+         if (fTransmit) {
+            fTransmit(shifter);
+         }
+         if (buffered) {
+            buffered = false;
+            regs()->STAT = regs()->STAT | LPUART_STAT_TDRE_MASK;
+            send(buffer);
+         }
+         else {
+            shifting = false;
+            regs()->STAT = regs()->STAT | LPUART_STAT_TC_MASK;
+         }
+      }) {
+   ownIrq(LPUART0_IRQn);
+}
+
+void LpuartModel::reset() {
+   memset(regs(), 0, sizeof(LPUART_Type));
+   regs()->BAUD = LPUART_BAUD_OSR(15)|LPUART_BAUD_SBR(4);
+   regs()->STAT = LPUART_STAT_TDRE_MASK|LPUART_STAT_TC_MASK;
+   shifting = false;
+   buffered = false;
+   sent.cancel();
+}
+
+Time LpuartModel::characterTime() const {
+   uint32_t baud  = regs()->BAUD;
+   uint32_t clock = getPeripheralClock(field(sim.regs()->SOPT2, SIM_SOPT2_LPUART0SRC_MASK));
+   if (clock == 0) {
+      fail("LPUART0 clock not modelled or disabled");
+   }
+   uint64_t clocksPerBit = (uint64_t)field(baud, LPUART_BAUD_SBR_MASK)*(field(baud, LPUART_BAUD_OSR_MASK)+1);
+   return cyclesToTime(10*clocksPerBit, clock);
+}
+
+void LpuartModel::send(uint8_t data) {
+   shifting = true;
+   shifter  = data;
+   regs()->STAT = regs()->STAT & ~LPUART_STAT_TC_MASK;
+   sent.after(characterTime());
+}
+
+bool LpuartModel::startReceive() {
+   if ((getPowerMode() == PowerMode_VLPS) || !(regs()->CTRL & LPUART_CTRL_RE_MASK)) {
+      return false;
+   }
+   regs()->STAT = regs()->STAT | LPUART_STAT_RAF_MASK;
+   return true;
+}
+
+void LpuartModel::receive(uint8_t data) {
+   LPUART_Type *lpuart = regs();
+   lpuart->STAT = lpuart->STAT & ~LPUART_STAT_RAF_MASK;
+   if (lpuart->STAT & LPUART_STAT_RDRF_MASK) {
+      lpuart->STAT = lpuart->STAT | LPUART_STAT_OR_MASK;
+      return;
+   }
+   received = data;
+   lpuart->STAT = lpuart->STAT | LPUART_STAT_RDRF_MASK;
+}
+
+void LpuartModel::update(uint32_t offset) {
+   if (offset == offsetof(LPUART_Type, DATA)) {
+      regs()->DATA = received;
+   }
+}
+
+void LpuartModel::read(uint32_t offset) {
+   if (offset == offsetof(LPUART_Type, DATA)) {
+      regs()->STAT = regs()->STAT & ~LPUART_STAT_RDRF_MASK;
+   }
+}
+
+void LpuartModel::written(uint32_t offset, uint32_t previous) {
+   LPUART_Type *lpuart = regs();
+   switch(offset) {
+      case offsetof(LPUART_Type, STAT): {
+         uint32_t value = lpuart->STAT;
+         uint32_t flags = previous & ~(value & LPUART_STAT_W1C) & (LPUART_STAT_W1C|LPUART_STAT_RO);
+         lpuart->STAT   = (value & ~(LPUART_STAT_W1C|LPUART_STAT_RO))|flags;
+         break;
+      }
+      case offsetof(LPUART_Type, DATA): {
+         uint8_t data = lpuart->DATA;
+         if (!(lpuart->CTRL & LPUART_CTRL_TE_MASK)) {
+            break;
+         }
+         if (!shifting) {
+            send(data);
+         }
+         else if (!buffered) {
+            buffered = true;
+            buffer   = data;
+            lpuart->STAT = lpuart->STAT & ~LPUART_STAT_TDRE_MASK;
+         }
+         else {
+            fail("LPUART0 DATA written while transmit buffer full");
+         }
+         break;
+      }
+   }
+}
+
+bool LpuartModel::irqRequest(IRQn_Type irqNum) {
+   (void)irqNum;
+   uint32_t stat = regs()->STAT;
+   uint32_t ctrl = regs()->CTRL;
+   return ((ctrl & LPUART_CTRL_TIE_MASK)  && (stat & LPUART_STAT_TDRE_MASK)) ||
+          ((ctrl & LPUART_CTRL_TCIE_MASK) && (stat & LPUART_STAT_TC_MASK))   ||
+          ((ctrl & LPUART_CTRL_RIE_MASK)  && (stat & LPUART_STAT_RDRF_MASK)) ||
+          ((ctrl & LPUART_CTRL_ILIE_MASK) && (stat & LPUART_STAT_IDLE_MASK)) ||
+          ((ctrl & LPUART_CTRL_ORIE_MASK) && (stat & LPUART_STAT_OR_MASK))   ||
+          ((ctrl & LPUART_CTRL_FEIE_MASK) && (stat & LPUART_STAT_FE_MASK));
+}
+
+} // End namespace Sim
@@ -0,0 +1,476 @@
+/**
+ * @file    peripherals.h
+ * @brief   Behavioural models of the MKL03 peripherals used by the firmware
+ *
+ * Each model keeps its registers in the model view and brings them up to date when the
+ * firmware accesses them. Counters are calculated from virtual time rather than stepped.
+ * Events are only scheduled for things that have an effect at a time (e.g. end of a
+ * conversion, a timer compare that requests an interrupt).
+ *
+ * Features not used by the firmware are not modelled (see Readme.md).
+ */
+#ifndef FIRMWARE_SIM_PERIPHERALS_H_
+#define FIRMWARE_SIM_PERIPHERALS_H_
+
+#include "simulator.h"
+
+namespace Sim {
+
+/**
+ * Get MCGOUTCLK frequency
+ */
+uint32_t getMcgOutClock();
+
+/**
+ * Get bus clock frequency
+ */
+uint32_t getBusClock();
+
+/**
+ * Get MCGIRCLK frequency (0 if disabled)
+ */
+uint32_t getMcgIrClock();
+
+/**
+ * Get MCGPCLK frequency (0 if disabled)
+ */
+uint32_t getMcgPClock();
+
+/**
+ * Get ERCLK32K frequency (0 if not from the LPO)
+ */
+uint32_t getErc32kClock();
+
+/**
+ * Get frequency of a peripheral clock selected by SIM SOPT2 (TPMSRC or LPUART0SRC)
+ *
+ * @param[in] select Clock select field
+ *
+ * @return Frequency (0 if disabled or not modelled)
+ */
+uint32_t getPeripheralClock(unsigned select);
+
+/** LPO frequency */
+constexpr uint32_t LPO_CLOCK  = 1000;
+
+/** HIRC frequency */
+constexpr uint32_t HIRC_CLOCK = 48000000;
+
+/**
+ * Pin levels of ports A and B
+ *
+ * A pin is driven by its GPIO output (MUX=1 and PDDR set), else by the board, else by its pull resistor.
+ * An undriven pin without a pull reads 0.
+ */
+class Pins {
+public:
+   /** Number of ports */
+   static constexpr unsigned PORTS = 2;
+
+   /**
+    * Set level driven onto a pin by the board
+    *
+    * @param[in] port  Port (0=A, 1=B)
+    * @param[in] pin   Pin number
+    * @param[in] level 0/1 or -1 for not driven
+    */
+   static void drive(unsigned port, unsigned pin, int level);
+
+   /**
+    * Get level driven by the MCU
+    *
+    * @param[in] port Port (0=A, 1=B)
+    * @param[in] pin  Pin number
+    *
+    * @return 0/1 or -1 if not a GPIO output
+    */
+   static int output(unsigned port, unsigned pin);
+
+   /**
+    * Get level of pin
+    *
+    * @param[in] port Port (0=A, 1=B)
+    * @param[in] pin  Pin number
+    */
+   static bool level(unsigned port, unsigned pin);
+
+   /**
+    * Recalculate pin levels after a change of PCR, GPIO or board drive.
+    * Edges are passed to the PORT models and changes of MCU outputs to the listener.
+    */
+   static void update();
+
+   /**
+    * Set function called when an MCU output changes
+    */
+   static void setListener(std::function<void(unsigned port, unsigned pin, int output)> listener);
+
+   /**
+    * Set all pins undriven
+    */
+   static void reset();
+};
+
+/**
+ * SIM - clock dividers, clock selection and ADC trigger selection
+ */
+class SimModel : public Peripheral {
+public:
+   SimModel() : Peripheral("SIM", SIM_BasePtr, sizeof(SIM_Type)) {}
+
+   SIM_Type *regs() const { return view<SIM_Type>(); }
+
+   virtual void reset() override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+
+   /** Divider from MCGOUTCLK to core clock */
+   unsigned getCoreDivider() const;
+
+   /** Divider from core clock to bus clock */
+   unsigned getBusDivider() const;
+};
+
+/**
+ * MCG Lite - clock source status follows selection immediately
+ */
+class McgModel : public Peripheral {
+public:
+   McgModel() : Peripheral("MCG", MCG_BasePtr, sizeof(MCG_Type)) {}
+
+   MCG_Type *regs() const { return view<MCG_Type>(); }
+
+   virtual void reset() override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+};
+
+/**
+ * SMC - stop mode selection and the stop aborted flag
+ */
+class SmcModel : public Peripheral {
+public:
+   SmcModel() : Peripheral("SMC", SMC_BasePtr, sizeof(SMC_Type)) {}
+
+   SMC_Type *regs() const { return view<SMC_Type>(); }
+
+   virtual void reset() override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+
+   /** Check if VLPS is the selected stop mode */
+   bool isVlpsSelected() const;
+
+   /** Set or clear PMCTRL.STOPA */
+   void setStopAborted(bool aborted);
+};
+
+/**
+ * RTC - time and prescaler counting from ERCLK32K
+ */
+class RtcModel : public Peripheral {
+private:
+   /** Time counting started */
+   Time     startTime = 0;
+
+   /** Prescaler when counting started */
+   uint32_t startPrescaler = 0;
+
+   /** Seconds when counting started */
+   uint32_t startSeconds = 0;
+
+   /** Get counts since counting started */
+   uint64_t counts() const;
+
+public:
+   RtcModel() : Peripheral("RTC", RTC_BasePtr, sizeof(RTC_Type)) {
+      ownIrq(RTC_Alarm_IRQn);
+      allowDirectReads();
+   }
+
+   RTC_Type *regs() const { return view<RTC_Type>(); }
+
+   virtual void reset() override;
+   virtual void update(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+   virtual bool irqRequest(IRQn_Type irqNum) override;
+};
+
+/**
+ * LPTMR - time counter mode
+ */
+class LptmrModel : public Peripheral {
+private:
+   /** Time counter started */
+   Time  startTime = 0;
+
+   /** Compare flag */
+   Event compare;
+
+   /** Get counter clock frequency */
+   uint32_t frequency() const;
+
+   /** Get counts since counter started */
+   uint64_t counts() const;
+
+   /** Schedule next compare */
+   void schedule();
+
+public:
+   LptmrModel();
+
+   LPTMR_Type *regs() const { return view<LPTMR_Type>(); }
+
+   virtual void reset() override;
+   virtual void update(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+   virtual bool irqRequest(IRQn_Type irqNum) override;
+};
+
+/**
+ * PORT - pin control and pin interrupts
+ */
+class PortModel : public Peripheral {
+private:
+   /** Port index (0=A) */
+   const unsigned fPort;
+
+public:
+   PortModel(const char *name, uint32_t base, unsigned port, IRQn_Type irqNum) :
+         Peripheral(name, base, sizeof(PORT_Type)), fPort(port) {
+      ownIrq(irqNum);
+   }
+
+   PORT_Type *regs() const { return view<PORT_Type>(); }
+
+   virtual void reset() override;
+   virtual void update(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+   virtual bool irqRequest(IRQn_Type irqNum) override;
+
+   /**
+    * Pin level changed - sets the interrupt flag as configured by PCR.IRQC
+    *
+    * @param[in] pin   Pin number
+    * @param[in] level New level
+    */
+   void pinChanged(unsigned pin, bool level);
+};
+
+/**
+ * GPIO A and B
+ */
+class GpioModel : public Peripheral {
+public:
+   GpioModel() : Peripheral("GPIO", GPIOA_BasePtr, 0x80) {}
+
+   GPIO_Type *regs(unsigned port) const { return reinterpret_cast<GPIO_Type *>(registers(fBase+0x40*port)); }
+
+   virtual void reset() override;
+   virtual void update(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+};
+
+/**
+ * TPM - counter, overflow flag and overflow trigger of the ADC
+ */
+class TpmModel : public Peripheral {
+private:
+   /** TPM index */
+   const unsigned fIndex;
+
+   /** Counter started (bus time) */
+   Time     startTime = 0;
+
+   /** Counter value when started */
+   uint32_t startCount = 0;
+
+   /** Counter clock when started */
+   uint32_t clock = 0;
+
+   /** Overflows before the overflow flag was last cleared */
+   uint64_t clearedOverflows = 0;
+
+   /** Overflow of counter */
+   Event overflow;
+
+   /** Get counter clocks since counter started */
+   uint64_t ticks() const;
+
+   /** Get number of overflows since counter started */
+   uint64_t overflows() const;
+
+   /** Restart counting from the current value */
+   void restart();
+
+public:
+   TpmModel(const char *name, uint32_t base, unsigned index, IRQn_Type irqNum);
+
+   TPM_Type *regs() const { return view<TPM_Type>(); }
+
+   virtual void reset() override;
+   virtual void update(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+   virtual bool irqRequest(IRQn_Type irqNum) override;
+
+   /** Check if the counter is running */
+   bool isRunning() const;
+
+   /**
+    * Schedule the overflow event if an overflow has an effect (interrupt or ADC trigger)
+    */
+   void schedule();
+};
+
+/**
+ * ADC - conversions, compare function, continuous and hardware triggered conversions, calibration
+ */
+class AdcModel : public Peripheral {
+private:
+   /** Conversion or calibration in progress */
+   Event    conversion;
+
+   /** Result register (0/1) of conversion in progress */
+   unsigned converting = 0;
+
+   /** Calibration in progress */
+   bool     calibrating = false;
+
+   /** Number of conversions completed */
+   uint64_t conversions = 0;
+
+   /** Get ADCK frequency */
+   uint32_t adck() const;
+
+   /**
+    * Start conversion
+    *
+    * @param[in] index  SC1/R register index
+    * @param[in] first  First conversion (not a continuous conversion)
+    */
+   void start(unsigned index, bool first);
+
+   /** Abort conversion in progress */
+   void abort();
+
+   /** Conversion complete */
+   void complete();
+
+public:
+   AdcModel();
+
+   ADC_Type *regs() const { return view<ADC_Type>(); }
+
+   virtual void reset() override;
+   virtual void read(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+   virtual bool irqRequest(IRQn_Type irqNum) override;
+
+   /**
+    * Check if conversions are triggered by overflow of a TPM
+    *
+    * @param[in] tpm TPM index
+    */
+   bool isTriggeredBy(unsigned tpm) const;
+
+   /**
+    * Overflow of a TPM
+    *
+    * @param[in] tpm TPM index
+    */
+   void trigger(unsigned tpm);
+
+   /** Get number of conversions completed */
+   uint64_t getConversions() const {
+      return conversions;
+   }
+
+   /**
+    * Set function giving the voltage of an input as a fraction of the reference
+    */
+   void setInput(std::function<double(unsigned channel)> input);
+};
+
+/**
+ * LPUART - 8N1 transmit and receive with status flags and interrupts
+ */
+class LpuartModel : public Peripheral {
+private:
+   /** Transmit shift register busy */
+   bool     shifting = false;
+
+   /** Character in transmit shift register */
+   uint8_t  shifter = 0;
+
+   /** Transmit buffer holds a character */
+   bool     buffered = false;
+
+   /** Character in transmit buffer */
+   uint8_t  buffer = 0;
+
+   /** Receive data */
+   uint8_t  received = 0;
+
+   /** End of character being sent */
+   Event    sent;
+
+   /** Receives characters sent */
+   std::function<void(uint8_t)> fTransmit;
+
+   /** Start sending a character */
+   void send(uint8_t data);
+
+public:
+   LpuartModel();
+
+   LPUART_Type *regs() const { return view<LPUART_Type>(); }
+
+   virtual void reset() override;
+   virtual void update(uint32_t offset) override;
+   virtual void read(uint32_t offset) override;
+   virtual void written(uint32_t offset, uint32_t previous) override;
+   virtual bool irqRequest(IRQn_Type irqNum) override;
+
+   /** Get time of one character (10 bits) */
+   Time characterTime() const;
+
+   /**
+    * Start bit of a received character.
+    *
+    * @return false if the receiver is not clocked (character is lost)
+    */
+   bool startReceive();
+
+   /**
+    * Received character complete
+    *
+    * @param[in] data Character
+    */
+   void receive(uint8_t data);
+
+   /**
+    * Set function receiving transmitted characters
+    */
+   void setTransmitter(std::function<void(uint8_t)> transmit) {
+      fTransmit = transmit;
+   }
+};
+
+/**
+ * The peripheral models
+ */
+namespace Models {
+extern SimModel    sim;
+extern McgModel    mcg;
+extern SmcModel    smc;
+extern RtcModel    rtc;
+extern LptmrModel  lptmr0;
+extern PortModel   porta;
+extern PortModel   portb;
+extern GpioModel   gpio;
+extern TpmModel    tpm0;
+extern TpmModel    tpm1;
+extern AdcModel    adc0;
+extern LpuartModel lpuart0;
+}
+
+} // End namespace Sim
+
+#endif /* FIRMWARE_SIM_PERIPHERALS_H_ */
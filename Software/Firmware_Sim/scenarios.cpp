@@ -0,0 +1,431 @@
+/**
+ * @file    scenarios.cpp
+ * @brief   Scenarios run against the booted firmware
+ *
+ * Each scenario schedules board events from the start of the run and checks what the
+ * firmware did through the pins, the host link and the peripheral registers.
+ * Random times and bounce come from the run's seed so a failing run can be repeated.
+ */
+#include "harness.h"
+#include "peripherals.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include <tuple>
+
+namespace Harness {
+
+using namespace Sim;
+using namespace Board;
+
+/// Power button debounce interval of the firmware
+static constexpr Time DEBOUNCE = 25*MS;
+
+/// Allowance for the LPTMR (1 kHz LPO) and the interrupts after the debounce interval
+static constexpr Time DEBOUNCE_SLACK = 2*MS;
+
+/// Time from power on by which the ADC compare function must be protecting target Vdd
+static constexpr Time PROTECTION_LIMIT = 30*MS;
+
+/// Time for the firmware to answer a command sent after a wake-up character
+static constexpr Time RESPONSE_LIMIT = 20*MS;
+
+/// Delay between the wake-up character and a command (as CPLD_Link)
+static constexpr Time WAKE_DELAY = 2*MS;
+
+/// Time from a fault while protected by the ADC compare function until target power is removed
+static constexpr Time FAULT_LIMIT = 100*US;
+
+/// Time from a fault while target Vdd is still settling (sampled) until target power is removed
+static constexpr Time SETTLING_FAULT_LIMIT = 30*MS;
+
+/// Time the power button of the prepared scenarios settles (pressed without bounce)
+static constexpr Time PREPARE_PRESS = 1*MS;
+
+/**
+ * Get level of TargetVddEnable (PTB1) at a time
+ *
+ * @return 0/1 or -1 if not driven
+ */
+static int enableAt(Time time) {
+   int level = -1;
+   for (const Change &change:enableChanges()) {
+      if (change.time > time) {
+         break;
+      }
+      level = change.level;
+   }
+   return level;
+}
+
+/**
+ * Get first change of TargetVddEnable to a level in a window
+ *
+ * @return Time of change or 0 if none
+ */
+static Time enableChange(int level, Time from, Time to) {
+   for (const Change &change:enableChanges()) {
+      if ((change.time >= from) && (change.time <= to) && (change.level == level)) {
+         return change.time;
+      }
+   }
+   return 0;
+}
+
+/**
+ * Get first line starting with a prefix received in a window
+ *
+ * @return Line or nullptr if none
+ */
+static const Line *findLine(const char *prefix, Time from, Time to) {
+   for (const Line &line:lines()) {
+      if ((line.time >= from) && (line.time <= to) && (line.text.compare(0, strlen(prefix), prefix) == 0)) {
+         return &line;
+      }
+   }
+   return nullptr;
+}
+
+/**
+ * Check if the ADC compare function is protecting target Vdd
+ */
+static bool protecting() {
+   const ADC_Type *adc = Models::adc0.regs();
+   return (adc->SC2 & ADC_SC2_ACFE_MASK) && (adc->SC3 & ADC_SC3_ADCO_MASK);
+}
+
+/**
+ * Record the time from power on until the ADC compare function protects target Vdd.
+ * Polled every 100 us from power on.
+ *
+ * @param[in] powerOn Time target power was enabled
+ */
+static void watchProtection(Time powerOn) {
+   auto poll = std::make_shared<std::function<void()>>();
+   *poll = [powerOn, poll]() {
+      if (protecting()) {
+         record("protection after power on (ms)", (double)(now()-powerOn)/MS);
+         *poll = nullptr;
+         return;
+      }
+      if (now()-powerOn > PROTECTION_LIMIT) {
+         fail("Target Vdd not protected %.1f ms after power on", (double)(now()-powerOn)/MS);
+      }
+      at(now()+100*US, *poll);
+   };
+   at(powerOn, *poll);
+}
+
+/**
+ * Check a power button press changed the supply after the debounce interval
+ *
+ * @param[in] pressed Time of first contact
+ * @param[in] settled Time the button contact settled
+ * @param[in] on      Expected level of TargetVddEnable
+ *
+ * @return Time of change
+ */
+static Time checkPowerChange(Time pressed, Time settled, bool on) {
+   Time change = enableChange(on, settled+DEBOUNCE, settled+DEBOUNCE+DEBOUNCE_SLACK);
+   if (change == 0) {
+      fail("Power not switched %s within %.0f ms of the button settling at %.3f ms",
+            on?"on":"off", (double)(DEBOUNCE+DEBOUNCE_SLACK)/MS, (double)settled/MS);
+   }
+   if (enableChange(on, pressed, settled+DEBOUNCE-1) != 0) {
+      fail("Power switched %s before the button had settled for the debounce interval", on?"on":"off");
+   }
+   record(on?"power on after settle (ms)":"power off after settle (ms)", (double)(change-settled)/MS);
+   return change;
+}
+
+/**
+ * Check the RAMP report of a power on
+ *
+ * "RAMP <sample ns> <rise ns> <settle ns> <final> <peak> <trace>"
+ */
+static void checkRamp(Time powerOn) {
+   const Line *ramp = findLine("RAMP ", powerOn, powerOn+10*MS);
+   if (ramp == nullptr) {
+      fail("No RAMP report within 10 ms of power on");
+   }
+   unsigned long sampleNs, riseNs, settleNs, final, peak;
+   if (sscanf(ramp->text.c_str(), "RAMP %lu %lu %lu %lu %lu", &sampleNs, &riseNs, &settleNs, &final, &peak) != 5) {
+      fail("Bad RAMP report '%s'", ramp->text.c_str());
+   }
+   unsigned expected = (unsigned)(VDD_NOMINAL/ADC_VREF*255+0.5);
+   if ((final+3 < expected) || (final > expected+3)) {
+      fail("RAMP final value %lu, expected %u", final, expected);
+   }
+   record("ramp rise 10-90% (us)", riseNs/1000.0);
+}
+
+/**
+ * Idle - powered off with nothing happening the firmware stays in VLPS without waking
+ */
+static void idleScenario(Random &random) {
+   Time length = random.range(100*MS, 2*SECOND);
+   at(start()+length, []() {
+      if (getPowerMode() != PowerMode_VLPS) {
+         fail("Not in VLPS while idle");
+      }
+      if (!output().empty() || (!enableChanges().empty() && (enableChanges().back().time >= start()))) {
+         fail("Activity while idle");
+      }
+      if (vlpsEntries() != 0) {
+         fail("Woke from VLPS %u times while idle", vlpsEntries());
+      }
+      pass();
+   });
+}
+
+/**
+ * Power button - press (with bounce) powers on, ramp is reported and protection started.
+ * Press again powers off, the supply is discharged and the firmware returns to VLPS.
+ */
+static void buttonScenario(Random &random) {
+   Time press1   = start()+random.range(1*MS, 50*MS);
+   Time settle1  = button(press1, true, random.range(0, 5), random);
+   Time release1 = settle1+random.range(60*MS, 300*MS);
+   Time settle2  = button(release1, false, random.range(0, 5), random);
+   Time press2   = settle2+random.range(DEBOUNCE+DEBOUNCE_SLACK, 200*MS);
+   Time settle3  = button(press2, true, random.range(0, 5), random);
+   Time release2 = settle3+random.range(60*MS, 300*MS);
+   Time settle4  = button(release2, false, random.range(0, 5), random);
+
+   // Protection is watched from the expected power on time
+   at(settle1+DEBOUNCE, []() {
+      watchProtection(now());
+   });
+   at(settle4+DEBOUNCE+50*MS, [press1, settle1, press2, settle3]() {
+      Time on  = checkPowerChange(press1, settle1, true);
+      Time off = checkPowerChange(press2, settle3, false);
+      if (enableAt(off-1) != 1) {
+         fail("Power did not stay on until the second press");
+      }
+      checkRamp(on);
+      if (dischargeChanges().empty() || (dischargeChanges().back().time < off)) {
+         fail("Target Vdd not discharged at power off");
+      }
+      if (vdd() > 0.1) {
+         fail("Target Vdd %.2f V after power off", vdd());
+      }
+      if (protecting()) {
+         fail("Vdd protection still active after power off");
+      }
+      if (getPowerMode() != PowerMode_VLPS) {
+         fail("Not back in VLPS after power off");
+      }
+      if (lostCharacters() != 0) {
+         fail("Host link characters lost");
+      }
+      pass();
+   });
+}
+
+/**
+ * Host commands - a wake-up character followed by a command (as CPLD_Link) while in VLPS.
+ * 'U' reports the transmit statistics (queued as a chain) and 'I' the idle statistics.
+ */
+static void commandsScenario(Random &random) {
+   Time wake1 = start()+random.range(1*MS, 100*MS);
+   send(wake1, "\n");
+   Time sent1 = send(wake1+WAKE_DELAY, "U");
+   Time wake2 = sent1+RESPONSE_LIMIT+random.range(1*MS, 100*MS);
+   send(wake2, "\n");
+   Time sent2 = send(wake2+WAKE_DELAY, "I");
+
+   at(sent2+RESPONSE_LIMIT, [sent1, sent2]() {
+      const Line *uart = findLine("UART ", sent1, sent1+RESPONSE_LIMIT);
+      if (uart == nullptr) {
+         fail("No response to 'U' sent after a wake-up character (%u characters lost)", lostCharacters());
+      }
+      unsigned long dropped, highWater, blocked;
+      if ((sscanf(uart->text.c_str(), "UART %lu %lu %lu", &dropped, &highWater, &blocked) != 3) || (dropped != 0)) {
+         fail("Bad UART report '%s'", uart->text.c_str());
+      }
+      record("'U' response (ms)", (double)(uart->time-sent1)/MS);
+
+      const Line *idle = findLine("IDLE ", sent2, sent2+RESPONSE_LIMIT);
+      if (idle == nullptr) {
+         fail("No response to 'I' sent after a wake-up character (%u characters lost)", lostCharacters());
+      }
+      // "IDLE <run ms> <wait ms> <wait entries> <min> <max> <mean> <vlps ms> <vlps entries> <min> <max> <mean> <aborted>"
+      unsigned long runMs, waitMs, waitCount, vlpsMs, vlpsCount, aborted;
+      unsigned long waitMinimum, waitMaximum, waitMean, vlpsMinimum, vlpsMaximum, vlpsMean;
+      if (sscanf(idle->text.c_str(), "IDLE %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu",
+            &runMs, &waitMs, &waitCount, &waitMinimum, &waitMaximum, &waitMean,
+            &vlpsMs, &vlpsCount, &vlpsMinimum, &vlpsMaximum, &vlpsMean, &aborted) != 12) {
+         fail("Bad IDLE report '%s'", idle->text.c_str());
+      }
+      if (vlpsCount == 0) {
+         fail("IDLE report has no VLPS entries '%s'", idle->text.c_str());
+      }
+      record("'I' response (ms)", (double)(idle->time-sent2)/MS);
+      record("VLPS entries in run", vlpsEntries());
+      if (getPowerMode() != PowerMode_VLPS) {
+         fail("Not back in VLPS after commands");
+      }
+      pass();
+   });
+}
+
+/**
+ * Fuzz - random interleaving of button presses (with bounce) and host commands.
+ * Each press toggles the power, each command is answered and the firmware ends in VLPS
+ * once powered off.
+ */
+static void fuzzScenario(Random &random) {
+   unsigned presses  = 0;
+   unsigned commands = 0;
+   Time     time     = start();
+   Time     lastSettled = start();
+   auto     expected = std::make_shared<std::vector<std::tuple<Time, Time, bool>>>();
+
+   for (unsigned event=random.range(2, 12); event>0; event--) {
+      time += random.range(1*MS, 80*MS);
+      if (random.range(0, 1)) {
+         // Press and release (power changes on the press)
+         Time settled = button(time, true, random.range(0, 4), random);
+         expected->push_back({time, settled, (++presses&1) != 0});
+         time = button(settled+random.range(30*MS, 80*MS), false, random.range(0, 4), random);
+         time += DEBOUNCE+DEBOUNCE_SLACK;
+         lastSettled = time;
+      }
+      else {
+         send(time, "\n");
+         time = send(time+WAKE_DELAY, random.range(0, 1)?"U":"I")+RESPONSE_LIMIT;
+         commands++;
+      }
+   }
+   at(std::max(time, lastSettled)+50*MS, [commands, presses, expected]() {
+      for (auto &[pressed, settled, on]:*expected) {
+         Time change = checkPowerChange(pressed, settled, on);
+         if (on) {
+            // Each power on is captured - the compare function must not be left enabled by the last one
+            checkRamp(change);
+         }
+      }
+      unsigned responses = 0;
+      for (const Line &line:lines()) {
+         if ((line.text.compare(0, 5, "UART ") == 0) || (line.text.compare(0, 5, "IDLE ") == 0)) {
+            responses++;
+         }
+      }
+      if (responses != commands) {
+         fail("%u responses to %u commands", responses, commands);
+      }
+      if ((presses&1) == 0) {
+         if (getPowerMode() != PowerMode_VLPS) {
+            fail("Not in VLPS when powered off");
+         }
+      }
+      else if (!protecting()) {
+         fail("Target Vdd not protected when powered on");
+      }
+      record("button presses", presses);
+      record("commands", commands);
+      pass();
+   });
+}
+
+/**
+ * Press the power button once without bounce
+ *
+ * @return Time power should be switched on
+ */
+static Time preparePowerOn() {
+   Random random(0);
+   return button(start()+PREPARE_PRESS, true, 0, random)+DEBOUNCE;
+}
+
+/**
+ * Check power was removed after a fault and the firmware went back to VLPS
+ *
+ * @param[in] fault Time of fault
+ * @param[in] limit Allowed time to remove power
+ * @param[in] name  Name of the statistic recording the time to remove power (ms)
+ */
+static void checkFault(Time fault, Time limit, const char *name) {
+   if (enableAt(fault) != 1) {
+      fail("Power not on at the fault");
+   }
+   Time off = enableChange(0, fault, now());
+   if (off == 0) {
+      fail("Power not removed after a fault at %.3f ms", (double)fault/MS);
+   }
+   if (off-fault > limit) {
+      fail("Power removed %.3f ms after a fault, limit %.3f ms", (double)(off-fault)/MS, (double)limit/MS);
+   }
+   record(name, (double)(off-fault)/MS);
+   if (protecting()) {
+      fail("Vdd protection still active after a fault");
+   }
+   if (ledChanges().empty() || (ledChanges().back().level != 0)) {
+      fail("Target Vdd LED not off after a fault");
+   }
+   if (getPowerMode() != PowerMode_VLPS) {
+      fail("Not back in VLPS after a fault");
+   }
+}
+
+/**
+ * Prepare Vdd fault (protected) - powered on and protected by the ADC compare function
+ */
+static void prepareProtected() {
+   Time powerOn = preparePowerOn();
+   at(powerOn+PROTECTION_LIMIT+DEBOUNCE_SLACK, []() {
+      if (!protecting()) {
+         fail("Target Vdd not protected after power on");
+      }
+      checkpoint();
+   });
+}
+
+/**
+ * Vdd fault (protected) - target Vdd collapses while protected by the ADC compare function.
+ * The ADC interrupt removes power within FAULT_LIMIT.
+ */
+static void faultScenario(Random &random) {
+   Time fault = start()+random.range(0, 5*MS);
+   Board::fault(fault, true);
+   at(fault+50*MS, [fault]() {
+      checkFault(fault, FAULT_LIMIT, "power off after fault (ms)");
+      pass();
+   });
+}
+
+/**
+ * Prepare Vdd fault (settling) - power button about to switch power on
+ */
+static void prepareSettling() {
+   Time powerOn = preparePowerOn();
+   at(powerOn-DEBOUNCE_SLACK, checkpoint);
+}
+
+/**
+ * Vdd fault (settling) - target Vdd collapses during the ramp capture or while sampled
+ * before protection starts. Power is removed once the settling time has elapsed.
+ */
+static void settlingFaultScenario(Random &random) {
+   // The run starts DEBOUNCE_SLACK before the nominal power on time
+   Time fault = start()+2*DEBOUNCE_SLACK+random.range(0, 10*MS);
+   Board::fault(fault, true);
+   at(fault+SETTLING_FAULT_LIMIT+50*MS, [fault]() {
+      checkFault(fault, SETTLING_FAULT_LIMIT, "power off after fault (ms)");
+      pass();
+   });
+}
+
+const Scenario scenarios[] = {
+   {"idle",        "Stays in VLPS without waking while nothing happens",           nullptr,          idleScenario},
+   {"button",      "Bouncing power button on, ramp report, protection, off, VLPS", nullptr,          buttonScenario},
+   {"commands",    "Wake-up character then 'U' and 'I' commands from VLPS",        nullptr,          commandsScenario},
+   {"fuzz",        "Random button presses and host commands",                      nullptr,          fuzzScenario},
+   {"fault",       "Vdd fault while protected by the ADC compare function",        prepareProtected, faultScenario},
+   {"faultsettle", "Vdd fault during the ramp capture or settling (sampled)",      prepareSettling,  settlingFaultScenario},
+};
+
+const unsigned scenarioCount = sizeof(scenarios)/sizeof(scenarios[0]);
+
+} // End namespace Harness
@@ -0,0 +1,162 @@
+/**
+ * @file    sim_host.h
+ * @brief   Host stand-in for the Cortex-M0+ instructions used by the firmware
+ *
+ * This file is force-included ahead of every translation unit (g++ -include sim_host.h).
+ * The firmware, the USBDM peripheral headers and pin_mapping.h are then compiled unchanged.
+ *
+ *  - The CMSIS intrinsics (cmsis_gcc.h) are replaced by calls to the simulator
+ *  - Inline assembler in the USBDM headers (__asm__("nop"), the PRIMASK critical sections,
+ *    WFI etc.) is turned into a call of simAsm() with the text of the assembler statement
+ *  - The bit manipulation engine (bme.h) is replaced by plain read-modify-write done
+ *    without an interrupt between the read and the write
+ *
+ * The standard headers used by the firmware are included before the assembler macros
+ * are defined as the C library also uses __asm__.
+ */
+#ifndef FIRMWARE_SIM_SIM_HOST_H_
+#define FIRMWARE_SIM_SIM_HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Execute inline assembler.
+ * Recognises nop, wfi, barriers and the PRIMASK critical section sequences.
+ *
+ * @param[in] text Text of the assembler statement including any operands
+ */
+void simAsm(const char *text);
+
+/** Get PRIMASK (1 => interrupts masked) */
+uint32_t simGetPrimask(void);
+
+/** Set PRIMASK (1 => interrupts masked) */
+void simSetPrimask(uint32_t primask);
+
+/** Breakpoint - reports where the firmware stopped and ends the simulation */
+void simBreakpoint(void);
+
+/** Start of an operation that hardware does in a single access */
+void simAtomicBegin(void);
+
+/** End of an operation that hardware does in a single access */
+void simAtomicEnd(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Replace cmsis_gcc.h
+#define __CMSIS_GCC_H
+
+#define __enable_irq()           simSetPrimask(0)
+#define __disable_irq()          simSetPrimask(1)
+#define __get_PRIMASK()          simGetPrimask()
+#define __set_PRIMASK(priMask)   simSetPrimask(priMask)
+#define __NOP()                  simAsm("nop")
+#define __WFI()                  simAsm("wfi")
+#define __WFE()                  simAsm("wfi")
+#define __SEV()                  simAsm("")
+#define __ISB()                  simAsm("")
+#define __DSB()                  simAsm("")
+#define __DMB()                  simAsm("")
+#define __BKPT(value)            simBreakpoint()
+#define __REV(value)             __builtin_bswap32(value)
+#define __CLZ                    __builtin_clz
+
+/** Load exclusive - there is only one processor */
+static inline uint32_t __LDREXW(volatile uint32_t *addr) {
+   return *addr;
+}
+
+/** Store exclusive - always succeeds as there is only one processor */
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) {
+   *addr = value;
+   return 0;
+}
+
+// Assembler statements become calls of simAsm() with the statement as text
+#define __asm__                  simAsm
+#define __asm                    simAsm
+#define volatile(...)            (#__VA_ARGS__)
+
+// Replace bme.h
+#define INCLUDE_BME_CPP_H
+
+namespace USBDM {
+
+/** Host bmeAnd() */
+template<typename T> static inline void bmeAnd(T &ref, const uint32_t mask) {
+   simAtomicBegin();
+   ref = ref & mask;
+   simAtomicEnd();
+}
+
+/** Host bmeOr() */
+template<typename T> static inline void bmeOr(T &ref, const uint32_t mask) {
+   simAtomicBegin();
+   ref = ref | mask;
+   simAtomicEnd();
+}
+
+/** Host bmeXor() */
+template<typename T> static inline void bmeXor(T &ref, const uint32_t mask) {
+   simAtomicBegin();
+   ref = ref ^ mask;
+   simAtomicEnd();
+}
+
+/** Host bmeInsert() */
+template<typename T> static inline void bmeInsert(T &ref, const uint8_t bitNum, const uint8_t width, const uint32_t value) {
+   const uint32_t mask = ((1UL<<width)-1)<<bitNum;
+   simAtomicBegin();
+   ref = (ref&~mask)|((value<<bitNum)&mask);
+   simAtomicEnd();
+}
+
+/** Host bmeExtract() */
+template<typename T> static inline uint32_t bmeExtract(T &ref, const uint8_t bitNum, const uint8_t width) {
+   return (ref>>bitNum)&((1UL<<width)-1);
+}
+
+/** Host bmeTestAndClear() */
+template<typename T> static inline uint32_t bmeTestAndClear(T &ref, const uint8_t bitNum) {
+   simAtomicBegin();
+   uint32_t value = ref;
+   ref = value & ~(1UL<<bitNum);
+   simAtomicEnd();
+   return (value>>bitNum)&1;
+}
+
+/** Host bmeTestAndSet() */
+template<typename T> static inline uint32_t bmeTestAndSet(T &ref, const uint8_t bitNum) {
+   simAtomicBegin();
+   uint32_t value = ref;
+   ref = value | (1UL<<bitNum);
+   simAtomicEnd();
+   return (value>>bitNum)&1;
+}
+
+} // End namespace USBDM
+
+#endif /* FIRMWARE_SIM_SIM_HOST_H_ */
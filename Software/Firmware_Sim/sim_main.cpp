@@ -0,0 +1,304 @@
+/**
+ * @file    sim_main.cpp
+ * @brief   Starts the firmware in the simulator and runs the scenarios
+ *
+ * Usage: firmware_sim [scenario|all] [runs] [first seed]
+ */
+#include "harness.h"
+#include "peripherals.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Firmware (see firmware.cpp and Startup_Code/system.cpp)
+int  firmwareMain();
+void SystemInitLowLevel(void);
+
+namespace Harness {
+
+using namespace Sim;
+
+/**
+ * Statistic accumulated over the runs of a scenario.
+ * Kept in memory shared with the runs.
+ */
+struct Statistic {
+   const char *name;
+   double      minimum;
+   double      maximum;
+   double      sum;
+   unsigned    count;
+};
+
+/** Maximum number of statistics for a scenario */
+static constexpr unsigned MAX_STATISTICS = 16;
+
+/**
+ * Results shared between the runs and the process running them
+ */
+struct Results {
+   Statistic     statistics[MAX_STATISTICS];
+   unsigned      statisticCount;
+   double        simulatedTime;
+   unsigned long accesses;
+   bool          prepared;        //!< Prepare step reached checkpoint() and ran the runs
+   unsigned      failures;        //!< Failed runs forked from the checkpoint
+};
+
+static Results *results;
+
+/** Run in progress (in a child) */
+static bool     running = false;
+
+/** Start of run */
+static Time     runStart;
+
+/** VLPS entries during run */
+static unsigned vlpsCount;
+
+/** Scenario being run */
+static const Scenario *current = nullptr;
+
+/** Selected scenario (nullptr => all) */
+static const char *selected = nullptr;
+
+/** Runs of each scenario */
+static unsigned runs = 1000;
+
+/** Seed of first run */
+static unsigned firstSeed = 1;
+
+Time start() {
+   return runStart;
+}
+
+unsigned vlpsEntries() {
+   return vlpsCount;
+}
+
+void record(const char *name, double value) {
+   Statistic *statistic = nullptr;
+   for (unsigned index=0; index<results->statisticCount; index++) {
+      if (strcmp(results->statistics[index].name, name) == 0) {
+         statistic = &results->statistics[index];
+         break;
+      }
+   }
+   if (statistic == nullptr) {
+      if (results->statisticCount == MAX_STATISTICS) {
+         fail("Too many statistics");
+      }
+      statistic = &results->statistics[results->statisticCount++];
+      *statistic = {name, value, value, 0, 0};
+   }
+   if (value < statistic->minimum) {
+      statistic->minimum = value;
+   }
+   if (value > statistic->maximum) {
+      statistic->maximum = value;
+   }
+   statistic->sum += value;
+   statistic->count++;
+}
+
+[[noreturn]] void pass() {
+   results->simulatedTime += (double)(now()-runStart)/SECOND;
+   results->accesses      += emulatedAccesses+steppedAccesses;
+   finish(0);
+}
+
+/**
+ * Get wall clock time in s
+ */
+static double wallTime() {
+   struct timespec time;
+   clock_gettime(CLOCK_MONOTONIC, &time);
+   return time.tv_sec+time.tv_nsec*1e-9;
+}
+
+/**
+ * Fork each run of the current scenario from the current state
+ *
+ * @return Number of failed runs or -1 in a run
+ */
+static int forkRuns() {
+   unsigned failures = 0;
+   for (unsigned seed=firstSeed; seed<firstSeed+runs; seed++) {
+      fflush(stdout);
+      pid_t child = fork();
+      if (child == 0) {
+         separateRegisters();
+         alarm(10);
+         running          = true;
+         runStart         = now();
+         vlpsCount        = 0;
+         emulatedAccesses = 0;
+         steppedAccesses  = 0;
+         Board::Random random(seed);
+         current->start(random);
+         return -1;
+      }
+      int status;
+      if ((child < 0) || (waitpid(child, &status, 0) != child)) {
+         perror("fork");
+         _exit(2);
+      }
+      if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+         failures++;
+         printf("   %s seed %u failed (%s %d)\n", current->name, seed,
+               WIFEXITED(status)?"exit":"signal", WIFEXITED(status)?WEXITSTATUS(status):WTERMSIG(status));
+      }
+   }
+   return failures;
+}
+
+void checkpoint() {
+   // The runs have their own time limit
+   alarm(0);
+   int failures = forkRuns();
+   if (failures < 0) {
+      // Run - continue the firmware with the run started
+      return;
+   }
+   results->failures = failures;
+   results->prepared = true;
+   finish(0);
+}
+
+/**
+ * Run each run of a scenario in a child process.
+ * A scenario with a prepare step is prepared in a child that forks the runs at checkpoint().
+ *
+ * @return Number of failed runs or -1 in the child
+ */
+static int runScenario(const Scenario &scenario) {
+   memset(results, 0, sizeof(*results));
+   current = &scenario;
+   double started = wallTime();
+   int    failures;
+
+   if (scenario.prepare == nullptr) {
+      failures = forkRuns();
+      if (failures < 0) {
+         return -1;
+      }
+   }
+   else {
+      fflush(stdout);
+      pid_t child = fork();
+      if (child == 0) {
+         separateRegisters();
+         alarm(10);
+         running   = true;
+         runStart  = now();
+         vlpsCount = 0;
+         scenario.prepare();
+         return -1;
+      }
+      int status;
+      if ((child < 0) || (waitpid(child, &status, 0) != child)) {
+         perror("fork");
+         _exit(2);
+      }
+      if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0) || !results->prepared) {
+         printf("   %s prepare failed\n", scenario.name);
+         failures = runs;
+      }
+      else {
+         failures = results->failures;
+      }
+   }
+   double elapsed = wallTime()-started;
+   unsigned passed = runs-failures;
+   printf("%-11s %6u runs %4u failed %8.0f runs/s  %8.1f ms simulated/run  %6.0f accesses/run\n",
+         scenario.name, runs, failures, runs/elapsed,
+         passed?1000*results->simulatedTime/passed:0.0, passed?(double)results->accesses/passed:0.0);
+   for (unsigned index=0; index<results->statisticCount; index++) {
+      const Statistic &statistic = results->statistics[index];
+      printf("   %-32s min %10.3f  mean %10.3f  max %10.3f\n",
+            statistic.name, statistic.minimum, statistic.sum/statistic.count, statistic.maximum);
+   }
+   return failures;
+}
+
+/**
+ * Called on each entry to WAIT or VLPS.
+ * The first entry to VLPS is the snapshot the scenarios are run from.
+ */
+static void sleeping(PowerMode mode) {
+   if (mode != PowerMode_VLPS) {
+      return;
+   }
+   if (running) {
+      vlpsCount++;
+      return;
+   }
+   printf("Firmware booted and idle at %.3f ms (%lu register accesses)\n",
+         (double)now()/MS, emulatedAccesses+steppedAccesses);
+
+   results = static_cast<Results *>(mmap(nullptr, sizeof(Results), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0));
+   if (results == MAP_FAILED) {
+      perror("mmap");
+      _exit(2);
+   }
+   unsigned failures = 0;
+   bool     found    = false;
+   for (unsigned index=0; index<scenarioCount; index++) {
+      if ((selected != nullptr) && (strcmp(selected, scenarios[index].name) != 0)) {
+         continue;
+      }
+      found = true;
+      int failed = runScenario(scenarios[index]);
+      if (failed < 0) {
+         // Child - continue the firmware with the run started
+         return;
+      }
+      failures += failed;
+   }
+   if (!found) {
+      printf("No scenario '%s'\n", selected);
+   }
+   printf("%s\n", (found && (failures == 0))?"PASSED":"FAILED");
+   finish((found && (failures == 0))?0:1);
+}
+
+} // End namespace Harness
+
+/**
+ * Reset the simulated processor before the firmware's static constructors run
+ * (hardware.cpp and system.cpp configure pins and clocks from constructors)
+ */
+static void __attribute__((constructor(102))) startSimulation() {
+   Sim::reset();
+   SystemInitLowLevel();
+}
+
+int main(int argc, char *argv[]) {
+   using namespace Harness;
+
+   if ((argc > 1) && (strcmp(argv[1], "-h") == 0)) {
+      printf("Usage: %s [scenario|all] [runs] [first seed]\n", argv[0]);
+      for (unsigned index=0; index<scenarioCount; index++) {
+         printf("  %-11s %s\n", scenarios[index].name, scenarios[index].description);
+      }
+      return 0;
+   }
+   if ((argc > 1) && (strcmp(argv[1], "all") != 0)) {
+      selected = argv[1];
+   }
+   if (argc > 2) {
+      runs = strtoul(argv[2], nullptr, 0);
+   }
+   if (argc > 3) {
+      firstSeed = strtoul(argv[3], nullptr, 0);
+   }
+   Board::reset();
+   Sim::setSleepHook(sleeping);
+   firmwareMain();
+   Sim::fail("Firmware main() returned");
+}
@@ -0,0 +1,79 @@
+/**
+ * @file    sim_vectors.cpp
+ * @brief   Interrupt handlers of the firmware as installed by Startup_Code/vectors.cpp
+ *
+ * vectors.cpp can't be compiled for the host (naked handlers and ARM assembler)
+ * so its table of external interrupts is repeated here.
+ * Handlers not provided by the firmware report the interrupt and end the simulation.
+ */
+#include "hardware.h"
+#include "simulator.h"
+
+extern "C" {
+
+/**
+ * Default handler for interrupts - an interrupt was enabled without a handler
+ */
+void Sim_Default_Handler(void) {
+   uint32_t vectorNum = (SCB->ICSR&SCB_ICSR_VECTACTIVE_Msk)>>SCB_ICSR_VECTACTIVE_Pos;
+   Sim::fail("Interrupt without a handler (vector %u)", (unsigned)vectorNum);
+}
+
+#define WEAK_DEFAULT_HANDLER __attribute__ ((__nothrow__, __weak__, alias("Sim_Default_Handler")))
+
+void FTF_Command_IRQHandler(void)             WEAK_DEFAULT_HANDLER;
+void PMC_IRQHandler(void)                     WEAK_DEFAULT_HANDLER;
+void LLWU_IRQHandler(void)                    WEAK_DEFAULT_HANDLER;
+void I2C0_IRQHandler(void)                    WEAK_DEFAULT_HANDLER;
+void SPI0_IRQHandler(void)                    WEAK_DEFAULT_HANDLER;
+void LPUART0_IRQHandler(void)                 WEAK_DEFAULT_HANDLER;
+void CMP0_IRQHandler(void)                    WEAK_DEFAULT_HANDLER;
+void TPM1_IRQHandler(void)                    WEAK_DEFAULT_HANDLER;
+void RTC_Alarm_IRQHandler(void)               WEAK_DEFAULT_HANDLER;
+void RTC_Seconds_IRQHandler(void)             WEAK_DEFAULT_HANDLER;
+void LPTMR0_IRQHandler(void)                  WEAK_DEFAULT_HANDLER;
+void PORTA_IRQHandler(void)                   WEAK_DEFAULT_HANDLER;
+void PORTB_IRQHandler(void)                   WEAK_DEFAULT_HANDLER;
+
+/** Used by SystemInitLowLevel() to set SCB->VTOR (only the address is used) */
+extern int const __vector_table[];
+int const __vector_table[48] = {};
+
+/** External interrupt handlers (IRQ 0-31) */
+extern void (*const simVectorTable[32])();
+void (*const simVectorTable[32])() = {
+   Sim_Default_Handler,                     /*    0  */
+   Sim_Default_Handler,                     /*    1  */
+   Sim_Default_Handler,                     /*    2  */
+   Sim_Default_Handler,                     /*    3  */
+   Sim_Default_Handler,                     /*    4  */
+   FTF_Command_IRQHandler,                  /*    5  Flash Memory Interface */
+   PMC_IRQHandler,                          /*    6  Power Management Controller */
+   LLWU_IRQHandler,                         /*    7  Low Leakage Wakeup */
+   I2C0_IRQHandler,                         /*    8  Inter-Integrated Circuit */
+   Sim_Default_Handler,                     /*    9  */
+   SPI0_IRQHandler,                         /*   10  Serial Peripheral Interface */
+   Sim_Default_Handler,                     /*   11  */
+   LPUART0_IRQHandler,                      /*   12  Serial Communication Interface */
+   Sim_Default_Handler,                     /*   13  */
+   Sim_Default_Handler,                     /*   14  */
+   USBDM::Adc0::irqHandler,                 /*   15  Analogue to Digital Converter */
+   CMP0_IRQHandler,                         /*   16  High-Speed Comparator */
+   USBDM::Tpm0::irqHandler,                 /*   17  Timer/PWM Module */
+   TPM1_IRQHandler,                         /*   18  Timer/PWM Module */
+   Sim_Default_Handler,                     /*   19  */
+   RTC_Alarm_IRQHandler,                    /*   20  Real Time Clock */
+   RTC_Seconds_IRQHandler,                  /*   21  Real Time Clock */
+   Sim_Default_Handler,                     /*   22  */
+   Sim_Default_Handler,                     /*   23  */
+   Sim_Default_Handler,                     /*   24  */
+   Sim_Default_Handler,                     /*   25  */
+   Sim_Default_Handler,                     /*   26  */
+   Sim_Default_Handler,                     /*   27  */
+   LPTMR0_IRQHandler,                       /*   28  Low Power Timer */
+   Sim_Default_Handler,                     /*   29  */
+   PORTA_IRQHandler,                        /*   30  General Purpose Input/Output */
+   PORTB_IRQHandler,                        /*   31  General Purpose Input/Output */
+};
+
+}
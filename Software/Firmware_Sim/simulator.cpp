@@ -0,0 +1,1060 @@
+/**
+ * @file    simulator.cpp
+ * @brief   Processor core of the simulator - register traps, virtual time, NVIC, SysTick, WFI
+ *
+ * Register accesses:
+ *  The peripheral and core register regions are mapped twice from the same memory.
+ *  The view at the hardware addresses is inaccessible so each firmware access raises SIGSEGV.
+ *  Pages of peripherals without read side effects (the RTC) are readable and only writes trap.
+ *  Simple moves (mov, movzx, movsx) are decoded and done by the handler through the model view.
+ *  Any other instruction is single stepped (EFLAGS.TF) with the page briefly accessible.
+ *
+ * Interrupts:
+ *  The firmware handler is called from the signal handler after an access, from nop and
+ *  from an unmasking of PRIMASK. The kernel saves the interrupted registers as the
+ *  processor's exception entry would. Handlers nest by priority as in the NVIC.
+ */
+#include "simulator.h"
+#include "peripherals.h"
+
+#include <signal.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+namespace Sim {
+
+/*
+ * ============================================================================
+ * Time and events
+ * ============================================================================
+ */
+
+/** Virtual time */
+static Time currentTime = 0;
+
+/** Set while a model is running (models use the model view) */
+static bool inModel = false;
+
+/** Time spent in VLPS before the current VLPS period (bus clocks stopped) */
+static Time stoppedTime = 0;
+
+/** Time the current VLPS period started */
+static Time stopStart = 0;
+
+/** Current power mode */
+static PowerMode powerMode = PowerMode_Run;
+
+/** Core cycles executed */
+static uint64_t coreCycles = 0;
+
+/** Core clock frequency */
+static uint32_t coreClock = 0;
+
+/** Remainder of cycle to time conversion (ps*Hz) */
+static uint64_t coreRemainder = 0;
+
+Time now() {
+   return currentTime;
+}
+
+Time now(Domain domain) {
+   if (domain == Domain_Always) {
+      return currentTime;
+   }
+   if (powerMode == PowerMode_VLPS) {
+      return stopStart-stoppedTime;
+   }
+   return currentTime-stoppedTime;
+}
+
+uint64_t clocks(uint32_t frequency, Domain domain) {
+   return (uint64_t)(((unsigned __int128)now(domain)*frequency)/SECOND);
+}
+
+Time cyclesToTime(uint64_t cycles, uint32_t frequency) {
+   return (Time)(((unsigned __int128)cycles*SECOND+frequency-1)/frequency);
+}
+
+PowerMode getPowerMode() {
+   return powerMode;
+}
+
+uint64_t getCoreCycles() {
+   return coreCycles;
+}
+
+uint32_t getCoreClock() {
+   return coreClock;
+}
+
+/**
+ * Scheduled events
+ */
+class Scheduler {
+public:
+   /** Events waiting for their time */
+   static std::vector<Event *> &events() {
+      static std::vector<Event *> list;
+      return list;
+   }
+
+   /** Time of the earliest event in Always time (recalculated when 0) */
+   static Time nextDue;
+
+   /**
+    * Get Always time of an event
+    */
+   static Time absoluteTime(const Event &event) {
+      if (event.fDomain == Domain_Always) {
+         return event.fWhen;
+      }
+      if (powerMode == PowerMode_VLPS) {
+         // Bus clocks stopped
+         return UINT64_MAX;
+      }
+      return event.fWhen+stoppedTime;
+   }
+
+   /**
+    * Get earliest event
+    *
+    * @return Event or nullptr if none
+    */
+   static Event *earliest() {
+      Event *first = nullptr;
+      Time   time  = UINT64_MAX;
+      for (Event *event:events()) {
+         Time when = absoluteTime(*event);
+         if (when < time) {
+            first = event;
+            time  = when;
+         }
+      }
+      return first;
+   }
+
+   /**
+    * Get time of next event
+    *
+    * @return Time or UINT64_MAX if none
+    */
+   static Time next() {
+      if (nextDue == 0) {
+         Event *event = earliest();
+         nextDue = (event == nullptr)?UINT64_MAX:absoluteTime(*event);
+      }
+      return nextDue;
+   }
+
+   /**
+    * Run events that are due
+    */
+   static void run() {
+      while (next() <= currentTime) {
+         Event *event = earliest();
+         remove(*event);
+         bool nested = inModel;
+         inModel = true;
+         event->fAction();
+         inModel = nested;
+      }
+   }
+
+   static void setAction(Event &event, std::function<void()> action) {
+      event.fAction = action;
+   }
+
+   static void add(Event &event) {
+      if (!event.fScheduled) {
+         events().push_back(&event);
+         event.fScheduled = true;
+      }
+      nextDue = 0;
+   }
+
+   static void remove(Event &event) {
+      if (event.fScheduled) {
+         auto &list = events();
+         for (auto it=list.begin(); it!=list.end(); ++it) {
+            if (*it == &event) {
+               list.erase(it);
+               break;
+            }
+         }
+         event.fScheduled = false;
+      }
+      nextDue = 0;
+   }
+};
+
+Time Scheduler::nextDue = 0;
+
+Event::Event(Domain domain, std::function<void()> action) : fDomain(domain), fAction(action) {
+}
+
+Event::~Event() {
+   Scheduler::remove(*this);
+}
+
+void Event::at(Time when) {
+   fWhen = when;
+   Scheduler::add(*this);
+}
+
+void Event::cancel() {
+   Scheduler::remove(*this);
+}
+
+void at(Time when, std::function<void()> action) {
+   Event *event = new Event(Domain_Always, nullptr);
+   Scheduler::setAction(*event, [event, action]() {
+      action();
+      delete event;
+   });
+   event->at(when);
+}
+
+static void refreshDirectReads();
+
+/**
+ * Advance time while the core executes
+ *
+ * @param[in] cycles Number of core cycles
+ */
+static void execute(unsigned cycles) {
+   coreCycles    += cycles;
+   uint64_t scaled = (uint64_t)cycles*SECOND+coreRemainder;
+   currentTime   += scaled/coreClock;
+   coreRemainder  = scaled%coreClock;
+   Scheduler::run();
+   refreshDirectReads();
+}
+
+void coreClockChanged() {
+   coreClock     = getMcgOutClock()/Models::sim.getCoreDivider();
+   coreRemainder = 0;
+}
+
+/*
+ * ============================================================================
+ * NVIC, SCB and SysTick
+ * ============================================================================
+ */
+
+/** PRIMASK values saved by CPSID and restored by MSR PRIMASK */
+static uint32_t primaskStack[32];
+
+/** Number of entries in primaskStack */
+static unsigned primaskDepth = 0;
+
+/** Current PRIMASK */
+static uint32_t primask = 0;
+
+/** Depth of operations done by hardware in a single access */
+static unsigned atomicDepth = 0;
+
+/** Priorities of active exceptions (innermost last) */
+static unsigned activePriority[8];
+
+/** Interrupt numbers of active exceptions (innermost last) */
+static unsigned activeIrq[8];
+
+/** Number of active exceptions */
+static unsigned activeDepth = 0;
+
+/** Priority of thread mode (lower than any interrupt) */
+constexpr unsigned THREAD_PRIORITY = 4;
+
+/** Peripherals owning each interrupt request */
+static Peripheral *irqOwners[32];
+
+/** Firmware handlers for external interrupts (see sim_vectors.cpp) */
+extern "C" void (*const simVectorTable[32])();
+
+/**
+ * NVIC, SCB and SysTick
+ */
+class Core : public Peripheral {
+private:
+   /** Core cycle count when the SysTick counter was last loaded */
+   uint64_t sysTickStart = 0;
+
+public:
+   Core() : Peripheral("Core", SCS_BASE, 0x1000) {
+   }
+
+   virtual void reset() override {
+      memset(registers(fBase), 0, fSize);
+      sysTickStart = 0;
+      enabled      = 0;
+      pended       = 0;
+   }
+
+   NVIC_Type    *nvic()    { return reinterpret_cast<NVIC_Type *>(registers(NVIC_BASE)); }
+   SCB_Type     *scb()     { return reinterpret_cast<SCB_Type *>(registers(SCB_BASE)); }
+   SysTick_Type *sysTick() { return reinterpret_cast<SysTick_Type *>(registers(SysTick_BASE)); }
+
+   /** Enabled interrupts */
+   uint32_t enabled = 0;
+
+   /** Pending interrupts (pended by software or latched from requests) */
+   uint32_t pended  = 0;
+
+   /**
+    * Get interrupt requests from peripherals
+    */
+   uint32_t requests() {
+      uint32_t mask = 0;
+      for (unsigned irqNum=0; irqNum<32; irqNum++) {
+         if ((enabled & (1U<<irqNum)) && (irqOwners[irqNum] != nullptr) &&
+             irqOwners[irqNum]->irqRequest(static_cast<IRQn_Type>(irqNum))) {
+            mask |= 1U<<irqNum;
+         }
+      }
+      return mask;
+   }
+
+   /**
+    * Latch interrupt requests into the pending state as the NVIC does.
+    * An interrupt stays pending if its request goes away before the handler is entered.
+    * Requests of active interrupts are not latched.
+    */
+   void latchRequests() {
+      uint32_t active = 0;
+      for (unsigned depth=0; depth<activeDepth; depth++) {
+         active |= 1U<<activeIrq[depth];
+      }
+      pended |= requests() & ~active;
+   }
+
+   /**
+    * Get priority of interrupt
+    */
+   unsigned priority(unsigned irqNum) {
+      return reinterpret_cast<volatile uint8_t *>(nvic()->IP)[irqNum]>>6;
+   }
+
+   /**
+    * Get highest priority interrupt that would preempt the current execution priority
+    *
+    * @return Interrupt number or -1 if none
+    */
+   int preempting() {
+      latchRequests();
+      uint32_t pending = pended & enabled;
+      unsigned current = (activeDepth == 0)?THREAD_PRIORITY:activePriority[activeDepth-1];
+      int      best    = -1;
+      for (unsigned irqNum=0; pending != 0; irqNum++, pending >>= 1) {
+         if ((pending & 1) && (priority(irqNum) < current) &&
+             ((best < 0) || (priority(irqNum) < priority(best)))) {
+            best = irqNum;
+         }
+      }
+      return best;
+   }
+
+   /**
+    * Get SysTick current value
+    */
+   uint32_t sysTickValue() {
+      uint32_t reload = (sysTick()->LOAD & SysTick_LOAD_RELOAD_Msk)+1;
+      uint64_t ticks  = coreCycles-sysTickStart;
+      if ((sysTick()->CTRL & SysTick_CTRL_CLKSOURCE_Msk) == 0) {
+         // External reference is core/16
+         ticks /= 16;
+      }
+      return (reload-(ticks%reload))%reload;
+   }
+
+   virtual void update(uint32_t offset) override {
+      switch(offset) {
+         case 0x010: // SysTick CTRL
+         case 0x018: // SysTick VAL
+            if (sysTick()->CTRL & SysTick_CTRL_ENABLE_Msk) {
+               sysTick()->VAL = sysTickValue();
+            }
+            break;
+         case 0x100: case 0x180: // ISER, ICER
+            nvic()->ISER[0] = enabled;
+            nvic()->ICER[0] = enabled;
+            break;
+         case 0x200: case 0x280: // ISPR, ICPR
+            latchRequests();
+            nvic()->ISPR[0] = pended & enabled;
+            nvic()->ICPR[0] = nvic()->ISPR[0];
+            break;
+         case 0xD04: // ICSR
+            scb()->ICSR = (activeDepth == 0)?0:(activeIrq[activeDepth-1]+16);
+            break;
+      }
+   }
+
+   virtual void written(uint32_t offset, uint32_t previous) override {
+      switch(offset) {
+         case 0x010: // SysTick CTRL
+            if (sysTick()->CTRL & SysTick_CTRL_TICKINT_Msk) {
+               fail("SysTick interrupt is not modelled");
+            }
+            if ((sysTick()->CTRL & ~previous) & SysTick_CTRL_ENABLE_Msk) {
+               sysTickStart = coreCycles;
+            }
+            break;
+         case 0x018: // SysTick VAL - any write clears
+            sysTickStart   = coreCycles;
+            sysTick()->VAL = 0;
+            break;
+         case 0x100: enabled |=  nvic()->ISER[0]; break;
+         case 0x180: enabled &= ~nvic()->ICER[0]; break;
+         case 0x200: pended  |=  nvic()->ISPR[0]; break;
+         case 0x280: pended  &= ~nvic()->ICPR[0]; break;
+      }
+   }
+};
+
+static Core core __attribute__((init_priority(101)));
+
+void Peripheral::ownIrq(IRQn_Type irqNum) {
+   irqOwners[irqNum] = this;
+}
+
+/**
+ * Take pending interrupts that preempt the current execution priority
+ */
+static void takeInterrupts() {
+   while ((primask == 0) && (atomicDepth == 0)) {
+      int irqNum = core.preempting();
+      if (irqNum < 0) {
+         return;
+      }
+      core.pended &= ~(1U<<irqNum);
+      activePriority[activeDepth] = core.priority(irqNum);
+      activeIrq[activeDepth++]    = irqNum;
+      execute(EXCEPTION_CYCLES/2);
+      simVectorTable[irqNum]();
+      execute(EXCEPTION_CYCLES/2);
+      activeDepth--;
+   }
+}
+
+/** Called on each entry to WAIT or VLPS */
+static std::function<void(PowerMode)> sleepHook;
+
+void setSleepHook(std::function<void(PowerMode)> hook) {
+   sleepHook = hook;
+}
+
+/**
+ * Wait for interrupt
+ *
+ * Sleeps in WAIT or in VLPS (SLEEPDEEP with SMC STOPM=VLPS) until an interrupt
+ * is pending that would preempt if PRIMASK were clear.
+ * Entry to VLPS is aborted (SMC PMCTRL.STOPA) if an interrupt is already pending.
+ */
+static void waitForInterrupt() {
+   bool deep = (core.scb()->SCR & SCB_SCR_SLEEPDEEP_Msk) != 0;
+   if (deep && !Models::smc.isVlpsSelected()) {
+      fail("Only VLPS is modelled for deep sleep");
+   }
+   if (core.preempting() >= 0) {
+      if (deep) {
+         Models::smc.setStopAborted(true);
+      }
+      return;
+   }
+   if (deep) {
+      Models::smc.setStopAborted(false);
+      stopStart = currentTime;
+      powerMode = PowerMode_VLPS;
+   }
+   else {
+      powerMode = PowerMode_Wait;
+   }
+   Scheduler::nextDue = 0;
+   if (sleepHook) {
+      sleepHook(powerMode);
+   }
+   do {
+      Time next = Scheduler::next();
+      if (next == UINT64_MAX) {
+         fail("%s entered with nothing to wake the processor", deep?"VLPS":"WAIT");
+      }
+      currentTime = next;
+      Scheduler::run();
+   } while (core.preempting() < 0);
+   refreshDirectReads();
+
+   if (powerMode == PowerMode_VLPS) {
+      stoppedTime += currentTime-stopStart;
+   }
+   powerMode = PowerMode_Run;
+   Scheduler::nextDue = 0;
+}
+
+/*
+ * ============================================================================
+ * Register access
+ * ============================================================================
+ */
+
+/**
+ * Register region mapped at the hardware address and for the models
+ */
+struct Region {
+   uint32_t  address;  //!< Hardware address
+   uint32_t  size;     //!< Size
+   uint8_t  *view;     //!< Model view (always accessible)
+};
+
+static Region regions[] = {
+      {0x40000000, 0x100000, nullptr},  // Peripheral bridge and GPIO
+      {0xE000E000, 0x1000,   nullptr},  // SysTick, NVIC and SCB
+};
+
+uint8_t *Peripheral::registers(uint32_t address) {
+   for (auto &region:regions) {
+      if ((address >= region.address) && (address < region.address+region.size)) {
+         return region.view+(address-region.address);
+      }
+   }
+   fail("No registers at 0x%08X", address);
+}
+
+/** Peripherals */
+static std::vector<Peripheral *> &peripherals() {
+   static std::vector<Peripheral *> list;
+   return list;
+}
+
+Peripheral::Peripheral(const char *name, uint32_t base, uint32_t size) :
+         fName(name), fBase(base), fSize(size) {
+   peripherals().push_back(this);
+}
+
+/**
+ * Find peripheral at an address
+ *
+ * @return Peripheral or nullptr if none (plain memory)
+ */
+static Peripheral *findPeripheral(uint32_t address) {
+   static Peripheral *last = nullptr;
+   if ((last != nullptr) && last->contains(address)) {
+      return last;
+   }
+   for (Peripheral *peripheral:peripherals()) {
+      if (peripheral->contains(address)) {
+         last = peripheral;
+         return peripheral;
+      }
+   }
+   return nullptr;
+}
+
+/**
+ * Bring the registers the firmware reads without a trap up to date
+ */
+static void refreshDirectReads() {
+   bool nested = inModel;
+   inModel = true;
+   for (Peripheral *peripheral:peripherals()) {
+      if (peripheral->hasDirectReads()) {
+         peripheral->update(0);
+      }
+   }
+   inModel = nested;
+}
+
+/**
+ * Get protection of a page at the hardware address.
+ * Pages holding only peripherals with direct reads are readable, others trap every access.
+ *
+ * @param[in] page Address of page
+ */
+static int pageProtection(uintptr_t page) {
+   bool direct = false;
+   for (Peripheral *peripheral:peripherals()) {
+      uintptr_t base = peripheral->getBase();
+      if ((base < page+0x1000) && (base+peripheral->getSize() > page)) {
+         if (!peripheral->hasDirectReads()) {
+            return PROT_NONE;
+         }
+         direct = true;
+      }
+   }
+   return direct?PROT_READ:PROT_NONE;
+}
+
+/** Access being single stepped */
+static struct {
+   uint32_t    address;
+   bool        write;
+   uint32_t    previous;
+   Peripheral *peripheral;
+} stepping;
+
+/**
+ * Start of a firmware access to a register
+ *
+ * @param[in] address Register address
+ * @param[in] write   Access is a write
+ */
+static void beginAccess(uint32_t address, bool write) {
+   execute(ACCESS_CYCLES);
+   stepping.address    = address;
+   stepping.write      = write;
+   stepping.peripheral = findPeripheral(address);
+   if (stepping.peripheral != nullptr) {
+      inModel = true;
+      stepping.peripheral->update(address-stepping.peripheral->getBase());
+      inModel = false;
+   }
+   stepping.previous = *reinterpret_cast<uint32_t *>(Peripheral::registers(address&~3));
+}
+
+/**
+ * End of a firmware access to a register
+ */
+static void endAccess() {
+   Peripheral *peripheral = stepping.peripheral;
+   if (peripheral != nullptr) {
+      inModel = true;
+      uint32_t offset = stepping.address-peripheral->getBase();
+      if (stepping.write) {
+         peripheral->written(offset, stepping.previous);
+      }
+      else {
+         peripheral->read(offset);
+      }
+      if (peripheral->hasDirectReads()) {
+         peripheral->update(0);
+      }
+      inModel = false;
+   }
+}
+
+/**
+ * General purpose register in the signal context
+ *
+ * @param[in] context Signal context
+ * @param[in] regNum  Register number (0-15 as encoded in ModRM and REX)
+ */
+static greg_t &gpr(ucontext_t *context, unsigned regNum) {
+   static const int map[16] = {
+         REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+         REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+   };
+   return context->uc_mcontext.gregs[map[regNum]];
+}
+
+/**
+ * Try to do a faulting move instruction through the model view
+ *
+ * Handles mov, movzx, movsx and movsxd with a memory operand and mov with an absolute address.
+ *
+ * @param[in] context Signal context
+ * @param[in] address Register address
+ *
+ * @return true if done
+ */
+static bool emulate(ucontext_t *context, uint32_t address) {
+   const uint8_t *ip = reinterpret_cast<const uint8_t *>(context->uc_mcontext.gregs[REG_RIP]);
+   const uint8_t *p  = ip;
+
+   bool    operand16 = false;
+   uint8_t rex       = 0;
+   while (*p == 0x66) {
+      operand16 = true;
+      p++;
+   }
+   if ((*p & 0xF0) == 0x40) {
+      rex = *p++;
+   }
+   unsigned opcode = *p++;
+   if ((opcode >= 0xA0) && (opcode <= 0xA3)) {
+      // mov al/ax/eax/rax to or from an absolute address (moffs64, no ModRM)
+      p += 8;
+      unsigned width = (opcode&1)?((rex&0x08)?8:operand16?2:4):1;
+      bool     write = (opcode&2) != 0;
+      greg_t  &rax   = gpr(context, 0);
+      uint8_t *view  = Peripheral::registers(address);
+      beginAccess(address, write);
+      if (write) {
+         memcpy(view, &rax, width);
+      }
+      else {
+         uint64_t value = 0;
+         memcpy(&value, view, width);
+         switch(width) {
+            case 1: rax = (rax&~0xFFULL)|value;   break;
+            case 2: rax = (rax&~0xFFFFULL)|value; break;
+            default: rax = value;                 break;
+         }
+      }
+      endAccess();
+      context->uc_mcontext.gregs[REG_RIP] = reinterpret_cast<greg_t>(p);
+      return true;
+   }
+   if (opcode == 0x0F) {
+      opcode = 0x0F00|*p++;
+   }
+   unsigned modrm = *p++;
+   unsigned mod   = modrm>>6;
+   unsigned rm    = modrm&7;
+   unsigned reg   = ((modrm>>3)&7)|((rex&0x04)?8:0);
+   if (mod == 3) {
+      return false;
+   }
+   if (rm == 4) {
+      unsigned sib = *p++;
+      if ((mod == 0) && ((sib&7) == 5)) {
+         p += 4;
+      }
+   }
+   if (mod == 1) {
+      p += 1;
+   }
+   else if ((mod == 2) || ((mod == 0) && (rm == 5))) {
+      p += 4;
+   }
+   unsigned size = (rex&0x08)?8:operand16?2:4;
+
+   // Byte register (AH-BH without REX)
+   auto byteReg = [&](unsigned regNum, uint8_t *&byte) {
+      if ((rex == 0) && (regNum >= 4) && (regNum < 8)) {
+         byte = reinterpret_cast<uint8_t *>(&gpr(context, regNum-4))+1;
+      }
+      else {
+         byte = reinterpret_cast<uint8_t *>(&gpr(context, regNum));
+      }
+   };
+   // Write to register as the processor does
+   auto setReg = [&](unsigned width, uint64_t value) {
+      greg_t &r = gpr(context, reg);
+      switch(width) {
+         case 1: { uint8_t *byte; byteReg(reg, byte); *byte = value; break; }
+         case 2: r = (r&~0xFFFFULL)|(value&0xFFFF); break;
+         case 4: r = (uint32_t)value;               break;
+         case 8: r = value;                         break;
+      }
+   };
+   auto getReg = [&](unsigned width) -> uint64_t {
+      if (width == 1) {
+         uint8_t *byte;
+         byteReg(reg, byte);
+         return *byte;
+      }
+      return gpr(context, reg);
+   };
+
+   bool     write;
+   unsigned width;
+   uint64_t value = 0;
+   int      extend = 0;   // Load: 0 zero extend, 1 sign extend
+   switch(opcode) {
+      case 0x8B: write = false; width = size;                     break; // mov r, m
+      case 0x8A: write = false; width = 1;    size = 1;           break; // mov r8, m8
+      case 0x89: write = true;  width = size; value = getReg(size); break; // mov m, r
+      case 0x88: write = true;  width = 1;    value = getReg(1);  break; // mov m8, r8
+      case 0xC7:                                                         // mov m, imm
+         if (((modrm>>3)&7) != 0) {
+            return false;
+         }
+         write = true;
+         width = size;
+         if (operand16) {
+            value = *reinterpret_cast<const uint16_t *>(p);
+            p += 2;
+         }
+         else {
+            value = (uint64_t)(int64_t)*reinterpret_cast<const int32_t *>(p);
+            p += 4;
+         }
+         break;
+      case 0xC6:                                                         // mov m8, imm8
+         if (((modrm>>3)&7) != 0) {
+            return false;
+         }
+         write = true;
+         width = 1;
+         value = *p++;
+         break;
+      case 0x0FB6: write = false; width = 1;                      break; // movzx r, m8
+      case 0x0FB7: write = false; width = 2;                      break; // movzx r, m16
+      case 0x0FBE: write = false; width = 1; extend = 1;          break; // movsx r, m8
+      case 0x0FBF: write = false; width = 2; extend = 1;          break; // movsx r, m16
+      case 0x63:                                                         // movsxd r, m32
+         if (size != 8) {
+            return false;
+         }
+         write = false; width = 4; extend = 1;
+         break;
+      default:
+         return false;
+   }
+   uint8_t *view = Peripheral::registers(address);
+   beginAccess(address, write);
+   if (write) {
+      memcpy(view, &value, width);
+   }
+   else {
+      memcpy(&value, view, width);
+      if (extend && (width < 8)) {
+         unsigned shift = 64-8*width;
+         value = (uint64_t)(((int64_t)(value<<shift))>>shift);
+      }
+      setReg(size, value);
+   }
+   endAccess();
+   context->uc_mcontext.gregs[REG_RIP] = reinterpret_cast<greg_t>(p);
+   return true;
+}
+
+/** Number of accesses done by single stepping */
+unsigned long steppedAccesses = 0;
+
+/** Number of accesses done by emulation */
+unsigned long emulatedAccesses = 0;
+
+/**
+ * Find region holding address
+ */
+static Region *findRegion(uintptr_t address) {
+   for (auto &region:regions) {
+      if ((address >= region.address) && (address < region.address+region.size)) {
+         return &region;
+      }
+   }
+   return nullptr;
+}
+
+/** Instruction of the last SysTick VAL read (0 if another access followed it) */
+static uintptr_t pollIp = 0;
+
+/**
+ * Skip time spent by the firmware polling SysTick VAL in a loop (blocking waits and delays).
+ * Called when consecutive register accesses are SysTick VAL reads by the same instruction.
+ * Nothing the loop can see changes before the next event so time is advanced to it, limited
+ * to a quarter of the SysTick period so the firmware doesn't miss a roll-over.
+ */
+static void skipPolling() {
+   uint64_t period = (core.sysTick()->LOAD & SysTick_LOAD_RELOAD_Msk)+1;
+   if ((core.sysTick()->CTRL & SysTick_CTRL_CLKSOURCE_Msk) == 0) {
+      period *= 16;
+   }
+   Time limit = currentTime+cyclesToTime(period/4, coreClock);
+   Time until = std::min(Scheduler::next(), limit);
+   if (until > currentTime) {
+      execute((unsigned)(((until-currentTime)*coreClock+SECOND-1)/SECOND));
+   }
+}
+
+/**
+ * Firmware access to a register
+ */
+static void segvHandler(int, siginfo_t *info, void *ucontext) {
+   ucontext_t *context = static_cast<ucontext_t *>(ucontext);
+   uintptr_t   address = reinterpret_cast<uintptr_t>(info->si_addr);
+
+   if ((findRegion(address) == nullptr) || inModel) {
+      fail("Invalid access at 0x%lX (pc=%p)%s", (unsigned long)address,
+            reinterpret_cast<void *>(context->uc_mcontext.gregs[REG_RIP]), inModel?" by a model":"");
+   }
+   uintptr_t ip = context->uc_mcontext.gregs[REG_RIP];
+   if (address == reinterpret_cast<uintptr_t>(&SysTick->VAL)) {
+      if (ip == pollIp) {
+         skipPolling();
+      }
+      pollIp = ip;
+   }
+   else {
+      pollIp = 0;
+   }
+   if (emulate(context, address)) {
+      emulatedAccesses++;
+      takeInterrupts();
+      return;
+   }
+   // Let the instruction do the access with the page accessible
+   steppedAccesses++;
+   beginAccess(address, (context->uc_mcontext.gregs[REG_ERR] & 2) != 0);
+   mprotect(reinterpret_cast<void *>(address&~0xFFFUL), 0x1000, PROT_READ|PROT_WRITE);
+   context->uc_mcontext.gregs[REG_EFL] |= 0x100;
+}
+
+/**
+ * Single step of an access completed
+ */
+static void trapHandler(int, siginfo_t *, void *ucontext) {
+   ucontext_t *context = static_cast<ucontext_t *>(ucontext);
+
+   context->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+   mprotect(reinterpret_cast<void *>(stepping.address&~0xFFFUL), 0x1000, pageProtection(stepping.address&~0xFFFUL));
+   endAccess();
+   takeInterrupts();
+}
+
+/** Memory holding the registers */
+static int registerMemory = -1;
+
+/**
+ * Create memory for the registers and map it at the hardware addresses and for the models.
+ * The contents of any previous mapping are copied.
+ */
+static void mapRegisters() {
+   size_t total = 0;
+   for (auto &region:regions) {
+      total += region.size;
+   }
+   int memory = memfd_create("registers", 0);
+   if ((memory < 0) || (ftruncate(memory, total) != 0)) {
+      perror("memfd_create");
+      _exit(2);
+   }
+   off_t offset = 0;
+   for (auto &region:regions) {
+      if (region.view != nullptr) {
+         // Copy only the written pages of the previous memory (the rest are holes)
+         off_t end  = offset+region.size;
+         off_t data = lseek(registerMemory, offset, SEEK_DATA);
+         while ((data >= 0) && (data < end)) {
+            off_t hole = std::min(lseek(registerMemory, data, SEEK_HOLE), end);
+            if (pwrite(memory, region.view+(data-offset), hole-data, data) != hole-data) {
+               perror("pwrite");
+               _exit(2);
+            }
+            data = lseek(registerMemory, hole, SEEK_DATA);
+         }
+      }
+      int   flags    = MAP_SHARED|((region.view == nullptr)?MAP_FIXED_NOREPLACE:MAP_FIXED);
+      void *hardware = mmap(reinterpret_cast<void *>((uintptr_t)region.address), region.size, PROT_NONE, flags, memory, offset);
+      void *view     = mmap(region.view, region.size, PROT_READ|PROT_WRITE,
+            MAP_SHARED|((region.view == nullptr)?0:MAP_FIXED), memory, offset);
+      if ((hardware != reinterpret_cast<void *>((uintptr_t)region.address)) || (view == MAP_FAILED)) {
+         fprintf(stderr, "Unable to map registers at 0x%08X\n", region.address);
+         _exit(2);
+      }
+      region.view = static_cast<uint8_t *>(view);
+      offset += region.size;
+      for (uintptr_t page=region.address; page<region.address+region.size; page+=0x1000) {
+         int protection = pageProtection(page);
+         if (protection != PROT_NONE) {
+            mprotect(reinterpret_cast<void *>(page), 0x1000, protection);
+         }
+      }
+   }
+   if (registerMemory >= 0) {
+      close(registerMemory);
+   }
+   registerMemory = memory;
+}
+
+void separateRegisters() {
+   mapRegisters();
+}
+
+void reset() {
+   mapRegisters();
+
+   struct sigaction action;
+   memset(&action, 0, sizeof(action));
+   action.sa_flags     = SA_SIGINFO|SA_NODEFER;
+   action.sa_sigaction = segvHandler;
+   sigaction(SIGSEGV, &action, nullptr);
+   action.sa_sigaction = trapHandler;
+   sigaction(SIGTRAP, &action, nullptr);
+
+   for (Peripheral *peripheral:peripherals()) {
+      peripheral->reset();
+   }
+   coreClockChanged();
+}
+
+/*
+ * ============================================================================
+ * End of simulation
+ * ============================================================================
+ */
+
+[[noreturn]] void finish(int status) {
+   fflush(stdout);
+   fflush(stderr);
+   _exit(status);
+}
+
+[[noreturn]] void fail(const char *format, ...) {
+   va_list args;
+   va_start(args, format);
+   fflush(stdout);
+   fprintf(stdout, "FAILED at %.3f ms: ", (double)currentTime/MS);
+   vfprintf(stdout, format, args);
+   fprintf(stdout, "\n");
+   va_end(args);
+   finish(100);
+}
+
+} // End namespace Sim
+
+using namespace Sim;
+
+/*
+ * ============================================================================
+ * Processor instructions used by the firmware (see sim_host.h)
+ * ============================================================================
+ */
+
+extern "C" void simAsm(const char *text) {
+   if (strstr(text, "CPSID") != nullptr) {
+      // CriticalSection entry
+      if (primaskDepth >= sizeof(primaskStack)/sizeof(primaskStack[0])) {
+         fail("Critical sections nested too deeply");
+      }
+      primaskStack[primaskDepth++] = primask;
+      primask = 1;
+   }
+   else if (strstr(text, "MSR") != nullptr) {
+      // CriticalSection exit
+      if (primaskDepth == 0) {
+         fail("Critical section exit without entry");
+      }
+      primask = primaskStack[--primaskDepth];
+      takeInterrupts();
+   }
+   else if (strstr(text, "nop") != nullptr) {
+      execute(1);
+      takeInterrupts();
+   }
+   else if (strstr(text, "wfi") != nullptr) {
+      execute(2);
+      waitForInterrupt();
+      execute(2);
+      takeInterrupts();
+   }
+   else if (strstr(text, "bkpt") != nullptr) {
+      simBreakpoint();
+   }
+   // Barriers and compiler barriers take no time
+}
+
+extern "C" uint32_t simGetPrimask(void) {
+   return primask;
+}
+
+extern "C" void simSetPrimask(uint32_t value) {
+   primask = value&1;
+   takeInterrupts();
+}
+
+extern "C" void simBreakpoint(void) {
+   fail("Breakpoint (BKPT) reached in firmware");
+}
+
+extern "C" void simAtomicBegin(void) {
+   atomicDepth++;
+}
+
+extern "C" void simAtomicEnd(void) {
+   atomicDepth--;
+   takeInterrupts();
+}
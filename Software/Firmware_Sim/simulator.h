@@ -0,0 +1,377 @@
+/**
+ * @file    simulator.h
+ * @brief   Register level simulator of the MKL03 running the firmware on the host
+ *
+ * The peripheral registers are memory at their hardware addresses that the firmware can't access.
+ * Each access by the firmware faults. The simulator then brings the register up to date
+ * (e.g. a counter or status flag), lets the single instruction complete and applies
+ * the effect of the access (e.g. write-1-to-clear flags, starting a conversion).
+ * The models see the same registers through a second mapping that is always accessible.
+ *
+ * Time is virtual. Each register access and nop takes a few core cycles and other
+ * computation takes no time. WFI moves time on to the next event.
+ * Interrupts are taken after any register access or nop (as on hardware) by
+ * making the firmware call the handler as if the processor had taken the exception.
+ */
+#ifndef FIRMWARE_SIM_SIMULATOR_H_
+#define FIRMWARE_SIM_SIMULATOR_H_
+
+// The simulator itself is host code (see sim_host.h)
+#undef __asm__
+#undef __asm
+#undef volatile
+
+#include <stdint.h>
+#include <vector>
+#include <functional>
+#include "derivative.h"
+
+namespace Sim {
+
+/// Virtual time in ps
+using Time = uint64_t;
+
+constexpr Time NS     = 1000;
+constexpr Time US     = 1000*NS;
+constexpr Time MS     = 1000*US;
+constexpr Time SECOND = 1000*MS;
+
+/// Core cycles for each register access (the access and the instructions around it)
+constexpr unsigned ACCESS_CYCLES = 4;
+
+/// Core cycles for exception entry and return
+constexpr unsigned EXCEPTION_CYCLES = 30;
+
+/**
+ * Clock domain of an event.
+ * Bus clocked peripherals stop in VLPS. Time in this domain excludes the time spent in VLPS.
+ */
+enum Domain {
+   Domain_Always,  //!< Low power clocks, pins and the outside world
+   Domain_Bus,     //!< Bus clocked peripherals
+};
+
+/**
+ * Get virtual time
+ */
+Time now();
+
+/**
+ * Get time in a clock domain
+ */
+Time now(Domain domain);
+
+/**
+ * Get number of clock edges of a clock since time 0 in a domain
+ *
+ * @param[in] frequency Clock frequency in Hz
+ * @param[in] domain    Domain of clock
+ */
+uint64_t clocks(uint32_t frequency, Domain domain);
+
+/**
+ * Convert clock cycles to time
+ *
+ * @param[in] cycles    Number of clock cycles
+ * @param[in] frequency Clock frequency in Hz
+ *
+ * @return Time for cycles (rounded up)
+ */
+Time cyclesToTime(uint64_t cycles, uint32_t frequency);
+
+/**
+ * Action at a time
+ */
+class Event {
+   friend class Scheduler;
+
+private:
+   Event(const Event &) = delete;
+
+   /** Domain of time */
+   const Domain fDomain;
+
+   /** Time of action in fDomain */
+   Time fWhen = 0;
+
+   /** Waiting for time */
+   bool fScheduled = false;
+
+   /** Action */
+   std::function<void()> fAction;
+
+public:
+   /**
+    * Create event
+    *
+    * @param[in] domain Clock domain of event time
+    * @param[in] action Action at time
+    */
+   Event(Domain domain, std::function<void()> action);
+
+   ~Event();
+
+   /**
+    * Schedule action (replaces any earlier time)
+    *
+    * @param[in] when Time in event's domain
+    */
+   void at(Time when);
+
+   /**
+    * Schedule action after a delay from now
+    *
+    * @param[in] delay Delay
+    */
+   void after(Time delay) {
+      at(now(fDomain)+delay);
+   }
+
+   /**
+    * Cancel action
+    */
+   void cancel();
+
+   /**
+    * Check if scheduled
+    */
+   bool isScheduled() const {
+      return fScheduled;
+   }
+
+   /**
+    * Get time of action in event's domain
+    */
+   Time when() const {
+      return fWhen;
+   }
+};
+
+/**
+ * Schedule a one-off action
+ *
+ * @param[in] when   Time
+ * @param[in] action Action
+ */
+void at(Time when, std::function<void()> action);
+
+/**
+ * Peripheral model
+ *
+ * The model is told about each firmware access to its registers
+ */
+class Peripheral {
+private:
+   Peripheral(const Peripheral &) = delete;
+
+protected:
+   /** Name used in messages */
+   const char *const fName;
+
+   /** Address of registers */
+   const uint32_t    fBase;
+
+   /** Size of registers */
+   const uint32_t    fSize;
+
+   /** Firmware reads the registers without a trap (see allowDirectReads()) */
+   bool              fDirectReads = false;
+
+   /**
+    * Create peripheral
+    *
+    * @param[in] name Name used in messages
+    * @param[in] base Address of registers
+    * @param[in] size Size of registers
+    */
+   Peripheral(const char *name, uint32_t base, uint32_t size);
+
+   /**
+    * Claim an interrupt request line
+    *
+    * @param[in] irqNum Interrupt number
+    */
+   void ownIrq(IRQn_Type irqNum);
+
+   /**
+    * Let the firmware read the registers without a trap.
+    * Only for registers that have no read side effects and whose values depend only on time
+    * and earlier writes. update() is called whenever time advances so they stay current.
+    * The firmware can't wait for such a register to change by polling it as the polling
+    * doesn't advance time.
+    */
+   void allowDirectReads() {
+      fDirectReads = true;
+   }
+
+   /**
+    * Get the model's view of the registers
+    */
+   template<typename T>
+   T *view() const {
+      return reinterpret_cast<T *>(registers(fBase));
+   }
+
+public:
+   virtual ~Peripheral() = default;
+
+   /**
+    * Get the model's view of a register
+    *
+    * @param[in] address Hardware address
+    *
+    * @return Pointer to register
+    */
+   static uint8_t *registers(uint32_t address);
+
+   /**
+    * Check if address is in this peripheral
+    */
+   bool contains(uint32_t address) const {
+      return (address >= fBase) && (address < fBase+fSize);
+   }
+
+   /**
+    * Get address of registers
+    */
+   uint32_t getBase() const {
+      return fBase;
+   }
+
+   /**
+    * Get size of registers
+    */
+   uint32_t getSize() const {
+      return fSize;
+   }
+
+   /**
+    * Check if the firmware reads the registers without a trap
+    */
+   bool hasDirectReads() const {
+      return fDirectReads;
+   }
+
+   /**
+    * Get name
+    */
+   const char *getName() const {
+      return fName;
+   }
+
+   /**
+    * Set registers to reset values
+    */
+   virtual void reset() {}
+
+   /**
+    * Called before the firmware reads or writes a register.
+    * Brings the register up to date.
+    *
+    * @param[in] offset Offset of register
+    */
+   virtual void update(uint32_t offset) {
+      (void)offset;
+   }
+
+   /**
+    * Called after the firmware has read a register
+    *
+    * @param[in] offset Offset of register
+    */
+   virtual void read(uint32_t offset) {
+      (void)offset;
+   }
+
+   /**
+    * Called after the firmware has written a register
+    *
+    * @param[in] offset   Offset of register
+    * @param[in] previous Value of the 32-bit word holding the register before the write
+    */
+   virtual void written(uint32_t offset, uint32_t previous) {
+      (void)offset;
+      (void)previous;
+   }
+
+   /**
+    * Get state of interrupt request
+    *
+    * @param[in] irqNum Interrupt number
+    *
+    * @return true if interrupt requested
+    */
+   virtual bool irqRequest(IRQn_Type irqNum) {
+      (void)irqNum;
+      return false;
+   }
+};
+
+/**
+ * Processor power mode
+ */
+enum PowerMode {
+   PowerMode_Run,   //!< Executing
+   PowerMode_Wait,  //!< WAIT - core stopped, bus clocks running
+   PowerMode_VLPS,  //!< VLPS - core and bus clocks stopped
+};
+
+/**
+ * Get current power mode
+ */
+PowerMode getPowerMode();
+
+/**
+ * Get number of core cycles executed (the core clock stops in WAIT and VLPS)
+ */
+uint64_t getCoreCycles();
+
+/**
+ * Get core clock frequency
+ */
+uint32_t getCoreClock();
+
+/**
+ * Update the core clock after a change of clock source or divider
+ */
+void coreClockChanged();
+
+/**
+ * Set function called on each entry to WAIT or VLPS
+ */
+void setSleepHook(std::function<void(PowerMode)> hook);
+
+/**
+ * Give this process its own copy of the registers (used after fork())
+ */
+void separateRegisters();
+
+/** Number of register accesses done by decoding the instruction */
+extern unsigned long emulatedAccesses;
+
+/** Number of register accesses done by single stepping the instruction */
+extern unsigned long steppedAccesses;
+
+/**
+ * End the simulation of a scenario
+ *
+ * @param[in] status Exit status of the scenario process (0 => scenario ran to the end)
+ */
+[[noreturn]] void finish(int status=0);
+
+/**
+ * Report an error in the firmware or a model and end the scenario
+ *
+ * @param[in] format printf() style format
+ */
+[[noreturn]] void fail(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Set registers to reset values and start trapping register accesses.
+ * Done once before the firmware's static constructors run.
+ */
+void reset();
+
+} // End namespace Sim
+
+#endif /* FIRMWARE_SIM_SIMULATOR_H_ */
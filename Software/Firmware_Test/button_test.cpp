@@ -0,0 +1,222 @@
+/**
+ * @file    button_test.cpp
+ * @brief   Simulation of power button debouncing (buttonDebouncer.h)
+ *
+ * Compares the previous 5 ms poll of the button with the edge interrupt and
+ * one-shot LPTMR used by the tester, for an hour of presses with contact bounce
+ * and short glitches.
+ * The edge and timer interrupt handlers of the debouncer used by the tester are driven
+ * by a simulated button pin and LPTMR. The polling follows the previous pollPowerButton().
+ */
+#include <random>
+#include <vector>
+#include "firmware_test.h"
+#include "buttonDebouncer.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/// Interval between polls (s)
+constexpr double POLL_INTERVAL     = 5e-3;
+
+/// Consistent polls to confirm debouncing (previous DEBOUNCE_COUNT)
+constexpr unsigned DEBOUNCE_COUNT  = 5;
+
+/// Time the button must be stable (debounceTicks)
+constexpr double DEBOUNCE_INTERVAL = 25e-3;
+
+/// Simulated time (s)
+constexpr double DURATION          = 3600;
+
+/// Button level change
+struct Edge {
+   double time;
+   bool   level;
+};
+
+/// Result of a debouncing method
+struct Outcome {
+   unsigned long interrupts = 0;   //!< Button related interrupts
+   unsigned      actions    = 0;   //!< Presses acted on
+   double        delay      = 0;   //!< Sum of time from press to action
+};
+
+/**
+ * Button with polling as previously used
+ *
+ * @param[in] edges     Button edges
+ * @param[in] presses   Time of each press (start of bounce)
+ */
+Outcome poll(const std::vector<Edge> &edges, const std::vector<double> &presses) {
+   Outcome  outcome;
+   bool     lastButton  = false;
+   unsigned stableCount = 0;
+   size_t   next        = 0;
+   bool     level       = false;
+   size_t   press       = 0;
+   for (double time=0; time<DURATION; time+=POLL_INTERVAL) {
+      outcome.interrupts++;
+      while ((next < edges.size()) && (edges[next].time <= time)) {
+         level = edges[next++].level;
+      }
+      if (level != lastButton) {
+         stableCount = 0;
+         lastButton  = level;
+         continue;
+      }
+      if (stableCount < DEBOUNCE_COUNT+1) {
+         stableCount++;
+      }
+      if ((stableCount == DEBOUNCE_COUNT) && level) {
+         while ((press+1 < presses.size()) && (presses[press+1] <= time)) {
+            press++;
+         }
+         outcome.actions++;
+         outcome.delay += time-presses[press];
+      }
+   }
+   return outcome;
+}
+
+/** Simulated time (s) */
+double simTime       = 0;
+
+/** Level of simulated button pin */
+bool   buttonLevel   = false;
+
+/** Simulated LPTMR is running */
+bool   timerRunning  = false;
+
+/** Time simulated LPTMR expires */
+double timerExpiry   = 0;
+
+/** Number of times the pin interrupt flags were cleared */
+size_t flagClears    = 0;
+
+/** Set if a press was acted on with interrupts enabled */
+bool   unmaskedPress = false;
+
+/** Time of each press acted on */
+std::vector<double> pressActions;
+
+/**
+ * Simulated button pin and LPTMR
+ */
+class SimButtonPlatform {
+public:
+   using Lock = CriticalSection;
+
+   static bool readButton() {
+      return buttonLevel;
+   }
+   static void clearButtonFlags() {
+      flagClears++;
+   }
+   static void startDebounceTimer() {
+      timerRunning = true;
+      timerExpiry  = simTime+DEBOUNCE_INTERVAL;
+   }
+   static void stopDebounceTimer() {
+      timerRunning = false;
+   }
+   static void pressed() {
+      unmaskedPress = unmaskedPress || (hostCriticalDepth == 0);
+      pressActions.push_back(simTime);
+   }
+};
+
+using Debouncer = ButtonDebouncer_T<SimButtonPlatform>;
+
+/**
+ * Button with edge interrupt restarting a one-shot timer (PORTB_IRQHandler() and LPTMR0_IRQHandler())
+ *
+ * @param[in] edges     Button edges
+ * @param[in] presses   Time of each press (start of bounce)
+ */
+Outcome edgeTimer(const std::vector<Edge> &edges, const std::vector<double> &presses) {
+   Outcome outcome;
+   size_t  next  = 0;
+   size_t  press = 0;
+   while ((next < edges.size()) || timerRunning) {
+      if (timerRunning && ((next == edges.size()) || (timerExpiry < edges[next].time))) {
+         // Timer interrupt
+         simTime = timerExpiry;
+         outcome.interrupts++;
+         size_t actions = pressActions.size();
+         Debouncer::timerIrqHandler();
+         if (pressActions.size() != actions) {
+            while ((press+1 < presses.size()) && (presses[press+1] <= simTime)) {
+               press++;
+            }
+            outcome.actions++;
+            outcome.delay += simTime-presses[press];
+         }
+      }
+      else {
+         // Port interrupt
+         simTime     = edges[next].time;
+         buttonLevel = edges[next].level;
+         next++;
+         outcome.interrupts++;
+         Debouncer::edgeIrqHandler();
+      }
+   }
+   return outcome;
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::buttonTest() {
+   constexpr unsigned PRESSES_PER_HOUR  = 20;
+   constexpr unsigned GLITCHES_PER_HOUR = 20;
+   constexpr unsigned MAX_BOUNCES       = 8;
+
+   std::mt19937 random(8);
+   std::uniform_real_distribution<double> uniform(0, 1);
+
+   std::vector<Edge>   edges;
+   std::vector<double> presses;
+   auto bounce = [&](double time, bool level) {
+      // Contact bounces 0.1-1 ms apart before settling
+      unsigned bounces = random()%(MAX_BOUNCES+1);
+      for (unsigned count=0; count<bounces; count++) {
+         edges.push_back({time, level});
+         time += 1e-4+9e-4*uniform(random);
+         edges.push_back({time, !level});
+         time += 1e-4+9e-4*uniform(random);
+      }
+      edges.push_back({time, level});
+      return time;
+   };
+   double slot = DURATION/(PRESSES_PER_HOUR+GLITCHES_PER_HOUR);
+   for (unsigned event=0; event<PRESSES_PER_HOUR+GLITCHES_PER_HOUR; event++) {
+      double time = (event+0.2+0.3*uniform(random))*slot;
+      if ((event%2) == 0) {
+         // Press held 100-600 ms
+         presses.push_back(time);
+         time = bounce(time, true);
+         bounce(time+0.1+0.5*uniform(random), false);
+      }
+      else {
+         // Glitch shorter than the debounce interval
+         edges.push_back({time, true});
+         edges.push_back({time+5e-3*uniform(random), false});
+      }
+   }
+   Outcome polled  = poll(edges, presses);
+   Outcome edged   = edgeTimer(edges, presses);
+
+   check(polled.actions == PRESSES_PER_HOUR, "Polling acts on each press once");
+   check(edged.actions  == PRESSES_PER_HOUR, "Edge and timer acts on each press once");
+   check(edged.interrupts*100 < polled.interrupts, "Edge and timer interrupts much fewer than polling");
+   check(flagClears == edges.size(), "Pin interrupt flags cleared on each edge");
+   check(!unmaskedPress, "Press acted on with interrupts masked");
+
+   printf("%u presses (up to %u bounces) and %u glitches per hour\n", PRESSES_PER_HOUR, MAX_BOUNCES, GLITCHES_PER_HOUR);
+   printf("  5 ms polling : %7lu button ISRs/hour, press->power mean %.1f ms\n",
+         polled.interrupts, 1e3*polled.delay/polled.actions);
+   printf("  edge + LPTMR : %7lu button ISRs/hour, press->power mean %.1f ms\n",
+         edged.interrupts,  1e3*edged.delay/edged.actions);
+}
@@ -0,0 +1,103 @@
+/*
+ ============================================================================
+ * @file    firmware_test.cpp
+ * @brief   Host program checking the hardware-free parts of the CPLD tester firmware
+ *
+ *  Usage:
+ *    firmware_test              Run all checks and benchmarks (except long checks)
+ *    firmware_test <group>...   Run the named check groups e.g. firmware_test vectors
+ ============================================================================
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "firmware_test.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+// Host versions of the hooks in usbdm_host.h
+volatile ErrorCode USBDM::errorCode = E_NO_ERROR;
+
+volatile unsigned USBDM::hostCriticalDepth = 0;
+
+uint32_t USBDM::getTicks() {
+   auto now = std::chrono::steady_clock::now().time_since_epoch();
+   // SysTick counts down at the core clock (48 MHz)
+   return TIMER_MASK&~static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()*48/1000);
+}
+
+void USBDM::enableNvicInterrupt(IRQn_Type, uint32_t) {
+}
+
+void mapHostPeripherals() {
+   static const struct {
+      uintptr_t address;
+      size_t    size;
+   } regions[] = {
+         {0x40000000, 0x100000},  // Peripheral bridge and GPIO
+         {0xE000E000, 0x1000},    // SysTick, NVIC and SCB
+   };
+   for (const auto &region:regions) {
+      void *mapped = mmap(reinterpret_cast<void *>(region.address), region.size,
+            PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED_NOREPLACE, -1, 0);
+      if (mapped != reinterpret_cast<void *>(region.address)) {
+         fprintf(stderr, "Unable to map registers at 0x%08lX\n", static_cast<unsigned long>(region.address));
+         exit(2);
+      }
+   }
+}
+
+/** Number of failed checks */
+static unsigned failures = 0;
+
+void FirmwareTest::check(bool ok, const char *description) {
+   if (!ok) {
+      printf("FAILED: %s\n", description);
+      failures++;
+   }
+}
+
+/**
+ * Check groups
+ */
+static const struct {
+   const char *name;
+   void      (*run)();
+   bool        byDefault;  //!< Run when no groups are named
+} groups[] = {
+      {"vectors",   vectorEngineTest,     true},
+      {"fmax",      fmaxSearchTest,       true},
+      {"button",    buttonTest,           true},
+      {"idle",      idleManagerTest,      true},
+      {"format",    formatTest,           true},
+      {"ultoa",     ultoaTest,            true},
+      {"ultoa-all", ultoaExhaustiveTest,  false},
+      {"float",     floatTest,            true},
+      {"formatstr", formatStringTest,     true},
+      {"queue",     queueTest,            true},
+      {"parser",    lineParserTest,       true},
+      {"hexdump",   hexDumpTest,          true},
+      {"lpuart",    lpuartTest,           true},
+      {"spibaud",   spiBaudTest,          true},
+};
+
+int main(int argc, char *argv[]) {
+   mapHostPeripherals();
+   for (const auto &group:groups) {
+      bool selected = (argc < 2) && group.byDefault;
+      for (int arg=1; arg<argc; arg++) {
+         selected = selected || (strcmp(argv[arg], group.name) == 0);
+      }
+      if (selected) {
+         printf("== %s\n", group.name);
+         group.run();
+      }
+   }
+   if (failures != 0) {
+      printf("%u checks failed\n", failures);
+      return 1;
+   }
+   printf("Firmware check passed\n");
+   return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file    firmware_test.h
+ * @brief   Checks of the CPLD tester firmware run on the host
+ *
+ * Each check group exercises the unmodified firmware headers against a reference
+ * or a simulation and prints the measurements it makes.
+ */
+#ifndef FIRMWARE_TEST_H_
+#define FIRMWARE_TEST_H_
+
+#include <chrono>
+
+namespace FirmwareTest {
+
+/**
+ * Report check result
+ *
+ * @param[in] ok          Result of check
+ * @param[in] description What was checked
+ */
+void check(bool ok, const char *description);
+
+/**
+ * Time an operation
+ *
+ * @param[in] operation Operation to time
+ *
+ * @return Time taken in ns
+ */
+template<typename Operation>
+double timeNs(Operation operation) {
+   auto start = std::chrono::steady_clock::now();
+   operation();
+   return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count();
+}
+
+/**
+ * Prevent the compiler from discarding a value computed for timing
+ *
+ * @param[in] value Value to keep
+ */
+template<typename T>
+void keep(const T &value) {
+   __asm__ volatile("" : : "g"(&value) : "memory");
+}
+
+/// Vector engine receiver and application (vectorEngine.h)
+void vectorEngineTest();
+
+/// Fmax search (fmaxSearch.h)
+void fmaxSearchTest();
+
+/// Power button debouncing simulation
+void buttonTest();
+
+/// Idle manager (idleManager.h)
+void idleManagerTest();
+
+/// FormattedIO bulk output (formatted_io.h, stringFormatter.h, lpuart.h)
+void formatTest();
+
+/// Digit conversion (FormattedIO::ultoa())
+void ultoaTest();
+
+/// Digit conversion of every 32-bit value (only run when named)
+void ultoaExhaustiveTest();
+
+/// Float and double formatting (FormattedIO::write(double))
+void floatTest();
+
+/// Compile-time format strings (FormattedIO::format<>())
+void formatStringTest();
+
+/// Single-producer/single-consumer queue (uart_queue.h)
+void queueTest();
+
+/// Command line parser (lineParser.h)
+void lineParserTest();
+
+/// Hex dump (FormattedIO::writeHexDump())
+void hexDumpTest();
+
+/// Buffered LPUART overflow policies and text block chains (lpuart.h)
+void lpuartTest();
+
+/// SPI baud rate calculation (Spi::calculateBr())
+void spiBaudTest();
+
+} // End namespace FirmwareTest
+
+#endif /* FIRMWARE_TEST_H_ */
@@ -0,0 +1,240 @@
+/**
+ * @file    float_test.cpp
+ * @brief   Checks of the integer-only float formatter (FormattedIO::write(double/float))
+ *
+ * Output is compared with snprintf("%.*f") or snprintf("%.*e") in the d.dddEn form used
+ * when the scaled value does not fit in 32 bits or would print as zero.
+ * Engineering notation is compared with a long double calculation.
+ */
+#include <random>
+#include <string>
+#include "firmware_test.h"
+#include "stringFormatter.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * StringFormatter with access to engineering notation conversion
+ */
+class Formatter : public StringFormatter {
+public:
+   using StringFormatter::StringFormatter;
+   using FormattedIO::convertToEngineeringNotation;
+};
+
+char      buffer[200];
+Formatter formatter(buffer);
+
+/**
+ * Format value with the given precision
+ */
+template<typename T>
+std::string format(T value, unsigned precision) {
+   formatter.clear();
+   formatter.setFloatFormat(precision, Padding_None, 0);
+   formatter.write(value);
+   return formatter.toString();
+}
+
+/**
+ * Expected formatting using snprintf()
+ */
+std::string reference(double value, int precision) {
+   if (std::isnan(value)) {
+      return "Nan";
+   }
+   if (std::isinf(value)) {
+      return (value<0)?"-Inf":"Inf";
+   }
+   if (value == 0) {
+      // Zero is written without sign
+      value = 0.0;
+   }
+   double magnitude = fabs(value);
+   char text[400];
+   snprintf(text, sizeof(text), "%.*f", precision, magnitude);
+
+   // Fixed if the scaled value is non-zero and fits in 32 bits
+   bool fixed = true;
+   if (magnitude != 0) {
+      std::string digits;
+      for (const char *ptr=text; *ptr!='\0'; ptr++) {
+         if (*ptr != '.') {
+            digits += *ptr;
+         }
+      }
+      size_t first = digits.find_first_not_of('0');
+      digits = (first == std::string::npos)?"0":digits.substr(first);
+      bool nonZero = static_cast<long double>(magnitude) >= powl(10.0L, -precision);
+      fixed = nonZero && ((digits.size() < 10) || ((digits.size() == 10) && (digits <= "4294967295")));
+   }
+   std::string result;
+   if (fixed) {
+      result = text;
+   }
+   else {
+      snprintf(text, sizeof(text), "%.*e", precision, magnitude);
+      std::string scientific(text);
+      size_t exponentPos = scientific.find('e');
+      int    exponent    = atoi(scientific.c_str()+exponentPos+1);
+      result = scientific.substr(0, exponentPos);
+      if (exponent != 0) {
+         result += "E"+std::to_string(exponent);
+      }
+   }
+   if (std::signbit(value)) {
+      result = "-"+result;
+   }
+   return result;
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::floatTest() {
+   std::mt19937_64 random(13);
+   unsigned long mismatches = 0;
+   unsigned long cases      = 0;
+   auto compare = [&](double value, unsigned precision) {
+      cases++;
+      std::string result = format(value, precision);
+      std::string expected = reference(value, precision);
+      if (result != expected) {
+         if (mismatches++ < 5) {
+            printf("%.17g precision %u: \"%s\" expected \"%s\"\n", value, precision, result.c_str(), expected.c_str());
+         }
+      }
+   };
+   static const double specials[] = {
+         0.0, -0.0, 1.0, -1.0, 0.5, 0.0005, 0.00049999, 0.0015, 0.0025, 1e-320, 5e-324,
+         1.7976931348623157e308, 2.2250738585072014e-308,
+         4294967.295, 4294967.2955, 4294967.2965, 4294967295.0, 4294967295.4, 4294967295.5, 4294967296.0,
+         NAN, -NAN, INFINITY, -INFINITY, 123.456, 999.9995, 9.9999999999, 1e10, 1e-10, 0.1, 0.2, 0.3,
+   };
+   for (double value:specials) {
+      for (unsigned precision=0; precision<=9; precision++) {
+         compare(value, precision);
+      }
+   }
+   for (unsigned trial=0; trial<1000000; trial++) {
+      unsigned precision = random()%10;
+
+      // Any bit pattern including denormals, NaN and Inf
+      uint64_t bits = random();
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      compare(value, precision);
+
+      // Values across +-1e12
+      compare(static_cast<double>(static_cast<int64_t>(random()))/(1LL<<62)*pow(10.0, static_cast<int>(random()%24)-12), precision);
+
+      // Exact binary ties
+      compare(static_cast<double>(random()%100000)/(1<<(random()%12)), precision);
+   }
+   check(mismatches == 0, "double formatting matches snprintf()");
+
+   mismatches = 0;
+   // Smallest and largest mantissa of every exponent - floats use a smaller BigNumber
+   for (uint32_t biasedExponent=0; biasedExponent<0xFF; biasedExponent++) {
+      for (uint32_t mantissa:{0x000001U, 0x7FFFFFU}) {
+         uint32_t bits = (biasedExponent<<23)|mantissa;
+         float value;
+         memcpy(&value, &bits, sizeof(value));
+         for (unsigned precision=0; precision<=9; precision++) {
+            cases++;
+            if (format(value, precision) != reference(value, precision)) {
+               mismatches++;
+            }
+         }
+      }
+   }
+   for (unsigned trial=0; trial<1000000; trial++) {
+      uint32_t bits = random();
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      unsigned precision = random()%10;
+      cases++;
+      if (format(value, precision) != reference(value, precision)) {
+         mismatches++;
+      }
+   }
+   check(mismatches == 0, "float formatting matches snprintf()");
+
+   // Engineering notation
+   mismatches = 0;
+   for (unsigned trial=0; trial<1000000; trial++) {
+      double value = static_cast<double>(static_cast<int64_t>(random()))/(1LL<<62)*pow(10.0, static_cast<int>(random()%30)-15);
+      if (value == 0) {
+         continue;
+      }
+      int precision = random()%4;
+      formatter.setFloatFormat(precision, Padding_None, 0);
+      bool     isNegative;
+      unsigned mantissa;
+      int      exponent;
+      formatter.convertToEngineeringNotation(value, isNegative, mantissa, exponent);
+
+      char text[64];
+      snprintf(text, sizeof(text), "%.17e", fabs(value));
+      int decade            = atoi(strchr(text, 'e')+1);
+      int expectedExponent  = decade-(((decade%3)+3)%3);
+      unsigned scale = 1;
+      for (int digit=0; digit<precision; digit++) {
+         scale *= 10;
+      }
+      unsigned expectedMantissa = llroundl(fabsl(static_cast<long double>(value))*powl(10.0L, precision-expectedExponent));
+      if (expectedMantissa >= 1000*scale) {
+         // Rounded up into the next group of three decades
+         expectedExponent += 3;
+         expectedMantissa  = llroundl(fabsl(static_cast<long double>(value))*powl(10.0L, precision-expectedExponent));
+      }
+      if ((mantissa != expectedMantissa) || (exponent != expectedExponent) || (isNegative != (value<0))) {
+         mismatches++;
+      }
+   }
+   check(mismatches == 0, "Engineering notation matches long double calculation");
+
+   // Padding and width (width is of the integer part) as the original code
+   formatter.clear();
+   for (Padding padding:{Padding_None, Padding_LeadingSpaces, Padding_LeadingZeroes}) {
+      for (double value:{3.14159, -3.14159, -1234.5, 0.0}) {
+         formatter.setFloatFormat(2, padding, 8);
+         formatter.write(value).write('|');
+      }
+   }
+   check(strcmp(formatter.toString(),
+         "3.14|-3.14|-1234.50|0.00|"
+         "       3.14|      -3.14|   -1234.50|       0.00|"
+         "00000003.14|-0000003.14|-0001234.50|00000000.00|") == 0, "Float padding and width");
+
+   // Speed for values like target Vdd
+   double values[1024];
+   for (auto &value:values) {
+      value = static_cast<double>(random()%3300000)/1000000.0;
+   }
+   constexpr unsigned REPEATS = 1000;
+   size_t total = 0;
+   formatter.setFloatFormat(3, Padding_None, 0);
+   double formatNs = timeNs([&]() {
+      for (unsigned repeat=0; repeat<REPEATS; repeat++) {
+         for (double value:values) {
+            formatter.clear();
+            formatter.write(value);
+            total += buffer[0];
+         }
+      }
+   });
+   double snprintfNs = timeNs([&]() {
+      for (unsigned repeat=0; repeat<REPEATS; repeat++) {
+         for (double value:values) {
+            snprintf(buffer, sizeof(buffer), "%.3f", value);
+            total += buffer[0];
+         }
+      }
+   });
+   keep(total);
+   printf("%lu cases. \"%%.3f\" in [0, 3.3): formatter %.1f ns/value, snprintf %.1f ns/value\n",
+         cases, formatNs/(REPEATS*1024), snprintfNs/(REPEATS*1024));
+}
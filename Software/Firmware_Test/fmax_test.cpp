@@ -0,0 +1,94 @@
+/**
+ * @file    fmax_test.cpp
+ * @brief   Checks of the Fmax search (fmaxSearch.h)
+ *
+ * The search is run against a simulated device that passes below a threshold frequency.
+ */
+#include <random>
+#include "firmware_test.h"
+#include "fmaxSearch.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * Number of halvings needed to bring a range within resolution
+ */
+unsigned halvings(uint32_t range, uint32_t resolution) {
+   unsigned count = 0;
+   while (range > resolution) {
+      range = range-(range>>1);
+      count++;
+   }
+   return count;
+}
+
+/**
+ * Search against a device passing at frequencies up to threshold
+ *
+ * @param[in] minimum     Lowest frequency to check (Hz)
+ * @param[in] maximum     Highest frequency to check (Hz)
+ * @param[in] resolution  Search resolution (Hz)
+ * @param[in] threshold   Highest frequency device passes at
+ *
+ * @return Number of checks made
+ */
+unsigned searchDevice(uint32_t minimum, uint32_t maximum, uint32_t resolution, uint32_t threshold) {
+   bool inRange = true;
+   unsigned calls = 0;
+   auto device = [&](uint32_t frequency) {
+      calls++;
+      inRange = inRange && (frequency >= minimum) && ((frequency <= maximum) || (frequency == minimum));
+      return frequency <= threshold;
+   };
+   FmaxResult result = searchFmax(minimum, maximum, resolution, device);
+
+   check(inRange, "Fmax checks only within range");
+   check(calls == result.steps, "Fmax step count");
+   if (threshold < minimum) {
+      check((result.fmax == 0) && (result.firstFail == minimum), "Fmax fail at minimum");
+   }
+   else if ((threshold >= maximum) || (maximum <= minimum)) {
+      check((result.fmax == ((maximum <= minimum)?minimum:maximum)) && (result.firstFail == 0), "Fmax pass at maximum");
+   }
+   else {
+      check((result.fmax <= threshold) && (result.firstFail > threshold), "Fmax brackets threshold");
+      check((result.firstFail-result.fmax) <= ((resolution == 0)?1:resolution), "Fmax within resolution");
+      check(result.steps <= 2+halvings(maximum-minimum, (resolution == 0)?1:resolution), "Fmax steps bound");
+   }
+   return result.steps;
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::fmaxSearchTest() {
+   // Range and resolution used by the tester (TPM clock 48 MHz, MOD >= 202)
+   constexpr uint32_t MINIMUM    = 1000;
+   constexpr uint32_t MAXIMUM    = 48000000/202;
+   constexpr uint32_t RESOLUTION = 100;
+
+   unsigned maxSteps = 0;
+   for (uint32_t threshold:{0u, MINIMUM-1, MINIMUM, MINIMUM+1, MINIMUM+RESOLUTION, MAXIMUM/2,
+                            MAXIMUM-RESOLUTION, MAXIMUM-1, MAXIMUM, MAXIMUM+1}) {
+      unsigned steps = searchDevice(MINIMUM, MAXIMUM, RESOLUTION, threshold);
+      maxSteps = (steps>maxSteps)?steps:maxSteps;
+   }
+   std::mt19937 random(4);
+   for (unsigned trial=0; trial<100000; trial++) {
+      unsigned steps = searchDevice(MINIMUM, MAXIMUM, RESOLUTION, MINIMUM+(random()%(MAXIMUM-MINIMUM)));
+      maxSteps = (steps>maxSteps)?steps:maxSteps;
+   }
+   // Degenerate ranges and resolutions
+   for (uint32_t threshold=0; threshold<=12; threshold++) {
+      searchDevice(5, 10, 0, threshold);
+      searchDevice(5, 10, 1, threshold);
+      searchDevice(5, 10, 100, threshold);
+      searchDevice(5, 5, 1, threshold);
+      searchDevice(5, 4, 1, threshold);
+   }
+   searchDevice(0, 0xFFFFFFFF, 1, 0x80000001);
+   searchDevice(0, 0xFFFFFFFF, 1, 0xFFFFFFFE);
+   printf("Fmax search %u-%u Hz at %u Hz: at most %u steps\n", MINIMUM, MAXIMUM, RESOLUTION, maxSteps);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file    format_string_test.cpp
+ * @brief   Checks of compile-time format strings (FormattedIO::format<>())
+ *
+ * Each format is compared with the equivalent chain of write() calls.
+ */
+#include <random>
+#include <string>
+#include "firmware_test.h"
+#include "stringFormatter.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * Formatter counting output only
+ */
+class NullFormatter : public FormattedIO {
+public:
+   size_t count = 0;
+
+protected:
+   virtual void _writeChar(char) override {
+      count++;
+   }
+   virtual void _writeChars(const char *, size_t size) override {
+      count += size;
+   }
+};
+
+static constexpr char okFormat[]      = "OK {} {} {} 0x{:x}\n";
+static constexpr char vddFormat[]     = "Vdd={} mV, state={:x}\n";
+static constexpr char fieldFormat[]   = "[{:08x}][{:4}][{:<6}][{:b}][{:o}][{:X}][{:d}]";
+static constexpr char braceFormat[]   = "{{{}}} }}{{";
+static constexpr char literalFormat[] = "No fields\n";
+static constexpr char mixedFormat[]   = "{}{}{}";
+
+/// Chain of writes equivalent to okFormat
+__attribute__((noinline)) void chainOk(FormattedIO &io, unsigned a, unsigned b, unsigned c, unsigned d) {
+   io.write("OK ").write(a).write(' ').write(b).write(' ').write(c).write(" 0x").write(d, Radix_16).writeln();
+}
+
+/// okFormat
+__attribute__((noinline)) void formatOk(FormattedIO &io, unsigned a, unsigned b, unsigned c, unsigned d) {
+   io.format<okFormat>(a, b, c, d);
+}
+
+/// Chain of writes equivalent to vddFormat
+__attribute__((noinline)) void chainVdd(FormattedIO &io, int vdd, unsigned state) {
+   io.write("Vdd=").write(vdd).write(" mV, state=").write(state, Radix_16).writeln();
+}
+
+/// vddFormat
+__attribute__((noinline)) void formatVdd(FormattedIO &io, int vdd, unsigned state) {
+   io.format<vddFormat>(vdd, state);
+}
+
+/// Chain of writes equivalent to fieldFormat (restoring the integer format)
+void chainFields(FormattedIO &io, unsigned a, int b, int c, unsigned d, unsigned e, unsigned f, int g) {
+   IoFormat saved;
+   io.getFormat(saved);
+   io.write('[').setPadding(Padding_LeadingZeroes).setWidth(8).write(a, Radix_16).write("][");
+   io.setPadding(Padding_LeadingSpaces).setWidth(4).write(b).write("][");
+   io.setPadding(Padding_TrailingSpaces).setWidth(6).write(c).write("][");
+   io.setFormat(saved);
+   io.write(d, Radix_2).write("][").write(e, Radix_8).write("][").write(f, Radix_16).write("][").write(g).write(']');
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::formatStringTest() {
+   static char formatBuffer[200];
+   static char chainBuffer[200];
+   StringFormatter formatted(formatBuffer);
+   StringFormatter chained(chainBuffer);
+
+   std::mt19937 random(14);
+   bool same = true;
+   for (unsigned trial=0; trial<200000; trial++) {
+      unsigned a = random(), b = random()>>(random()%32), c = random()%1000, d = random();
+      int      vdd = static_cast<int>(random())>>(random()%32);
+
+      // Current integer format applies to {} and {:x} fields
+      Padding padding = static_cast<Padding>(random()%4);
+      int     width   = random()%12;
+      formatted.clear().setPadding(padding).setWidth(width);
+      chained.clear().setPadding(padding).setWidth(width);
+
+      formatOk(formatted, a, b, c, d);
+      chainOk(chained, a, b, c, d);
+      formatVdd(formatted, vdd, b);
+      chainVdd(chained, vdd, b);
+      formatted.format<fieldFormat>(a, vdd, static_cast<int>(c)-500, b&0xFF, c, d, vdd);
+      chainFields(chained, a, vdd, static_cast<int>(c)-500, b&0xFF, c, d, vdd);
+      formatted.format<mixedFormat>("text", static_cast<char>('a'+c%26), vdd);
+      chained.write("text").write(static_cast<char>('a'+c%26)).write(vdd);
+      same = same && (strcmp(formatted.toString(), chained.toString()) == 0);
+   }
+   check(same, "format<>() matches chain of write()");
+
+   formatted.clear().setPadding(Padding_None).setWidth(0);
+   formatted.format<braceFormat>(7).format<literalFormat>();
+   check(strcmp(formatted.toString(), "{7} }{No fields\n") == 0, "format<>() literal braces and text");
+
+   // Call cost
+   constexpr unsigned CALLS = 5000000;
+   NullFormatter null;
+   double chainOkNs   = timeNs([&]() { for (unsigned index=0; index<CALLS; index++) chainOk(null, index, index*3, index*7, index); });
+   double formatOkNs  = timeNs([&]() { for (unsigned index=0; index<CALLS; index++) formatOk(null, index, index*3, index*7, index); });
+   double chainVddNs  = timeNs([&]() { for (unsigned index=0; index<CALLS; index++) chainVdd(null, static_cast<int>(index)-100, index); });
+   double formatVddNs = timeNs([&]() { for (unsigned index=0; index<CALLS; index++) formatVdd(null, static_cast<int>(index)-100, index); });
+   keep(null.count);
+   printf("ns/call                     chain  format\n");
+   printf("  \"OK {} {} {} 0x{:x}\\n\"     %6.1f  %6.1f\n", chainOkNs/CALLS,  formatOkNs/CALLS);
+   printf("  \"Vdd={} mV, state={:x}\\n\" %6.1f  %6.1f\n", chainVddNs/CALLS, formatVddNs/CALLS);
+}
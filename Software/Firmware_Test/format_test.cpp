@@ -0,0 +1,169 @@
+/**
+ * @file    format_test.cpp
+ * @brief   Checks of the bulk output path of FormattedIO (formatted_io.h)
+ *
+ * Output through _writeChars() (StringFormatter and the buffered LPUART) is compared
+ * with the character at a time path and with output of the original code.
+ */
+#include <random>
+#include <string>
+#include "firmware_test.h"
+#include "host_lpuart.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * Formatter using only the character at a time path
+ */
+class CharFormatter : public FormattedIO {
+public:
+   std::string text;
+
+protected:
+   virtual void _writeChar(char ch) override {
+      text += ch;
+   }
+};
+
+/**
+ * Fixed sequence of writes
+ */
+void writeFixed(FormattedIO &io) {
+   static const int      signedValues[]   = {0, -1, 127, -32768, 2147483647};
+   static const uint8_t  unsignedValues[] = {0, 1, 9, 10, 255};
+   io.write("Text ").write(42).write(' ').write(-42).writeln();
+   io.write(0xBEEF, Radix_16).write(',').write(5, Radix_2).write(',').write(8, Radix_8).writeln();
+   io.setWidth(8).setPadding(Padding_LeadingZeroes).write(123).write('|').write(-123).writeln();
+   io.setPadding(Padding_LeadingSpaces).write(123).write('|').write(-123).writeln();
+   io.setPadding(Padding_TrailingSpaces).write(123).write('|').writeln();
+   io.setPadding(Padding_None).setWidth(0);
+   io.writeArray(signedValues).writeln();
+   io.writeArray(unsignedValues, Radix_16).writeln();
+}
+
+/// Output of writeFixed() from the character at a time code before the bulk path was added
+const char fixedOutput[] =
+   "Text 42 -42\n"
+   "BEEF,101,10\n"
+   "00000123|-0000123\n"
+   "     123|    -123\n"
+   "123     |\n"
+   "{ 0, -1, 127, -32768, 2147483647, }\n"
+   "{ 0x0, 0x1, 0x9, 0xA, 0xFF, }\n";
+
+/**
+ * Random sequence of writes
+ */
+void writeRandom(FormattedIO &io, uint32_t seed) {
+   std::mt19937 random(seed);
+   static const Radix radices[] = {Radix_2, Radix_8, Radix_10, Radix_16};
+   for (unsigned step=0; step<20; step++) {
+      switch(random()%6) {
+         case 0: {
+            char text[20];
+            unsigned length = random()%sizeof(text);
+            for (unsigned index=0; index<length; index++) {
+               text[index] = " abc\n"[random()%5];
+            }
+            text[length] = '\0';
+            io.write(text);
+         }
+         break;
+         case 1:
+            io.write(static_cast<long>(random())-(1L<<31));
+            break;
+         case 2:
+            io.write(static_cast<unsigned long>(random()), radices[random()%4]);
+            break;
+         case 3:
+            io.setWidth(random()%12).setPadding(static_cast<Padding>(random()%4));
+            break;
+         case 4: {
+            int16_t values[5];
+            for (auto &value:values) {
+               value = random();
+            }
+            io.writeArray(values, random()%6, radices[random()%4]);
+         }
+         break;
+         case 5:
+            io.writeln();
+            break;
+      }
+   }
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::formatTest() {
+   static char buffer[2000];
+   StringFormatter formatter(buffer);
+   CharFormatter   reference;
+
+   writeFixed(reference);
+   check(reference.text == fixedOutput, "Character path output unchanged");
+   writeFixed(formatter);
+   check(reference.text == formatter.toString(), "StringFormatter output unchanged");
+
+   HostLpuart<256> uart;
+   uart.reset();
+   writeFixed(uart);
+   uart.transmit();
+   std::string expected;
+   for (char ch:reference.text) {
+      expected += ch;
+      if (ch == '\n') {
+         expected += '\r';
+      }
+   }
+   check(uart.sent == expected, "LPUART output unchanged");
+
+   // Random writes
+   bool same = true;
+   bool truncated = true;
+   for (uint32_t seed=0; seed<20000; seed++) {
+      CharFormatter check;
+      writeRandom(check, seed);
+      StringFormatter bulk(buffer);
+      writeRandom(bulk, seed);
+      same = same && (check.text == bulk.toString());
+
+      // Small buffer truncates
+      char small[40];
+      StringFormatter smallFormatter(small);
+      writeRandom(smallFormatter, seed);
+      truncated = truncated && (check.text.substr(0, sizeof(small)-1) == smallFormatter.toString());
+   }
+   check(same, "StringFormatter bulk path matches character path");
+   check(truncated, "StringFormatter truncates at end of buffer");
+
+   // Speed of a line of text, two numbers and an array
+   {
+      constexpr unsigned ITERATIONS = 200000;
+      static const int values[16] = {1, 22, 333, 4444, 55555, -6, -77, -888, 9, 10, 11, 12, 13, 14, 15, 16};
+      auto line = [](FormattedIO &io, unsigned iteration) {
+         io.write("Vdd measurement ").write(iteration).write(" mV ").write(iteration*7, Radix_16).writeArray(values).writeln();
+      };
+      size_t bytes = 0;
+      double formatterNs = timeNs([&]() {
+         for (unsigned iteration=0; iteration<ITERATIONS; iteration++) {
+            formatter.clear();
+            line(formatter, iteration);
+            bytes += strlen(formatter.toString());
+         }
+      });
+      size_t sent = 0;
+      double uartNs = timeNs([&]() {
+         for (unsigned iteration=0; iteration<ITERATIONS; iteration++) {
+            uart.sent.clear();
+            line(uart, iteration);
+            uart.transmit();
+            sent += uart.sent.size();
+         }
+      });
+      printf("StringFormatter %.0f MB/s, LPUART queue and transmit %.0f MB/s\n", 1e3*bytes/formatterNs, 1e3*sent/uartNs);
+   }
+}
@@ -0,0 +1,164 @@
+/**
+ * @file    hex_dump_test.cpp
+ * @brief   Checks of the hex dump (FormattedIO::writeHexDump())
+ *
+ * Dumps of every start alignment are compared with a reference built with snprintf().
+ */
+#include <algorithm>
+#include <random>
+#include <string>
+#include "firmware_test.h"
+#include "formatted_io.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * Formatter collecting or just counting output
+ */
+class DumpFormatter : public FormattedIO {
+public:
+   std::string text;
+   bool        collect = true;
+   size_t      total   = 0;
+
+protected:
+   virtual void _writeChar(char ch) override {
+      total++;
+      if (collect) {
+         text += ch;
+      }
+   }
+   virtual void _writeChars(const char *data, size_t size) override {
+      total += size;
+      if (collect) {
+         text.append(data, size);
+      }
+   }
+};
+
+/**
+ * Reference hex dump
+ */
+std::string referenceDump(const uint8_t *data, size_t size, uint32_t visibleAddress, unsigned bytesPerLine, bool showAscii) {
+   char        buffer[20];
+   std::string text = "          ";
+   for (unsigned column=0; column<bytesPerLine; column++) {
+      snprintf(buffer, sizeof(buffer), (column+1 < bytesPerLine)?"%02X ":"%02X", column);
+      text += buffer;
+   }
+   text += '\n';
+   uint32_t lineAddress = visibleAddress&~(bytesPerLine-1);
+   unsigned skip        = visibleAddress-lineAddress;
+   while (size > 0) {
+      snprintf(buffer, sizeof(buffer), "%08X: ", lineAddress);
+      text += buffer;
+      std::string ascii;
+      unsigned count = std::min<size_t>(bytesPerLine-skip, size);
+      for (unsigned column=0; column<bytesPerLine; column++) {
+         if ((column < skip) || (column >= skip+count)) {
+            text  += "   ";
+            ascii += ' ';
+         }
+         else {
+            uint8_t value = *data++;
+            snprintf(buffer, sizeof(buffer), "%02X ", value);
+            text  += buffer;
+            ascii += ((value >= ' ') && (value < 127))?static_cast<char>(value):'.';
+         }
+      }
+      if (showAscii) {
+         // ASCII column is not padded after the last byte
+         text += ' ';
+         text += ascii.substr(0, skip+count);
+      }
+      else {
+         text.pop_back();
+      }
+      text        += '\n';
+      size        -= count;
+      lineAddress += bytesPerLine;
+      skip         = 0;
+   }
+   return text;
+}
+
+/**
+ * Dump in the style of the flash example (a write() call per field)
+ */
+void printDump(FormattedIO &io, const uint8_t *address, uint32_t size) {
+   constexpr unsigned RowWidth = 32;
+   io.setPadding(Padding_LeadingZeroes).setWidth(2);
+   io.write("          ");
+   for (unsigned index=0; index<RowWidth; index++) {
+      io.write(index).write(" ");
+   }
+   io.writeln();
+   bool needNewline = true;
+   for (unsigned index=0; index<size; index++) {
+      if (needNewline) {
+         io.setPadding(Padding_LeadingZeroes).setWidth(8).write(index, Radix_16).write(": ");
+         io.setPadding(Padding_LeadingZeroes).setWidth(2);
+      }
+      io.write(address[index], Radix_16).write(" ");
+      needNewline = (((index+1)&(RowWidth-1)) == 0);
+      if (needNewline) {
+         io.writeln();
+      }
+   }
+   io.writeln();
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::hexDumpTest() {
+   std::mt19937 random(7);
+   uint8_t memory[1100];
+   for (auto &byte:memory) {
+      byte = random();
+   }
+   memcpy(memory+3, "Starting\n", 9);
+
+   unsigned cases      = 0;
+   unsigned mismatches = 0;
+   for (uint32_t address=0x120; address<0x160; address++) {
+      for (unsigned size:{0u, 1u, 5u, 16u, 17u, 31u, 32u, 33u, 100u, 1024u}) {
+         for (unsigned bytesPerLine:{16u, 32u}) {
+            for (bool showAscii:{false, true}) {
+               DumpFormatter io;
+               io.writeHexDump(memory, size, address, bytesPerLine, showAscii);
+               std::string expected = referenceDump(memory, size, address, bytesPerLine, showAscii);
+               cases++;
+               if ((io.text != expected) && (mismatches++ == 0)) {
+                  printf("Address 0x%X, size %u, %u bytes per line, ASCII %d\n%s---\n%s",
+                        address, size, bytesPerLine, showAscii, io.text.c_str(), expected.c_str());
+               }
+            }
+         }
+      }
+   }
+   check(mismatches == 0, "Hex dump matches reference");
+
+   // Speed dumping 1 KB into a counting sink
+   constexpr unsigned DUMPS = 2000;
+   auto dumpUs = [](auto dump) {
+      DumpFormatter io;
+      io.collect = false;
+      double ns = timeNs([&]() {
+         for (unsigned index=0; index<DUMPS; index++) {
+            dump(io);
+         }
+      });
+      keep(io.total);
+      return ns/DUMPS/1000;
+   };
+   double hex16Us = dumpUs([&](FormattedIO &io) { io.writeHexDump(memory, 1024, 0, 16, true); });
+   double hex32Us = dumpUs([&](FormattedIO &io) { io.writeHexDump(memory, 1024, 0, 32, false); });
+   double arrayUs = dumpUs([&](FormattedIO &io) { io.writeArray(memory, 1024, 0); });
+   double printUs = dumpUs([&](FormattedIO &io) { printDump(io, memory, 1024); });
+   printf("%u dumps\n", cases);
+   printf("1 KB: writeHexDump(16, ASCII) %.2f us, writeHexDump(32) %.2f us, writeArray(visibleIndex) %.2f us, printDump %.2f us\n",
+         hex16Us, hex32Us, arrayUs, printUs);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file    host_lpuart.h
+ * @brief   Buffered LPUART (lpuart.h) with transmission driven by the check
+ *
+ * The transmit interrupt handler is called directly while the transmit interrupt is enabled.
+ * Characters written to the DATA register are collected.
+ */
+#ifndef FIRMWARE_TEST_HOST_LPUART_H_
+#define FIRMWARE_TEST_HOST_LPUART_H_
+
+#include <string>
+#include "lpuart.h"
+
+namespace FirmwareTest {
+
+/**
+ * Buffered LPUART0 with a collected output
+ *
+ * @tparam txSize Size of transmit queue
+ */
+template<int txSize>
+class HostLpuart : public USBDM::LpuartBuffered_T<USBDM::Lpuart0Info, 4, txSize> {
+
+   using Base = USBDM::LpuartBuffered_T<USBDM::Lpuart0Info, 4, txSize>;
+
+public:
+   using Base::txWrite;
+   using Base::txQueue;
+   using Base::txChains;
+
+   /** Characters sent */
+   std::string sent;
+
+   /**
+    * Run the transmit interrupt
+    *
+    * @param[in] count Maximum number of interrupts to run
+    *
+    * @return true if the transmit interrupt is still enabled
+    */
+   bool transmit(unsigned count=~0U) {
+      volatile LPUART_Type *lpuart = &*USBDM::Lpuart0Info::lpuart;
+      while ((count-- > 0) && (lpuart->CTRL & LPUART_CTRL_TIE_MASK)) {
+         lpuart->DATA = ~0U;
+         Base::txIrqHandler();
+         if (lpuart->DATA != ~0U) {
+            sent += static_cast<char>(lpuart->DATA);
+         }
+      }
+      return (lpuart->CTRL & LPUART_CTRL_TIE_MASK) != 0;
+   }
+
+   /**
+    * Reset queues and collected output
+    */
+   void reset() {
+      transmit();
+      sent.clear();
+      Base::setTxOverflow(USBDM::LpuartTxOverflow_Block);
+      Base::clearTxStatistics();
+   }
+};
+
+} // End namespace FirmwareTest
+
+#endif /* FIRMWARE_TEST_HOST_LPUART_H_ */
@@ -0,0 +1,189 @@
+/**
+ * @file    idle_test.cpp
+ * @brief   Checks of the idle manager (idleManager.h) against a simulated SMC
+ *
+ * The simulated platform keeps time in ms and a 24-bit core cycle counter that stops in WAIT and VLPS.
+ * Interrupts are scheduled at random times. A pending interrupt wakes WAIT, aborts
+ * entry to VLPS and is taken (creating work for the main loop) when interrupts are unmasked.
+ */
+#include <random>
+#include "firmware_test.h"
+#include "idleManager.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/// Simulated MCU
+struct Simulation {
+   uint32_t time           = 0;      //!< Time (ms)
+   uint32_t cycles         = 0;      //!< Core cycles
+   unsigned lockDepth      = 0;      //!< Interrupts masked when > 0
+   uint32_t nextInterrupt  = 0;      //!< Time of next interrupt (ms)
+   bool     pending        = false;  //!< Interrupt pending
+   unsigned work           = 0;      //!< Work created by interrupts
+   unsigned taken          = 0;      //!< Interrupts taken
+   bool     unmaskedIdle   = false;  //!< Low-power mode entered or work checked with interrupts unmasked
+   std::mt19937 random{9};
+
+   /** Schedule next interrupt 0-20 ms from now */
+   void schedule() {
+      nextInterrupt = time+random()%21;
+   }
+
+   /** Advance time, raising the interrupt when due */
+   void advance(uint32_t ms) {
+      time += ms;
+      if (time >= nextInterrupt) {
+         pending = true;
+      }
+   }
+
+   /** Take pending interrupt if unmasked */
+   void takeInterrupt() {
+      if (pending && (lockDepth == 0)) {
+         pending = false;
+         taken++;
+         work++;
+         schedule();
+      }
+   }
+} sim;
+
+/// Cycles to enter and leave WAIT
+constexpr uint32_t WAIT_CYCLES  = 30;
+
+/// Cycles to enter and leave VLPS
+constexpr uint32_t STOP_CYCLES  = 200;
+
+/// Cycles for an aborted VLPS entry
+constexpr uint32_t ABORT_CYCLES = 40;
+
+/**
+ * Simulated platform for IdleManager_T
+ */
+class SimPlatform {
+public:
+   class Lock {
+   public:
+      Lock() {
+         sim.lockDepth++;
+      }
+      ~Lock() {
+         sim.lockDepth--;
+         sim.takeInterrupt();
+      }
+   };
+
+   static constexpr uint32_t CYCLE_MASK = (1UL<<24)-1;
+
+   static uint32_t getTime() {
+      return sim.time;
+   }
+   static uint32_t getCycles() {
+      return sim.cycles&CYCLE_MASK;
+   }
+   static void enterWait() {
+      sim.unmaskedIdle = sim.unmaskedIdle || (sim.lockDepth == 0);
+      if (!sim.pending) {
+         sim.advance(sim.nextInterrupt-sim.time);
+      }
+      sim.cycles += WAIT_CYCLES;
+   }
+   static bool enterDeepSleep() {
+      sim.unmaskedIdle = sim.unmaskedIdle || (sim.lockDepth == 0);
+      if (sim.pending) {
+         sim.cycles += ABORT_CYCLES;
+         return false;
+      }
+      sim.advance(sim.nextInterrupt-sim.time);
+      sim.cycles += STOP_CYCLES;
+      return true;
+   }
+};
+
+using Idle = IdleManager_T<SimPlatform>;
+
+} // End anonymous namespace
+
+void FirmwareTest::idleManagerTest() {
+   constexpr unsigned LOOPS = 100000;
+
+   sim.cycles = SimPlatform::CYCLE_MASK-1000;
+   sim.schedule();
+   Idle::initialise();
+   uint32_t startTime = sim.time;
+
+   unsigned entered[IDLE_MODE_COUNT] = {0};
+   unsigned lostWork    = 0;
+   unsigned lateWake    = 0;
+   for (unsigned loop=0; loop<LOOPS; loop++) {
+      // Main loop work - possibly long enough for an interrupt to become pending
+      if (sim.work > 0) {
+         sim.work--;
+         sim.advance(sim.random()%3);
+         sim.cycles += 1000;
+         sim.takeInterrupt();
+      }
+      bool deepSleep = (sim.random()%2) == 0;
+      unsigned workBefore = sim.work;
+      IdleMode mode = Idle::idle(
+            [&]() {
+               sim.unmaskedIdle = sim.unmaskedIdle || (sim.lockDepth == 0);
+               // Interrupt arrives between the check for work and the WFI
+               if ((sim.random()%8) == 0) {
+                  sim.advance(sim.nextInterrupt-sim.time);
+               }
+               return sim.work > 0;
+            },
+            [&]() {
+               return deepSleep;
+            });
+      entered[mode]++;
+      if ((mode == IdleMode_Run) != (workBefore > 0)) {
+         lostWork++;
+      }
+      if ((mode != IdleMode_Run) && (sim.work == 0)) {
+         // Returned from idle without the interrupt being taken
+         lateWake++;
+      }
+      if ((mode == IdleMode_DeepSleep) != ((mode != IdleMode_Run) && deepSleep)) {
+         lostWork++;
+      }
+   }
+   check(!sim.unmaskedIdle, "Idle checks and entry made with interrupts masked");
+   check(lostWork == 0, "Idle mode follows work pending and deep sleep allowed");
+   check(lateWake == 0, "Waking interrupt taken on return from idle");
+
+   IdleModeStatistics statistics[IDLE_MODE_COUNT];
+   uint32_t residency = 0;
+   for (unsigned mode=0; mode<IDLE_MODE_COUNT; mode++) {
+      Idle::getStatistics(static_cast<IdleMode>(mode), statistics[mode]);
+      residency += statistics[mode].residency;
+   }
+   // Run period after the last idle() is not yet accounted
+   Idle::idle([]() { return false; }, []() { return false; });
+   uint32_t accounted = 0;
+   for (unsigned mode=0; mode<IDLE_MODE_COUNT; mode++) {
+      Idle::getStatistics(static_cast<IdleMode>(mode), statistics[mode]);
+      accounted += statistics[mode].residency;
+   }
+   check(accounted == sim.time-startTime, "Residency sums to elapsed time");
+   check(residency <= accounted, "Residency only increases");
+   check((statistics[IdleMode_Wait].entries == entered[IdleMode_Wait]+1) &&
+         (statistics[IdleMode_DeepSleep].entries == entered[IdleMode_DeepSleep]),
+         "Entries counted");
+   check(Idle::getDeepSleepAborted() > 0, "Some deep sleeps aborted by pending interrupt");
+   check((statistics[IdleMode_Wait].overheadMinimum == WAIT_CYCLES) && (statistics[IdleMode_Wait].overheadMaximum == WAIT_CYCLES),
+         "WAIT overhead measured across counter wrap");
+   check((statistics[IdleMode_DeepSleep].overheadMinimum == ABORT_CYCLES) && (statistics[IdleMode_DeepSleep].overheadMaximum == STOP_CYCLES),
+         "VLPS overhead measured, time in mode excluded");
+
+   printf("%u loops, %u ms: run %u ms, wait %u ms (%u), VLPS %u ms (%u, %u aborted)\n",
+         LOOPS, sim.time-startTime,
+         statistics[IdleMode_Run].residency,
+         statistics[IdleMode_Wait].residency, statistics[IdleMode_Wait].entries,
+         statistics[IdleMode_DeepSleep].residency, statistics[IdleMode_DeepSleep].entries,
+         Idle::getDeepSleepAborted());
+}
@@ -0,0 +1,212 @@
+/**
+ * @file    line_parser_test.cpp
+ * @brief   Checks of the command line parser (lineParser.h)
+ *
+ * Random lines made of numbers, keywords, separators and junk are parsed with random
+ * patterns and compared with a reference that splits the line into tokens and converts
+ * them with strtoul().
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "firmware_test.h"
+#include "lineParser.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+const char *const keywords[] = {"power", "clock", "vectors", "vdd", "p"};
+const LineParser  parser(keywords);
+
+/**
+ * Result of reference parse
+ */
+struct Reference {
+   LineError             error;
+   unsigned              position;
+   std::vector<uint32_t> values;
+};
+
+bool isSeparator(char ch) {
+   return (ch == ' ') || (ch == ',') || (ch == '\t') || (ch == '\r');
+}
+
+/**
+ * Convert a numeric token
+ *
+ * @param[in]  token Token
+ * @param[in]  type  Argument type ('u', 'i' or 'x')
+ * @param[out] value Value (two's complement for 'i')
+ * @param[out] bad   Offset in token of bad digit
+ */
+LineError convert(const std::string &token, char type, uint32_t &value, size_t &bad) {
+   size_t start    = 0;
+   bool   negative = false;
+   if ((type == 'i') && ((token[0] == '-') || (token[0] == '+'))) {
+      negative = (token[0] == '-');
+      start    = 1;
+   }
+   int base = 10;
+   if (type == 'x') {
+      base = 16;
+   }
+   else if ((token.size() > start+1) && (token[start] == '0') && ((token[start+1]|0x20) == 'x')) {
+      base   = 16;
+      start += 2;
+   }
+   else if ((token.size() > start+1) && (token[start] == '0') && ((token[start+1]|0x20) == 'b')) {
+      base   = 2;
+      start += 2;
+   }
+   // strtoul() accepts a sign, spaces and a prefix - only offer it digits
+   size_t end = start;
+   while ((end < token.size()) && isxdigit(token[end]) &&
+          (strtoul(token.substr(end, 1).c_str(), nullptr, 16) < static_cast<unsigned>(base))) {
+      end++;
+   }
+   if (end == start) {
+      bad = end;
+      return LineError_BadDigit;
+   }
+   errno = 0;
+   unsigned long long magnitude = strtoull(token.substr(start, end-start).c_str(), nullptr, base);
+   if ((errno == ERANGE) || (magnitude > 0xFFFFFFFFULL)) {
+      return LineError_Overflow;
+   }
+   if ((type == 'i') && (magnitude > (negative?0x80000000ULL:0x7FFFFFFFULL))) {
+      return LineError_Overflow;
+   }
+   if (end < token.size()) {
+      bad = end;
+      return LineError_BadDigit;
+   }
+   value = negative?-static_cast<uint32_t>(magnitude):static_cast<uint32_t>(magnitude);
+   return LineError_None;
+}
+
+/**
+ * Reference parse
+ */
+Reference referenceParse(const std::string &line, const std::string &pattern, unsigned maxArgs) {
+   Reference reference = {LineError_None, 0, {}};
+   size_t position   = 0;
+   size_t patternPos = 0;
+   for(;;) {
+      while ((position < line.size()) && isSeparator(line[position])) {
+         position++;
+      }
+      char type   = (patternPos < pattern.size())?pattern[patternPos]:'\0';
+      bool repeat = (type != '\0') && (patternPos+1 < pattern.size()) && (pattern[patternPos+1] == '*');
+      reference.position = position;
+      if (position >= line.size()) {
+         reference.error = ((type == '\0') || repeat)?LineError_None:LineError_TooFewArgs;
+         return reference;
+      }
+      if ((type == '\0') || (reference.values.size() >= maxArgs)) {
+         reference.error = LineError_TooManyArgs;
+         return reference;
+      }
+      size_t end = position;
+      while ((end < line.size()) && !isSeparator(line[end])) {
+         end++;
+      }
+      std::string token = line.substr(position, end-position);
+      uint32_t    value = 0;
+      if (type == 'k') {
+         unsigned index = 0;
+         while ((index < sizeof(keywords)/sizeof(keywords[0])) && (token != keywords[index])) {
+            index++;
+         }
+         if (index == sizeof(keywords)/sizeof(keywords[0])) {
+            reference.error = LineError_UnknownKeyword;
+            return reference;
+         }
+         value = index;
+      }
+      else {
+         size_t bad = 0;
+         reference.error = convert(token, type, value, bad);
+         if (reference.error != LineError_None) {
+            if (reference.error == LineError_BadDigit) {
+               reference.position = position+bad;
+            }
+            return reference;
+         }
+      }
+      reference.values.push_back(value);
+      position = end;
+      if (!repeat) {
+         patternPos++;
+      }
+   }
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::lineParserTest() {
+   static const char *const pieces[] = {
+         "0", "1", "9", "a", "F", "x", "b", "-", "+", " ", ",", "\t", "\r", "g", "Z", "5", "0x", "0b",
+         "power", "clock", "vdd", "p", "4294967295", "4294967296", "2147483647", "2147483648",
+         "-2147483648", "-2147483649", "FFFFFFFF", "100000000",
+   };
+   static const char *const patterns[] = {
+         "u", "i", "x", "k", "kuu", "kx*", "ui*", "u*", "kik", "xxxx", "", "k*", "x*",
+   };
+   std::mt19937  random(12345);
+   constexpr unsigned long CASES = 2000000;
+   unsigned long valid = 0;
+   unsigned      mismatches = 0;
+   for (unsigned long n=0; n<CASES; n++) {
+      std::string line;
+      for (unsigned count=random()%12; count>0; count--) {
+         line += pieces[random()%(sizeof(pieces)/sizeof(pieces[0]))];
+      }
+      const char *pattern = patterns[random()%(sizeof(patterns)/sizeof(patterns[0]))];
+      unsigned    maxArgs = 1+random()%8;
+      LineArg     args[8];
+      LineParseResult result    = parser.parse(line.c_str(), pattern, args, maxArgs);
+      Reference       reference = referenceParse(line, pattern, maxArgs);
+      bool same = (result.error == reference.error) && (result.position == reference.position);
+      if (same && (reference.error == LineError_None)) {
+         same = (result.count == reference.values.size());
+         const char *type = pattern;
+         for (unsigned index=0; same && (index<result.count); index++) {
+            same = (args[index].value == reference.values[index]) && (args[index].type == *type);
+            if (type[1] != '*') {
+               type++;
+            }
+         }
+         valid++;
+      }
+      if (!same && (mismatches++ < 5)) {
+         printf("Line \"%s\" pattern \"%s\": error %d at %u, expected error %d at %u\n",
+               line.c_str(), pattern, result.error, result.position, reference.error, reference.position);
+      }
+   }
+   check(mismatches == 0, "Random lines parsed as reference");
+   LineArg args[80];
+   check(parser.parse("vectors 12", "kz", args).error == LineError_BadPattern, "Bad pattern");
+
+   // Speed - a keyword and 64 hexadecimal words
+   std::string line = "vectors";
+   for (unsigned index=0; index<64; index++) {
+      char word[8];
+      snprintf(word, sizeof(word), " %04X", (index*7919)&0xFFFF);
+      line += word;
+   }
+   constexpr unsigned LINES = 200000;
+   uint32_t sum = 0;
+   double ns = timeNs([&]() {
+      for (unsigned index=0; index<LINES; index++) {
+         LineParseResult result = parser.parse(line.c_str(), "kx*", args);
+         sum += args[result.count-1].value;
+      }
+   });
+   keep(sum);
+   printf("%lu random lines (%lu valid)\n", CASES, valid);
+   printf("Parse 64 hex words: %.0f ns per line, %.2f ns per character\n", ns/LINES, ns/LINES/line.size());
+}
@@ -0,0 +1,348 @@
+/**
+ * @file    lpuart_test.cpp
+ * @brief   Checks of the buffered LPUART transmit overflow policies and text block chains (lpuart.h)
+ *
+ * A small transmit queue is used so the overflow policies are exercised.
+ * The transmit interrupt is run by the check at random points between writes.
+ */
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include "firmware_test.h"
+#include "host_lpuart.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/** Size of transmit queue */
+constexpr int TX_SIZE = 16;
+
+using Uart = HostLpuart<TX_SIZE>;
+
+/** Blocks of chains */
+constexpr unsigned ARENA_BLOCKS = 6;
+
+TextArena_T<8, ARENA_BLOCKS> arena;
+
+/**
+ * Formatter giving the expected LPUART output ('\n' is followed by '\r')
+ */
+class LineFormatter : public FormattedIO {
+public:
+   std::string text;
+
+protected:
+   virtual void _writeChar(char ch) override {
+      text += ch;
+      if (ch == '\n') {
+         text += '\r';
+      }
+   }
+};
+
+/**
+ * Check the overflow policies with the transmit interrupt stopped
+ */
+void overflowPolicies(Uart &uart) {
+   LpuartTxStatistics statistics;
+
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropNewest);
+   uart.write("0123456789ABCDEFGHIJ\n");
+   uart.transmit();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "0123456789ABCDEF", "DropNewest keeps oldest characters");
+   check((statistics.droppedBytes == 6) && (statistics.highWater == TX_SIZE), "DropNewest statistics");
+
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+   uart.write("0123456789ABCDEFGHIJ");
+   uart.transmit();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "~56789ABCDEFGHIJ", "DropOldest keeps newest characters and marks gap");
+   check(statistics.droppedBytes == 5, "DropOldest statistics");
+
+   // Marker from an earlier drop is reused
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+   uart.write("0123456789ABCD").write("EF").write("GH").write("IJ");
+   uart.transmit();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "~56789ABCDEFGHIJ", "Repeated DropOldest keeps a single marker");
+   check(statistics.droppedBytes == 5, "Repeated DropOldest statistics");
+
+   // Queued character that equals the marker is not mistaken for one
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+   uart.write("~123456789ABCDEF").write("GHIJ");
+   uart.transmit();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "~56789ABCDEFGHIJ", "DropOldest over a queued marker character");
+   check(statistics.droppedBytes == 5, "DropOldest counts a queued marker character as lost");
+
+   // Block - the transmit interrupt is run by another thread while the writer waits
+   uart.reset();
+   std::atomic<bool> done(false);
+   std::thread isr([&]() {
+      volatile LPUART_Type *lpuart = &*Lpuart0Info::lpuart;
+      while (!done || !uart.txQueue.isEmpty()) {
+         if (!uart.txQueue.isEmpty()) {
+            // Writer and handler both update CTRL - make sure the interrupt isn't lost
+            lpuart->CTRL = lpuart->CTRL | LPUART_CTRL_TIE_MASK;
+         }
+         uart.transmit(1);
+         std::this_thread::yield();
+      }
+   });
+   static const char text[] = "The quick brown fox jumps over the lazy dog\n";
+   uart.write(text);
+   done = true;
+   isr.join();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "The quick brown fox jumps over the lazy dog\n\r", "Block loses no characters");
+   check((statistics.droppedBytes == 0) && (statistics.blockedTicks > 0), "Block statistics");
+   uart.reset();
+}
+
+/**
+ * Check chains are sent in order with the characters written either side of them
+ *
+ * @param[in] uart Uart to use (Block policy)
+ */
+void chainOrder(Uart &uart) {
+   std::mt19937 random(3);
+   bool same       = true;
+   bool released   = true;
+   bool truncation = false;
+   for (unsigned run=0; run<100000; run++) {
+      uart.reset();
+      std::string expected;
+      for (unsigned step=1+random()%6; step>0; step--) {
+         if (random()&1) {
+            ChainFormatter chain(arena);
+            LineFormatter  line;
+            for (unsigned count=random()%5; count>0; count--) {
+               unsigned value = random()%100000;
+               const char *separator = (count == 1)?"\n":",";
+               chain.write(value).write(separator);
+               line.write(value).write(separator);
+            }
+            // Truncated at arena capacity
+            truncation = truncation || chain.isTruncated();
+            expected  += line.text.substr(0, chain.length());
+            // Chains can only wait TX_CHAINS deep when single threaded
+            while (uart.txChains.isFull()) {
+               uart.transmit(1);
+            }
+            uart.writeChain(chain);
+            same = same && (chain.length() == 0);
+         }
+         else {
+            char text[12];
+            unsigned length = random()%(sizeof(text)-1);
+            for (unsigned index=0; index<length; index++) {
+               text[index] = 'a'+random()%26;
+            }
+            text[length] = '\0';
+            // Block policy waits for the interrupt
+            while (uart.getTxSpace() < length) {
+               uart.transmit(1);
+            }
+            uart.write(text);
+            expected += text;
+         }
+         uart.transmit(random()%20);
+      }
+      uart.transmit();
+      same     = same && (uart.sent == expected);
+      released = released && (arena.getFreeCount() == ARENA_BLOCKS);
+   }
+   check(same, "Chains sent in order with queued characters");
+   check(released, "Chain blocks returned to arena");
+   check(truncation, "Chains truncated at arena capacity");
+}
+
+/**
+ * Check DropOldest never discards or stalls a chain.
+ * Chain text is upper case and queued text lower case so they can be separated in the output.
+ *
+ * @param[in] uart Uart to use
+ */
+void dropOldestChains(Uart &uart) {
+   // Drop moves the queue past the chain position in one step
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+   {
+      ChainFormatter chain(arena, false);
+      uart.write("0123456789");
+      chain.write("CHAIN");
+      uart.writeChain(chain);
+      uart.write("abcdefghijklmnopqrstu");
+   }
+   uart.transmit();
+   bool sent = (uart.sent == "CHAIN~ghijklmnopqrstu") && (arena.getFreeCount() == ARENA_BLOCKS);
+   check(sent, "Chain sent and returned to arena when drop passes its position");
+   if (!sent) {
+      // A stalled chain would stall the following checks
+      return;
+   }
+
+   // Drop while the chain is part sent
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+   {
+      ChainFormatter chain(arena, false);
+      chain.write("LONGCHAIN");
+      uart.writeChain(chain);
+      uart.write("0123");
+      uart.transmit(3);
+      uart.write("abcdefghijklmnopqrstuvwxyz");
+   }
+   uart.transmit();
+   sent = (uart.sent == "LONGCHAIN~lmnopqrstuvwxyz") && (arena.getFreeCount() == ARENA_BLOCKS);
+   check(sent, "Part sent chain completed and returned to arena when queue dropped");
+   if (!sent) {
+      return;
+   }
+
+   // Random writes, chains and interrupts
+   std::mt19937 random(17);
+   bool chainsIntact = true;
+   bool textInOrder  = true;
+   bool released     = true;
+   for (unsigned run=0; run<50000; run++) {
+      uart.reset();
+      uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+      std::string chains;
+      std::string text;
+      for (unsigned step=1+random()%8; step>0; step--) {
+         if ((random()%3) == 0) {
+            ChainFormatter chain(arena, false);
+            std::string    written;
+            for (unsigned count=1+random()%10; count>0; count--) {
+               written += static_cast<char>('A'+random()%26);
+            }
+            chain.write(written.c_str());
+            // Truncated at arena capacity
+            chains += written.substr(0, chain.length());
+            while (uart.txChains.isFull()) {
+               uart.transmit(1);
+            }
+            uart.writeChain(chain);
+         }
+         else {
+            std::string line;
+            for (unsigned count=random()%(2*TX_SIZE); count>0; count--) {
+               line += static_cast<char>('a'+random()%26);
+            }
+            uart.write(line.c_str());
+            text += line;
+         }
+         uart.transmit(random()%(TX_SIZE/2));
+      }
+      uart.transmit();
+      // Chains are whole and in order, queued text is a subsequence of what was written
+      std::string sentChains;
+      std::string::size_type textIndex = 0;
+      for (char ch:uart.sent) {
+         if ((ch >= 'A') && (ch <= 'Z')) {
+            sentChains += ch;
+         }
+         else if (ch != '~') {
+            textIndex = text.find(ch, textIndex);
+            if (textIndex == std::string::npos) {
+               textInOrder = false;
+               break;
+            }
+            textIndex++;
+         }
+      }
+      chainsIntact = chainsIntact && (sentChains == chains);
+      released     = released && (arena.getFreeCount() == ARENA_BLOCKS);
+   }
+   check(chainsIntact, "DropOldest never discards chain text");
+   check(textInOrder, "DropOldest keeps queued text in order");
+   check(released, "DropOldest chains returned to arena");
+   uart.reset();
+}
+
+/**
+ * Make a single block chain holding text
+ *
+ * @param[in] text Text for chain (no longer than a block)
+ *
+ * @return Chain
+ */
+TextBlock *makeChain(const char *text) {
+   ChainFormatter chain(arena, false);
+   chain.write(text);
+   return chain.detach();
+}
+
+/**
+ * Check the overflow policies when too many chains are waiting to be sent
+ *
+ * @param[in] uart Uart to use
+ */
+void chainOverflow(Uart &uart) {
+   static const char *const texts[] = {"AA", "BBB", "CCCC", "DDDDD", "EEEEEE"};
+   LpuartTxStatistics statistics;
+
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropNewest);
+   for (const char *text:texts) {
+      uart.writeChain(makeChain(text));
+   }
+   uart.transmit();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "AABBBCCCCDDDDD", "DropNewest discards newest chain");
+   check((statistics.droppedBytes == 6) && (arena.getFreeCount() == ARENA_BLOCKS), "DropNewest chain statistics and release");
+
+   uart.reset();
+   uart.setTxOverflow(LpuartTxOverflow_DropOldest);
+   for (const char *text:texts) {
+      uart.writeChain(makeChain(text));
+   }
+   uart.transmit();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "BBBCCCCDDDDDEEEEEE", "DropOldest discards oldest waiting chain");
+   check((statistics.droppedBytes == 2) && (arena.getFreeCount() == ARENA_BLOCKS), "DropOldest chain statistics and release");
+
+   // Block - the transmit interrupt is run by another thread while the writer waits.
+   // Chains are made beforehand so only the interrupt uses the arena.
+   uart.reset();
+   TextBlock *chains[sizeof(texts)/sizeof(texts[0])];
+   for (unsigned index=0; index<sizeof(texts)/sizeof(texts[0]); index++) {
+      chains[index] = makeChain(texts[index]);
+   }
+   std::atomic<bool> done(false);
+   std::thread isr([&]() {
+      while (!done || !uart.txChains.isEmpty()) {
+         uart.transmit(1);
+         std::this_thread::yield();
+      }
+      uart.transmit();
+   });
+   for (TextBlock *chain:chains) {
+      uart.writeChain(chain);
+   }
+   done = true;
+   isr.join();
+   uart.getTxStatistics(statistics);
+   check(uart.sent == "AABBBCCCCDDDDDEEEEEE", "Block loses no chains");
+   check((statistics.droppedBytes == 0) && (arena.getFreeCount() == ARENA_BLOCKS), "Block chain statistics and release");
+   uart.reset();
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::lpuartTest() {
+   Uart uart;
+   overflowPolicies(uart);
+   chainOrder(uart);
+   dropOldestChains(uart);
+   chainOverflow(uart);
+}
@@ -0,0 +1,154 @@
+/**
+ * @file    queue_test.cpp
+ * @brief   Checks of the single-producer/single-consumer UartQueue (uart_queue.h)
+ *
+ * A producer thread and a consumer thread stand in for the main loop and the UART interrupt.
+ */
+#include <random>
+#include <thread>
+#include "firmware_test.h"
+#include "uart_queue.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * Stream a numbered sequence of bytes through a queue from another thread
+ * using a random mix of single, bulk and all-or-nothing writes and single and bulk reads.
+ *
+ * @param[in] total Number of bytes
+ *
+ * @return true if the sequence was received intact
+ */
+bool stress(unsigned long total) {
+   // Size is not a power of two
+   static UartQueue<uint8_t, 50> queue;
+   std::thread producer([&]() {
+      std::mt19937 random(1);
+      uint8_t data[64];
+      unsigned long sent = 0;
+      while (sent < total) {
+         unsigned count = 1+random()%40;
+         if (count > total-sent) {
+            count = total-sent;
+         }
+         for (unsigned index=0; index<count; index++) {
+            data[index] = static_cast<uint8_t>(sent+index);
+         }
+         switch(random()%3) {
+            case 0:
+               if (queue.enQueueDiscardOnFull(data[0])) {
+                  sent++;
+               }
+               break;
+            case 1:
+               sent += queue.push(data, count);
+               break;
+            case 2:
+               if (queue.enQueueAllOrNothing(data, count)) {
+                  sent += count;
+               }
+               else {
+                  std::this_thread::yield();
+               }
+               break;
+         }
+      }
+   });
+   std::mt19937 random(2);
+   bool          intact   = true;
+   unsigned long received = 0;
+   uint8_t       data[64];
+   while (received < total) {
+      if (random()&1) {
+         if (queue.isEmpty()) {
+            std::this_thread::yield();
+            continue;
+         }
+         intact = intact && (queue.deQueue() == static_cast<uint8_t>(received));
+         received++;
+      }
+      else {
+         unsigned count = queue.pop(data, 1+random()%60);
+         for (unsigned index=0; index<count; index++) {
+            intact = intact && (data[index] == static_cast<uint8_t>(received+index));
+         }
+         received += count;
+      }
+   }
+   producer.join();
+   return intact && queue.isEmpty();
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::queueTest() {
+   // Single thread
+   {
+      UartQueue<char, 5> queue;
+      check(queue.isEmpty() && !queue.isFull(), "Queue empty");
+      unsigned added = queue.push("abcdefg", 7);
+      check((added == 5) && queue.isFull() && (queue.size() == 5), "Push stops at capacity");
+      char data[8] = {0};
+      unsigned removed = queue.pop(data, 3);
+      check((removed == 3) && (memcmp(data, "abc", 3) == 0), "Pop in order");
+      check(queue.enQueueAllOrNothing("wxyz", 4) == false, "All or nothing refused when no room");
+      check(queue.enQueueAllOrNothing("xyz", 3), "All or nothing accepted");
+      removed = queue.pop(data, 8);
+      check((removed == 5) && (memcmp(data, "dexyz", 5) == 0) && queue.isEmpty(), "Pop across wrap");
+      check((queue.getAddedCount() == 8) && (queue.getRemovedCount() == 8), "Added and removed counts");
+   }
+
+   // Two threads
+   constexpr unsigned long STRESS_BYTES = 5000000;
+   for (unsigned run=0; run<3; run++) {
+      check(stress(STRESS_BYTES), "Two thread sequence intact");
+   }
+
+   // Speed
+   constexpr unsigned long BYTES = 100000000;
+   static UartQueue<char, 64> queue;
+   unsigned long sum = 0;
+   double singleNs = timeNs([&]() {
+      for (unsigned long index=0; index<BYTES; index++) {
+         queue.enQueueDiscardOnFull(static_cast<char>(index));
+         sum += queue.deQueue();
+      }
+   });
+   char in[32] = {0};
+   char out[32];
+   double bulkNs = timeNs([&]() {
+      for (unsigned long index=0; index<BYTES; index+=sizeof(in)) {
+         in[0] = static_cast<char>(index);
+         queue.push(in, sizeof(in));
+         queue.pop(out, sizeof(out));
+         sum += out[0];
+      }
+   });
+   constexpr unsigned long THREAD_BYTES = 20000000;
+   double threadNs = timeNs([&]() {
+      std::thread producer([&]() {
+         for (unsigned long index=0; index<THREAD_BYTES;) {
+            unsigned count = queue.enQueueDiscardOnFull(in, sizeof(in));
+            index += count;
+            if (count == 0) {
+               std::this_thread::yield();
+            }
+         }
+      });
+      for (unsigned long received=0; received<THREAD_BYTES;) {
+         unsigned count = queue.pop(out, sizeof(out));
+         received += count;
+         if (count == 0) {
+            std::this_thread::yield();
+         }
+      }
+      producer.join();
+   });
+   keep(sum);
+   printf("Two thread stress %lu bytes x 3 (%u CPUs)\n", STRESS_BYTES, std::thread::hardware_concurrency());
+   printf("ns/byte: enqueue+dequeue %.2f, push+pop 32 %.3f, two threads bulk 32 %.2f\n",
+         singleNs/BYTES, bulkNs/BYTES, threadNs/THREAD_BYTES);
+}
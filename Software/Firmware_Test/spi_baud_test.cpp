@@ -0,0 +1,95 @@
+/**
+ * @file    spi_baud_test.cpp
+ * @brief   Checks of the SPI baud rate calculation (Spi::calculateBr())
+ *
+ * The closed form is compared with the factor table search it replaced
+ * and with the best speed found by trying every divisor.
+ */
+#include "firmware_test.h"
+#include "spi.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/** Gives access to the baud rate calculation */
+class SpiBaud : public Spi {
+public:
+   using Spi::calculateBr;
+   using Spi::calculateSpeed;
+};
+
+// Evaluated at compile time
+static_assert(SpiBaud::calculateBr<48000000, 10000000>() == SpiBaud::calculateBr(48000000, 10000000),
+      "Compile time and run time calculateBr() differ");
+
+/**
+ * Original calculation (spi.cpp) searching the factor tables
+ */
+uint8_t referenceCalculateBr(uint32_t clockFrequency, uint32_t frequency) {
+   static const uint16_t spprFactors[] = {1,2,3,4,5,6,7,8};
+   static const uint16_t sprFactors[]  = {2,4,8,16,32,64,128,256,512};
+
+   int bestSPPR = 0;
+   int bestSPR  = 0;
+   int32_t bestDifference = 0x7FFFFFFF;
+   for (int sppr = (sizeof(spprFactors)/sizeof(spprFactors[0]))-1; sppr >= 0; sppr--) {
+      for (int spr = (sizeof(sprFactors)/sizeof(sprFactors[0]))-1; spr >= 0; spr--) {
+         uint32_t calculatedFrequency = clockFrequency/(spprFactors[sppr]*sprFactors[spr]);
+         int32_t difference = frequency-calculatedFrequency;
+         if (difference < 0) {
+            break;
+         }
+         if (difference < bestDifference) {
+            bestDifference = difference;
+            bestSPR  = spr;
+            bestSPPR = sppr;
+         }
+      }
+   }
+   return SPI_BR_SPPR(bestSPPR)|SPI_BR_SPR(bestSPR);
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::spiBaudTest() {
+   static const uint32_t clocks[] = {
+         1000000, 2000000, 3000001, 4000000, 7777777, 8000000, 12000000,
+         16000000, 20971520, 24000000, 47972352, 48000000,
+   };
+   constexpr uint8_t SLOWEST = SPI_BR_SPPR(7)|SPI_BR_SPR(8);
+
+   unsigned long cases       = 0;
+   unsigned long unreachable = 0;
+   bool sameAsOriginal = true;
+   bool bestSpeed      = true;
+   bool slowest        = true;
+   for (uint32_t clock:clocks) {
+      for (uint32_t frequency=1; frequency<=clock; frequency+=1+frequency/2000) {
+         cases++;
+         uint8_t br = SpiBaud::calculateBr(clock, frequency);
+         if ((clock/4096) > frequency) {
+            // No setting is slow enough
+            unreachable++;
+            slowest = slowest && (br == SLOWEST);
+            continue;
+         }
+         uint32_t best = 0;
+         for (unsigned prescale=1; prescale<=8; prescale++) {
+            for (unsigned shift=1; shift<=9; shift++) {
+               uint32_t speed = clock/(prescale<<shift);
+               if ((speed <= frequency) && (speed > best)) {
+                  best = speed;
+               }
+            }
+         }
+         bestSpeed      = bestSpeed && (SpiBaud::calculateSpeed(clock, br) == best);
+         sameAsOriginal = sameAsOriginal && (br == referenceCalculateBr(clock, frequency));
+      }
+   }
+   check(sameAsOriginal, "calculateBr() matches original search");
+   check(bestSpeed, "calculateBr() gives highest speed not above frequency");
+   check(slowest, "calculateBr() gives slowest setting when frequency is unreachable");
+   printf("%lu clock/frequency pairs (%lu unreachable)\n", cases, unreachable);
+}
@@ -0,0 +1,201 @@
+/**
+ * @file    ultoa_test.cpp
+ * @brief   Checks of the division-free digit conversion (FormattedIO::ultoa())
+ *
+ * Conversions are compared with the original division loop.
+ * Values are limited to 32 bits as unsigned long is 32 bits on the target.
+ */
+#include <random>
+#include "firmware_test.h"
+#include "formatted_io.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/**
+ * Access to conversion functions
+ */
+class Converter : public FormattedIO {
+public:
+   using FormattedIO::ultoa;
+};
+
+/**
+ * Original conversion using division for each digit
+ */
+char *referenceUltoa(char *ptr, unsigned long value, Radix radix, Padding padding, int width, bool isNegative) {
+   // Save beginning for reversal
+   char *beginPtr = ptr;
+   // Convert backwards
+   do {
+      *ptr++ = "0123456789ABCDEF"[value % static_cast<unsigned>(radix)];
+      value /= static_cast<unsigned>(radix);
+   } while (value != 0);
+
+   // Add leading padding
+   switch (padding) {
+      case Padding_TrailingSpaces:
+      case Padding_None:
+         if (isNegative) {
+            width--;
+            *ptr++ = '-';
+         }
+         break;
+      case Padding_LeadingSpaces:
+         if (isNegative) {
+            *ptr++ = '-';
+         }
+         while ((ptr-beginPtr) < width) {
+            *ptr++ = ' ';
+         }
+         break;
+      case Padding_LeadingZeroes:
+         while ((ptr-beginPtr) < (width-1)) {
+            *ptr++ = '0';
+         }
+         if (isNegative) {
+            *ptr++ = '-';
+         }
+         if ((ptr-beginPtr) < width) {
+            *ptr++ = '0';
+         }
+         break;
+   }
+   // Reverse digits
+   char *endPtr = ptr-1;
+   char *tPtr   = beginPtr;
+   while (tPtr < endPtr) {
+      char t = *tPtr;
+      *tPtr++ = *endPtr;
+      *endPtr-- = t;
+   }
+   // Add trailing padding
+   if (padding==Padding_TrailingSpaces) {
+      while ((ptr-beginPtr) < width) {
+         *ptr++ = ' ';
+      }
+   }
+   *ptr = '\0';
+   return ptr;
+}
+
+/**
+ * Compare conversion with reference
+ *
+ * @return true if the same
+ */
+bool sameConversion(uint32_t value, Radix radix, Padding padding=Padding_None, int width=0, bool isNegative=false) {
+   char buffer[50];
+   char reference[50];
+   char *end          = Converter::ultoa(buffer, value, radix, padding, width, isNegative);
+   char *referenceEnd = referenceUltoa(reference, value, radix, padding, width, isNegative);
+   return ((end-buffer) == (referenceEnd-reference)) && (strcmp(buffer, reference) == 0);
+}
+
+/**
+ * Compare compile-time radix conversion with reference
+ *
+ * @return true if the same
+ */
+template<Radix radix>
+bool sameFixedConversion(uint32_t value) {
+   char buffer[50];
+   char reference[50];
+   char *end          = Converter::ultoa<radix>(buffer, value);
+   char *referenceEnd = referenceUltoa(reference, value, radix, Padding_None, 0, false);
+   return ((end-buffer) == (referenceEnd-reference)) && (strcmp(buffer, reference) == 0);
+}
+
+/**
+ * Time conversion of values of a given size
+ *
+ * @return ns per value
+ */
+template<typename Convert>
+double convertNs(uint32_t mask, Convert convert) {
+   constexpr unsigned VALUES = 1000000;
+   static uint32_t values[VALUES];
+   std::mt19937 random(mask);
+   for (auto &value:values) {
+      // Full length values of the given size
+      value = (random()&mask)|((mask>>1)+1);
+   }
+   char buffer[50];
+   size_t total = 0;
+   double ns = timeNs([&]() {
+      for (uint32_t value:values) {
+         total += convert(buffer, value)-buffer;
+      }
+   });
+   keep(total);
+   return ns/VALUES;
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::ultoaTest() {
+   static const Radix radices[] = {Radix_2, Radix_8, Radix_10, Radix_16, static_cast<Radix>(3), static_cast<Radix>(7)};
+
+   // Small values and the boundaries of digit count and of the reciprocal multiply
+   bool same = true;
+   for (uint32_t value=0; value<(1U<<20); value++) {
+      same = same && sameConversion(value, Radix_10) && sameConversion(value, Radix_16);
+   }
+   for (uint64_t boundary=1; boundary<=(1ULL<<32); boundary*=10) {
+      for (uint32_t value=boundary-1000; value!=static_cast<uint32_t>(boundary+1000); value++) {
+         same = same && sameConversion(value, Radix_10);
+      }
+   }
+   for (uint32_t value=43699-1000; value<43699+1000; value++) {
+      same = same && sameConversion(value, Radix_10);
+   }
+   same = same && sameConversion(0xFFFFFFFF, Radix_2) && sameConversion(0xFFFFFFFF, Radix_10);
+   check(same, "ultoa() at boundary values");
+
+   // Random value, radix, padding, width and sign
+   same = true;
+   std::mt19937 random(12);
+   for (unsigned trial=0; trial<2000000; trial++) {
+      uint32_t value = random()>>(random()%32);
+      same = same && sameConversion(value, radices[random()%6], static_cast<Padding>(random()%4), random()%36, random()%2);
+      same = same && sameFixedConversion<Radix_10>(value) && sameFixedConversion<Radix_16>(value) &&
+            sameFixedConversion<Radix_8>(value) && sameFixedConversion<Radix_2>(value);
+   }
+   check(same, "ultoa() random conversions");
+
+   printf("ns/value           8-bit  16-bit  32-bit\n");
+   static const struct {
+      const char *name;
+      Radix       radix;
+   } timings[] = {
+         {"radix 10",  Radix_10},
+         {"radix 16",  Radix_16},
+         {"radix 2 ",  Radix_2},
+   };
+   for (const auto &timing:timings) {
+      printf("  %s new    ", timing.name);
+      for (uint32_t mask:{0xFFU, 0xFFFFU, 0xFFFFFFFFU}) {
+         printf(" %7.1f", convertNs(mask, [&](char *buffer, uint32_t value) {
+            return Converter::ultoa(buffer, value, timing.radix, Padding_None, 0, false);
+         }));
+      }
+      printf("\n  %s before ", timing.name);
+      for (uint32_t mask:{0xFFU, 0xFFFFU, 0xFFFFFFFFU}) {
+         printf(" %7.1f", convertNs(mask, [&](char *buffer, uint32_t value) {
+            return referenceUltoa(buffer, value, timing.radix, Padding_None, 0, false);
+         }));
+      }
+      printf("\n");
+   }
+}
+
+void FirmwareTest::ultoaExhaustiveTest() {
+   bool same = true;
+   uint32_t value = 0;
+   do {
+      same = same && sameFixedConversion<Radix_10>(value);
+   } while (++value != 0);
+   check(same, "ultoa<Radix_10>() for all 32-bit values");
+}
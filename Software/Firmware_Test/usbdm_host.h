@@ -0,0 +1,140 @@
+/**
+ * @file    usbdm_host.h
+ * @brief   Host stand-in for the USBDM hardware headers used by the firmware checks
+ *
+ * This file is force-included ahead of every translation unit (g++ -include usbdm_host.h).
+ * It claims the include guards of pin_mapping.h, gpio.h and delay.h so that the unmodified
+ * hardware-free headers of the tester (Sources/) and the USBDM formatting, queue and LPUART
+ * headers compile on a PC.
+ *
+ * The register structures of MKL03Z4.h are used unchanged. Peripheral registers are plain
+ * memory mapped at the peripheral addresses by mapHostPeripherals() so a check can set
+ * status flags and read back what a driver wrote. Write-1-to-clear flags and registers with
+ * read side effects are not modelled.
+ */
+#ifndef FIRMWARE_TEST_USBDM_HOST_H_
+#define FIRMWARE_TEST_USBDM_HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+// Replace pin_mapping.h, gpio.h and delay.h
+#define PROJECT_HEADERS_PIN_MAPPING_H
+#define HEADER_GPIO_H
+#define INCLUDE_USBDM_DELAY_H_
+
+#define NOINLINE_DEBUG __attribute__((noinline))
+
+#include "derivative.h"
+#include "error.h"
+#include "pcr.h"
+
+/**
+ * Map memory at the addresses of the peripheral and core registers.
+ * Must be called before any register is accessed.
+ */
+void mapHostPeripherals();
+
+namespace USBDM {
+
+constexpr bool MapAllPinsOnStartup = false;
+constexpr bool ForceLockedPins     = false;
+
+// Pins of peripherals are not used on the host (gpio.h is replaced)
+template<class Info, int bitNum, Polarity polarity> class GpioTable_T;
+
+/** Number of critical sections entered and not yet left */
+extern volatile unsigned hostCriticalDepth;
+
+/**
+ * Critical section.
+ * There are no interrupts on the host - the nesting is recorded so a check
+ * can confirm code is (or is not) run inside a critical section.
+ */
+class CriticalSection {
+public:
+   CriticalSection() {
+      hostCriticalDepth = hostCriticalDepth + 1;
+   }
+   ~CriticalSection() {
+      hostCriticalDepth = hostCriticalDepth - 1;
+   }
+};
+
+/** Mask for SysTick counter (24-bit down-counter) */
+static constexpr uint32_t TIMER_MASK = ((1UL<<24)-1UL);
+
+/**
+ * Get current SysTick count (decrements)
+ *
+ * @return Host time in core clock (48 MHz) ticks masked to the SysTick width
+ */
+uint32_t getTicks();
+
+/**
+ * Stand-in for LPUART0 pin mapping (pin_mapping.h)
+ */
+class Lpuart0Info {
+public:
+   //! Hardware base address as uint32_t
+   static constexpr uint32_t baseAddress = LPUART0_BasePtr;
+
+   //! Hardware base pointer
+   static constexpr HardwarePtr<LPUART_Type> lpuart = baseAddress;
+
+   //! Pins are not mapped on the host
+   static constexpr bool mapPinsOnEnable = false;
+
+   //! Number of samples per bit
+   static constexpr uint32_t oversampleRatio = 8;
+
+   //! IRQ numbers for hardware
+   static constexpr IRQn_Type irqNums[]  = LPUART0_IRQS;
+
+   //! Number of IRQs for hardware
+   static constexpr uint32_t irqCount  = sizeof(irqNums)/sizeof(irqNums[0]);
+
+   //! Class based callback handler has been installed in vector table
+   static constexpr bool irqHandlerInstalled = true;
+
+   //! Default IRQ level
+   static constexpr NvicPriority irqLevel =  NvicPriority_Normal;
+
+   static void enableClock() {}
+   static void disableClock() {}
+
+   //! Default Baud rate used if not explicitly given
+   static constexpr uint32_t defaultBaudRate = 115200;
+
+   //! Default buffer size for receive queue when interrupt driven
+   static constexpr unsigned receiveBufferSize = 50;
+
+   //! Default buffer size for transmit queue when interrupt driven
+   static constexpr unsigned transmitBufferSize = 50;
+
+   /**
+    * Get input clock frequency
+    *
+    * @return Input clock frequency as a uint32_t in Hz
+    */
+   static uint32_t getClockFrequency() {
+      return 48000000;
+   }
+
+   //! Pin of each signal
+   static constexpr struct {
+      int8_t gpioBit;
+   } info[] = {
+         /*   0: LPUART0_TX = PTA3 */ {3},
+         /*   1: LPUART0_RX = PTA4 */ {4},
+   };
+};
+
+} // End namespace USBDM
+
+#endif /* FIRMWARE_TEST_USBDM_HOST_H_ */
@@ -0,0 +1,252 @@
+/**
+ * @file    vector_test.cpp
+ * @brief   Checks of the test vector engine (vectorEngine.h)
+ *
+ * The GPIO fields are replaced by stubs driving a small sequential model of a CPLD.
+ * Streams are fed a byte at a time as the UART ISR would and the sender is paced by
+ * the window released callback.
+ */
+#include <vector>
+#include "firmware_test.h"
+#include "vectorEngine.h"
+
+using namespace USBDM;
+using namespace FirmwareTest;
+
+namespace {
+
+/** CPLD model - a 4-bit accumulator clocked by the clock pin */
+uint32_t cpldState  = 0;
+uint32_t cpldInputs = 0;
+bool     cpldClock  = false;
+
+/** Set if the response is sampled with the clock low */
+bool     sampledLow = false;
+
+/** Update model state */
+uint32_t nextState(uint32_t state, uint32_t inputs) {
+   return ((state*3)+inputs)&0xF;
+}
+
+/** Stand-in for the stimulus GpioField */
+struct StimulusStub {
+   static constexpr unsigned LEFT  = 7;
+   static constexpr unsigned RIGHT = 0;
+   static void setOutput(PinDriveStrength, PinSlewRate) {}
+   static void setInput() {}
+   static void write(uint32_t value) {
+      cpldInputs = value;
+   }
+};
+
+/** Stand-in for the response GpioField */
+struct ResponseStub {
+   static constexpr unsigned LEFT  = 3;
+   static constexpr unsigned RIGHT = 0;
+   static void setInput() {}
+   static uint32_t read() {
+      sampledLow = sampledLow || !cpldClock;
+      return cpldState;
+   }
+};
+
+/** Stand-in for the clock Gpio */
+struct ClockStub {
+   static void setOutput(PinDriveStrength, PinSlewRate) {}
+   static void high() {
+      if (!cpldClock) {
+         cpldState = nextState(cpldState, cpldInputs);
+      }
+      cpldClock = true;
+   }
+   static void low() {
+      cpldClock = false;
+   }
+};
+
+using Engine = VectorEngine_T<StimulusStub, ResponseStub, ClockStub>;
+
+/** Vectors per window (default window size) */
+constexpr unsigned WINDOW = 16;
+
+/** Bytes of the stream being sent */
+std::vector<uint8_t> stream;
+
+/** Next byte of stream to send */
+size_t sent = 0;
+
+/**
+ * Pass stream bytes to the receiver as the UART ISR would
+ *
+ * @param[in] count Number of bytes to send
+ */
+void send(size_t count) {
+   while ((count-- > 0) && (sent < stream.size())) {
+      Engine::receive(stream[sent++]);
+   }
+}
+
+/**
+ * Window released callback - send another window of vectors
+ */
+void windowReleased() {
+   send(WINDOW*sizeof(TestVector));
+}
+
+/**
+ * Create a stream of vectors with failures at given positions
+ *
+ * @param[in]  count     Number of vectors
+ * @param[in]  failEvery Make every n'th vector fail (0 => none)
+ * @param[out] expected  Expected result of applying the stream
+ */
+void makeStream(uint32_t count, unsigned failEvery, VectorResult &expected) {
+   stream.clear();
+   sent = 0;
+   for (unsigned index=0; index<4; index++) {
+      stream.push_back(count>>(8*index));
+   }
+   expected = {count, 0, 0, 0};
+   uint32_t state = 0;
+   for (uint32_t index=0; index<count; index++) {
+      TestVector vector;
+      vector.stimulus = (index*7+3)&0xFF;
+      state           = nextState(state, vector.stimulus);
+      vector.expected = state;
+      vector.mask     = (index%5 == 0)?0x3:0xF;
+      if ((failEvery != 0) && ((index%failEvery) == failEvery-1)) {
+         // Wrong value in a checked bit
+         vector.expected ^= 0x2;
+         if (expected.failCount++ == 0) {
+            expected.firstFailIndex    = index;
+            expected.firstFailResponse = state;
+         }
+      }
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&vector);
+      stream.insert(stream.end(), bytes, bytes+sizeof(vector));
+   }
+}
+
+/**
+ * Send a stream paced by the window released callback and apply it
+ *
+ * @param[in] count     Number of vectors
+ * @param[in] failEvery Make every n'th vector fail (0 => none)
+ */
+void pacedStream(uint32_t count, unsigned failEvery) {
+   VectorResult expected;
+   makeStream(count, failEvery, expected);
+   cpldState = 0;
+
+   Engine::startStream();
+   // Header and up to two windows before the first window is released
+   send(4+2*WINDOW*sizeof(TestVector));
+   check(Engine::isStreamActive(), "Stream active once header received");
+
+   VectorResult result;
+   bool complete = Engine::runStream(result);
+   check(complete, "Stream completed");
+   check(sent == stream.size(), "Whole stream sent");
+   check(!Engine::isReceiving() && !Engine::isStreamActive(), "Receiver idle after stream");
+   check((result.vectorCount == expected.vectorCount) && (result.failCount == expected.failCount),
+         "Vector and failure counts");
+   if (expected.failCount > 0) {
+      check((result.firstFailIndex == expected.firstFailIndex) && (result.firstFailResponse == expected.firstFailResponse),
+            "First failure");
+   }
+}
+
+/**
+ * Sender ignores the window released callback and overruns the windows
+ *
+ * @param[in] count Number of vectors (more than two windows)
+ */
+void overrunStream(uint32_t count) {
+   VectorResult expected;
+   makeStream(count, 0, expected);
+   cpldState = 0;
+
+   Engine::startStream();
+   // Header and two windows fill both windows - the next byte overruns
+   send(4+2*WINDOW*sizeof(TestVector));
+   check(Engine::isReceiving(), "Receiving before overrun");
+   bool idleEarly = false;
+   while (sent < stream.size()) {
+      send(1);
+      idleEarly = idleEarly || ((sent < stream.size()) && !Engine::isReceiving());
+   }
+   check(!idleEarly, "Rest of overrun stream discarded, not taken as commands");
+   check(!Engine::isReceiving(), "Receiver idle at end of declared stream");
+
+   VectorResult result;
+   check(!Engine::runStream(result), "Overrun stream reported as aborted");
+   check(result.vectorCount == 2*WINDOW, "Windows received before overrun applied");
+   check(!Engine::isStreamActive(), "Engine idle after aborted stream");
+
+   // Receiver accepts the next stream
+   pacedStream(3*WINDOW+1, 7);
+}
+
+} // End anonymous namespace
+
+void FirmwareTest::vectorEngineTest() {
+   Engine::setWindowCallback(windowReleased);
+   Engine::enableReception();
+
+   for (uint32_t count:{0u, 1u, WINDOW-1, WINDOW, WINDOW+1, 2*WINDOW, 2*WINDOW+1, 1000u}) {
+      pacedStream(count, 0);
+      pacedStream(count, 13);
+   }
+   check(!sampledLow, "Response sampled while clock high");
+
+   // Bits outside the fields are not kept in the packed windows
+   {
+      cpldState = 0;
+      TestVector vector = {0x103, 0x30, 0xF0};
+      stream = {1, 0, 0, 0};
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&vector);
+      stream.insert(stream.end(), bytes, bytes+sizeof(vector));
+      sent = 0;
+      Engine::startStream();
+      send(stream.size());
+      VectorResult result;
+      Engine::runStream(result);
+      check((result.vectorCount == 1) && (result.failCount == 0) && (cpldInputs == 0x03), "Bits outside fields ignored");
+   }
+
+   // Overrun with a partial window and a single vector left to discard
+   overrunStream(100);
+   overrunStream(2*WINDOW+1);
+
+   // Disabling reception aborts a stream part way through
+   VectorResult expected;
+   makeStream(100, 0, expected);
+   Engine::startStream();
+   send(20);
+   Engine::enableReception(false);
+   check(!Engine::isReceiving(), "Disabling reception aborts stream");
+   Engine::enableReception();
+
+   // Application and reception speed
+   {
+      constexpr unsigned VECTORS = 1000000;
+      std::vector<TestVector> vectors(VECTORS);
+      for (unsigned index=0; index<VECTORS; index++) {
+         vectors[index] = {static_cast<uint16_t>(index), 0, 0xF};
+      }
+      VectorResult result = {0, 0, 0, 0};
+      double applyNs = timeNs([&]() {
+         Engine::applyBlock(vectors.data(), VECTORS, result);
+      });
+      keep(result);
+
+      makeStream(VECTORS, 0, expected);
+      double receiveNs = timeNs([&]() {
+         Engine::startStream();
+         send(4+2*WINDOW*sizeof(TestVector));
+         Engine::runStream(result);
+      });
+      check(result.vectorCount == VECTORS, "Benchmark stream applied");
+      printf("Apply %.1f M vectors/s, receive and apply %.1f MB/s\n", 1e3*VECTORS/applyNs, 1e3*stream.size()/receiveNs);
+   }
+}
@@ -37,6 +37,20 @@ enum Mcp23008Interrupt {
    Mcp23008Interrupt_ActiveHigh  = 0b01<<1, //!< IRQ pin is push-pull and active-high
 };
 
+/**
+ * Interface for MCP23008 I2C GPIO expander.
+ *
+ * The registers written by the master (IODIR, IPOL, GPINTEN, DEFVAL, INTCON, IOCON, GPPU and OLAT)
+ * are shadowed. Writes are write-through and are skipped if the register already holds the value.
+ * The device is used in sequential mode so adjacent registers are written (or read) in one burst.
+ *
+ * @note The shadow assumes this object is the only master changing the device registers.
+ *       Use refresh() if the device may have been changed or reset independently.
+ *
+ * @note If the device does not respond (at construction or on a failed write) the shadow is
+ *       marked invalid and writes are no longer skipped until refresh() succeeds.
+ *       setPin() and clearPin() then use the last known output latch value.
+ */
 class mcp23008 {
 
 private:
@@ -63,48 +77,97 @@ private:
       OLAT_ADDR,   //!< OLAT_ADDR
    };
 
+   // Last values written to (or read from) device registers (INTF, INTCAP and GPIO are not used)
+   uint8_t shadow[OLAT_ADDR+1] = {};
+
+   // Indicates the shadow matches the device registers
+   bool shadowValid = false;
+
+   /**
+    * Write consecutive MCP23008 Registers as a sequential burst.
+    * Unchanged registers at the start and end of the range are not written while the shadow is valid.
+    * A failed write invalidates the shadow.
+    *
+    * @param[in]  address Address of first register
+    * @param[in]  size    Number of registers
+    * @param[in]  values  Values to write to registers
+    */
+   void writeRegs(RegAddress address, unsigned size, const uint8_t values[]) {
+      unsigned first = 0;
+      if (shadowValid) {
+         while ((first<size) && (shadow[address+first] == values[first])) {
+            first++;
+         }
+         while ((size>first) && (shadow[address+size-1] == values[size-1])) {
+            size--;
+         }
+      }
+      if (first == size) {
+         // No change
+         return;
+      }
+      uint8_t txData[1+OLAT_ADDR+1];
+      txData[0] = address+first;
+      for (unsigned index=first; index<size; index++) {
+         txData[1+index-first] = values[index];
+      }
+      i2c.startTransaction();
+      ErrorCode rc = i2c.transmit(MCP23008_ADDRESS, 1+size-first, txData);
+      i2c.endTransaction();
+
+      if (rc != E_NO_ERROR) {
+         // Device state unknown
+         shadowValid = false;
+         return;
+      }
+      for (unsigned index=first; index<size; index++) {
+         shadow[address+index] = values[index];
+      }
+   }
+
    /**
-    * Write MCP23008 Register
+    * Write MCP23008 Register.
+    * The write is skipped if the register is known to hold the value.
     *
     * @param[in]  address Register address
     * @param[in]  value   Value to write to register
     */
    void writeReg(RegAddress address, uint8_t value) {
-      uint8_t txData[] = {address, value};
-
-      i2c.startTransaction();
-      i2c.transmit(MCP23008_ADDRESS, sizeof(txData), txData);
-      i2c.endTransaction();
+      writeRegs(address, 1, &value);
    }
 
    /**
-    * Read MCP23008 Register
+    * Read consecutive MCP23008 Registers as a sequential burst
+    *
+    * @param[in]  address  Address of first register
+    * @param[in]  size     Number of registers
+    * @param[out] values   Values read from registers
     *
-    * @param[in]  address  Register address
-    * @param[out] value    Value read from register
+    * @return E_NO_ERROR on success
     */
-   void readReg(RegAddress address, uint8_t &value) {
-      uint8_t txData[]  = {address};
-      uint8_t rxData[1] = {};
+   ErrorCode readRegs(RegAddress address, unsigned size, uint8_t values[]) {
+      uint8_t txData[] = {address};
 
       i2c.startTransaction();
-      i2c.txRx(MCP23008_ADDRESS, sizeof(txData), txData, sizeof(rxData), rxData);
+      ErrorCode rc = i2c.txRx(MCP23008_ADDRESS, sizeof(txData), txData, size, values);
       i2c.endTransaction();
 
-      value = rxData[0];
+      return rc;
    }
 
 public:
 
    /**
-    * Create the MCP23008 interface
+    * Create the MCP23008 interface.
+    * Enables sequential mode and loads the register shadow from the device.
+    * Use isShadowValid() to check the device responded.
     *
     * @param[in] i2cInterface        I2C interface to use for communication
     * @param[in] i2cAddress          Bottom 3-bits of I2C address (determined by pin-strapping)
     * @param[in] mcp23008SlewRate    Slew rate control for SDA pin (defaults to fast)
     * @param[in] mcp23008Interrupt   IRQ pin mode (defaults to open-drain)
     */
-   constexpr mcp23008(
+   mcp23008(
          USBDM::I2c        &i2cInterface,
          uint8_t            i2cAddress        = 0b000,
          Mcp23008SlewRate   mcp23008SlewRate  = Mcp23008SlewRate_Fast,
@@ -113,9 +176,85 @@ public:
             MCP23008_ADDRESS((0b0100000|(i2cAddress&0b111))<<1),
             i2c(i2cInterface) {
 
-      writeReg(
-            IOCON_ADDR,
-            mcp23008SlewRate|mcp23008Interrupt|Mcp23008Sequential_Disable);
+      // Written by refresh() as the shadow is not yet valid
+      shadow[IOCON_ADDR] = (uint8_t)(mcp23008SlewRate|mcp23008Interrupt|Mcp23008Sequential_Enable);
+      refresh();
+   }
+
+   /**
+    * Reload the register shadow from the device.
+    * Reads IODIR-GPPU and OLAT (INTCAP and GPIO are not read so interrupts are not cleared).
+    * If the shadow is invalid IOCON is written first as the device may have been reset.
+    * The shadow is only valid once this succeeds.
+    *
+    * @return E_NO_ERROR on success
+    */
+   ErrorCode refresh() {
+      ErrorCode rc;
+
+      if (!shadowValid) {
+         // Written unconditionally as the device state is not known
+         const uint8_t txData[] = {IOCON_ADDR, shadow[IOCON_ADDR]};
+
+         i2c.startTransaction();
+         rc = i2c.transmit(MCP23008_ADDRESS, sizeof(txData), txData);
+         i2c.endTransaction();
+
+         if (rc != E_NO_ERROR) {
+            return rc;
+         }
+      }
+      // Read into a copy so a failure doesn't lose the last known values
+      uint8_t values[OLAT_ADDR+1];
+
+      rc = readRegs(IODIR_ADDR, GPPU_ADDR-IODIR_ADDR+1, values+IODIR_ADDR);
+      if (rc == E_NO_ERROR) {
+         rc = readRegs(OLAT_ADDR, 1, values+OLAT_ADDR);
+      }
+      shadowValid = (rc == E_NO_ERROR);
+      if (shadowValid) {
+         for (unsigned index=IODIR_ADDR; index<=GPPU_ADDR; index++) {
+            shadow[index] = values[index];
+         }
+         shadow[OLAT_ADDR] = values[OLAT_ADDR];
+      }
+      return rc;
+   }
+
+   /**
+    * Check if the register shadow matches the device
+    *
+    * @return false if the device has not responded since construction or a failed write (see refresh())
+    */
+   bool isShadowValid() const {
+      return shadowValid;
+   }
+
+   /**
+    * Configure GPIO direction, input polarity and pull-ups.
+    * Changed registers are written as one sequential burst.
+    *
+    * @param[in] direction Bit-mask controlling pin direction (0=> out, 1=> in)
+    * @param[in] polarity  Bit-mask controlling polarity of input pins (0=> normal, 1=> inverted)
+    * @param[in] pullUps   Bit-mask controlling pull-ups (0=> Disabled, 1=> Enabled)
+    */
+   void configure(uint8_t direction, uint8_t polarity, uint8_t pullUps) {
+      if (!shadowValid) {
+         // Registers between IPOL and GPPU are not known so can't be included in the burst
+         const uint8_t values[] = {direction, polarity};
+         writeRegs(IODIR_ADDR, sizeof(values), values);
+         writeReg(GPPU_ADDR, pullUps);
+         return;
+      }
+      uint8_t values[GPPU_ADDR-IODIR_ADDR+1];
+
+      for (unsigned index=0; index<sizeof(values); index++) {
+         values[index] = shadow[IODIR_ADDR+index];
+      }
+      values[IODIR_ADDR-IODIR_ADDR] = direction;
+      values[IPOL_ADDR-IODIR_ADDR]  = polarity;
+      values[GPPU_ADDR-IODIR_ADDR]  = pullUps;
+      writeRegs(IODIR_ADDR, sizeof(values), values);
    }
 
    /**
@@ -133,7 +272,25 @@ public:
     * @param[in] data  Data value to output to pins (if configured as output)
     */
    void writeData(uint8_t data) {
-      writeReg(GPIO_ADDR, data);
+      writeReg(OLAT_ADDR, data);
+   }
+
+   /**
+    * Set a GPIO pin high
+    *
+    * @param[in] pinNum  Pin to change [0..7] (if configured as output)
+    */
+   void setPin(unsigned pinNum) {
+      writeReg(OLAT_ADDR, shadow[OLAT_ADDR]|(1<<pinNum));
+   }
+
+   /**
+    * Set a GPIO pin low
+    *
+    * @param[in] pinNum  Pin to change [0..7] (if configured as output)
+    */
+   void clearPin(unsigned pinNum) {
+      writeReg(OLAT_ADDR, shadow[OLAT_ADDR]&~(1<<pinNum));
    }
 
    /**
@@ -142,18 +299,19 @@ public:
     * @param[out] data Data read
     */
    void readData(uint8_t &data) {
-      readReg(GPIO_ADDR, data);
+      readRegs(GPIO_ADDR, 1, &data);
    }
 
    /**
-    * Read the state of output latch for GPIO pins
+    * Read the state of output latch for GPIO pins.
+    * This is served from the register shadow.
     *
     * @param[out] data State read
     *
     * @note This will not be the pin value if the pin is configured as an input.
     */
    void readState(uint8_t &data) {
-      readReg(OLAT_ADDR, data);
+      data = shadow[OLAT_ADDR];
    }
 
    /**
@@ -175,6 +333,8 @@ public:
    }
 
    /**
+    * Read the interrupt state.
+    * INTF and INTCAP are read as one sequential burst (reading INTCAP clears the interrupt).
     *
     * @param[out] flags       Bit-mask reflecting the pins generating the current interrupt conditions
     * @param[out] gpioState   State of the GPIO Port value at the (first) interrupt
@@ -187,8 +347,12 @@ public:
     *       The value is cleared by this method or readData().
     */
    void pollInterruptState(uint8_t &flags, uint8_t &gpioState) {
-      readReg(INTCAP_ADDR, gpioState);
-      readReg(INTF_ADDR, flags);
+      uint8_t rxData[INTCAP_ADDR-INTF_ADDR+1] = {};
+
+      readRegs(INTF_ADDR, sizeof(rxData), rxData);
+
+      flags     = rxData[INTF_ADDR-INTF_ADDR];
+      gpioState = rxData[INTCAP_ADDR-INTF_ADDR];
    }
 
    /**
@@ -207,11 +371,12 @@ public:
          uint8_t modeMask,
          uint8_t defaultMask = 0
    ) {
-      // Disable before changes
-      writeReg(GPINTEN_ADDR,  0);
-      writeReg(DEFVAL_ADDR,   defaultMask);
-      writeReg(INTCON_ADDR,   modeMask);
-      writeReg(GPINTEN_ADDR,  enableMask);
+      if (!shadowValid || (shadow[DEFVAL_ADDR] != defaultMask) || (shadow[INTCON_ADDR] != modeMask)) {
+         // Disable before changes (GPINTEN, DEFVAL, INTCON in one burst)
+         const uint8_t values[] = {0, defaultMask, modeMask};
+         writeRegs(GPINTEN_ADDR, sizeof(values), values);
+      }
+      writeReg(GPINTEN_ADDR, enableMask);
    }
 
 }; // class mcp23008
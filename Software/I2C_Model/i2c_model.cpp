@@ -0,0 +1,760 @@
+/*
+ ============================================================================
+ * @file    i2c_model.cpp
+ * @brief   Host program running the I2C driver and device drivers against device models
+ *
+ *  Usage:
+ *    i2c_model            Check drivers against models and report bus cost per operation
+ *    i2c_model trace      As above with a trace of bus activity
+ ============================================================================
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "i2c_model.h"
+#include "mcp23008.h"
+#include "pca9685.h"
+#include "mma845x.h"
+#include "fxos8700cq.h"
+#include "hmc5883l.h"
+
+using namespace USBDM;
+using namespace I2cModel;
+
+// Host versions of the hardware hooks in usbdm_host.h
+volatile ErrorCode USBDM::errorCode = E_NO_ERROR;
+I2C_Type           USBDM::hostI2cRegisters;
+I2cBusModel        I2cModel::i2cBus;
+
+uint8_t USBDM::hostI2cRead(unsigned offset) {
+   return i2cBus.readRegister(offset);
+}
+
+void USBDM::hostI2cWrite(unsigned offset, uint8_t value) {
+   i2cBus.writeRegister(offset, value);
+}
+
+void USBDM::hostEnterCritical() {
+   i2cBus.enterCritical();
+}
+
+void USBDM::hostExitCritical() {
+   i2cBus.exitCritical();
+}
+
+void USBDM::waitUS(uint32_t usToWait) {
+   i2cBus.delay(usToWait);
+}
+
+void USBDM::waitMS(uint32_t msToWait) {
+   i2cBus.delay(msToWait*1000.0);
+}
+
+void hostAsm(const char *instruction) {
+   if (strcmp(instruction, "wfi") == 0) {
+      i2cBus.waitForInterrupt();
+   }
+}
+
+/** Number of failed checks */
+static unsigned failures = 0;
+
+/**
+ * Report check result
+ *
+ * @param[in] ok          Result of check
+ * @param[in] description What was checked
+ */
+static void check(bool ok, const char *description) {
+   if (!ok) {
+      printf("FAILED: %s\n", description);
+      failures++;
+   }
+}
+
+/**
+ * Run an operation and print the bus activity it caused
+ *
+ * @param[in] name      Description of operation
+ * @param[in] operation Operation to run
+ */
+static void measure(const char *name, std::function<void()> operation) {
+   BusStatistics before = i2cBus.getStatistics();
+   double        start  = i2cBus.getTime();
+   operation();
+   BusStatistics cost   = i2cBus.getStatistics()-before;
+   printf("  %-42s %5lu %5lu %5lu %6lu %9.1f\n",
+         name, cost.starts+cost.repeatedStarts, cost.bytes, cost.naks, cost.bits, i2cBus.getTime()-start);
+}
+
+/**
+ * Print heading for measure()
+ *
+ * @param[in] device Device name
+ */
+static void heading(const char *device) {
+   printf("%s @ %.0f Hz\n", device, i2cBus.getSclFrequency());
+   printf("  %-42s %5s %5s %5s %6s %9s\n", "Operation", "S/Sr", "Bytes", "NAKs", "Bits", "Time(us)");
+}
+
+/**
+ * MCP23008 I/O expander with GPIO_Tester driver
+ */
+static void mcp23008Test() {
+   i2cBus.reset();
+   Mcp23008Model model(0b000);
+   i2cBus.attach(model);
+   HostI2c i2c;
+
+   // Device left configured e.g. by an earlier run
+   static const uint8_t earlier[] = {Mcp23008Model::IODIR, 0xF0};
+   static const uint8_t latch[]   = {Mcp23008Model::OLAT, 0x05};
+   i2c.transmit(0x40, earlier);
+   i2c.transmit(0x40, latch);
+
+   heading("MCP23008");
+   mcp23008 *gpio = nullptr;
+   measure("Constructor (IOCON + shadow refresh)", [&]{ gpio = new mcp23008(i2c); });
+   check(!(model.getRegister(Mcp23008Model::IOCON)&Mcp23008Model::IOCON_SEQOP), "MCP23008 sequential mode set by constructor");
+   uint8_t data = 0;
+   gpio->readState(data);
+   check(data == 0x05, "MCP23008 shadow loaded from device");
+   check(model.getRegister(Mcp23008Model::IODIR) == 0xF0, "MCP23008 configuration preserved");
+
+   measure("setDirection()", [&]{ gpio->setDirection(0x0F); });
+   measure("setDirection() unchanged", [&]{ gpio->setDirection(0x0F); });
+   measure("writeData()", [&]{ gpio->writeData(0xA5); });
+   check(model.getRegister(Mcp23008Model::OLAT) == 0xA5, "MCP23008 OLAT written");
+   check((model.getPins()&0xF0) == 0xA0, "MCP23008 outputs driven");
+   measure("writeData() unchanged", [&]{ gpio->writeData(0xA5); });
+
+   model.driveInputs(0x05, 0x0F);
+   measure("readData()", [&]{ gpio->readData(data); });
+   check(data == 0xA5, "MCP23008 inputs read");
+   measure("readState()", [&]{ gpio->readState(data); });
+   check(data == 0xA5, "MCP23008 output latch read");
+
+   measure("setPin()", [&]{ gpio->setPin(4); });
+   check(model.getRegister(Mcp23008Model::OLAT) == 0xB5, "MCP23008 pin set");
+   measure("clearPin()", [&]{ gpio->clearPin(7); });
+   check(model.getRegister(Mcp23008Model::OLAT) == 0x35, "MCP23008 pin cleared");
+   gpio->setPin(7);
+
+   measure("setInputPolarity()", [&]{ gpio->setInputPolarity(0x01); });
+   gpio->readData(data);
+   check(data == 0xB4, "MCP23008 input polarity");
+   measure("setPullUps()", [&]{ gpio->setPullUps(0x0C); });
+   model.driveInputs(0x01, 0x03);
+   gpio->readData(data);
+   check((data&0x0F) == 0x0C, "MCP23008 pull-ups");
+   measure("configure() (IODIR..GPPU burst)", [&]{ gpio->configure(0x1F, 0x00, 0x03); });
+   check((model.getRegister(Mcp23008Model::IODIR) == 0x1F) &&
+         (model.getRegister(Mcp23008Model::IPOL)  == 0x00) &&
+         (model.getRegister(Mcp23008Model::GPPU)  == 0x03), "MCP23008 configure()");
+   gpio->configure(0x0F, 0x01, 0x0C);
+
+   measure("configureInterruptOnChange()", [&]{ gpio->configureInterruptOnChange(0x03, 0x00); });
+   model.driveInputs(0x03, 0x03);
+   check(model.interruptAsserted(), "MCP23008 interrupt on change");
+   uint8_t flags = 0, captured = 0;
+   measure("pollInterruptState() (INTF..INTCAP burst)", [&]{ gpio->pollInterruptState(flags, captured); });
+   check(flags == 0x02, "MCP23008 INTF");
+   check(captured == 0xBE, "MCP23008 INTCAP");
+   check(!model.interruptAsserted(), "MCP23008 interrupt cleared by reading INTCAP");
+   measure("configureInterruptOnChange() enable only", [&]{ gpio->configureInterruptOnChange(0x0F, 0x00); });
+   check((model.getRegister(Mcp23008Model::GPINTEN) == 0x0F), "MCP23008 GPINTEN");
+   measure("configureInterruptOnChange() new mode", [&]{ gpio->configureInterruptOnChange(0x03, 0x03, 0x01); });
+   check((model.getRegister(Mcp23008Model::GPINTEN) == 0x03) &&
+         (model.getRegister(Mcp23008Model::DEFVAL)  == 0x01) &&
+         (model.getRegister(Mcp23008Model::INTCON)  == 0x03), "MCP23008 interrupt mode changed");
+
+   // Device changed behind the driver's back
+   static const uint8_t external[] = {Mcp23008Model::OLAT, 0x00};
+   i2c.transmit(0x40, external);
+   measure("refresh()", [&]{ gpio->refresh(); });
+   gpio->readState(data);
+   check(data == 0x00, "MCP23008 refresh()");
+
+   // Four register writes as separate transactions and as one batch
+   static const uint8_t writes[4][2] = {{Mcp23008Model::OLAT, 1}, {Mcp23008Model::IPOL, 2}, {Mcp23008Model::OLAT, 3}, {Mcp23008Model::GPPU, 4}};
+   measure("4 register writes, separate", [&]{ for (auto &write:writes) { i2c.transmit(0x40, write); } });
+   I2cSegment segments[4];
+   for (unsigned index=0; index<4; index++) {
+      segments[index] = I2cSegment::write(0x40, 2, writes[index]);
+   }
+   measure("4 register writes, transfer()", [&]{ i2c.transfer(segments); });
+   check(model.getRegister(Mcp23008Model::GPPU) == 4, "MCP23008 batched writes");
+   delete gpio;
+
+   // Device not responding when the driver is created
+   Mcp23008Model late(0b010);
+   measure("Constructor (no device)", [&]{ gpio = new mcp23008(i2c, 0b010); });
+   check(!gpio->isShadowValid(), "MCP23008 shadow invalid without device");
+   i2cBus.attach(late);
+   static const uint8_t unknown[] = {Mcp23008Model::OLAT, 0x05};
+   i2c.transmit(0x44, unknown);
+   measure("writeData() shadow invalid", [&]{ gpio->writeData(0x00); });
+   check(late.getRegister(Mcp23008Model::OLAT) == 0x00, "MCP23008 write-through while shadow invalid");
+   measure("refresh() shadow invalid (IOCON + shadow)", [&]{ check(gpio->refresh() == E_NO_ERROR, "MCP23008 refresh() after device appears"); });
+   check(gpio->isShadowValid(), "MCP23008 shadow valid after refresh()");
+   check(!(late.getRegister(Mcp23008Model::IOCON)&Mcp23008Model::IOCON_SEQOP) &&
+          (late.getRegister(Mcp23008Model::IOCON)&Mcp23008Model::IOCON_ODR), "MCP23008 IOCON restored by refresh()");
+   BusStatistics before = i2cBus.getStatistics();
+   gpio->writeData(0x00);
+   check((i2cBus.getStatistics()-before).bytes == 0, "MCP23008 writes skipped once shadow valid");
+   delete gpio;
+   printf("\n");
+}
+
+/**
+ * MCP23008 accessed with queued transactions in interrupt mode
+ */
+static void asyncTest() {
+   i2cBus.reset();
+   Mcp23008Model model(0b001);
+   i2cBus.attach(model);
+   HostI2c i2c(400000, I2cMode_Interrupt);
+
+   static uint8_t values[8][2];
+   static uint8_t readBack[8];
+   static const uint8_t olat[] = {Mcp23008Model::OLAT};
+   std::vector<I2cTransaction> writes, reads;
+   writes.reserve(8);
+   reads.reserve(8);
+   for (unsigned index=0; index<8; index++) {
+      values[index][0] = Mcp23008Model::OLAT;
+      values[index][1] = (uint8_t)(0x11*index);
+      writes.emplace_back(0x42, 2, values[index]);
+      reads.emplace_back(0x42, 1, olat, 1, readBack+index);
+   }
+   heading("MCP23008 interrupt mode");
+   measure("8 x (write OLAT, read OLAT) queued", [&]{
+      for (unsigned index=0; index<8; index++) {
+         i2c.queueTransaction(writes[index]);
+         i2c.queueTransaction(reads[index]);
+      }
+      while (!reads[7].isComplete()) {
+         i2cBus.waitForInterrupt();
+      }
+   });
+   for (unsigned index=0; index<8; index++) {
+      check((reads[index].getErrorCode() == E_NO_ERROR) && (readBack[index] == values[index][1]), "Queued transactions");
+   }
+   printf("\n");
+}
+
+/**
+ * Recovery of the transaction queue from cancelled and stuck transactions
+ */
+static void queueRecoveryTest() {
+   i2cBus.reset();
+   Mcp23008Model model(0b011);
+   i2cBus.attach(model);
+   HostI2c i2c(400000, I2cMode_Interrupt);
+
+   static const uint8_t first[]  = {Mcp23008Model::OLAT, 0x11};
+   static const uint8_t second[] = {Mcp23008Model::OLAT, 0x22};
+   static const uint8_t third[]  = {Mcp23008Model::OLAT, 0x33};
+
+   // Cancelling the transaction in progress starts the next
+   I2cTransaction cancelled(0x46, sizeof(first), first);
+   I2cTransaction following(0x46, sizeof(second), second);
+   i2c.queueTransaction(cancelled);
+   i2c.queueTransaction(following);
+   i2c.cancelTransaction(cancelled);
+   for (unsigned count=0; !following.isComplete() && (count<1000); count++) {
+      i2cBus.waitForInterrupt();
+   }
+   check(cancelled.getErrorCode() == E_INTERRUPTED, "Cancelled transaction in progress");
+   check(following.getErrorCode() == E_NO_ERROR, "Queue restarted after cancel");
+   check(model.getRegister(Mcp23008Model::OLAT) == 0x22, "Transaction after cancel");
+
+   // An earlier asynchronous transaction stops making progress
+   I2cTransaction stuck(0x46, sizeof(first), first);
+   i2cBus.holdBus();
+   i2c.queueTransaction(stuck);
+   ErrorCode rc = i2c.transmit(0x46, sizeof(third), third);
+   check(stuck.getErrorCode() == E_TIMEOUT, "Stuck transaction timed out");
+   check(rc == E_NO_ERROR, "Blocking transaction behind stuck transaction");
+   check(model.getRegister(Mcp23008Model::OLAT) == 0x33, "Queue recovered from stuck transaction");
+   check(i2c.busHangResets == 1, "Bus reset on timeout");
+}
+
+/**
+ * Apply a transaction directly to a reference device model
+ *
+ * @param[in]  device Device model (nullptr if absent)
+ * @param[in]  txSize Size of transmission data
+ * @param[in]  txData Data for transmission
+ * @param[in]  rxSize Size of reception data
+ * @param[out] rxData Data buffer for reception
+ *
+ * @return Expected result of transaction
+ */
+static ErrorCode referenceTransaction(I2cSlaveModel *device, unsigned txSize, const uint8_t txData[], unsigned rxSize, uint8_t rxData[]) {
+   if (device == nullptr) {
+      return E_NO_ACK;
+   }
+   if (txSize > 0) {
+      device->start(0, false);
+      for (unsigned index=0; index<txSize; index++) {
+         device->write(txData[index]);
+      }
+      device->stop();
+   }
+   if (rxSize > 0) {
+      device->start(0, true);
+      for (unsigned index=0; index<rxSize; index++) {
+         rxData[index] = device->read();
+      }
+      device->stop();
+   }
+   return E_NO_ERROR;
+}
+
+/** Queued transaction of randomTransactionTest() */
+struct RandomTransaction {
+   I2cTransaction transaction{(uint8_t)0, 0, nullptr};
+   uint8_t        txData[5];
+   uint8_t        rxData[5];
+   uint8_t        expectedRx[5];
+   ErrorCode      expectedRc;
+};
+
+static RandomTransaction randomTransactions[8];
+
+/** Order in which randomTransactions[] completed */
+static std::vector<unsigned> completions;
+
+static void randomTransactionComplete(I2cTransaction &transaction) {
+   for (unsigned index=0; index<8; index++) {
+      if (&randomTransactions[index].transaction == &transaction) {
+         completions.push_back(index);
+      }
+   }
+}
+
+/**
+ * Random queued transactions, cancels and blocking calls checked against reference device models
+ */
+static void randomTransactionTest() {
+   i2cBus.reset();
+   Mcp23008Model modelA(0b100), modelB(0b101);
+   i2cBus.attach(modelA);
+   i2cBus.attach(modelB);
+   HostI2c i2c(400000, I2cMode_Interrupt);
+
+   std::mt19937 random(5);
+   bool results = true, data = true, order = true, idle = true, state = true;
+   unsigned long transactions = 0, cancelled = 0, blocking = 0;
+   for (unsigned round=0; round<5000; round++) {
+      Mcp23008Model referenceA(modelA), referenceB(modelB);
+      unsigned count = 1+random()%8;
+      unsigned cancelIndex = ((random()%4) == 0)?random()%count:~0U;
+      completions.clear();
+      for (unsigned index=0; index<count; index++) {
+         RandomTransaction &op = randomTransactions[index];
+         unsigned choice  = random()%6;
+         uint8_t  address = (choice == 0)?0x4E:(choice&1)?0x48:0x4A;
+         I2cSlaveModel *reference = (address == 0x48)?&referenceA:(address == 0x4A)?&referenceB:nullptr;
+         unsigned txSize = random()%5, rxSize = random()%5;
+         if ((txSize+rxSize) == 0) {
+            txSize = 1;
+         }
+         // Register pointer then data
+         op.txData[0] = random()%(Mcp23008Model::REGISTER_COUNT+1);
+         for (unsigned byte=1; byte<txSize; byte++) {
+            op.txData[byte] = random();
+         }
+         memset(op.rxData, 0, sizeof(op.rxData));
+         memset(op.expectedRx, 0, sizeof(op.expectedRx));
+         op.transaction = I2cTransaction(address, txSize, op.txData, rxSize, op.rxData, randomTransactionComplete);
+         op.expectedRc  = (index == cancelIndex)?E_INTERRUPTED:
+               referenceTransaction(reference, txSize, op.txData, rxSize, op.expectedRx);
+      }
+      for (unsigned index=0; index<count; index++) {
+         RandomTransaction &op = randomTransactions[index];
+         i2c.queueTransaction(op.transaction);
+         transactions++;
+         if (index == cancelIndex) {
+            i2c.cancelTransaction(op.transaction);
+            cancelled++;
+         }
+         // Other work between queuing
+         for (unsigned work=random()%20; work>0; work--) {
+            i2cBus.waitForInterrupt();
+         }
+      }
+      // Blocking transaction behind queued transactions
+      if ((random()%4) == 0) {
+         static const uint8_t olat[] = {Mcp23008Model::OLAT};
+         uint8_t value = 0, expected = 0;
+         referenceTransaction(&referenceA, 1, olat, 1, &expected);
+         results = results && (i2c.txRx(0x48, 1, olat, 1, &value) == E_NO_ERROR) && (value == expected);
+         blocking++;
+      }
+      for (unsigned work=0; (completions.size() < count) && (work<100000); work++) {
+         i2cBus.waitForInterrupt();
+      }
+      for (unsigned index=0; index<count; index++) {
+         RandomTransaction &op = randomTransactions[index];
+         results = results && (op.transaction.getErrorCode() == op.expectedRc);
+         if (op.expectedRc == E_NO_ERROR) {
+            data = data && (memcmp(op.rxData, op.expectedRx, sizeof(op.rxData)) == 0);
+         }
+      }
+      // Each completes once, in queue order apart from the cancelled transaction
+      std::vector<unsigned> sorted(completions);
+      std::sort(sorted.begin(), sorted.end());
+      for (unsigned index=0; index<count; index++) {
+         order = order && (sorted.size() == count) && (sorted[index] == index);
+      }
+      unsigned last = 0;
+      for (unsigned index:completions) {
+         if (index != cancelIndex) {
+            order = order && (index >= last);
+            last  = index;
+         }
+      }
+      idle = idle && i2c.isIdle();
+      for (unsigned reg=0; reg<Mcp23008Model::REGISTER_COUNT; reg++) {
+         state = state && (modelA.getRegister(reg) == referenceA.getRegister(reg)) &&
+                          (modelB.getRegister(reg) == referenceB.getRegister(reg));
+      }
+   }
+   check(results, "Random transactions complete with expected result");
+   check(data, "Random transactions receive expected data");
+   check(order, "Random transactions complete once in queue order");
+   check(idle, "Queue empty after random transactions");
+   check(state, "Device registers match reference after random transactions");
+   printf("Random queued transactions: %lu (%lu cancelled, %lu blocking calls behind queue)\n\n",
+         transactions, cancelled, blocking);
+}
+
+/**
+ * Random batched transactions (scatter-gather segments) checked against reference device models
+ */
+static void randomBatchTest() {
+   i2cBus.reset();
+   Mcp23008Model modelA(0b110), modelB(0b111);
+   i2cBus.attach(modelA);
+   i2cBus.attach(modelB);
+   HostI2c i2c(400000, I2cMode_Interrupt);
+
+   std::mt19937 random(9);
+   bool results = true, data = true, conditions = true, state = true;
+   unsigned long batches = 0, segmentTotal = 0, messageTotal = 0;
+   for (unsigned round=0; round<10000; round++) {
+      Mcp23008Model referenceA(modelA), referenceB(modelB);
+      I2cSegment segments[8];
+      uint8_t    buffers[8][4];
+      uint8_t    expected[8][4] = {};
+      unsigned   count = 1+random()%8;
+      for (unsigned index=0; index<count; index++) {
+         bool     continued = (index > 0) && ((random()%3) == 0);
+         bool     read      = continued?((segments[index-1].flags&I2cSegment_Read) != 0):((random()&1) != 0);
+         unsigned choice    = random()%10;
+         uint8_t  address   = (choice == 0)?0x48:(choice&1)?0x4C:0x4E;
+         unsigned size      = read?1+random()%3:random()%4;
+         for (unsigned byte=0; byte<sizeof(buffers[index]); byte++) {
+            buffers[index][byte] = random()%(Mcp23008Model::REGISTER_COUNT+1);
+         }
+         uint8_t flags = (continued?I2cSegment_Continue:0)|(((random()%5) == 0)?I2cSegment_Stop:0);
+         segments[index] = read?I2cSegment::read(address, size, buffers[index], flags):
+                                I2cSegment::write(address, size, buffers[index], flags);
+      }
+      // Reference - messages are applied in turn until one is not acknowledged
+      ErrorCode      expectedRc = E_NO_ERROR;
+      I2cSlaveModel *device     = nullptr;
+      unsigned       messages   = 0;
+      unsigned       stops      = 1;
+      for (unsigned index=0; index<count; index++) {
+         const I2cSegment &segment = segments[index];
+         bool read = (segment.flags&I2cSegment_Read) != 0;
+         if (!(segment.flags&I2cSegment_Continue)) {
+            if (device != nullptr) {
+               device->stop();
+            }
+            uint8_t address = segment.address&~1;
+            device = (address == 0x4C)?&referenceA:(address == 0x4E)?&referenceB:nullptr;
+            messages++;
+            if (device == nullptr) {
+               expectedRc = E_NO_ACK;
+               break;
+            }
+            device->start(address>>1, read);
+         }
+         for (unsigned byte=0; byte<segment.size; byte++) {
+            if (read) {
+               expected[index][byte] = device->read();
+            }
+            else {
+               device->write(segment.data[byte]);
+            }
+         }
+         bool lastOfMessage = ((index+1) == count) || !(segments[index+1].flags&I2cSegment_Continue);
+         if (lastOfMessage && ((index+1) < count) && (segment.flags&I2cSegment_Stop)) {
+            stops++;
+         }
+      }
+      if ((device != nullptr) && (expectedRc == E_NO_ERROR)) {
+         device->stop();
+      }
+      BusStatistics before = i2cBus.getStatistics();
+      ErrorCode rc;
+      if (round&1) {
+         rc = i2c.transfer(segments, count);
+      }
+      else {
+         I2cTransaction transaction(segments, count);
+         i2c.queueTransaction(transaction);
+         for (unsigned work=0; !transaction.isComplete() && (work<100000); work++) {
+            i2cBus.waitForInterrupt();
+         }
+         rc = transaction.getErrorCode();
+      }
+      BusStatistics cost = i2cBus.getStatistics()-before;
+      results = results && (rc == expectedRc);
+      if (expectedRc == E_NO_ERROR) {
+         for (unsigned index=0; index<count; index++) {
+            if (segments[index].flags&I2cSegment_Read) {
+               data = data && (memcmp(buffers[index], expected[index], segments[index].size) == 0);
+            }
+         }
+         // A (REPEATED-)START for each message and STOP where requested
+         conditions = conditions && ((cost.starts+cost.repeatedStarts) == messages) &&
+               (cost.stops == stops) && (cost.starts == stops);
+      }
+      for (unsigned reg=0; reg<Mcp23008Model::REGISTER_COUNT; reg++) {
+         state = state && (modelA.getRegister(reg) == referenceA.getRegister(reg)) &&
+                          (modelB.getRegister(reg) == referenceB.getRegister(reg));
+      }
+      batches++;
+      segmentTotal += count;
+      messageTotal += messages;
+   }
+   check(results, "Random batches complete with expected result");
+   check(data, "Random batches scatter received data");
+   check(conditions, "Random batches use a START per message");
+   check(state, "Device registers match reference after random batches");
+   printf("Random batched transactions: %lu (%lu segments, %lu messages)\n\n", batches, segmentTotal, messageTotal);
+}
+
+/** Gives access to the baud rate calculation */
+class I2cBaud : public USBDM::I2c {
+public:
+   using I2c::getBPSValue;
+};
+
+// Evaluated at compile time
+static_assert(I2cBaud::getBPSValue<400000, 24000000>() == I2cBaud::getBPSValue(400000, 24000000),
+      "Compile time and run time getBPSValue() differ");
+
+/**
+ * Original calculation (i2c.cpp) scanning the ICR divisor table
+ */
+static uint8_t referenceGetBPSValue(uint32_t bps, uint32_t clockFrequency) {
+   static const uint16_t divisors[] = {
+         // Divider assuming MULT == 0
+         20,   22,  24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
+         48,   56,  64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
+         160, 192, 224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
+         640, 768, 896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840,
+   };
+   uint8_t  best_mul   = 0;
+   uint8_t  best_icr   = (uint8_t)-1u;
+   uint16_t best_error = (uint16_t)-1u;
+
+   for (uint8_t mul=0; mul<=2; mul++) {
+      uint32_t divisor = (clockFrequency>>mul)/bps;
+      for (uint8_t icr=0; icr<(sizeof(divisors)/sizeof(divisors[0])); icr++) {
+         if (divisor>divisors[icr]) {
+            continue;
+         }
+         uint16_t error=(uint16_t)(divisors[icr]-divisor);
+         if ((error<best_error) || (error==0)) {
+            best_error=error;
+            best_icr=icr;
+            best_mul=mul;
+         }
+      }
+   }
+   if (best_icr == (uint8_t)-1u) {
+      return I2C_F_MULT(1)|I2C_F_ICR(5);
+   }
+   return I2C_F_MULT(best_mul)|I2C_F_ICR(best_icr);
+}
+
+/**
+ * Baud rate calculation against the original table scan
+ */
+static void baudRateTest() {
+   unsigned long cases = 0, differences = 0;
+   for (uint32_t clock=1000000; clock<=100000000; clock+=977777) {
+      for (uint32_t bps=1; bps<=clock; bps+=1+bps/500) {
+         cases++;
+         if (I2cBaud::getBPSValue(bps, clock) != referenceGetBPSValue(bps, clock)) {
+            differences++;
+         }
+      }
+   }
+   check(differences == 0, "getBPSValue() matches original table scan");
+   printf("Baud rate: %lu clock/bps pairs, %lu differences\n\n", cases, differences);
+}
+
+/**
+ * PCA9685 PWM controller with snippet driver
+ */
+static void pca9685Test() {
+   i2cBus.reset();
+   // Driver default address is 0x60 (7-bit) i.e. A5 strapped high
+   Pca9685Model model0(0x20), model1(0x21);
+   i2cBus.attach(model0);
+   i2cBus.attach(model1);
+   HostI2c i2c;
+
+   heading("PCA9685");
+   PCA9685 *pwm = nullptr;
+   measure("Constructor", [&]{ pwm = new PCA9685(i2c); });
+   if (model0.ignoredWrites != 0) {
+      printf("  Note: PRE_SCALE written with MODE1.SLEEP clear is ignored by the device\n");
+   }
+   measure("set_pin_pwm()", [&]{ pwm->set_pin_pwm(3, 1000); });
+   check(model0.getDutyCycle(3) == 1000, "PCA9685 PWM duty-cycle");
+   // The driver's high/low refer to the load rather than the LEDn output i.e. high => LEDn full off
+   measure("set_pin_high()", [&]{ pwm->set_pin_high(4); });
+   check(model0.getDutyCycle(4) == 0, "PCA9685 pin high");
+   measure("set_pin_low()", [&]{ pwm->set_pin_low(4); });
+   check(model0.getDutyCycle(4) == 4096, "PCA9685 pin low");
+   measure("allHigh() via ALLCALL address", [&]{ pwm->allHigh(); });
+   if (model0.getDutyCycle(3) != 0) {
+      printf("  Note: ALLCALL address is ignored unless MODE1.ALLCALL is set\n");
+   }
+   delete pwm;
+
+   // Both devices respond to ALLCALL when enabled
+   const uint8_t mode1 = PCA9685_MODE1_AI_MASK|PCA9685_MODE1_SLEEP_MASK|PCA9685_MODE1_ALLCALL_MASK;
+   PCA9685 pwm0(i2c, PCA9685_DEFAULT_SLAVE_BASE_ADDRESS,   30, mode1);
+   PCA9685 pwm1(i2c, PCA9685_DEFAULT_SLAVE_BASE_ADDRESS+2, 30, mode1);
+   check(model0.getRegister(Pca9685Model::PRE_SCALE) == 30, "PCA9685 prescaler written while sleeping");
+   check((model0.getDutyCycle(3) == 0) && (model1.getDutyCycle(15) == 0), "PCA9685 ALLCALL reaches both devices");
+   measure("allLow() via ALLCALL address", [&]{ pwm0.allLow(); });
+   check((model0.getDutyCycle(3) == 4096) && (model1.getDutyCycle(7) == 4096), "PCA9685 allLow");
+   printf("\n");
+}
+
+/**
+ * MMA845x accelerometer with snippet driver
+ */
+static void mma845xTest() {
+   i2cBus.reset();
+   Mma845xModel model;
+   model.setAcceleration(40, -24, 1000);
+   i2cBus.attach(model);
+   HostI2c i2c;
+
+   heading("MMA845x");
+   MMA845x *accelerometer = nullptr;
+   measure("Constructor", [&]{ accelerometer = new MMA845x(i2c, MMA845x::AccelerometerMode_2Gmode); });
+   check(getError() == E_NO_ERROR, "MMA845x found");
+   uint32_t id = 0;
+   measure("readID()", [&]{ id = accelerometer->readID(); });
+   check(id == 0x1A, "MMA845x WHO_AM_I");
+   int     status;
+   int16_t x, y, z;
+   measure("readAccelerometerXYZ() (waits for data)", [&]{ accelerometer->readAccelerometerXYZ(status, x, y, z); });
+   check((x == 163) && (y == -98) && (z == 4096), "MMA845x acceleration");
+   measure("standby()", [&]{ accelerometer->standby(); });
+   measure("active()", [&]{ accelerometer->active(); });
+   ErrorCode rc = E_NO_ERROR;
+   measure("calibrateAccelerometer()", [&]{ rc = accelerometer->calibrateAccelerometer(); });
+   check(rc == E_NO_ERROR, "MMA845x calibration");
+   accelerometer->readAccelerometerXYZ(status, x, y, z);
+   check((abs(x) <= 8) && (abs(y) <= 8) && (abs(z-4096) <= 8), "MMA845x calibrated");
+   if (model.ignoredWrites != 0) {
+      printf("  Note: CTRL_REG1 fields other than ACTIVE written while active are ignored by the device\n");
+   }
+   delete accelerometer;
+   printf("\n");
+}
+
+/**
+ * FXOS8700CQ accelerometer and magnetometer with snippet driver
+ */
+static void fxos8700cqTest() {
+   i2cBus.reset();
+   Fxos8700cqModel model;
+   model.setAcceleration(0, 500, 866);
+   model.setMagneticField(250, -120, 400);
+   i2cBus.attach(model);
+   HostI2c i2c;
+
+   heading("FXOS8700CQ");
+   FXOS8700CQ *sensor = nullptr;
+   measure("Constructor", [&]{ sensor = new FXOS8700CQ(i2c, FXOS8700CQ::ACCEL_2Gmode); });
+   uint32_t id = 0;
+   measure("readID()", [&]{ id = sensor->readID(); });
+   check(id == 0xC7, "FXOS8700CQ WHO_AM_I");
+   measure("enable(ACCEL_MAG)", [&]{ sensor->enable(FXOS8700CQ::ACCEL_MAG); });
+   waitMS(10);
+   int     status;
+   int16_t x, y, z;
+   measure("readAccelerometerXYZ()", [&]{ sensor->readAccelerometerXYZ(&status, &x, &y, &z); });
+   check((x == 0) && (y == 2048) && (z == 3547), "FXOS8700CQ acceleration");
+   measure("readMagnetometerXYZ()", [&]{ sensor->readMagnetometerXYZ(&status, &x, &y, &z); });
+   check((x == 250) && (y == -120) && (z == 400), "FXOS8700CQ magnetic field");
+   FXOS8700CQ::Data data;
+   measure("readAll()", [&]{ sensor->readAll(data); });
+   measure("standby()", [&]{ sensor->standby(); });
+   measure("active()", [&]{ sensor->active(); });
+   delete sensor;
+   printf("\n");
+}
+
+/**
+ * HMC5883L magnetometer with snippet driver
+ */
+static void hmc5883lTest() {
+   i2cBus.reset();
+   Hmc5883lModel model;
+   model.setMagneticField(200, -300, 400);
+   i2cBus.attach(model);
+   HostI2c i2c;
+
+   heading("HMC5883L");
+   HMC5883L *compass = nullptr;
+   measure("Constructor", [&]{ compass = new HMC5883L(i2c); });
+   uint32_t id = 0;
+   measure("readID()", [&]{ id = compass->readID(); });
+   check(id == 0x483433, "HMC5883L ID");
+   int16_t x, y, z;
+   measure("doMeasurement() (polls status)", [&]{ compass->doMeasurement(&x, &y, &z); });
+   check((x == 78) && (y == -117) && (z == 156), "HMC5883L measurement");
+   measure("setRange()", [&]{ compass->setRange(HMC5883L::MagRange_1_3); });
+   compass->doMeasurement(&x, &y, &z);
+   check((x == 218) && (y == -327) && (z == 436), "HMC5883L range");
+   delete compass;
+   printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+   if ((argc >= 2) && (strcmp(argv[1], "trace") == 0)) {
+      i2cBus.setTrace(stdout);
+   }
+   mcp23008Test();
+   asyncTest();
+   queueRecoveryTest();
+   randomTransactionTest();
+   randomBatchTest();
+   baudRateTest();
+   pca9685Test();
+   mma845xTest();
+   fxos8700cqTest();
+   hmc5883lTest();
+   if (failures != 0) {
+      printf("%u checks failed\n", failures);
+      return 1;
+   }
+   printf("Model check passed\n");
+   return 0;
+}
@@ -0,0 +1,1413 @@
+/**
+ * @file i2c_model.h
+ *
+ * Behavioural models of an I2C bus and slave devices for running the I2C driver on a PC
+ *
+ * - I2cBusModel       Simulated I2C0 master register block with attached slaves
+ * - HostI2c           The unmodified USBDM::I2c driver connected to the bus model
+ * - Mcp23008Model     MCP23008 8-bit I/O expander
+ * - Pca9685Model      PCA9685 16-channel PWM controller
+ * - Mma845xModel      MMA8451/2/3 3-axis accelerometer
+ * - Fxos8700cqModel   FXOS8700CQ 3-axis accelerometer and magnetometer
+ * - Hmc5883lModel     HMC5883L 3-axis magnetometer
+ *
+ * The bus model follows the register interface of the KL I2C master closely enough for
+ * I2c::poll() to run unchanged in polled and interrupt modes. Bus activity is counted in
+ * SCL bit times and simulated time advances with it so that device conversion and
+ * reset times are seen by the drivers.
+ *
+ * Device models cover the register behaviour used by the drivers in this tree
+ * (address pointer auto-increment, read-only and self-clearing registers, data-ready
+ * status, reset) rather than every feature of the parts.
+ */
+
+#ifndef I2C_MODEL_H_
+#define I2C_MODEL_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+#include <functional>
+#include "i2c.h"
+
+namespace I2cModel {
+
+/**
+ * Bus activity counters
+ */
+struct BusStatistics {
+   unsigned long starts;          //!< START conditions
+   unsigned long repeatedStarts;  //!< REPEATED-START conditions
+   unsigned long stops;           //!< STOP conditions
+   unsigned long bytes;           //!< Bytes transferred including address bytes
+   unsigned long naks;            //!< Address or data bytes not acknowledged by a slave
+   unsigned long bits;            //!< SCL bit times (byte = 9, START/REPEATED-START/STOP = 1)
+
+   BusStatistics operator-(const BusStatistics &other) const {
+      return {
+         starts-other.starts, repeatedStarts-other.repeatedStarts, stops-other.stops,
+         bytes-other.bytes, naks-other.naks, bits-other.bits,
+      };
+   }
+};
+
+/**
+ * Interface of a slave device on the bus model
+ */
+class I2cSlaveModel {
+public:
+   virtual ~I2cSlaveModel() {}
+
+   /**
+    * Check if device responds to address
+    *
+    * @param[in] address 7-bit address
+    *
+    * @return true => device acknowledges address
+    */
+   virtual bool matches(uint8_t address) const = 0;
+
+   /**
+    * START or REPEATED-START with an address matching this device
+    *
+    * @param[in] address 7-bit address used
+    * @param[in] read    true => master is reading
+    */
+   virtual void start(uint8_t address, bool read) = 0;
+
+   /**
+    * Byte written by master
+    *
+    * @param[in] data Byte written
+    *
+    * @return true => device acknowledges byte
+    */
+   virtual bool write(uint8_t data) = 0;
+
+   /**
+    * Byte read by master
+    *
+    * @return Byte driven onto bus
+    */
+   virtual uint8_t read() = 0;
+
+   /**
+    * STOP or REPEATED-START ending access to this device
+    */
+   virtual void stop() {}
+
+   /**
+    * Advance device to simulated time
+    *
+    * @param[in] now Simulated time in microseconds
+    */
+   virtual void update(double now) {
+      (void)now;
+   }
+};
+
+/**
+ * Slave with a register address pointer.
+ * The first byte written after addressing sets the pointer.
+ * Following bytes are written to or read from registers with the pointer advanced after each byte.
+ */
+class RegisterSlaveModel : public I2cSlaveModel {
+
+private:
+   bool pointerNext = false;
+
+protected:
+   uint8_t       pointer = 0;       //!< Register address pointer
+   double        now     = 0;       //!< Simulated time of last update()
+
+public:
+   unsigned long registerReads  = 0;  //!< Register bytes read by master
+   unsigned long registerWrites = 0;  //!< Register bytes written by master
+
+protected:
+   /**
+    * Read register
+    *
+    * @param[in] reg Register address
+    *
+    * @return Register value
+    */
+   virtual uint8_t readRegister(uint8_t reg) = 0;
+
+   /**
+    * Write register
+    *
+    * @param[in] reg   Register address
+    * @param[in] value Value written
+    */
+   virtual void writeRegister(uint8_t reg, uint8_t value) = 0;
+
+   /**
+    * Get register address following reg
+    *
+    * @param[in] reg Register address
+    *
+    * @return Next register address
+    */
+   virtual uint8_t nextRegister(uint8_t reg) = 0;
+
+public:
+   void start(uint8_t, bool read) override {
+      pointerNext = !read;
+   }
+
+   bool write(uint8_t data) override {
+      if (pointerNext) {
+         pointerNext = false;
+         pointer     = data;
+         return true;
+      }
+      registerWrites++;
+      writeRegister(pointer, data);
+      pointer = nextRegister(pointer);
+      return true;
+   }
+
+   uint8_t read() override {
+      registerReads++;
+      uint8_t value = readRegister(pointer);
+      pointer = nextRegister(pointer);
+      return value;
+   }
+
+   void update(double time) override {
+      now = time;
+   }
+};
+
+/**
+ * Simulated I2C0 master with attached slaves
+ *
+ * Register accesses from the driver arrive through hostI2cRead()/hostI2cWrite().
+ * A byte transfer started by writing D completes at the next read of S (polled mode)
+ * or the next wfi (interrupt mode) when the interrupt handler is called.
+ * The bus stays BUSY after a STOP for two reads of S (polled mode) or until the next wfi
+ * (interrupt mode). STOP detection then sets FLT.STOPF and IICIF if FLT.SSIE is set.
+ */
+class I2cBusModel {
+
+private:
+   uint8_t  registers[13]    = {};
+   bool     transferPending  = false;
+   bool     addressPhase     = false;
+   bool     reading          = false;
+   bool     inHandler        = false;
+   bool     stopPending      = false;
+   bool     held             = false;
+   unsigned stopReads        = 0;
+   unsigned criticalNesting  = 0;
+   double   sclFrequency     = 100000;
+   double   time             = 0;
+   FILE    *traceFile        = nullptr;
+
+   std::vector<I2cSlaveModel*> slaves;
+   std::vector<I2cSlaveModel*> selected;
+   std::function<void()>       interruptHandler;
+   BusStatistics               statistics = {};
+
+   static constexpr unsigned C1 = 0x02;
+   static constexpr unsigned S  = 0x03;
+   static constexpr unsigned D  = 0x04;
+   static constexpr unsigned FLT = 0x06;
+
+   void trace(const char *format, unsigned value=0) {
+      if (traceFile != nullptr) {
+         fprintf(traceFile, format, value);
+      }
+   }
+
+   void addBits(unsigned bits) {
+      statistics.bits += bits;
+      time            += bits*1e6/sclFrequency;
+   }
+
+   void updateSlaves() {
+      for (I2cSlaveModel *slave:slaves) {
+         slave->update(time);
+      }
+   }
+
+   void endAccess() {
+      for (I2cSlaveModel *slave:selected) {
+         slave->stop();
+      }
+      selected.clear();
+   }
+
+   void startTransfer(bool acknowledged) {
+      uint8_t status = registers[S] & ~(I2C_S_RXAK_MASK|I2C_S_TCF_MASK);
+      registers[S]   = status | (acknowledged?0:I2C_S_RXAK_MASK);
+      if (!acknowledged) {
+         statistics.naks++;
+      }
+      statistics.bytes++;
+      addBits(9);
+      transferPending = true;
+   }
+
+   void completeTransfer() {
+      if (transferPending && !held) {
+         transferPending = false;
+         registers[S] |= I2C_S_IICIF_MASK|I2C_S_TCF_MASK;
+      }
+   }
+
+   void completeStop() {
+      if (stopPending) {
+         stopPending = false;
+         registers[FLT] |= I2C_FLT_STOPF_MASK;
+         if (registers[FLT] & I2C_FLT_SSIE_MASK) {
+            registers[S] |= I2C_S_IICIF_MASK;
+         }
+      }
+   }
+
+   void receiveByte() {
+      uint8_t data = 0xFF;
+      if (reading) {
+         // Open-drain bus - wired-AND of all responding devices
+         for (I2cSlaveModel *slave:selected) {
+            data &= slave->read();
+         }
+      }
+      registers[D] = data;
+      bool acknowledge = !(registers[C1] & I2C_C1_TXAK_MASK);
+      trace(acknowledge?" r%02X":" r%02X~", data);
+      // Master drives ACK/NAK
+      statistics.bytes++;
+      addBits(9);
+      transferPending = true;
+      registers[S] &= ~I2C_S_TCF_MASK;
+   }
+
+   void transmitByte(uint8_t data) {
+      bool acknowledged = false;
+      if (addressPhase) {
+         addressPhase = false;
+         reading      = data & 1;
+         updateSlaves();
+         for (I2cSlaveModel *slave:slaves) {
+            if (slave->matches(data>>1)) {
+               slave->start(data>>1, reading);
+               selected.push_back(slave);
+            }
+         }
+         acknowledged = !selected.empty();
+         trace(" A%02X", data);
+      }
+      else if (!reading) {
+         for (I2cSlaveModel *slave:selected) {
+            acknowledged = slave->write(data) || acknowledged;
+         }
+         trace(" w%02X", data);
+      }
+      if (!acknowledged) {
+         trace("~");
+      }
+      startTransfer(acknowledged);
+   }
+
+   void writeControl(uint8_t value) {
+      uint8_t previous = registers[C1];
+      registers[C1] = value & ~I2C_C1_RSTA_MASK;
+      if (!(previous & I2C_C1_MST_MASK) && (value & I2C_C1_MST_MASK)) {
+         // START
+         trace(" S");
+         statistics.starts++;
+         addBits(1);
+         addressPhase = true;
+      }
+      else if ((previous & I2C_C1_MST_MASK) && !(value & I2C_C1_MST_MASK)) {
+         // STOP
+         trace(" P\n");
+         statistics.stops++;
+         addBits(1);
+         endAccess();
+         addressPhase    = false;
+         transferPending = false;
+         stopPending     = true;
+         stopReads       = 2;
+      }
+      else if ((value & I2C_C1_MST_MASK) && (value & I2C_C1_RSTA_MASK)) {
+         // REPEATED-START
+         trace(" Sr");
+         statistics.repeatedStarts++;
+         addBits(1);
+         endAccess();
+         addressPhase = true;
+      }
+      else if ((previous & I2C_C1_TX_MASK) && (value & I2C_C1_MST_MASK) && !(value & I2C_C1_TX_MASK)) {
+         // Change to receive - the driver's dummy read of D that starts reception
+         // is discarded without reaching the register so reception starts here
+         receiveByte();
+      }
+   }
+
+public:
+   /**
+    * Read register of simulated I2C0
+    *
+    * @param[in] offset Register offset in I2C_Type
+    *
+    * @return Register value
+    */
+   uint8_t readRegister(unsigned offset) {
+      switch (offset) {
+         case S: {
+            // Polled driver - transfer completes when status is checked
+            if (!(registers[C1] & I2C_C1_IICIE_MASK)) {
+               completeTransfer();
+            }
+            bool busy = (registers[C1] & I2C_C1_MST_MASK) || stopPending;
+            if (!(registers[C1] & I2C_C1_IICIE_MASK) && stopPending && (--stopReads == 0)) {
+               completeStop();
+            }
+            return registers[S] | (busy?I2C_S_BUSY_MASK:0);
+         }
+         case D: {
+            uint8_t data = registers[D];
+            if ((registers[C1] & I2C_C1_MST_MASK) && !(registers[C1] & I2C_C1_TX_MASK)) {
+               // Reading D starts reception of the next byte
+               receiveByte();
+            }
+            return data;
+         }
+         default:
+            return registers[offset];
+      }
+   }
+
+   /**
+    * Write register of simulated I2C0
+    *
+    * @param[in] offset Register offset in I2C_Type
+    * @param[in] value  Value to write
+    */
+   void writeRegister(unsigned offset, uint8_t value) {
+      switch (offset) {
+         case C1:
+            writeControl(value);
+            break;
+         case S:
+            registers[S] &= ~(value & (I2C_S_IICIF_MASK|I2C_S_ARBL_MASK));
+            break;
+         case FLT:
+            // START/STOP flags are write 1 to clear
+            registers[FLT] = (value & ~(I2C_FLT_STOPF_MASK|I2C_FLT_STARTF_MASK)) |
+                             (registers[FLT] & ~value & (I2C_FLT_STOPF_MASK|I2C_FLT_STARTF_MASK));
+            break;
+         case D:
+            registers[D] = value;
+            if ((registers[C1] & I2C_C1_MST_MASK) && (registers[C1] & I2C_C1_TX_MASK)) {
+               transmitByte(value);
+            }
+            break;
+         default:
+            registers[offset] = value;
+            break;
+      }
+   }
+
+   /**
+    * Call interrupt handler if the interrupt is enabled, pending and not masked
+    */
+   void dispatchInterrupt() {
+      while ((criticalNesting == 0) && !inHandler && interruptHandler &&
+             (registers[C1] & I2C_C1_IICIE_MASK) && (registers[S] & I2C_S_IICIF_MASK)) {
+         inHandler = true;
+         interruptHandler();
+         inHandler = false;
+      }
+   }
+
+   /**
+    * Wait for interrupt (wfi).
+    * Completes any transfer in progress and calls the interrupt handler.
+    */
+   void waitForInterrupt() {
+      completeTransfer();
+      completeStop();
+      dispatchInterrupt();
+   }
+
+   /** Mask interrupts */
+   void enterCritical() {
+      criticalNesting++;
+   }
+
+   /** Unmask interrupts */
+   void exitCritical() {
+      if (--criticalNesting == 0) {
+         dispatchInterrupt();
+      }
+   }
+
+   /**
+    * Set handler called for the I2C0 interrupt
+    *
+    * @param[in] handler Handler (usually calls I2c::poll())
+    */
+   void setInterruptHandler(std::function<void()> handler) {
+      interruptHandler = handler;
+   }
+
+   /**
+    * Add device to bus
+    *
+    * @param[in] slave Device model
+    */
+   void attach(I2cSlaveModel &slave) {
+      slaves.push_back(&slave);
+      slave.update(time);
+   }
+
+   /**
+    * A slave holds the bus e.g. SDA low part way through a byte.
+    * Byte transfers do not complete until releaseBus().
+    */
+   void holdBus() {
+      held = true;
+   }
+
+   /**
+    * Release the bus held by holdBus() e.g. by clocking SCL
+    */
+   void releaseBus() {
+      held = false;
+   }
+
+   /**
+    * Remove all devices and reset the master
+    */
+   void reset() {
+      slaves.clear();
+      selected.clear();
+      memset(registers, 0, sizeof(registers));
+      transferPending = false;
+      addressPhase    = false;
+      stopPending     = false;
+      held            = false;
+      interruptHandler = nullptr;
+   }
+
+   /**
+    * Advance simulated time with the bus idle
+    *
+    * @param[in] microseconds Time to advance
+    */
+   void delay(double microseconds) {
+      time += microseconds;
+      updateSlaves();
+   }
+
+   /**
+    * Set SCL frequency used to convert bit times to simulated time
+    *
+    * @param[in] frequency Frequency in Hz
+    */
+   void setSclFrequency(double frequency) {
+      sclFrequency = frequency;
+   }
+
+   /** @return SCL frequency in Hz */
+   double getSclFrequency() const {
+      return sclFrequency;
+   }
+
+   /** @return Simulated time in microseconds */
+   double getTime() const {
+      return time;
+   }
+
+   /** @return Bus activity counters */
+   const BusStatistics &getStatistics() const {
+      return statistics;
+   }
+
+   /**
+    * Print bus conditions and bytes (S, Sr, P, Annn address, wnn, rnn, ~ = NAK)
+    *
+    * @param[in] file File for trace or nullptr to disable
+    */
+   void setTrace(FILE *file) {
+      traceFile = file;
+   }
+};
+
+/** Bus model behind the simulated I2C0 */
+extern I2cBusModel i2cBus;
+
+/**
+ * The USBDM::I2c driver connected to the simulated I2C0
+ */
+class HostI2c : public USBDM::I2c {
+
+private:
+   const uint32_t inputClock;
+
+public:
+   /** Number of calls to busHangReset() */
+   unsigned busHangResets = 0;
+
+   /**
+    * Create driver instance
+    *
+    * @param[in] bps        Interface speed in bits-per-second
+    * @param[in] i2cMode    Mode of operation
+    * @param[in] inputClock Frequency of I2C input clock assumed when calculating F
+    */
+   HostI2c(uint32_t bps=400000, USBDM::I2cMode i2cMode=USBDM::I2cMode_Polled, uint32_t inputClock=24000000) :
+      I2c(0x40066000, i2cMode), inputClock(inputClock) {
+
+      i2c->C1 = I2C_C1_IICEN_MASK|i2cMode;
+      setBPS(bps);
+      if (i2cMode == USBDM::I2cMode_Interrupt) {
+         i2cBus.setInterruptHandler([this]{ poll(); });
+      }
+   }
+
+   ~HostI2c() {
+      i2cBus.setInterruptHandler(nullptr);
+   }
+
+   /**
+    * Set interface speed.
+    * The bus model runs at the SCL frequency actually obtained from the F register value.
+    *
+    * @param[in] bps Interface speed in bits-per-second
+    */
+   void setBPS(uint32_t bps) {
+      I2c::setBPS(bps, inputClock);
+      i2cBus.setSclFrequency(getSclFrequency());
+   }
+
+   /**
+    * Get SCL frequency from F register value
+    *
+    * @return Frequency in Hz
+    */
+   uint32_t getSclFrequency() {
+      uint8_t  f    = i2c->F;
+      unsigned icr  = (f&I2C_F_ICR_MASK)>>I2C_F_ICR_SHIFT;
+      unsigned mult = (f&I2C_F_MULT_MASK)>>I2C_F_MULT_SHIFT;
+      for (const I2cDivisor &entry:I2C_SORTED_DIVISORS) {
+         if ((entry.firstIcr == icr) || (entry.lastIcr == icr)) {
+            return (inputClock>>mult)/entry.divisor;
+         }
+      }
+      return 0;
+   }
+
+   /** @return true => No transaction in progress or queued */
+   bool isIdle() const {
+      return (currentTransaction == nullptr) && (queueHead == nullptr);
+   }
+
+   void busHangReset() override {
+      busHangResets++;
+      i2cBus.releaseBus();
+   }
+};
+
+/**
+ * MCP23008 8-bit I/O expander
+ */
+class Mcp23008Model : public RegisterSlaveModel {
+
+public:
+   /** Register addresses */
+   enum {
+      IODIR, IPOL, GPINTEN, DEFVAL, INTCON, IOCON, GPPU, INTF, INTCAP, GPIO, OLAT,
+      REGISTER_COUNT,
+   };
+
+   static constexpr uint8_t IOCON_SEQOP  = 1<<5;  //!< Sequential operation disabled
+   static constexpr uint8_t IOCON_ODR    = 1<<2;  //!< INT pin is open-drain
+   static constexpr uint8_t IOCON_INTPOL = 1<<1;  //!< INT pin is active-high
+
+private:
+   const uint8_t address;
+   uint8_t regs[REGISTER_COUNT];
+   uint8_t inputs      = 0;
+   uint8_t inputsDriven = 0;
+   uint8_t lastPins    = 0;
+
+   /** Pin levels - outputs from OLAT, inputs from external drive or pull-ups */
+   uint8_t pins() const {
+      uint8_t inputLevels = (inputs&inputsDriven)|(regs[GPPU]&~inputsDriven);
+      return (regs[OLAT]&~regs[IODIR])|(inputLevels&regs[IODIR]);
+   }
+
+   /** Value of GPIO register (input polarity applied) */
+   uint8_t gpioValue() const {
+      return pins()^(regs[IPOL]&regs[IODIR]);
+   }
+
+   /** Check enabled inputs against DEFVAL or their previous level */
+   void checkInterrupts() {
+      uint8_t current   = pins();
+      uint8_t enabled   = regs[GPINTEN]&regs[IODIR];
+      uint8_t reference = (regs[INTCON]&regs[DEFVAL])|(~regs[INTCON]&lastPins);
+      uint8_t triggered = (current^reference)&enabled;
+      if (triggered) {
+         if (regs[INTF] == 0) {
+            regs[INTCAP] = gpioValue();
+         }
+         regs[INTF] |= triggered;
+      }
+      lastPins = current;
+   }
+
+   /** Reading GPIO or INTCAP clears the interrupt */
+   void clearInterrupt() {
+      regs[INTF] = 0;
+      // Conditions against DEFVAL persist
+      checkInterrupts();
+   }
+
+protected:
+   uint8_t readRegister(uint8_t reg) override {
+      switch (reg) {
+         case GPIO: {
+            uint8_t value = gpioValue();
+            clearInterrupt();
+            return value;
+         }
+         case INTCAP: {
+            uint8_t value = regs[INTCAP];
+            clearInterrupt();
+            return value;
+         }
+         default:
+            return (reg<REGISTER_COUNT)?regs[reg]:0;
+      }
+   }
+
+   void writeRegister(uint8_t reg, uint8_t value) override {
+      switch (reg) {
+         case INTF:
+         case INTCAP:
+            // Read-only
+            return;
+         case IOCON:
+            regs[IOCON] = value&(IOCON_SEQOP|(1<<4)|IOCON_ODR|IOCON_INTPOL);
+            return;
+         case GPIO:
+            regs[OLAT] = value;
+            break;
+         default:
+            if (reg<REGISTER_COUNT) {
+               regs[reg] = value;
+            }
+            break;
+      }
+      checkInterrupts();
+   }
+
+   uint8_t nextRegister(uint8_t reg) override {
+      if (regs[IOCON]&IOCON_SEQOP) {
+         return reg;
+      }
+      return (reg>=OLAT)?IODIR:reg+1;
+   }
+
+public:
+   /**
+    * Create model in power-on state
+    *
+    * @param[in] pinStrapping A2-A0 pin levels
+    */
+   Mcp23008Model(uint8_t pinStrapping=0) : address(0x20|(pinStrapping&0x7)) {
+      reset();
+   }
+
+   /** Power-on reset */
+   void reset() {
+      memset(regs, 0, sizeof(regs));
+      regs[IODIR] = 0xFF;
+      lastPins    = pins();
+   }
+
+   bool matches(uint8_t addr) const override {
+      return addr == address;
+   }
+
+   /**
+    * Drive pins externally
+    *
+    * @param[in] levels Pin levels
+    * @param[in] mask   Pins driven (others are pulled up if GPPU is set or read low)
+    */
+   void driveInputs(uint8_t levels, uint8_t mask=0xFF) {
+      inputs       = levels;
+      inputsDriven = mask;
+      checkInterrupts();
+   }
+
+   /** @return Pin levels */
+   uint8_t getPins() const {
+      return pins();
+   }
+
+   /**
+    * Get register value without side effects
+    *
+    * @param[in] reg Register address
+    *
+    * @return Register value
+    */
+   uint8_t getRegister(unsigned reg) const {
+      return (reg==GPIO)?gpioValue():regs[reg];
+   }
+
+   /** @return true => INT pin asserted */
+   bool interruptAsserted() const {
+      return regs[INTF] != 0;
+   }
+};
+
+/**
+ * PCA9685 16-channel 12-bit PWM controller
+ */
+class Pca9685Model : public RegisterSlaveModel {
+
+public:
+   /** Register addresses */
+   enum {
+      MODE1        = 0x00,
+      MODE2        = 0x01,
+      SUBADR1      = 0x02,
+      SUBADR2      = 0x03,
+      SUBADR3      = 0x04,
+      ALLCALLADR   = 0x05,
+      LED0_ON_L    = 0x06,
+      LED15_OFF_H  = 0x45,
+      ALL_LED_ON_L = 0xFA,
+      ALL_LED_OFF_H= 0xFD,
+      PRE_SCALE    = 0xFE,
+      TESTMODE     = 0xFF,
+   };
+
+   static constexpr uint8_t MODE1_AI      = 1<<5;  //!< Register auto-increment
+   static constexpr uint8_t MODE1_SLEEP   = 1<<4;  //!< Oscillator off
+   static constexpr uint8_t MODE1_SUB1    = 1<<3;  //!< Respond to SUBADR1
+   static constexpr uint8_t MODE1_SUB2    = 1<<2;  //!< Respond to SUBADR2
+   static constexpr uint8_t MODE1_SUB3    = 1<<1;  //!< Respond to SUBADR3
+   static constexpr uint8_t MODE1_ALLCALL = 1<<0;  //!< Respond to ALLCALLADR
+   static constexpr uint8_t LED_FULL      = 1<<4;  //!< Full on/off bit in LEDn_ON_H/LEDn_OFF_H
+
+private:
+   const uint8_t address;
+   uint8_t regs[256];
+   bool    generalCall = false;
+
+protected:
+   uint8_t readRegister(uint8_t reg) override {
+      if (reg>=ALL_LED_ON_L && reg<=ALL_LED_OFF_H) {
+         // Write-only
+         return 0;
+      }
+      return regs[reg];
+   }
+
+   void writeRegister(uint8_t reg, uint8_t value) override {
+      if (reg>LED15_OFF_H && reg<ALL_LED_ON_L) {
+         // Reserved
+         return;
+      }
+      if (reg>=ALL_LED_ON_L && reg<=ALL_LED_OFF_H) {
+         for (unsigned channel=0; channel<16; channel++) {
+            regs[LED0_ON_L+4*channel+(reg-ALL_LED_ON_L)] = value;
+         }
+         return;
+      }
+      if (reg == PRE_SCALE) {
+         if (!(regs[MODE1]&MODE1_SLEEP)) {
+            // Only writable when oscillator is off
+            ignoredWrites++;
+            return;
+         }
+         value = (value<3)?3:value;
+      }
+      regs[reg] = value;
+   }
+
+   uint8_t nextRegister(uint8_t reg) override {
+      return (regs[MODE1]&MODE1_AI)?(uint8_t)(reg+1):reg;
+   }
+
+public:
+   /** Writes to PRE_SCALE discarded because MODE1.SLEEP was clear */
+   unsigned long ignoredWrites = 0;
+
+   /**
+    * Create model in power-on state
+    *
+    * @param[in] pinStrapping A5-A0 pin levels
+    */
+   Pca9685Model(uint8_t pinStrapping=0) : address(0x40|(pinStrapping&0x3F)) {
+      reset();
+   }
+
+   /** Power-on or software reset */
+   void reset() {
+      memset(regs, 0, sizeof(regs));
+      regs[MODE1]      = MODE1_SLEEP|MODE1_ALLCALL;
+      regs[MODE2]      = 0x04;
+      regs[SUBADR1]    = 0xE2;
+      regs[SUBADR2]    = 0xE4;
+      regs[SUBADR3]    = 0xE8;
+      regs[ALLCALLADR] = 0xE0;
+      for (unsigned channel=0; channel<16; channel++) {
+         regs[LED0_ON_L+4*channel+3] = LED_FULL;
+      }
+      regs[PRE_SCALE]  = 0x1E;
+   }
+
+   bool matches(uint8_t addr) const override {
+      return (addr == address) || (addr == 0) ||
+            ((regs[MODE1]&MODE1_ALLCALL) && (addr == (regs[ALLCALLADR]>>1))) ||
+            ((regs[MODE1]&MODE1_SUB1)    && (addr == (regs[SUBADR1]>>1))) ||
+            ((regs[MODE1]&MODE1_SUB2)    && (addr == (regs[SUBADR2]>>1))) ||
+            ((regs[MODE1]&MODE1_SUB3)    && (addr == (regs[SUBADR3]>>1)));
+   }
+
+   void start(uint8_t addr, bool read) override {
+      generalCall = (addr == 0);
+      RegisterSlaveModel::start(addr, read);
+   }
+
+   bool write(uint8_t data) override {
+      if (generalCall) {
+         // SWRST
+         if (data == 0x06) {
+            reset();
+         }
+         return true;
+      }
+      return RegisterSlaveModel::write(data);
+   }
+
+   /**
+    * Get register value without side effects
+    *
+    * @param[in] reg Register address
+    *
+    * @return Register value
+    */
+   uint8_t getRegister(unsigned reg) const {
+      return regs[reg];
+   }
+
+   /**
+    * Get output duty-cycle
+    *
+    * @param[in] channel Output channel [0..15]
+    *
+    * @return Duty-cycle in 1/4096 (4096 => full on)
+    */
+   unsigned getDutyCycle(unsigned channel) const {
+      const uint8_t *led = regs+LED0_ON_L+4*channel;
+      if (led[3]&LED_FULL) {
+         return 0;
+      }
+      if (led[1]&LED_FULL) {
+         return 4096;
+      }
+      unsigned on  = ((led[1]&0xF)<<8)|led[0];
+      unsigned off = ((led[3]&0xF)<<8)|led[2];
+      return (off-on)&0xFFF;
+   }
+
+   /** @return PWM frequency with the internal 25 MHz oscillator */
+   double getPwmFrequency() const {
+      return 25e6/(4096.0*(regs[PRE_SCALE]+1));
+   }
+};
+
+/**
+ * Accelerometer register set shared by the MMA845x and FXOS8700CQ
+ */
+class AccelerometerModel : public RegisterSlaveModel {
+
+public:
+   /** Register addresses */
+   enum {
+      STATUS       = 0x00,
+      OUT_X_MSB    = 0x01,
+      OUT_Z_MSB    = 0x05,
+      OUT_Z_LSB    = 0x06,
+      WHO_AM_I     = 0x0D,
+      XYZ_DATA_CFG = 0x0E,
+      CTRL_REG1    = 0x2A,
+      CTRL_REG2    = 0x2B,
+      CTRL_REG3    = 0x2C,
+      CTRL_REG4    = 0x2D,
+      CTRL_REG5    = 0x2E,
+      OFF_X        = 0x2F,
+      OFF_Y        = 0x30,
+      OFF_Z        = 0x31,
+   };
+
+   static constexpr uint8_t CTRL_REG1_ACTIVE = 1<<0;  //!< Active mode
+   static constexpr uint8_t CTRL_REG1_F_READ = 1<<1;  //!< 8-bit fast read
+   static constexpr uint8_t CTRL_REG2_RST    = 1<<6;  //!< Software reset
+   static constexpr uint8_t STATUS_ZYXDR     = 1<<3;  //!< New X, Y and Z data
+   static constexpr uint8_t STATUS_ZYXOW     = 1<<7;  //!< X, Y and Z data overwritten
+
+   /** Time device is not accessible after reset (us) */
+   static constexpr double RESET_TIME = 500;
+
+private:
+   const uint8_t address;
+   const uint8_t id;
+   const uint8_t lastRegister;
+   double        nextSample     = 0;
+   double        resetComplete  = 0;
+   int           acceleration[3] = {0, 0, 1000};
+
+   /** @return Output data period in microseconds */
+   double samplePeriod() const {
+      static const double periods[] = {1250, 2500, 5000, 10000, 20000, 80000, 160000, 640000};
+      return periods[(regs[CTRL_REG1]>>3)&0x7];
+   }
+
+   /** Latch new accelerometer sample */
+   void sampleAcceleration() {
+      for (unsigned axis=0; axis<3; axis++) {
+         // 4096 counts/g at +/-2g, offset registers are 2 mg/LSB (8 counts)
+         int counts = (acceleration[axis]*4096)/1000 + 8*(int8_t)regs[OFF_X+axis];
+         counts >>= (regs[XYZ_DATA_CFG]&0x3);
+         counts   = (counts<-8192)?-8192:(counts>8191)?8191:counts;
+         regs[OUT_X_MSB+2*axis]   = (uint8_t)(counts>>6);
+         regs[OUT_X_MSB+2*axis+1] = (uint8_t)(counts<<2);
+      }
+      regs[STATUS] = (regs[STATUS]&STATUS_ZYXDR)?(STATUS_ZYXOW|0x7F):0x0F;
+   }
+
+protected:
+   uint8_t regs[128] = {};
+
+   /** @return true => accelerometer is sampling */
+   virtual bool accelerometerEnabled() const {
+      return true;
+   }
+
+   /**
+    * Latch new samples when active
+    */
+   virtual void sample() {
+      if (accelerometerEnabled()) {
+         sampleAcceleration();
+      }
+   }
+
+   /**
+    * Check if register is read-only
+    *
+    * @param[in] reg Register address
+    *
+    * @return true => read-only
+    */
+   virtual bool isReadOnly(uint8_t reg) const {
+      return (reg<=OUT_Z_LSB) || (reg==WHO_AM_I);
+   }
+
+   /**
+    * Check if register may only be written in standby
+    *
+    * @param[in] reg Register address
+    *
+    * @return true => writes are ignored when active
+    */
+   virtual bool isStandbyOnly(uint8_t reg) const {
+      return (reg==XYZ_DATA_CFG) || (reg==CTRL_REG3) || (reg==CTRL_REG4) || (reg==CTRL_REG5);
+   }
+
+   /** Registers set to reset values */
+   virtual void resetRegisters() {
+      memset(regs, 0, sizeof(regs));
+      regs[WHO_AM_I] = id;
+   }
+
+   uint8_t readRegister(uint8_t reg) override {
+      uint8_t value = (reg<=lastRegister)?regs[reg]:0;
+      if (reg == ((regs[CTRL_REG1]&CTRL_REG1_F_READ)?OUT_Z_MSB:OUT_Z_LSB)) {
+         // Reading last data byte clears status
+         regs[STATUS] = 0;
+      }
+      return value;
+   }
+
+   void writeRegister(uint8_t reg, uint8_t value) override {
+      if ((reg>lastRegister) || isReadOnly(reg)) {
+         return;
+      }
+      if (reg == CTRL_REG2 && (value&CTRL_REG2_RST)) {
+         resetRegisters();
+         resetComplete = now+RESET_TIME;
+         return;
+      }
+      bool active = regs[CTRL_REG1]&CTRL_REG1_ACTIVE;
+      if (reg == CTRL_REG1) {
+         if (active) {
+            // Only ACTIVE may be changed when active
+            if ((value^regs[CTRL_REG1])&~CTRL_REG1_ACTIVE) {
+               ignoredWrites++;
+            }
+            value = (regs[CTRL_REG1]&~CTRL_REG1_ACTIVE)|(value&CTRL_REG1_ACTIVE);
+         }
+         else if (value&CTRL_REG1_ACTIVE) {
+            // First sample after one period
+            nextSample = now+samplePeriod();
+         }
+      }
+      else if (active && isStandbyOnly(reg)) {
+         ignoredWrites++;
+         return;
+      }
+      regs[reg] = value;
+   }
+
+   uint8_t nextRegister(uint8_t reg) override {
+      if (regs[CTRL_REG1]&CTRL_REG1_F_READ) {
+         // Fast read skips LSBs and wraps within data block
+         if (reg == OUT_Z_MSB) {
+            return STATUS;
+         }
+         if (reg>=OUT_X_MSB && reg<OUT_Z_MSB) {
+            return reg+2;
+         }
+      }
+      return (reg>=lastRegister)?0:reg+1;
+   }
+
+   /**
+    * Create model in power-on state
+    *
+    * @param[in] address      7-bit address
+    * @param[in] id           WHO_AM_I value
+    * @param[in] lastRegister Highest register address
+    */
+   AccelerometerModel(uint8_t address, uint8_t id, uint8_t lastRegister) :
+      address(address), id(id), lastRegister(lastRegister) {
+   }
+
+public:
+   /** Writes discarded because the device was active (CTRL_REG1 except ACTIVE, XYZ_DATA_CFG, CTRL_REG3-5) */
+   unsigned long ignoredWrites = 0;
+
+   bool matches(uint8_t addr) const override {
+      // Not accessible while resetting
+      return (addr == address) && (now >= resetComplete);
+   }
+
+   void update(double time) override {
+      RegisterSlaveModel::update(time);
+      if (!(regs[CTRL_REG1]&CTRL_REG1_ACTIVE)) {
+         return;
+      }
+      double period = samplePeriod();
+      if (nextSample <= now) {
+         unsigned long samples = 1+(unsigned long)((now-nextSample)/period);
+         // A second sample is enough to show data was overwritten
+         sample();
+         if (samples > 1) {
+            sample();
+         }
+         nextSample += period*samples;
+      }
+   }
+
+   /**
+    * Set acceleration
+    *
+    * @param[in] x X axis in mg
+    * @param[in] y Y axis in mg
+    * @param[in] z Z axis in mg
+    */
+   void setAcceleration(int x, int y, int z) {
+      acceleration[0] = x;
+      acceleration[1] = y;
+      acceleration[2] = z;
+   }
+
+   /**
+    * Get register value without side effects
+    *
+    * @param[in] reg Register address
+    *
+    * @return Register value
+    */
+   uint8_t getRegister(unsigned reg) const {
+      return regs[reg];
+   }
+};
+
+/**
+ * MMA8451Q/MMA8452Q/MMA8453Q 3-axis accelerometer
+ */
+class Mma845xModel : public AccelerometerModel {
+public:
+   /**
+    * Create model in power-on state
+    *
+    * @param[in] sa0 SA0 pin level
+    * @param[in] id  WHO_AM_I value (0x1A => MMA8451, 0x2A => MMA8452, 0x3A => MMA8453)
+    */
+   Mma845xModel(bool sa0=true, uint8_t id=0x1A) : AccelerometerModel(sa0?0x1D:0x1C, id, OFF_Z) {
+      resetRegisters();
+   }
+};
+
+/**
+ * FXOS8700CQ 3-axis accelerometer and magnetometer
+ */
+class Fxos8700cqModel : public AccelerometerModel {
+
+public:
+   /** Magnetometer register addresses */
+   enum {
+      M_DR_STATUS  = 0x32,
+      M_OUT_X_MSB  = 0x33,
+      M_OUT_Z_MSB  = 0x37,
+      M_OUT_Z_LSB  = 0x38,
+      M_CTRL_REG1  = 0x5B,
+      M_CTRL_REG2  = 0x5C,
+      LAST_REGISTER= 0x78,
+   };
+
+   static constexpr uint8_t M_CTRL_REG2_HYB_AUTOINC = 1<<5;  //!< Hybrid auto-increment
+
+private:
+   int field[3] = {0, 0, 0};
+
+   /** @return M_CTRL_REG1.m_hms (0 => accelerometer, 1 => magnetometer, 3 => both) */
+   unsigned sensors() const {
+      return regs[M_CTRL_REG1]&0x3;
+   }
+
+protected:
+   bool accelerometerEnabled() const override {
+      return sensors() != 1;
+   }
+
+   void sample() override {
+      AccelerometerModel::sample();
+      if (sensors() != 0) {
+         for (unsigned axis=0; axis<3; axis++) {
+            regs[M_OUT_X_MSB+2*axis]   = (uint8_t)(field[axis]>>8);
+            regs[M_OUT_X_MSB+2*axis+1] = (uint8_t)field[axis];
+         }
+         regs[M_DR_STATUS] = (regs[M_DR_STATUS]&STATUS_ZYXDR)?(STATUS_ZYXOW|0x7F):0x0F;
+      }
+   }
+
+   bool isReadOnly(uint8_t reg) const override {
+      return AccelerometerModel::isReadOnly(reg) || (reg>=M_DR_STATUS && reg<=M_OUT_Z_LSB);
+   }
+
+   uint8_t readRegister(uint8_t reg) override {
+      if (reg == ((regs[CTRL_REG1]&CTRL_REG1_F_READ)?M_OUT_Z_MSB:M_OUT_Z_LSB)) {
+         uint8_t value = regs[reg];
+         regs[M_DR_STATUS] = 0;
+         return value;
+      }
+      return AccelerometerModel::readRegister(reg);
+   }
+
+   uint8_t nextRegister(uint8_t reg) override {
+      if (regs[M_CTRL_REG2]&M_CTRL_REG2_HYB_AUTOINC) {
+         // Hybrid mode - accelerometer data is followed by magnetometer data
+         bool fastRead = regs[CTRL_REG1]&CTRL_REG1_F_READ;
+         if (reg == (fastRead?OUT_Z_MSB:OUT_Z_LSB)) {
+            return M_OUT_X_MSB;
+         }
+         if (reg == (fastRead?M_OUT_Z_MSB:M_OUT_Z_LSB)) {
+            return STATUS;
+         }
+         if (fastRead && reg>=M_OUT_X_MSB && reg<M_OUT_Z_MSB) {
+            return reg+2;
+         }
+      }
+      return AccelerometerModel::nextRegister(reg);
+   }
+
+   /**
+    * Get address from pin strapping
+    *
+    * @param[in] sa SA1,SA0 pin levels
+    *
+    * @return 7-bit address
+    */
+   static constexpr uint8_t addressFromPins(uint8_t sa) {
+      constexpr uint8_t addresses[] = {0x1E, 0x1D, 0x1C, 0x1F};
+      return addresses[sa&0x3];
+   }
+
+public:
+   /**
+    * Create model in power-on state
+    *
+    * @param[in] sa SA1,SA0 pin levels
+    */
+   Fxos8700cqModel(uint8_t sa=0b01) : AccelerometerModel(addressFromPins(sa), 0xC7, LAST_REGISTER) {
+      resetRegisters();
+   }
+
+   /**
+    * Set magnetic field
+    *
+    * @param[in] x X axis in 0.1 uT
+    * @param[in] y Y axis in 0.1 uT
+    * @param[in] z Z axis in 0.1 uT
+    */
+   void setMagneticField(int x, int y, int z) {
+      field[0] = x;
+      field[1] = y;
+      field[2] = z;
+   }
+};
+
+/**
+ * HMC5883L 3-axis magnetometer
+ */
+class Hmc5883lModel : public RegisterSlaveModel {
+
+public:
+   /** Register addresses */
+   enum {
+      CRA, CRB, MODE, OUT_X_H, OUT_X_L, OUT_Z_H, OUT_Z_L, OUT_Y_H, OUT_Y_L, STATUS, IDA, IDB, IDC,
+      REGISTER_COUNT,
+   };
+
+   static constexpr uint8_t STATUS_RDY = 1<<0;   //!< Data ready
+
+   /** Single measurement time (us) */
+   static constexpr double MEASUREMENT_TIME = 6000;
+
+private:
+   uint8_t regs[REGISTER_COUNT];
+   double  measurementDone = 0;
+   bool    measuring       = false;
+   int     field[3]        = {0, 0, 0};
+
+   /** @return Continuous mode period in microseconds */
+   double samplePeriod() const {
+      static const double periods[] = {1333333, 666667, 333333, 133333, 66667, 33333, 13333, 13333};
+      return periods[(regs[CRA]>>2)&0x7];
+   }
+
+   /** Latch measurement */
+   void measure() {
+      static const int gains[] = {1370, 1090, 820, 660, 440, 390, 330, 230};
+      int gain = gains[regs[CRB]>>5];
+      // Field is X, Y, Z - registers are X, Z, Y
+      static const unsigned axisRegister[] = {OUT_X_H, OUT_Y_H, OUT_Z_H};
+      for (unsigned axis=0; axis<3; axis++) {
+         int counts = (field[axis]*gain)/1000;
+         if ((counts<-2048) || (counts>2047)) {
+            // Overflow
+            counts = -4096;
+         }
+         regs[axisRegister[axis]]   = (uint8_t)(counts>>8);
+         regs[axisRegister[axis]+1] = (uint8_t)counts;
+      }
+      regs[STATUS] |= STATUS_RDY;
+   }
+
+protected:
+   uint8_t readRegister(uint8_t reg) override {
+      return (reg<REGISTER_COUNT)?regs[reg]:0;
+   }
+
+   void writeRegister(uint8_t reg, uint8_t value) override {
+      if (reg>MODE) {
+         // Read-only
+         return;
+      }
+      regs[reg] = value;
+      if (reg == MODE) {
+         measuring = ((value&0x3) <= 1);
+         if (measuring) {
+            regs[STATUS]   &= ~STATUS_RDY;
+            measurementDone = now+(((value&0x3)==1)?MEASUREMENT_TIME:samplePeriod());
+         }
+      }
+   }
+
+   uint8_t nextRegister(uint8_t reg) override {
+      // Wraps at end of data registers and at end of register map
+      if (reg == OUT_Y_L) {
+         return OUT_X_H;
+      }
+      return (reg>=IDC)?CRA:reg+1;
+   }
+
+public:
+   /**
+    * Create model in power-on state
+    */
+   Hmc5883lModel() {
+      memset(regs, 0, sizeof(regs));
+      regs[CRA]  = 0x10;
+      regs[CRB]  = 0x20;
+      regs[MODE] = 0x01;
+      regs[IDA]  = 'H';
+      regs[IDB]  = '4';
+      regs[IDC]  = '3';
+   }
+
+   bool matches(uint8_t addr) const override {
+      return addr == 0x1E;
+   }
+
+   void update(double time) override {
+      RegisterSlaveModel::update(time);
+      while (measuring && (now >= measurementDone)) {
+         measure();
+         if ((regs[MODE]&0x3) == 1) {
+            // Single measurement returns to idle
+            regs[MODE] = (regs[MODE]&~0x3)|0x3;
+            measuring  = false;
+         }
+         else {
+            measurementDone += samplePeriod();
+         }
+      }
+   }
+
+   /**
+    * Set magnetic field
+    *
+    * @param[in] x X axis in mGauss
+    * @param[in] y Y axis in mGauss
+    * @param[in] z Z axis in mGauss
+    */
+   void setMagneticField(int x, int y, int z) {
+      field[0] = x;
+      field[1] = y;
+      field[2] = z;
+   }
+
+   /**
+    * Get register value without side effects
+    *
+    * @param[in] reg Register address
+    *
+    * @return Register value
+    */
+   uint8_t getRegister(unsigned reg) const {
+      return regs[reg];
+   }
+};
+
+} // End namespace I2cModel
+
+#endif /* I2C_MODEL_H_ */
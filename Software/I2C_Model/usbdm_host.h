@@ -0,0 +1,249 @@
+/**
+ * @file    usbdm_host.h
+ * @brief   Host stand-in for the USBDM hardware headers used by the I2C driver
+ *
+ * This file is force-included ahead of every translation unit (g++ -include usbdm_host.h).
+ * It claims the include guards of pin_mapping.h and delay.h so that the unmodified
+ * i2c.h, i2c.cpp and device drivers compile on a PC with the I2C0 registers routed
+ * to the bus model in i2c_model.h.
+ */
+#ifndef I2C_MODEL_USBDM_HOST_H_
+#define I2C_MODEL_USBDM_HOST_H_
+
+// System headers are included before __asm__ is redirected below
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <random>
+
+// Replace pin_mapping.h and delay.h
+#define PROJECT_HEADERS_PIN_MAPPING_H
+#define INCLUDE_USBDM_DELAY_H_
+
+#include "error.h"
+
+/** Inline assembly used by the driver ("wfi", "nop") is passed to the bus model */
+void hostAsm(const char *instruction);
+#define __asm__(s) hostAsm(s)
+#define __asm(s)   hostAsm(s)
+
+// I2C register fields (from MKL03Z4.h)
+#define I2C_F_ICR_MASK       (0x3FU)
+#define I2C_F_ICR_SHIFT      (0U)
+#define I2C_F_ICR(x)         (((uint8_t)(((uint8_t)(x))<<I2C_F_ICR_SHIFT))&I2C_F_ICR_MASK)
+#define I2C_F_MULT_MASK      (0xC0U)
+#define I2C_F_MULT_SHIFT     (6U)
+#define I2C_F_MULT(x)        (((uint8_t)(((uint8_t)(x))<<I2C_F_MULT_SHIFT))&I2C_F_MULT_MASK)
+#define I2C_C1_WUEN_MASK     (0x2U)
+#define I2C_C1_WUEN_SHIFT    (1U)
+#define I2C_C1_WUEN(x)       (((uint8_t)(((uint8_t)(x))<<I2C_C1_WUEN_SHIFT))&I2C_C1_WUEN_MASK)
+#define I2C_C1_RSTA_MASK     (0x4U)
+#define I2C_C1_RSTA_SHIFT    (2U)
+#define I2C_C1_RSTA(x)       (((uint8_t)(((uint8_t)(x))<<I2C_C1_RSTA_SHIFT))&I2C_C1_RSTA_MASK)
+#define I2C_C1_TXAK_MASK     (0x8U)
+#define I2C_C1_TXAK_SHIFT    (3U)
+#define I2C_C1_TXAK(x)       (((uint8_t)(((uint8_t)(x))<<I2C_C1_TXAK_SHIFT))&I2C_C1_TXAK_MASK)
+#define I2C_C1_TX_MASK       (0x10U)
+#define I2C_C1_TX_SHIFT      (4U)
+#define I2C_C1_TX(x)         (((uint8_t)(((uint8_t)(x))<<I2C_C1_TX_SHIFT))&I2C_C1_TX_MASK)
+#define I2C_C1_MST_MASK      (0x20U)
+#define I2C_C1_MST_SHIFT     (5U)
+#define I2C_C1_MST(x)        (((uint8_t)(((uint8_t)(x))<<I2C_C1_MST_SHIFT))&I2C_C1_MST_MASK)
+#define I2C_C1_IICIE_MASK    (0x40U)
+#define I2C_C1_IICIE_SHIFT   (6U)
+#define I2C_C1_IICIE(x)      (((uint8_t)(((uint8_t)(x))<<I2C_C1_IICIE_SHIFT))&I2C_C1_IICIE_MASK)
+#define I2C_C1_IICEN_MASK    (0x80U)
+#define I2C_C1_IICEN_SHIFT   (7U)
+#define I2C_C1_IICEN(x)      (((uint8_t)(((uint8_t)(x))<<I2C_C1_IICEN_SHIFT))&I2C_C1_IICEN_MASK)
+#define I2C_S_RXAK_MASK      (0x1U)
+#define I2C_S_RXAK_SHIFT     (0U)
+#define I2C_S_RXAK(x)        (((uint8_t)(((uint8_t)(x))<<I2C_S_RXAK_SHIFT))&I2C_S_RXAK_MASK)
+#define I2C_S_IICIF_MASK     (0x2U)
+#define I2C_S_IICIF_SHIFT    (1U)
+#define I2C_S_IICIF(x)       (((uint8_t)(((uint8_t)(x))<<I2C_S_IICIF_SHIFT))&I2C_S_IICIF_MASK)
+#define I2C_S_SRW_MASK       (0x4U)
+#define I2C_S_SRW_SHIFT      (2U)
+#define I2C_S_SRW(x)         (((uint8_t)(((uint8_t)(x))<<I2C_S_SRW_SHIFT))&I2C_S_SRW_MASK)
+#define I2C_S_RAM_MASK       (0x8U)
+#define I2C_S_RAM_SHIFT      (3U)
+#define I2C_S_RAM(x)         (((uint8_t)(((uint8_t)(x))<<I2C_S_RAM_SHIFT))&I2C_S_RAM_MASK)
+#define I2C_S_ARBL_MASK      (0x10U)
+#define I2C_S_ARBL_SHIFT     (4U)
+#define I2C_S_ARBL(x)        (((uint8_t)(((uint8_t)(x))<<I2C_S_ARBL_SHIFT))&I2C_S_ARBL_MASK)
+#define I2C_S_BUSY_MASK      (0x20U)
+#define I2C_S_BUSY_SHIFT     (5U)
+#define I2C_S_BUSY(x)        (((uint8_t)(((uint8_t)(x))<<I2C_S_BUSY_SHIFT))&I2C_S_BUSY_MASK)
+#define I2C_S_IAAS_MASK      (0x40U)
+#define I2C_S_IAAS_SHIFT     (6U)
+#define I2C_S_IAAS(x)        (((uint8_t)(((uint8_t)(x))<<I2C_S_IAAS_SHIFT))&I2C_S_IAAS_MASK)
+#define I2C_S_TCF_MASK       (0x80U)
+#define I2C_S_TCF_SHIFT      (7U)
+#define I2C_S_TCF(x)         (((uint8_t)(((uint8_t)(x))<<I2C_S_TCF_SHIFT))&I2C_S_TCF_MASK)
+#define I2C_D_DATA_MASK      (0xFFU)
+#define I2C_D_DATA_SHIFT     (0U)
+#define I2C_D_DATA(x)        (((uint8_t)(((uint8_t)(x))<<I2C_D_DATA_SHIFT))&I2C_D_DATA_MASK)
+#define I2C_C2_AD_MASK       (0x7U)
+#define I2C_C2_AD_SHIFT      (0U)
+#define I2C_C2_AD(x)         (((uint8_t)(((uint8_t)(x))<<I2C_C2_AD_SHIFT))&I2C_C2_AD_MASK)
+#define I2C_C2_RMEN_MASK     (0x8U)
+#define I2C_C2_RMEN_SHIFT    (3U)
+#define I2C_C2_RMEN(x)       (((uint8_t)(((uint8_t)(x))<<I2C_C2_RMEN_SHIFT))&I2C_C2_RMEN_MASK)
+#define I2C_C2_SBRC_MASK     (0x10U)
+#define I2C_C2_SBRC_SHIFT    (4U)
+#define I2C_C2_SBRC(x)       (((uint8_t)(((uint8_t)(x))<<I2C_C2_SBRC_SHIFT))&I2C_C2_SBRC_MASK)
+#define I2C_C2_ADEXT_MASK    (0x40U)
+#define I2C_C2_ADEXT_SHIFT   (6U)
+#define I2C_C2_ADEXT(x)      (((uint8_t)(((uint8_t)(x))<<I2C_C2_ADEXT_SHIFT))&I2C_C2_ADEXT_MASK)
+#define I2C_C2_GCAEN_MASK    (0x80U)
+#define I2C_C2_GCAEN_SHIFT   (7U)
+#define I2C_C2_GCAEN(x)      (((uint8_t)(((uint8_t)(x))<<I2C_C2_GCAEN_SHIFT))&I2C_C2_GCAEN_MASK)
+#define I2C_FLT_FLT_MASK     (0xFU)
+#define I2C_FLT_FLT_SHIFT    (0U)
+#define I2C_FLT_FLT(x)       (((uint8_t)(((uint8_t)(x))<<I2C_FLT_FLT_SHIFT))&I2C_FLT_FLT_MASK)
+#define I2C_FLT_STARTF_MASK  (0x10U)
+#define I2C_FLT_STARTF_SHIFT (4U)
+#define I2C_FLT_STARTF(x)    (((uint8_t)(((uint8_t)(x))<<I2C_FLT_STARTF_SHIFT))&I2C_FLT_STARTF_MASK)
+#define I2C_FLT_SSIE_MASK    (0x20U)
+#define I2C_FLT_SSIE_SHIFT   (5U)
+#define I2C_FLT_SSIE(x)      (((uint8_t)(((uint8_t)(x))<<I2C_FLT_SSIE_SHIFT))&I2C_FLT_SSIE_MASK)
+#define I2C_FLT_STOPF_MASK   (0x40U)
+#define I2C_FLT_STOPF_SHIFT  (6U)
+#define I2C_FLT_STOPF(x)     (((uint8_t)(((uint8_t)(x))<<I2C_FLT_STOPF_SHIFT))&I2C_FLT_STOPF_MASK)
+#define I2C_FLT_SHEN_MASK    (0x80U)
+#define I2C_FLT_SHEN_SHIFT   (7U)
+#define I2C_FLT_SHEN(x)      (((uint8_t)(((uint8_t)(x))<<I2C_FLT_SHEN_SHIFT))&I2C_FLT_SHEN_MASK)
+
+namespace USBDM {
+
+/** Interrupt priority (unused) */
+enum NvicPriority {
+   NvicPriority_Normal,
+};
+
+/** Pin polarity (unused) */
+enum Polarity {
+   ActiveLow,
+   ActiveHigh,
+};
+
+constexpr bool MapAllPinsOnStartup = false;
+constexpr bool ForceLockedPins     = false;
+
+template<class Info, int bitNum, Polarity polarity> class GpioTable_T;
+
+class I2c0Info;
+
+/** Access I2C0 register in bus model */
+uint8_t hostI2cRead(unsigned offset);
+
+/** Access I2C0 register in bus model */
+void hostI2cWrite(unsigned offset, uint8_t value);
+
+/** Mask interrupts from bus model */
+void hostEnterCritical();
+
+/** Unmask interrupts from bus model - pending interrupts are taken */
+void hostExitCritical();
+
+/**
+ * Delay in microseconds (advances simulated time)
+ *
+ * @param[in]  usToWait  Microseconds to wait
+ */
+void waitUS(uint32_t usToWait);
+
+/**
+ * Delay in milliseconds (advances simulated time)
+ *
+ * @param[in]  msToWait  Milliseconds to wait
+ */
+void waitMS(uint32_t msToWait);
+
+/**
+ * Critical section.
+ * Interrupts from the bus model are held off while in scope.
+ */
+class CriticalSection {
+public:
+   CriticalSection() {
+      hostEnterCritical();
+   }
+   ~CriticalSection() {
+      hostExitCritical();
+   }
+};
+
+} // End namespace USBDM
+
+/**
+ * I2C register.
+ * Reads and writes are passed to the bus model.
+ */
+class I2cRegister {
+private:
+   const unsigned offset;
+
+public:
+   constexpr I2cRegister(unsigned offset) : offset(offset) {}
+   operator uint8_t() const {
+      return USBDM::hostI2cRead(offset);
+   }
+   I2cRegister &operator=(uint8_t value) {
+      USBDM::hostI2cWrite(offset, value);
+      return *this;
+   }
+   I2cRegister &operator&=(uint8_t value) {
+      return *this = (uint8_t)(*this & value);
+   }
+   I2cRegister &operator|=(uint8_t value) {
+      return *this = (uint8_t)(*this | value);
+   }
+};
+
+/** I2C register layout (KL03) */
+struct I2C_Type {
+   I2cRegister A1   {0x00};
+   I2cRegister F    {0x01};
+   I2cRegister C1   {0x02};
+   I2cRegister S    {0x03};
+   I2cRegister D    {0x04};
+   I2cRegister C2   {0x05};
+   I2cRegister FLT  {0x06};
+   I2cRegister RA   {0x07};
+   I2cRegister SMB  {0x08};
+   I2cRegister A2   {0x09};
+   I2cRegister SLTH {0x0A};
+   I2cRegister SLTL {0x0B};
+   I2cRegister S2   {0x0C};
+};
+
+namespace USBDM {
+
+/** Registers of simulated I2C0 */
+extern I2C_Type hostI2cRegisters;
+
+/**
+ * Pointer to hardware.
+ * All instances refer to the simulated I2C0.
+ */
+template<class T>
+class HardwarePtr {
+public:
+   constexpr HardwarePtr(uint32_t) {}
+   T *operator->() const {
+      return &hostI2cRegisters;
+   }
+};
+
+} // End namespace USBDM
+
+#endif /* I2C_MODEL_USBDM_HOST_H_ */